@@ -239,6 +239,13 @@ static int range_alloc_set(const struct lu_env *env,
 		/* allocate new hiwater range */
 		range_alloc(hiset, space, set_sz);
 
+		/*
+		 * The next hiwater range will be short, get a new super
+		 * sequence from the controller before space runs out.
+		 */
+		if (seq->lss_cli && lu_seq_range_space(space) < set_sz)
+			seq_client_prefetch(seq->lss_cli, SEQ_ALLOC_SUPER);
+
 		/* update ondisk seq with new *space */
 		rc = seq_store_update(env, seq, NULL, seq->lss_need_sync);
 	}
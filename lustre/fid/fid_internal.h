@@ -87,6 +87,11 @@ void fid_server_mod_exit(void);
 int seq_client_alloc_super(struct lu_client_seq *seq,
 			   const struct lu_env *env);
 
+void seq_client_prefetch(struct lu_client_seq *seq, __u32 opc);
+
+void seq_client_drop_slices(struct lu_client_seq *seq);
+void seq_client_wait_update(struct lu_client_seq *seq);
+
 extern struct dentry *seq_debugfs_dir;
 
 extern struct lprocfs_vars seq_client_debugfs_list[];
@@ -51,23 +51,19 @@
 
 struct dentry *seq_debugfs_dir;
 
-static int seq_client_rpc(struct lu_client_seq *seq,
-			  struct lu_seq_range *output, __u32 opc,
-			  const char *opcname)
+static struct ptlrpc_request *seq_client_rpc_prep(struct lu_client_seq *seq,
+						 __u32 opc)
 {
 	struct obd_export     *exp = seq->lcs_exp;
 	struct ptlrpc_request *req;
-	struct lu_seq_range   *out, *in;
+	struct lu_seq_range   *in;
 	__u32                 *op;
-	unsigned int           debug_mask;
-	int                    rc;
-	ENTRY;
 
 	LASSERT(exp != NULL && !IS_ERR(exp));
 	req = ptlrpc_request_alloc_pack(class_exp2cliimp(exp), &RQF_SEQ_QUERY,
 					LUSTRE_MDS_VERSION, SEQ_QUERY);
 	if (!req)
-		RETURN(-ENOMEM);
+		return ERR_PTR(-ENOMEM);
 
 	/* Init operation code */
 	op = req_capsule_client_get(&req->rq_pill, &RMF_SEQ_OPC);
@@ -100,7 +96,6 @@ static int seq_client_rpc(struct lu_client_seq *seq,
 			req->rq_no_resend = 1;
 			req->rq_no_delay = 1;
 		}
-		debug_mask = D_CONSOLE;
 	} else {
 		if (seq->lcs_type == LUSTRE_SEQ_METADATA) {
 			req->rq_reply_portal = MDC_REPLY_PORTAL;
@@ -109,8 +104,6 @@ static int seq_client_rpc(struct lu_client_seq *seq,
 			req->rq_reply_portal = OSC_REPLY_PORTAL;
 			req->rq_request_portal = SEQ_DATA_PORTAL;
 		}
-
-		debug_mask = D_INFO;
 	}
 
 	/* Allow seq client RPC during recovery time. */
@@ -118,33 +111,176 @@ static int seq_client_rpc(struct lu_client_seq *seq,
 
 	ptlrpc_at_set_req_timeout(req);
 
-	rc = ptlrpc_queue_wait(req);
+	return req;
+}
 
-	if (rc)
-		GOTO(out_req, rc);
+static int seq_client_rpc_reply(struct lu_client_seq *seq,
+				struct ptlrpc_request *req,
+				struct lu_seq_range *output, __u32 opc)
+{
+	const char	    *opcname;
+	struct lu_seq_range *out;
 
+	opcname = opc == SEQ_ALLOC_SUPER ? "super" : "meta";
 	out = req_capsule_server_get(&req->rq_pill, &RMF_SEQ_RANGE);
+	if (!out)
+		return -EPROTO;
+
 	*output = *out;
 
 	if (!lu_seq_range_is_sane(output)) {
 		CERROR("%s: Invalid range received from server: "
 		       DRANGE"\n", seq->lcs_name, PRANGE(output));
-		GOTO(out_req, rc = -EINVAL);
+		return -EINVAL;
 	}
 
 	if (lu_seq_range_is_exhausted(output)) {
 		CERROR("%s: Range received from server is exhausted: "
 		       DRANGE"]\n", seq->lcs_name, PRANGE(output));
-		GOTO(out_req, rc = -EINVAL);
+		return -EINVAL;
 	}
 
-	CDEBUG_LIMIT(debug_mask, "%s: Allocated %s-sequence "DRANGE"]\n",
+	CDEBUG_LIMIT(opc == SEQ_ALLOC_SUPER ? D_CONSOLE : D_INFO,
+		     "%s: Allocated %s-sequence "DRANGE"]\n",
 		     seq->lcs_name, opcname, PRANGE(output));
 
-	EXIT;
-out_req:
+	return 0;
+}
+
+/*
+ * Synchronous sequence RPC, the caller stalls until the server replies so
+ * the time it waits is accounted in the allocation statistics.
+ */
+static int seq_client_rpc(struct lu_client_seq *seq,
+			  struct lu_seq_range *output, __u32 opc)
+{
+	struct lu_client_seq_stats *stats = &seq->lcs_stats;
+	struct ptlrpc_request	   *req;
+	ktime_t			    start = ktime_get();
+	__u64			    usec;
+	int			    rc;
+	ENTRY;
+
+	req = seq_client_rpc_prep(seq, opc);
+	if (IS_ERR(req))
+		RETURN(PTR_ERR(req));
+
+	rc = ptlrpc_queue_wait(req);
+	if (rc == 0)
+		rc = seq_client_rpc_reply(seq, req, output, opc);
 	ptlrpc_req_finished(req);
-	return rc;
+
+	usec = ktime_us_delta(ktime_get(), start);
+	spin_lock(&seq->lcs_lock);
+	stats->lcss_stall++;
+	stats->lcss_stall_us += usec;
+	if (usec > stats->lcss_stall_max_us)
+		stats->lcss_stall_max_us = usec;
+	spin_unlock(&seq->lcs_lock);
+
+	RETURN(rc);
+}
+
+struct seq_prefetch_args {
+	struct lu_client_seq	*spa_seq;
+	__u32			 spa_opc;
+	__u32			 spa_flush_gen;
+};
+
+static int seq_client_prefetch_interpret(const struct lu_env *env,
+					 struct ptlrpc_request *req,
+					 void *args, int rc)
+{
+	struct seq_prefetch_args *spa = args;
+	struct lu_client_seq	 *seq = spa->spa_seq;
+	struct lu_seq_range	  range;
+
+	if (rc == 0)
+		rc = seq_client_rpc_reply(seq, req, &range, spa->spa_opc);
+
+	spin_lock(&seq->lcs_lock);
+	if (rc == 0 && spa->spa_flush_gen == seq->lcs_flush_gen)
+		seq->lcs_next = range;
+	else if (rc != 0)
+		seq->lcs_stats.lcss_prefetch_fail++;
+	seq->lcs_prefetching = 0;
+	spin_unlock(&seq->lcs_lock);
+	wake_up_all(&seq->lcs_waitq);
+
+	if (rc != 0)
+		CDEBUG(D_INFO, "%s: Cannot prefetch sequence: rc = %d\n",
+		       seq->lcs_name, rc);
+
+	return 0;
+}
+
+/**
+ * Get the next range of sequences from the server in the background.
+ *
+ * The range is kept in lu_client_seq::lcs_next until lcs_space runs out, so
+ * that threads allocating FIDs at a sequence boundary do not wait for the
+ * server. Nothing is done for a local server, or if a range is already
+ * prefetched.
+ *
+ * \param[in] seq	pointer to the client sequence manager
+ * \param[in] opc	SEQ_ALLOC_META or SEQ_ALLOC_SUPER
+ */
+void seq_client_prefetch(struct lu_client_seq *seq, __u32 opc)
+{
+	struct seq_prefetch_args *spa;
+	struct ptlrpc_request	 *req;
+	__u32			  gen;
+
+	if (seq->lcs_srv || !seq->lcs_exp)
+		return;
+
+	spin_lock(&seq->lcs_lock);
+	if (seq->lcs_prefetching || !lu_seq_range_is_zero(&seq->lcs_next)) {
+		spin_unlock(&seq->lcs_lock);
+		return;
+	}
+	seq->lcs_prefetching = 1;
+	seq->lcs_stats.lcss_prefetch++;
+	gen = seq->lcs_flush_gen;
+	spin_unlock(&seq->lcs_lock);
+
+	req = seq_client_rpc_prep(seq, opc);
+	if (IS_ERR(req)) {
+		spin_lock(&seq->lcs_lock);
+		seq->lcs_stats.lcss_prefetch_fail++;
+		seq->lcs_prefetching = 0;
+		spin_unlock(&seq->lcs_lock);
+		wake_up_all(&seq->lcs_waitq);
+		return;
+	}
+
+	/* a synchronous RPC is sent when needed if this one cannot be */
+	req->rq_no_resend = 1;
+	req->rq_no_delay = 1;
+
+	spa = ptlrpc_req_async_args(spa, req);
+	spa->spa_seq = seq;
+	spa->spa_opc = opc;
+	spa->spa_flush_gen = gen;
+	req->rq_interpret_reply = seq_client_prefetch_interpret;
+	ptlrpcd_add_req(req);
+}
+
+/* Switch lcs_space to the prefetched range, if there is one. */
+static bool seq_client_use_next(struct lu_client_seq *seq)
+{
+	bool used = false;
+
+	spin_lock(&seq->lcs_lock);
+	if (!lu_seq_range_is_zero(&seq->lcs_next)) {
+		seq->lcs_space = seq->lcs_next;
+		lu_seq_range_init(&seq->lcs_next);
+		seq->lcs_stats.lcss_prefetch_hit++;
+		used = true;
+	}
+	spin_unlock(&seq->lcs_lock);
+
+	return used;
 }
 
 /* Request sequence-controller node to allocate new super-sequence. */
@@ -173,8 +309,11 @@ int seq_client_alloc_super(struct lu_client_seq *seq,
 			RETURN(-EINPROGRESS);
 		}
 
-		rc = seq_client_rpc(seq, &seq->lcs_space,
-				    SEQ_ALLOC_SUPER, "super");
+		if (seq_client_use_next(seq))
+			rc = 0;
+		else
+			rc = seq_client_rpc(seq, &seq->lcs_space,
+					    SEQ_ALLOC_SUPER);
 	}
 	mutex_unlock(&seq->lcs_mutex);
 	RETURN(rc);
@@ -196,6 +335,11 @@ static int seq_client_alloc_meta(const struct lu_env *env,
 #endif
 	} else {
 		do {
+			if (seq_client_use_next(seq)) {
+				rc = 0;
+				break;
+			}
+
 			/*
 			 * If meta server return -EINPROGRESS or EAGAIN,
 			 * it means meta server might not be ready to
@@ -203,7 +347,7 @@ static int seq_client_alloc_meta(const struct lu_env *env,
 			 * (MDT0)yet
 			 */
 			rc = seq_client_rpc(seq, &seq->lcs_space,
-					    SEQ_ALLOC_META, "meta");
+					    SEQ_ALLOC_META);
 			if (rc == -EINPROGRESS || rc == -EAGAIN)
 				/*
 				 * MDT0 is not ready, let's wait for 2
@@ -245,6 +389,14 @@ static int seq_client_alloc_seq(const struct lu_env *env,
 	*seqnr = seq->lcs_space.lsr_start;
 	seq->lcs_space.lsr_start += 1;
 
+	spin_lock(&seq->lcs_lock);
+	seq->lcs_stats.lcss_switch++;
+	spin_unlock(&seq->lcs_lock);
+
+	/* get the next range while this sequence is being used */
+	if (lu_seq_range_is_exhausted(&seq->lcs_space))
+		seq_client_prefetch(seq, SEQ_ALLOC_META);
+
 	CDEBUG(D_INFO, "%s: Allocated sequence [%#llx]\n", seq->lcs_name,
 	       *seqnr);
 
@@ -255,6 +407,10 @@ static int seq_fid_alloc_prep(struct lu_client_seq *seq,
 			      wait_queue_entry_t *link)
 {
 	if (seq->lcs_update) {
+		spin_lock(&seq->lcs_lock);
+		seq->lcs_stats.lcss_wait++;
+		spin_unlock(&seq->lcs_lock);
+
 		add_wait_queue(&seq->lcs_waitq, link);
 		set_current_state(TASK_UNINTERRUPTIBLE);
 		mutex_unlock(&seq->lcs_mutex);
@@ -340,9 +496,67 @@ int seq_client_get_seq(const struct lu_env *env,
 }
 EXPORT_SYMBOL(seq_client_get_seq);
 
+/* Allocate the next FID of \a slice, return false if it is used up. */
+static bool seq_slice_alloc_fid(struct lu_seq_slice *slice, struct lu_fid *fid)
+{
+	bool found = false;
+
+	spin_lock(&slice->lsl_lock);
+	if (!fid_is_zero(&slice->lsl_fid) &&
+	    fid_oid(&slice->lsl_fid) < slice->lsl_end) {
+		slice->lsl_fid.f_oid++;
+		*fid = slice->lsl_fid;
+		found = true;
+	}
+	spin_unlock(&slice->lsl_lock);
+
+	return found;
+}
+
+/*
+ * Hand the FIDs from \a fid on of the current sequence to \a slice, \a fid
+ * itself is allocated to the caller. Called with seq::lcs_mutex held.
+ */
+static void seq_slice_fill(struct lu_client_seq *seq,
+			   struct lu_seq_slice *slice,
+			   const struct lu_fid *fid)
+{
+	__u64 end;
+
+	end = min_t(__u64, (__u64)fid_oid(fid) + seq->lcs_slice_width - 1,
+		    seq->lcs_width);
+	seq->lcs_fid.f_oid = end;
+
+	spin_lock(&slice->lsl_lock);
+	slice->lsl_fid = *fid;
+	slice->lsl_end = end;
+	spin_unlock(&slice->lsl_lock);
+}
+
+/* Drop the FIDs left in all slices, e.g. when the sequence is finished. */
+void seq_client_drop_slices(struct lu_client_seq *seq)
+{
+	struct lu_seq_slice *slice;
+	int i;
+
+	if (!seq->lcs_slices)
+		return;
+
+	cfs_percpt_for_each(slice, i, seq->lcs_slices) {
+		spin_lock(&slice->lsl_lock);
+		fid_zero(&slice->lsl_fid);
+		slice->lsl_end = 0;
+		spin_unlock(&slice->lsl_lock);
+	}
+}
+
 /**
  * Allocate new fid on passed client @seq and save it to @fid.
  *
+ * FIDs are taken from the slice of the current CPT first, without taking
+ * seq::lcs_mutex, so the FIDs allocated by different threads are not in
+ * order within a sequence unless seq::lcs_slice_width is 0.
+ *
  * \param[in] env	pointer to the thread context
  * \param[in,out] seq	pointer to the client sequence manager
  * \param[out] fid	to hold the new allocated fid
@@ -355,6 +569,7 @@ EXPORT_SYMBOL(seq_client_get_seq);
 int seq_client_alloc_fid(const struct lu_env *env,
 			 struct lu_client_seq *seq, struct lu_fid *fid)
 {
+	struct lu_seq_slice *slice = NULL;
 	wait_queue_entry_t link;
 	int rc;
 	ENTRY;
@@ -362,20 +577,38 @@ int seq_client_alloc_fid(const struct lu_env *env,
 	LASSERT(seq != NULL);
 	LASSERT(fid != NULL);
 
+	if (seq->lcs_slices && seq->lcs_slice_width > 0) {
+		slice = seq->lcs_slices[cfs_cpt_current(cfs_cpt_tab, 1)];
+		if (!OBD_FAIL_PRECHECK(OBD_FAIL_SEQ_EXHAUST) &&
+		    seq_slice_alloc_fid(slice, fid))
+			GOTO(out, rc = 0);
+	}
+
 	init_waitqueue_entry(&link, current);
 	mutex_lock(&seq->lcs_mutex);
 
-	if (OBD_FAIL_CHECK(OBD_FAIL_SEQ_EXHAUST))
+	if (OBD_FAIL_CHECK(OBD_FAIL_SEQ_EXHAUST)) {
 		seq->lcs_fid.f_oid = seq->lcs_width;
+		seq_client_drop_slices(seq);
+	}
 
 	while (1) {
 		u64 seqnr;
 
 		if (unlikely(!fid_is_zero(&seq->lcs_fid) &&
 			     fid_oid(&seq->lcs_fid) < seq->lcs_width)) {
-			/* Just bump last allocated fid and return to caller. */
-			seq->lcs_fid.f_oid++;
 			rc = 0;
+			/* another thread may have refilled the slice */
+			if (slice && seq_slice_alloc_fid(slice, fid))
+				break;
+
+			/* Just bump last allocated fid and return to caller. */
+			*fid = seq->lcs_fid;
+			fid->f_oid++;
+			if (slice)
+				seq_slice_fill(seq, slice, fid);
+			else
+				seq->lcs_fid = *fid;
 			break;
 		}
 
@@ -399,13 +632,15 @@ int seq_client_alloc_fid(const struct lu_env *env,
 			RETURN(rc);
 		}
 
+		*fid = seq->lcs_fid;
+		if (slice)
+			seq_slice_fill(seq, slice, fid);
 		rc = 1;
 		break;
 	}
 
-	*fid = seq->lcs_fid;
 	mutex_unlock(&seq->lcs_mutex);
-
+out:
 	CDEBUG(D_INFO, "%s: Allocated FID "DFID"\n", seq->lcs_name,  PFID(fid));
 
 	RETURN(rc);
@@ -413,17 +648,14 @@ int seq_client_alloc_fid(const struct lu_env *env,
 EXPORT_SYMBOL(seq_client_alloc_fid);
 
 /*
- * Finish the current sequence due to disconnect.
- * See mdc_import_event()
+ * Wait for the sequence switch in progress, if any, to finish. Called with
+ * seq::lcs_mutex held, which is released while waiting.
  */
-void seq_client_flush(struct lu_client_seq *seq)
+void seq_client_wait_update(struct lu_client_seq *seq)
 {
 	wait_queue_entry_t link;
 
-	LASSERT(seq != NULL);
 	init_waitqueue_entry(&link, current);
-	mutex_lock(&seq->lcs_mutex);
-
 	while (seq->lcs_update) {
 		add_wait_queue(&seq->lcs_waitq, &link);
 		set_current_state(TASK_UNINTERRUPTIBLE);
@@ -435,8 +667,20 @@ void seq_client_flush(struct lu_client_seq *seq)
 		remove_wait_queue(&seq->lcs_waitq, &link);
 		set_current_state(TASK_RUNNING);
 	}
+}
+
+/*
+ * Finish the current sequence due to disconnect.
+ * See mdc_import_event()
+ */
+void seq_client_flush(struct lu_client_seq *seq)
+{
+	LASSERT(seq != NULL);
+	mutex_lock(&seq->lcs_mutex);
+	seq_client_wait_update(seq);
 
 	fid_zero(&seq->lcs_fid);
+	seq_client_drop_slices(seq);
 	/**
 	 * this id shld not be used for seq range allocation.
 	 * set to -1 for dgb check.
@@ -444,6 +688,12 @@ void seq_client_flush(struct lu_client_seq *seq)
 	seq->lcs_space.lsr_index = -1;
 
 	lu_seq_range_init(&seq->lcs_space);
+
+	/* drop the prefetched range, and any prefetch in flight */
+	spin_lock(&seq->lcs_lock);
+	lu_seq_range_init(&seq->lcs_next);
+	seq->lcs_flush_gen++;
+	spin_unlock(&seq->lcs_lock);
 	mutex_unlock(&seq->lcs_mutex);
 }
 EXPORT_SYMBOL(seq_client_flush);
@@ -468,6 +718,14 @@ void seq_client_fini(struct lu_client_seq *seq)
 
 	seq_client_debugfs_fini(seq);
 
+	/* the prefetch RPC interpreter still refers to seq */
+	wait_event_idle(seq->lcs_waitq, !seq->lcs_prefetching);
+
+	if (seq->lcs_slices) {
+		cfs_percpt_free(seq->lcs_slices);
+		seq->lcs_slices = NULL;
+	}
+
 	if (seq->lcs_exp) {
 		class_export_put(seq->lcs_exp);
 		seq->lcs_exp = NULL;
@@ -499,6 +757,20 @@ void seq_client_init(struct lu_client_seq *seq,
 		seq->lcs_width = LUSTRE_DATA_SEQ_MAX_WIDTH;
 
 	init_waitqueue_head(&seq->lcs_waitq);
+	spin_lock_init(&seq->lcs_lock);
+
+	/* FIDs are allocated in order if slices cannot be allocated */
+	seq->lcs_slice_width = LUSTRE_SEQ_SLICE_WIDTH;
+	seq->lcs_slices = cfs_percpt_alloc(cfs_cpt_tab,
+					   sizeof(**seq->lcs_slices));
+	if (seq->lcs_slices) {
+		struct lu_seq_slice *slice;
+		int i;
+
+		cfs_percpt_for_each(slice, i, seq->lcs_slices)
+			spin_lock_init(&slice->lsl_lock);
+	}
+
 	/* Make sure that things are clear before work is started. */
 	seq_client_flush(seq);
 
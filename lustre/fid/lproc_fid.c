@@ -540,6 +540,8 @@ static ssize_t ldebugfs_client_fid_width_seq_write(struct file *file,
 		return rc;
 
 	mutex_lock(&seq->lcs_mutex);
+	/* don't change the width under a sequence switch */
+	seq_client_wait_update(seq);
 	if (seq->lcs_type == LUSTRE_SEQ_DATA)
 		max = LUSTRE_DATA_SEQ_MAX_WIDTH;
 	else
@@ -547,6 +549,8 @@ static ssize_t ldebugfs_client_fid_width_seq_write(struct file *file,
 
 	if (val <= max) {
 		seq->lcs_width = val;
+		/* slices may go past the new width */
+		seq_client_drop_slices(seq);
 
 		CDEBUG(D_INFO, "%s: Sequence size: %llu\n", seq->lcs_name,
 		       seq->lcs_width);
@@ -571,6 +575,85 @@ ldebugfs_client_fid_width_seq_show(struct seq_file *m, void *unused)
 	RETURN(0);
 }
 
+static ssize_t
+ldebugfs_client_fid_slice_width_seq_write(struct file *file,
+					  const char __user *buffer,
+					  size_t count, loff_t *off)
+{
+	struct seq_file *m = file->private_data;
+	struct lu_client_seq *seq = m->private;
+	unsigned int val;
+	int rc;
+
+	ENTRY;
+	rc = kstrtouint_from_user(buffer, count, 0, &val);
+	if (rc)
+		return rc;
+
+	if (val > LUSTRE_METADATA_SEQ_MAX_WIDTH)
+		return -ERANGE;
+
+	mutex_lock(&seq->lcs_mutex);
+	seq_client_wait_update(seq);
+	seq->lcs_slice_width = val;
+	seq_client_drop_slices(seq);
+	mutex_unlock(&seq->lcs_mutex);
+
+	RETURN(count);
+}
+
+static int
+ldebugfs_client_fid_slice_width_seq_show(struct seq_file *m, void *unused)
+{
+	struct lu_client_seq *seq = (struct lu_client_seq *)m->private;
+
+	ENTRY;
+	seq_printf(m, "%u\n", seq->lcs_slice_width);
+
+	RETURN(0);
+}
+
+static ssize_t
+ldebugfs_client_fid_alloc_stats_seq_write(struct file *file,
+					  const char __user *buffer,
+					  size_t count, loff_t *off)
+{
+	struct seq_file *m = file->private_data;
+	struct lu_client_seq *seq = m->private;
+
+	spin_lock(&seq->lcs_lock);
+	memset(&seq->lcs_stats, 0, sizeof(seq->lcs_stats));
+	spin_unlock(&seq->lcs_lock);
+
+	return count;
+}
+
+static int
+ldebugfs_client_fid_alloc_stats_seq_show(struct seq_file *m, void *unused)
+{
+	struct lu_client_seq *seq = (struct lu_client_seq *)m->private;
+	struct lu_client_seq_stats stats;
+
+	spin_lock(&seq->lcs_lock);
+	stats = seq->lcs_stats;
+	spin_unlock(&seq->lcs_lock);
+
+	seq_printf(m, "sequence_switches: %llu\n"
+		   "prefetch_hits: %llu\n"
+		   "prefetches: %llu\n"
+		   "prefetch_failures: %llu\n"
+		   "stalls: %llu\n"
+		   "stall_total_us: %llu\n"
+		   "stall_max_us: %llu\n"
+		   "waits: %llu\n",
+		   stats.lcss_switch, stats.lcss_prefetch_hit,
+		   stats.lcss_prefetch, stats.lcss_prefetch_fail,
+		   stats.lcss_stall, stats.lcss_stall_us,
+		   stats.lcss_stall_max_us, stats.lcss_wait);
+
+	return 0;
+}
+
 static int
 ldebugfs_client_fid_fid_seq_show(struct seq_file *m, void *unused)
 {
@@ -605,6 +688,8 @@ ldebugfs_client_fid_server_seq_show(struct seq_file *m, void *unused)
 
 LDEBUGFS_SEQ_FOPS(ldebugfs_client_fid_space);
 LDEBUGFS_SEQ_FOPS(ldebugfs_client_fid_width);
+LDEBUGFS_SEQ_FOPS(ldebugfs_client_fid_slice_width);
+LDEBUGFS_SEQ_FOPS(ldebugfs_client_fid_alloc_stats);
 LDEBUGFS_SEQ_FOPS_RO(ldebugfs_client_fid_server);
 LDEBUGFS_SEQ_FOPS_RO(ldebugfs_client_fid_fid);
 
@@ -617,5 +702,9 @@ struct lprocfs_vars seq_client_debugfs_list[] = {
 	  .fops	=	&ldebugfs_client_fid_server_fops},
 	{ .name	=	"fid",
 	  .fops	=	&ldebugfs_client_fid_fid_fops	},
+	{ .name	=	"slice_width",
+	  .fops	=	&ldebugfs_client_fid_slice_width_fops	},
+	{ .name	=	"alloc_stats",
+	  .fops	=	&ldebugfs_client_fid_alloc_stats_fops	},
 	{ NULL }
 };
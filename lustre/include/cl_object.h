@@ -1940,7 +1940,12 @@ struct cl_io {
 	 * the read IO will check to-be-read OSCs' status, and make fast-switch
 	 * another mirror if some of the OSTs are not healthy.
 	 */
-			     ci_tried_all_mirrors:1;
+			     ci_tried_all_mirrors:1,
+	/**
+	 * O_DIRECT read or write: all the pages of an iteration are
+	 * submitted at once, so the iteration may cover several stripes.
+	 */
+			     ci_dio:1;
 	/**
 	 * Bypass quota check
 	 */
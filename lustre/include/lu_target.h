@@ -135,6 +135,11 @@ struct tg_grants_data {
 	/* shall we grant space to clients not
 	 * supporting OBD_CONNECT_GRANT_PARAM? */
 	int			 tgd_grant_compat_disable;
+	/* number of bulk write RPCs processed */
+	u64			 tgd_tot_write_rpcs;
+	/* number of bulk write RPCs with cached pages the client had no
+	 * grant for, i.e. sync writes the client fell back to */
+	u64			 tgd_tot_sync_write_rpcs;
 	/* protect all statfs-related counters */
 	spinlock_t		 tgd_osfs_lock;
 	time64_t		 tgd_osfs_age;
@@ -541,6 +546,10 @@ ssize_t tot_granted_show(struct kobject *kobj, struct attribute *attr,
 			 char *buf);
 ssize_t tot_pending_show(struct kobject *kobj, struct attribute *attr,
 			 char *buf);
+ssize_t tot_write_rpcs_show(struct kobject *kobj, struct attribute *attr,
+			    char *buf);
+ssize_t tot_sync_write_rpcs_show(struct kobject *kobj, struct attribute *attr,
+				 char *buf);
 ssize_t grant_compat_disable_show(struct kobject *kobj, struct attribute *attr,
 				  char *buf);
 ssize_t grant_compat_disable_store(struct kobject *kobj,
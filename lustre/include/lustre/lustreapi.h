@@ -363,6 +363,8 @@ struct find_param {
 
 	time_t			 fp_btime;
 	int			 fp_bsign;
+	/* number of threads walking the tree in llapi_find() */
+	unsigned int		 fp_thread_count;
 };
 
 int llapi_ostlist(char *path, struct find_param *param);
@@ -512,8 +514,11 @@ int llapi_changelog_get_fd(void *priv);
 /* Allow records up to endrec to be destroyed; requires registered id. */
 int llapi_changelog_clear(const char *mdtname, const char *idstr,
 			  long long endrec);
+int llapi_changelog_ack(void *priv, const char *idstr, long long endrec);
 extern int llapi_changelog_set_xflags(void *priv,
 				    enum changelog_send_extra_flag extra_flags);
+int llapi_changelog_set_filter(void *priv,
+			       const struct changelog_filter *filter);
 
 /* HSM copytool interface.
  * priv is private state, managed internally by these functions
@@ -1117,6 +1122,34 @@ ssize_t llapi_mirror_copy_many(int fd, __u16 src, __u16 *dst, size_t count);
 int llapi_mirror_copy(int fd, unsigned int src, unsigned int dst,
 		       off_t pos, size_t count);
 
+/**
+ * Progress of llapi_file_copy_data().
+ */
+struct llapi_copy_stats {
+	uint64_t	lcs_size;	/* size of the source file */
+	uint64_t	lcs_copied;	/* bytes copied so far */
+	uint64_t	lcs_skipped;	/* bytes of holes not copied */
+	double		lcs_seconds;	/* time spent copying */
+};
+
+struct llapi_copy_param {
+	/* number of copy threads, 0 means 1 */
+	unsigned int	lcp_threads;
+	/* seconds between two lcp_progress calls */
+	unsigned int	lcp_stats_interval;
+	/* bytes copied at once by a thread, 0 means the stripe size */
+	uint64_t	lcp_seg_size;
+	/* checked on the source fd before each segment, < 0 aborts */
+	int		(*lcp_check)(int fd);
+	void		(*lcp_progress)(const struct llapi_copy_stats *stats,
+					void *data);
+	void		*lcp_data;
+	struct llapi_copy_stats lcp_stats;
+};
+
+int llapi_file_copy_data(int fd_src, int fd_dst,
+			 struct llapi_copy_param *param);
+
 int llapi_heat_get(int fd, struct lu_heat *heat);
 int llapi_heat_set(int fd, __u64 flags);
 int llapi_layout_sanity(struct llapi_layout *layout, bool incomplete, bool flr);
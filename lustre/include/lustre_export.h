@@ -102,6 +102,11 @@ struct tg_export_data {
 	long			ted_grant;    /* in bytes */
 	long			ted_pending;  /* bytes just being written */
 	__u8			ted_pagebits; /* log2 of client page size */
+	/* recent write rate used to predict grant needs, bytes/sec */
+	u64			ted_write_rate;
+	/* bytes written since ted_write_time */
+	u64			ted_write_bytes;
+	time64_t		ted_write_time;
 
 	/**
 	 * File Modification Data (FMD) tracking
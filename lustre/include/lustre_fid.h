@@ -198,7 +198,13 @@ enum {
 	 * This is how many sequences may be in one super-sequence allocated to
 	 * MDTs.
 	 */
-	LUSTRE_SEQ_SUPER_WIDTH = ((1ULL << 30ULL) * LUSTRE_SEQ_META_WIDTH)
+	LUSTRE_SEQ_SUPER_WIDTH = ((1ULL << 30ULL) * LUSTRE_SEQ_META_WIDTH),
+
+	/*
+	 * How many FIDs of the current sequence are handed to a CPU partition
+	 * at once by the client sequence manager.
+	 */
+	LUSTRE_SEQ_SLICE_WIDTH = 0x0000000000000100ULL,
 };
 
 /** special OID for local objects */
@@ -408,6 +414,35 @@ enum lu_mgr_type {
 
 struct lu_server_seq;
 
+/*
+ * Slice of the current sequence owned by a CPU partition, FIDs are allocated
+ * from it without taking lu_client_seq::lcs_mutex.
+ */
+struct lu_seq_slice {
+	spinlock_t		lsl_lock;
+	/* last allocated fid in this slice */
+	struct lu_fid		lsl_fid;
+	/* last oid of this slice */
+	__u32			lsl_end;
+};
+
+/* FID allocation statistics, see seq_client_alloc_fid() */
+struct lu_client_seq_stats {
+	/* sequences switched to */
+	__u64			lcss_switch;
+	/* switches served by a prefetched range */
+	__u64			lcss_prefetch_hit;
+	/* prefetch RPCs sent, and failed */
+	__u64			lcss_prefetch;
+	__u64			lcss_prefetch_fail;
+	/* allocations waiting for a sequence RPC, and the time waited */
+	__u64			lcss_stall;
+	__u64			lcss_stall_us;
+	__u64			lcss_stall_max_us;
+	/* threads waiting for another thread switching sequence */
+	__u64			lcss_wait;
+};
+
 /* Client sequence manager interface. */
 struct lu_client_seq {
         /* Sequence-controller export. */
@@ -448,6 +483,24 @@ struct lu_client_seq {
 	/* wait queue for fid allocation and update indicator */
 	wait_queue_head_t       lcs_waitq;
 	int                     lcs_update;
+
+	/*
+	 * Per-CPT slices of lcs_fid, and how many FIDs a slice takes at once.
+	 * No slices are used if lcs_slice_width is 0, so that FIDs are
+	 * allocated in order.
+	 */
+	struct lu_seq_slice   **lcs_slices;
+	__u32			lcs_slice_width;
+
+	/* protects lcs_next, lcs_prefetching and lcs_stats */
+	spinlock_t		lcs_lock;
+	/* Range prefetched from the server, used once lcs_space runs out */
+	struct lu_seq_range	lcs_next;
+	/* a prefetch RPC is in flight */
+	unsigned int		lcs_prefetching:1;
+	/* bumped by seq_client_flush() to drop in-flight prefetches */
+	__u32			lcs_flush_gen;
+	struct lu_client_seq_stats lcs_stats;
 };
 
 /* server sequence manager interface */
@@ -1459,6 +1459,8 @@ struct ptlrpc_bulk_desc {
 
 	/* encrypted iov, size is either 0 or bd_iov_count. */
 	struct bio_vec *bd_enc_vec;
+	/* CPU partition of the page pool bd_enc_vec pages come from */
+	int bd_enc_cpt;
 	struct bio_vec *bd_vec;
 };
 
@@ -68,6 +68,8 @@ struct nodemap_pde {
  * will be added to the default nodemap
  */
 
+struct lu_idmap_hash;
+
 struct lu_nodemap {
 	/* human readable ID */
 	char			 nm_name[LUSTRE_NODEMAP_NAME_LENGTH + 1];
@@ -98,6 +100,8 @@ struct lu_nodemap {
 	struct rb_root		 nm_fs_to_client_gidmap;
 	/* GID map keyed by remote UID */
 	struct rb_root		 nm_client_to_fs_gidmap;
+	/* copy of the id maps searched without lock, see idmap_hash_search() */
+	struct lu_idmap_hash __rcu *nm_idmap_hash;
 	/* attached client members of this nodemap */
 	struct mutex		 nm_member_list_lock;
 	struct list_head	 nm_member_list;
@@ -111,6 +115,8 @@ struct lu_nodemap {
 
 	/* used when loading/unloading nodemaps */
 	struct list_head	 nm_list;
+	/* nodemaps are freed after lockless lookups are done with them */
+	struct rcu_head		 nm_rcu;
 };
 
 /* Store handles to local MGC storage to save config locally. In future
@@ -176,9 +182,16 @@ struct lu_nodemap *nodemap_get_from_exp(struct obd_export *exp);
 void nodemap_putref(struct lu_nodemap *nodemap);
 
 #ifdef HAVE_SERVER_SUPPORT
+struct nodemap_range_array;
+
 struct nodemap_range_tree {
 	struct interval_node *nmrt_range_interval_root;
 	unsigned int nmrt_range_highest_id;
+	/* number of ranges in the tree */
+	unsigned int nmrt_range_count;
+	/* ranges sorted by start NID for lockless classification, only
+	 * compiled once the config is active, see range_tree_compile() */
+	struct nodemap_range_array __rcu *nmrt_range_array;
 };
 
 struct nodemap_config {
@@ -202,6 +215,9 @@ struct nodemap_config {
 	 * nodemaps
 	 */
 	struct cfs_hash *nmc_nodemap_hash;
+
+	/* config is freed after lockless classifications are done with it */
+	struct rcu_head nmc_rcu;
 };
 
 struct nodemap_config *nodemap_config_alloc(void);
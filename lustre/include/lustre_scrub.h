@@ -46,6 +46,8 @@
 #define SCRUB_MAGIC_V1			0x4C5FD252
 #define SCRUB_CHECKPOINT_INTERVAL	60
 #define SCRUB_WINDOW_SIZE		1024
+/* The max count of partitions scanned by parallel threads. */
+#define SCRUB_PARTS_MAX			15
 
 enum scrub_next_status {
 	/* exit current loop and process next group */
@@ -251,8 +253,17 @@ struct scrub_file {
 	/* Keep the flags after scrub reset. See 'enum scrub_internal_flags' */
 	__u16	sf_internal_flags;
 
-	__u32	sf_reserved_1;
-	__u64	sf_reserved_2[16];
+	/* How many partitions the sf_pos_parts are for, zero if the last
+	 * checkpoint was not taken by a parallel scanning. */
+	__u32	sf_parts;
+
+	/* The sf_pos_last_checkpoint the sf_pos_parts were taken with, they
+	 * are stale if it differs, e.g. an older OSD moved the checkpoint
+	 * without knowing about them. */
+	__u64	sf_pos_parts_checkpoint;
+
+	/* The position for the last checkpoint of each partition. */
+	__u64	sf_pos_parts[SCRUB_PARTS_MAX];
 
 	/* Bitmap for OI files recreated case. */
 	__u8    sf_oi_bitmap[SCRUB_OI_BITMAP_SIZE];
@@ -357,12 +368,24 @@ int lustre_index_register(struct dt_device *dev, const char *devname,
 void lustre_index_backup(const struct lu_env *env, struct dt_device *dev,
 			 const char *devname, struct list_head *head,
 			 spinlock_t *lock, int *guard, bool backup);
+/*
+ * Insert @count records of @keysize + @recsize bytes each, read from the
+ * backup into @buf, into the re-created index @obj. -EOPNOTSUPP means that
+ * nothing was inserted, the records are then inserted one by one.
+ */
+typedef int (*lustre_index_restore_records_t)(const struct lu_env *env,
+					      struct dt_device *dev,
+					      struct dt_object *obj,
+					      char *buf, int count,
+					      __u32 keysize, __u32 recsize);
+
 int lustre_index_restore(const struct lu_env *env, struct dt_device *dev,
 			 const struct lu_fid *parent_fid,
 			 const struct lu_fid *tgt_fid,
 			 const struct lu_fid *bak_fid, const char *name,
 			 struct list_head *head, spinlock_t *lock,
-			 char *buf, int bufsize);
+			 char *buf, int bufsize,
+			 lustre_index_restore_records_t restore_records);
 
 static inline void lustre_fid2lbx(char *buf, const struct lu_fid *fid, int len)
 {
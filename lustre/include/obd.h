@@ -416,6 +416,13 @@ struct lov_obd {
 	struct lov_md_tgt_desc	*lov_mdc_tgts;
 
 	struct kobject		*lov_tgts_kobj;
+
+	/* fan out the sub-IO submission of IOs touching at least this many
+	 * stripes to worker threads, 0 disables */
+	unsigned int		lov_submit_parallel;
+	/* stripes per submit, and most threads submitting them at once */
+	struct obd_histogram	lov_submit_stripes_hist;
+	struct obd_histogram	lov_submit_active_hist;
 };
 
 #define lmv_tgt_desc lu_tgt_desc
@@ -541,6 +541,8 @@ extern char obd_jobid_var[];
 #define OBD_FAIL_SEC_CTX_INIT_CONT_NET   0x1202
 #define OBD_FAIL_SEC_CTX_FINI_NET        0x1203
 #define OBD_FAIL_SEC_CTX_HDL_PAUSE       0x1204
+#define OBD_FAIL_SEC_UPCALL_BATCH        0x1205
+#define OBD_FAIL_SEC_NODEMAP_BENCH       0x1206
 
 #define OBD_FAIL_LLOG                               0x1300
 /* was	OBD_FAIL_LLOG_ORIGIN_CONNECT_NET            0x1301 until 2.4 */
@@ -586,6 +588,7 @@ extern char obd_jobid_var[];
 #define OBD_FAIL_LLITE_PCC_MKWRITE_PAUSE	    0x1413
 #define OBD_FAIL_LLITE_PCC_ATTACH_PAUSE		    0x1414
 #define OBD_FAIL_LLITE_SHORT_COMMIT		    0x1415
+#define OBD_FAIL_LOV_SUBMIT_DELAY		    0x1416
 
 #define OBD_FAIL_FID_INDIR	0x1501
 #define OBD_FAIL_FID_INLMA	0x1502
@@ -650,6 +653,7 @@ extern char obd_jobid_var[];
 #define OBD_FAIL_LARGE_STRIPE		0x1703
 #define OBD_FAIL_OUT_ENOSPC             0x1704
 #define OBD_FAIL_INVALIDATE_UPDATE	0x1705
+#define OBD_FAIL_OUT_BATCH_NET_REP	0x1706
 
 /* MIGRATE */
 #define OBD_FAIL_MIGRATE_ENTRIES		0x1801
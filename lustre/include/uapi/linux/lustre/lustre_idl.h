@@ -848,6 +848,7 @@ struct ptlrpc_body_v2 {
 #define OBD_CONNECT2_ASYNC_DISCARD	0x4000ULL /* support async DoM data discard */
 #define OBD_CONNECT2_ENCRYPT		0x8000ULL /* client-to-disk encrypt */
 #define OBD_CONNECT2_FIDMAP	       0x10000ULL /* FID map */
+#define OBD_CONNECT2_OUT_BATCH	       0x20000ULL /* resend batched OUT RPC */
 /* XXX README XXX:
  * Please DO NOT add flag values here before first ensuring that this same
  * flag value is not in use on some other branch.  Please clear any such
@@ -904,7 +905,8 @@ struct ptlrpc_body_v2 {
 				OBD_CONNECT2_LSOM | \
 				OBD_CONNECT2_ASYNC_DISCARD | \
 				OBD_CONNECT2_PCC | \
-				OBD_CONNECT2_CRUSH)
+				OBD_CONNECT2_CRUSH | \
+				OBD_CONNECT2_OUT_BATCH)
 
 #define OST_CONNECT_SUPPORTED  (OBD_CONNECT_SRVLOCK | OBD_CONNECT_GRANT | \
 				OBD_CONNECT_REQPORTAL | OBD_CONNECT_VERSION | \
@@ -1520,7 +1522,10 @@ struct quota_body {
 	__u64		qb_slv_ver; /* slave index file version */
 	struct lustre_handle	qb_lockh;     /* per-ID lock handle */
 	struct lustre_handle	qb_glb_lockh; /* global lock handle */
-	__u64		qb_padding1[4];
+	__u64		qb_demand;  /* space the slave expects to consume
+				     * before its next pre-acquire
+				     * (kbytes/inodes), 0 if unknown */
+	__u64		qb_padding1[3];
 };
 
 /* When the quota_body is used in the reply of quota global intent
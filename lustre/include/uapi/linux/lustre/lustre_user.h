@@ -2085,6 +2085,27 @@ static inline void changelog_remap_rec(struct changelog_rec *rec,
 			cref_want;
 }
 
+/**
+ * Reader-side changelog filter, installed with OBD_IOC_CHLG_SET_FILTER on an
+ * open changelog device. Records not matching every non-empty criterion are
+ * dropped by the prefetch thread before they are queued and copied to
+ * userspace. The filter saves the copies and the reader wakeups, not the
+ * network transfer.
+ *
+ * Filtering on the MDT is not supported. The client reads the changelog
+ * through the generic llog RPCs, which return whole llog chunks by offset
+ * and index, and the client checks that the record indices in a chunk are
+ * contiguous. A server-side filter would need its own changelog read RPC.
+ */
+struct changelog_filter {
+	/* Bitmask of (1 << CL_*) record types to deliver, 0 means all */
+	__u64		cf_type_mask;
+	/* Only deliver records for this target FID, zero FID means any */
+	struct lu_fid	cf_tfid;
+	/* Only deliver records with this jobid, empty string means any */
+	char		cf_jobid[LUSTRE_JOBID_SIZE];
+};
+
 enum changelog_message_type {
 	CL_RECORD = 10, /* message is a changelog_rec */
 	CL_EOF    = 11, /* at end of current changelog */
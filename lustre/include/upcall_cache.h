@@ -35,6 +35,7 @@
 
 #include <libcfs/libcfs.h>
 #include <uapi/linux/lnet/lnet-types.h>
+#include <lprocfs_status.h>
 
 /** \defgroup ucache ucache
  *
@@ -80,21 +81,27 @@ struct md_identity {
 };
 
 struct upcall_cache_entry {
-	struct list_head	ue_hash;
+	struct hlist_node	ue_hash;
 	uint64_t		ue_key;
 	atomic_t		ue_refcount;
 	int			ue_flags;
 	wait_queue_head_t	ue_waitq;
 	time64_t		ue_acquire_expire;
 	time64_t		ue_expire;
+	ktime_t			ue_acquire_start;	/* for upcall latency */
+	struct rcu_head		ue_rcu;
 	union {
 		struct md_identity	identity;
 	} u;
 };
 
-#define UC_CACHE_HASH_SIZE        (128)
+#define UC_CACHE_HASH_SIZE        (1024)
 #define UC_CACHE_HASH_INDEX(id)   ((id) & (UC_CACHE_HASH_SIZE - 1))
 #define UC_CACHE_UPCALL_MAXPATH   (1024UL)
+/* max number of keys resolved by a single upcall */
+#define UC_CACHE_UPCALL_BATCH_MAX (64)
+/* an entry is refreshed in the background during the last 1/8 of its life */
+#define UC_CACHE_REFRESH_SHIFT    (3)
 
 struct upcall_cache;
 
@@ -110,20 +117,42 @@ struct upcall_cache_ops {
 					    __u64 key, void *args);
 	int             (*do_upcall)(struct upcall_cache *,
 				     struct upcall_cache_entry *);
+	/* optional, resolve several keys with one upcall */
+	int             (*do_batch_upcall)(struct upcall_cache *,
+					   __u64 *keys, int count);
 	int             (*parse_downcall)(struct upcall_cache *,
 					  struct upcall_cache_entry *, void *);
 };
 
+/* each hash chain has its own lock, lookups of valid entries are lockless */
+struct upcall_cache_bucket {
+	spinlock_t		ucb_lock;
+	struct hlist_head	ucb_hash;
+};
+
 struct upcall_cache {
-	struct list_head	uc_hashtable[UC_CACHE_HASH_SIZE];
-	spinlock_t		uc_lock;
+	struct upcall_cache_bucket uc_hashtable[UC_CACHE_HASH_SIZE];
 	struct rw_semaphore	uc_upcall_rwsem;
 
 	char			uc_name[40];		/* for upcall */
 	char			uc_upcall[UC_CACHE_UPCALL_MAXPATH];
 	time64_t		uc_acquire_expire;	/* seconds */
 	time64_t		uc_entry_expire;	/* seconds */
+	time64_t		uc_neg_expire;		/* seconds */
 	struct upcall_cache_ops	*uc_ops;
+
+	/* keys queued while an upcall is being started, they are all
+	 * passed to the next one, see refresh_entry() */
+	spinlock_t		uc_batch_lock;
+	unsigned int		uc_upcall_batch;	/* max keys per upcall */
+	bool			uc_batch_running;
+	int			uc_batch_count;
+	__u64			uc_batch_keys[UC_CACHE_UPCALL_BATCH_MAX];
+	__u64			uc_batch_launch[UC_CACHE_UPCALL_BATCH_MAX];
+
+	/* upcall latency in usec and number of keys per upcall */
+	struct obd_histogram	uc_upcall_hist;
+	struct obd_histogram	uc_batch_hist;
 };
 
 struct upcall_cache_entry *upcall_cache_get_entry(struct upcall_cache *cache,
@@ -145,6 +174,8 @@ static inline void upcall_cache_flush_all(struct upcall_cache *cache)
 }
 
 void upcall_cache_flush_one(struct upcall_cache *cache, __u64 key, void *args);
+int upcall_cache_stats_seq_show(struct upcall_cache *cache, struct seq_file *m);
+void upcall_cache_stats_clear(struct upcall_cache *cache);
 struct upcall_cache *upcall_cache_init(const char *name, const char *upcall,
 				       struct upcall_cache_ops *ops);
 void upcall_cache_cleanup(struct upcall_cache *cache);
@@ -1145,6 +1145,134 @@ static inline bool lfsck_assistant_req_empty(struct lfsck_assistant_data *lad)
 	return empty;
 }
 
+/* Take the first queued request, it is moved to the lad_inflight_list
+ * until handled, so that the checkpoint will not skip it. */
+static struct lfsck_assistant_req *
+lfsck_assistant_req_claim(struct lfsck_assistant_data *lad)
+{
+	struct lfsck_assistant_req *lar = NULL;
+
+	spin_lock(&lad->lad_lock);
+	if (!list_empty(&lad->lad_req_list)) {
+		lar = list_entry(lad->lad_req_list.next,
+				 struct lfsck_assistant_req, lar_list);
+		list_move_tail(&lar->lar_list, &lad->lad_inflight_list);
+	}
+	spin_unlock(&lad->lad_lock);
+
+	return lar;
+}
+
+static void lfsck_assistant_req_done(const struct lu_env *env,
+				     struct lfsck_component *com,
+				     struct lfsck_assistant_req *lar)
+{
+	struct lfsck_instance		*lfsck = com->lc_lfsck;
+	struct lfsck_bookmark		*bk    = &lfsck->li_bookmark_ram;
+	struct lfsck_assistant_data	*lad   = com->lc_data;
+	bool				 wakeup = false;
+	bool				 idle;
+
+	spin_lock(&lad->lad_lock);
+	list_del_init(&lar->lar_list);
+	lad->lad_prefetched--;
+	/* Wake up the main engine thread only when the list is empty or
+	 * half of the prefetched items have been handled to avoid too
+	 * frequent thread schedule. */
+	if (lad->lad_prefetched <= (bk->lb_async_windows / 2))
+		wakeup = true;
+	idle = lfsck_assistant_req_idle(lad);
+	spin_unlock(&lad->lad_lock);
+
+	if (wakeup)
+		wake_up_all(&lfsck->li_thread.t_ctl_waitq);
+	/* The assistant thread may wait for the helpers to drain. */
+	if (idle && atomic_read(&lad->lad_helpers) > 0)
+		wake_up_all(&lad->lad_thread.t_ctl_waitq);
+
+	lad->lad_ops->la_req_fini(env, lar);
+}
+
+static inline bool lfsck_assistant_helper_exit(struct lfsck_assistant_data *lad,
+					       struct ptlrpc_thread *mthread)
+{
+	return lad->lad_helpers_stop || lad->lad_helper_status < 0 ||
+	       test_bit(LAD_EXIT, &lad->lad_flags) ||
+	       !thread_is_running(mthread);
+}
+
+static void lfsck_assistant_helpers_stop(struct lfsck_assistant_data *lad)
+{
+	lad->lad_helpers_stop = true;
+	wake_up_all(&lad->lad_thread.t_ctl_waitq);
+	wait_event_idle(lad->lad_thread.t_ctl_waitq,
+			atomic_read(&lad->lad_helpers) == 0);
+}
+
+/**
+ * The LFSCK assistant helper thread.
+ *
+ * It takes the first-stage requests from the same queue as the assistant
+ * thread and handles them in parallel with it, until the first-stage
+ * scanning is done or the assistant thread exits.
+ *
+ * \param[in] args	pointer to the thread arguments
+ *
+ * \retval		0 for success
+ * \retval		negative error number on failure
+ */
+int lfsck_assistant_helper(void *args)
+{
+	struct lfsck_thread_args	*lta	 = args;
+	struct lu_env			*env	 = &lta->lta_env;
+	struct lfsck_component		*com	 = lta->lta_com;
+	struct lfsck_instance		*lfsck	 = lta->lta_lfsck;
+	struct lfsck_bookmark		*bk	 = &lfsck->li_bookmark_ram;
+	struct lfsck_assistant_data	*lad	 = com->lc_data;
+	struct ptlrpc_thread		*mthread = &lfsck->li_thread;
+	struct ptlrpc_thread		*athread = &lad->lad_thread;
+	struct lfsck_assistant_req	*lar;
+	int				 rc	 = 0;
+	int				 i;
+
+	while (1) {
+		wait_event_idle(athread->t_ctl_waitq,
+				!lfsck_assistant_req_empty(lad) ||
+				lfsck_assistant_helper_exit(lad, mthread));
+
+		if (lfsck_assistant_helper_exit(lad, mthread))
+			break;
+
+		lar = lfsck_assistant_req_claim(lad);
+		if (lar == NULL)
+			continue;
+
+		rc = lad->lad_ops->la_handler_p1(env, com, lar);
+		lfsck_assistant_req_done(env, com, lar);
+		if (rc < 0 && bk->lb_param & LPF_FAILOUT) {
+			spin_lock(&lad->lad_lock);
+			if (lad->lad_helper_status == 0)
+				lad->lad_helper_status = rc;
+			spin_unlock(&lad->lad_lock);
+			wake_up_all(&athread->t_ctl_waitq);
+			break;
+		}
+	}
+
+	spin_lock(&lad->lad_lock);
+	for (i = 0; i < LFSCK_ASSISTANT_THREADS_MAX; i++) {
+		if (lad->lad_helper_tasks[i] == current)
+			lad->lad_helper_tasks[i] = NULL;
+	}
+	spin_unlock(&lad->lad_lock);
+
+	if (atomic_dec_and_test(&lad->lad_helpers))
+		wake_up_all(&athread->t_ctl_waitq);
+	lfsck_thread_args_fini(lta);
+
+	return rc;
+}
+
 /**
  * Query the LFSCK status from the instatnces on remote servers.
  *
@@ -1613,40 +1741,28 @@ int lfsck_assistant_engine(void *args)
 
 	while (1) {
 		while (!list_empty(&lad->lad_req_list)) {
-			bool wakeup = false;
-
 			if (unlikely(test_bit(LAD_EXIT, &lad->lad_flags) ||
 				     !thread_is_running(mthread)))
 				GOTO(cleanup, rc = lad->lad_post_result);
 
-			lar = list_entry(lad->lad_req_list.next,
-					 struct lfsck_assistant_req,
-					 lar_list);
-			/* Only the lfsck_assistant_engine thread itself can
-			 * remove the "lar" from the head of the list, LFSCK
-			 * engine thread only inserts other new "lar" at the
-			 * end of the list. So it is safe to handle current
-			 * "lar" without the spin_lock. */
-			rc = lao->la_handler_p1(env, com, lar);
-			spin_lock(&lad->lad_lock);
-			list_del_init(&lar->lar_list);
-			lad->lad_prefetched--;
-			/* Wake up the main engine thread only when the list
-			 * is empty or half of the prefetched items have been
-			 * handled to avoid too frequent thread schedule. */
-			if (lad->lad_prefetched <= (bk->lb_async_windows / 2))
-				wakeup = true;
-			spin_unlock(&lad->lad_lock);
-			if (wakeup)
-				wake_up_all(&mthread->t_ctl_waitq);
+			if (unlikely(lad->lad_helper_status < 0))
+				GOTO(cleanup, rc = lad->lad_helper_status);
+
+			/* The helper threads, if any, take the requests from
+			 * the same list, it may have been drained by them. */
+			lar = lfsck_assistant_req_claim(lad);
+			if (lar == NULL)
+				break;
 
-			lao->la_req_fini(env, lar);
+			rc = lao->la_handler_p1(env, com, lar);
+			lfsck_assistant_req_done(env, com, lar);
 			if (rc < 0 && bk->lb_param & LPF_FAILOUT)
 				GOTO(cleanup, rc);
 		}
 
 		wait_event_idle(athread->t_ctl_waitq,
 				!lfsck_assistant_req_empty(lad) ||
+				lad->lad_helper_status < 0 ||
 				test_bit(LAD_EXIT, &lad->lad_flags) ||
 				test_bit(LAD_TO_POST, &lad->lad_flags) ||
 				test_bit(LAD_TO_DOUBLE_SCAN, &lad->lad_flags));
@@ -1654,6 +1770,9 @@ int lfsck_assistant_engine(void *args)
 		if (unlikely(test_bit(LAD_EXIT, &lad->lad_flags)))
 			GOTO(cleanup, rc = lad->lad_post_result);
 
+		if (unlikely(lad->lad_helper_status < 0))
+			GOTO(cleanup, rc = lad->lad_helper_status);
+
 		if (!list_empty(&lad->lad_req_list))
 			continue;
 
@@ -1661,9 +1780,16 @@ int lfsck_assistant_engine(void *args)
 			CDEBUG(D_LFSCK, "%s: %s LFSCK assistant thread post\n",
 			       lfsck_lfsck2name(lfsck), lad->lad_name);
 
+			/* All the first-stage requests have been queued, wait
+			 * for the helpers to finish the in-flight ones. */
+			lfsck_assistant_helpers_stop(lad);
+
 			if (unlikely(test_bit(LAD_EXIT, &lad->lad_flags)))
 				GOTO(cleanup, rc = lad->lad_post_result);
 
+			if (unlikely(lad->lad_helper_status < 0))
+				GOTO(cleanup, rc = lad->lad_helper_status);
+
 			clear_bit(LAD_TO_POST, &lad->lad_flags);
 			LASSERT(lad->lad_post_result > 0);
 
@@ -1752,6 +1878,8 @@ p2_next:
 	}
 
 cleanup:
+	lfsck_assistant_helpers_stop(lad);
+
 	/* Cleanup the unfinished requests. */
 	spin_lock(&lad->lad_lock);
 	if (rc < 0)
@@ -734,6 +734,10 @@ struct lfsck_instance {
 	/* Sleep N jiffies for each schedule. */
 	__u32			  li_sleep_jif;
 
+	/* How many threads handle the assistant requests in the first-stage
+	 * scanning, including the assistant thread itself. */
+	unsigned int		  li_assistant_threads;
+
 	/* How many objects have been scanned since last sleep. */
 	__u32			  li_new_scanned;
 
@@ -823,10 +827,16 @@ struct lfsck_assistant_operations {
 				 struct lfsck_request *lr);
 };
 
+#define LFSCK_ASSISTANT_THREADS_MAX	16
+
 struct lfsck_assistant_data {
 	spinlock_t				 lad_lock;
 	struct list_head			 lad_req_list;
 
+	/* The requests being handled, in the order of being taken from the
+	 * lad_req_list, protected by lad_lock. */
+	struct list_head			 lad_inflight_list;
+
 	/* list for the ost targets involve LFSCK. */
 	struct list_head			 lad_ost_list;
 
@@ -859,6 +869,14 @@ struct lfsck_assistant_data {
 	int					 lad_post_result;
 	unsigned long				 lad_flags;
 	bool					 lad_advance_lock;
+
+	/* Whether the first-stage requests can be handled in parallel by
+	 * the assistant helper threads, set by the component. */
+	bool					 lad_parallel;
+	bool					 lad_helpers_stop;
+	atomic_t				 lad_helpers;
+	int					 lad_helper_status;
+	struct task_struct	*lad_helper_tasks[LFSCK_ASSISTANT_THREADS_MAX];
 };
 enum {
 	LAD_TO_POST = 0,
@@ -1008,6 +1026,7 @@ int lfsck_open_dir(const struct lu_env *env,
 		   struct lfsck_instance *lfsck, __u64 cookie);
 int lfsck_master_engine(void *args);
 int lfsck_assistant_engine(void *args);
+int lfsck_assistant_helper(void *args);
 
 /* lfsck_bookmark.c */
 void lfsck_bookmark_cpu_to_le(struct lfsck_bookmark *des,
@@ -1231,6 +1250,29 @@ static void inline lfsck_position_cpu_to_le(struct lfsck_position *des,
 	des->lp_dir_cookie = cpu_to_le64(src->lp_dir_cookie);
 }
 
+/* The oldest request that has not been handled yet. The requests are taken
+ * from lad_req_list in order, so it is either the first in-flight one or the
+ * first queued one. The caller should hold lad_lock. */
+static inline struct lfsck_assistant_req *
+lfsck_assistant_req_first(struct lfsck_assistant_data *lad)
+{
+	if (!list_empty(&lad->lad_inflight_list))
+		return list_entry(lad->lad_inflight_list.next,
+				  struct lfsck_assistant_req, lar_list);
+
+	if (!list_empty(&lad->lad_req_list))
+		return list_entry(lad->lad_req_list.next,
+				  struct lfsck_assistant_req, lar_list);
+
+	return NULL;
+}
+
+static inline bool lfsck_assistant_req_idle(struct lfsck_assistant_data *lad)
+{
+	return list_empty(&lad->lad_req_list) &&
+	       list_empty(&lad->lad_inflight_list);
+}
+
 static inline umode_t lfsck_object_type(const struct dt_object *obj)
 {
 	return lu_object_attr(&obj->do_lu);
@@ -5572,9 +5572,9 @@ static int lfsck_layout_scan_stripes(const struct lu_env *env,
 			RETURN(lad->lad_assistant_status);
 		}
 
-		list_add_tail(&llr->llr_lar.lar_list, &lad->lad_req_list);
-		if (lad->lad_prefetched == 0)
+		if (list_empty(&lad->lad_req_list))
 			wakeup = true;
+		list_add_tail(&llr->llr_lar.lar_list, &lad->lad_req_list);
 
 		lad->lad_prefetched++;
 		spin_unlock(&lad->lad_lock);
@@ -6847,19 +6847,17 @@ static void lfsck_layout_assistant_fill_pos(const struct lu_env *env,
 					    struct lfsck_position *pos)
 {
 	struct lfsck_assistant_data	*lad = com->lc_data;
-	struct lfsck_layout_req		*llr;
+	struct lfsck_assistant_req	*lar;
 
 	if (((struct lfsck_layout *)(com->lc_file_ram))->ll_status !=
 	    LS_SCANNING_PHASE1)
 		return;
 
-	if (list_empty(&lad->lad_req_list))
+	lar = lfsck_assistant_req_first(lad);
+	if (lar == NULL)
 		return;
 
-	llr = list_entry(lad->lad_req_list.next,
-			 struct lfsck_layout_req,
-			 llr_lar.lar_list);
-	pos->lp_oit_cookie = llr->llr_lar.lar_parent->lso_oit_cookie - 1;
+	pos->lp_oit_cookie = lar->lar_parent->lso_oit_cookie - 1;
 }
 
 struct lfsck_assistant_operations lfsck_layout_assistant_ops = {
@@ -6892,13 +6890,19 @@ int lfsck_layout_setup(const struct lu_env *env, struct lfsck_instance *lfsck)
 	com->lc_lfsck = lfsck;
 	com->lc_type = LFSCK_TYPE_LAYOUT;
 	if (lfsck->li_master) {
+		struct lfsck_assistant_data *lad;
+
 		com->lc_ops = &lfsck_layout_master_ops;
-		com->lc_data = lfsck_assistant_data_init(
-				&lfsck_layout_assistant_ops,
-				LFSCK_LAYOUT);
-		if (com->lc_data == NULL)
+		lad = lfsck_assistant_data_init(&lfsck_layout_assistant_ops,
+						LFSCK_LAYOUT);
+		if (lad == NULL)
 			GOTO(out, rc = -ENOMEM);
 
+		/* Each first-stage request verifies one OST-object against
+		 * its parent independently, they can be handled in parallel. */
+		lad->lad_parallel = true;
+		com->lc_data = lad;
+
 		for (i = 0; i < LFSCK_STF_COUNT; i++)
 			mutex_init(&com->lc_sub_trace_objs[i].lsto_mutex);
 	} else {
@@ -1629,6 +1629,8 @@ static int lfsck_fid_init(struct lfsck_instance *lfsck)
 			     ss->ss_server_seq);
 	OBD_FREE(prefix, MAX_OBD_NAME + 7);
 
+	/* lb_last_fid is only the last allocated FID if they are in order */
+	lfsck->li_seq->lcs_slice_width = 0;
 	if (fid_is_sane(&bk->lb_last_fid))
 		lfsck->li_seq->lcs_fid = bk->lb_last_fid;
 
@@ -1971,6 +1973,7 @@ lfsck_assistant_data_init(struct lfsck_assistant_operations *lao,
 		}
 
 		INIT_LIST_HEAD(&lad->lad_req_list);
+		INIT_LIST_HEAD(&lad->lad_inflight_list);
 		spin_lock_init(&lad->lad_lock);
 		INIT_LIST_HEAD(&lad->lad_ost_list);
 		INIT_LIST_HEAD(&lad->lad_ost_phase1_list);
@@ -1979,6 +1982,7 @@ lfsck_assistant_data_init(struct lfsck_assistant_operations *lao,
 		INIT_LIST_HEAD(&lad->lad_mdt_phase1_list);
 		INIT_LIST_HEAD(&lad->lad_mdt_phase2_list);
 		init_waitqueue_head(&lad->lad_thread.t_ctl_waitq);
+		atomic_set(&lad->lad_helpers, 0);
 		lad->lad_ops = lao;
 		lad->lad_name = name;
 	}
@@ -2518,6 +2522,59 @@ again:
 	RETURN(rc);
 }
 
+/* Start the helper threads to handle the first-stage requests of the
+ * component together with its assistant thread. It is not fatal if some
+ * helper fails to start, the assistant thread can handle all of them. */
+static void lfsck_start_assistant_helpers(struct lfsck_component *com)
+{
+	struct lfsck_instance		*lfsck = com->lc_lfsck;
+	struct lfsck_assistant_data	*lad   = com->lc_data;
+	struct lfsck_thread_args	*lta;
+	struct task_struct		*task;
+	unsigned int			 i;
+
+	if (!lad->lad_parallel)
+		return;
+
+	for (i = 1; i < lfsck->li_assistant_threads; i++) {
+		lta = lfsck_thread_args_init(lfsck, com, NULL);
+		if (IS_ERR(lta))
+			break;
+
+		task = kthread_create(lfsck_assistant_helper, lta, "%s_%u",
+				      lad->lad_name, i);
+		if (IS_ERR(task)) {
+			CDEBUG(D_LFSCK, "%s: cannot start LFSCK assistant "
+			       "helper %u for %s: rc = %ld\n",
+			       lfsck_lfsck2name(lfsck), i, lad->lad_name,
+			       PTR_ERR(task));
+			lfsck_thread_args_fini(lta);
+			break;
+		}
+
+		/* register before running, it unregisters itself at exit */
+		spin_lock(&lad->lad_lock);
+		lad->lad_helper_tasks[i] = task;
+		spin_unlock(&lad->lad_lock);
+		atomic_inc(&lad->lad_helpers);
+		wake_up_process(task);
+	}
+}
+
+static void lfsck_assistant_interrupt(struct lfsck_assistant_data *lad)
+{
+	int i;
+
+	spin_lock(&lad->lad_lock);
+	if (lad->lad_task != NULL)
+		cfs_force_sig(SIGINT, lad->lad_task);
+	for (i = 0; i < LFSCK_ASSISTANT_THREADS_MAX; i++) {
+		if (lad->lad_helper_tasks[i] != NULL)
+			cfs_force_sig(SIGINT, lad->lad_helper_tasks[i]);
+	}
+	spin_unlock(&lad->lad_lock);
+}
+
 int lfsck_start_assistant(const struct lu_env *env, struct lfsck_component *com,
 			  struct lfsck_start_param *lsp)
 {
@@ -2534,6 +2591,8 @@ int lfsck_start_assistant(const struct lu_env *env, struct lfsck_component *com,
 	lad->lad_post_result = 0;
 	lad->lad_flags = 0;
 	lad->lad_advance_lock = false;
+	lad->lad_helpers_stop = false;
+	lad->lad_helper_status = 0;
 	thread_set_flags(athread, 0);
 
 	lta = lfsck_thread_args_init(lfsck, com, lsp);
@@ -2560,6 +2619,9 @@ int lfsck_start_assistant(const struct lu_env *env, struct lfsck_component *com,
 			rc = 0;
 	}
 
+	if (rc == 0)
+		lfsck_start_assistant_helpers(com);
+
 	RETURN(rc);
 }
 
@@ -2571,7 +2633,7 @@ int lfsck_checkpoint_generic(const struct lu_env *env,
 	struct ptlrpc_thread		*athread = &lad->lad_thread;
 
 	wait_event_idle(mthread->t_ctl_waitq,
-			list_empty(&lad->lad_req_list) ||
+			lfsck_assistant_req_idle(lad) ||
 			!thread_is_running(mthread) ||
 			thread_is_stopped(athread));
 
@@ -2598,7 +2660,7 @@ void lfsck_post_generic(const struct lu_env *env,
 
 	wake_up_all(&athread->t_ctl_waitq);
 	wait_event_idle(mthread->t_ctl_waitq,
-			(*result > 0 && list_empty(&lad->lad_req_list)) ||
+			(*result > 0 && lfsck_assistant_req_idle(lad)) ||
 			thread_is_stopped(athread));
 
 	if (lad->lad_assistant_status < 0)
@@ -2869,6 +2931,60 @@ int lfsck_set_windows(struct dt_device *key, unsigned int val)
 }
 EXPORT_SYMBOL(lfsck_set_windows);
 
+int lfsck_get_assistant_threads(char *buf, struct dt_device *key)
+{
+	struct lu_env		env;
+	struct lfsck_instance  *lfsck;
+	int			rc;
+	ENTRY;
+
+	rc = lu_env_init(&env, LCT_MD_THREAD | LCT_DT_THREAD);
+	if (rc != 0)
+		RETURN(rc);
+
+	lfsck = lfsck_instance_find(key, true, false);
+	if (likely(lfsck != NULL)) {
+		rc = sprintf(buf, "%u\n", lfsck->li_assistant_threads);
+		lfsck_instance_put(&env, lfsck);
+	} else {
+		rc = -ENXIO;
+	}
+
+	lu_env_fini(&env);
+
+	RETURN(rc);
+}
+EXPORT_SYMBOL(lfsck_get_assistant_threads);
+
+int lfsck_set_assistant_threads(struct dt_device *key, unsigned int val)
+{
+	struct lu_env		env;
+	struct lfsck_instance  *lfsck;
+	int			rc;
+	ENTRY;
+
+	if (val < 1 || val > LFSCK_ASSISTANT_THREADS_MAX)
+		RETURN(-ERANGE);
+
+	rc = lu_env_init(&env, LCT_MD_THREAD | LCT_DT_THREAD);
+	if (rc != 0)
+		RETURN(rc);
+
+	lfsck = lfsck_instance_find(key, true, false);
+	if (likely(lfsck != NULL)) {
+		/* take effect since the next LFSCK run */
+		lfsck->li_assistant_threads = val;
+		lfsck_instance_put(&env, lfsck);
+	} else {
+		rc = -ENXIO;
+	}
+
+	lu_env_fini(&env);
+
+	RETURN(rc);
+}
+EXPORT_SYMBOL(lfsck_set_assistant_threads);
+
 int lfsck_dump(struct seq_file *m, struct dt_device *key, enum lfsck_type type)
 {
 	struct lu_env		env;
@@ -3419,18 +3535,12 @@ int lfsck_stop(const struct lu_env *env, struct dt_device *key,
 
 		list_for_each_entry(com, &lfsck->li_list_scan, lc_link) {
 			lad = com->lc_data;
-			spin_lock(&lad->lad_lock);
-			if (lad->lad_task != NULL)
-				cfs_force_sig(SIGINT, lad->lad_task);
-			spin_unlock(&lad->lad_lock);
+			lfsck_assistant_interrupt(lad);
 		}
 
 		list_for_each_entry(com, &lfsck->li_list_double_scan, lc_link) {
 			lad = com->lc_data;
-			spin_lock(&lad->lad_lock);
-			if (lad->lad_task != NULL)
-				cfs_force_sig(SIGINT, lad->lad_task);
-			spin_unlock(&lad->lad_lock);
+			lfsck_assistant_interrupt(lad);
 		}
 	}
 
@@ -3688,6 +3798,7 @@ int lfsck_register(const struct lu_env *env, struct dt_device *key,
 	lfsck->li_next = next;
 	lfsck->li_bottom = key;
 	lfsck->li_obd = obd;
+	lfsck->li_assistant_threads = 1;
 
 	rc = lfsck_tgt_descs_init(&lfsck->li_ost_descs);
 	if (rc != 0)
@@ -4350,9 +4350,9 @@ static void lfsck_namespace_close_dir(const struct lu_env *env,
 		RETURN_EXIT;
 	}
 
-	list_add_tail(&lnr->lnr_lar.lar_list, &lad->lad_req_list);
-	if (lad->lad_prefetched == 0)
+	if (list_empty(&lad->lad_req_list))
 		wakeup = true;
+	list_add_tail(&lnr->lnr_lar.lar_list, &lad->lad_req_list);
 
 	lad->lad_prefetched++;
 	spin_unlock(&lad->lad_lock);
@@ -4695,9 +4695,9 @@ static int lfsck_namespace_exec_dir(const struct lu_env *env,
 		return lad->lad_assistant_status;
 	}
 
-	list_add_tail(&lnr->lnr_lar.lar_list, &lad->lad_req_list);
-	if (lad->lad_prefetched == 0)
+	if (list_empty(&lad->lad_req_list))
 		wakeup = true;
+	list_add_tail(&lnr->lnr_lar.lar_list, &lad->lad_req_list);
 
 	lad->lad_prefetched++;
 	spin_unlock(&lad->lad_lock);
@@ -6679,18 +6679,18 @@ static void lfsck_namespace_assistant_fill_pos(const struct lu_env *env,
 					       struct lfsck_position *pos)
 {
 	struct lfsck_assistant_data	*lad = com->lc_data;
+	struct lfsck_assistant_req	*lar;
 	struct lfsck_namespace_req	*lnr;
 
 	if (((struct lfsck_namespace *)(com->lc_file_ram))->ln_status !=
 	    LS_SCANNING_PHASE1)
 		return;
 
-	if (list_empty(&lad->lad_req_list))
+	lar = lfsck_assistant_req_first(lad);
+	if (lar == NULL)
 		return;
 
-	lnr = list_entry(lad->lad_req_list.next,
-			 struct lfsck_namespace_req,
-			 lnr_lar.lar_list);
+	lnr = container_of(lar, struct lfsck_namespace_req, lnr_lar);
 	pos->lp_oit_cookie = lnr->lnr_lar.lar_parent->lso_oit_cookie;
 	pos->lp_dir_cookie = lnr->lnr_dir_cookie - 1;
 	pos->lp_dir_parent = lnr->lnr_lar.lar_parent->lso_fid;
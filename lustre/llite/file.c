@@ -1427,6 +1427,7 @@ void ll_io_init(struct cl_io *io, struct file *file, enum cl_io_type iot,
 	}
 	io->ci_noatime = file_is_noatime(file);
 	io->ci_async_readahead = false;
+	io->ci_dio = !!(file->f_flags & O_DIRECT);
 
 	/* FLR: only use non-delay I/O for read as there is only one
 	 * avaliable mirror for write. */
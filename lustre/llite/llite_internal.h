@@ -113,6 +113,8 @@ struct ll_trunc_sem {
 	atomic_t	ll_trunc_waiters;
 };
 
+struct ll_xattr_cache;
+
 struct ll_inode_info {
 	__u32				lli_inode_magic;
 	spinlock_t			lli_lock;
@@ -259,7 +261,8 @@ struct ll_inode_info {
 
 	struct rw_semaphore		lli_xattrs_list_rwsem;
 	struct mutex			lli_xattrs_enq_lock;
-	struct list_head		lli_xattrs; /* ll_xattr_entry->xe_list */
+	/* packed xattr cache, see xattr_cache.c */
+	struct ll_xattr_cache __rcu	*lli_xattrs;
 };
 
 static inline void ll_trunc_sem_init(struct ll_trunc_sem *sem)
@@ -366,8 +369,6 @@ enum ll_file_flags {
 	LLIF_DATA_MODIFIED      = 0,
 	/* File is being restored */
 	LLIF_FILE_RESTORING	= 1,
-	/* Xattr cache is attached to the file */
-	LLIF_XATTR_CACHE	= 2,
 	/* Project inherit */
 	LLIF_PROJECT_INHERIT	= 3,
 	/* update atime from MDS even if it's older than local inode atime. */
@@ -708,6 +709,9 @@ struct ll_sb_info {
 	unsigned int		  ll_heat_decay_weight;
 	unsigned int		  ll_heat_period_second;
 
+	/* direct IO is submitted in windows of this size, 0 disables */
+	unsigned int		  ll_dio_submit_mb;
+
 	/* filesystem fsname */
 	char			  ll_fsname[LUSTRE_MAXFSNAME + 1];
 
@@ -717,6 +721,7 @@ struct ll_sb_info {
 
 #define SBI_DEFAULT_HEAT_DECAY_WEIGHT	((80 * 256 + 50) / 100)
 #define SBI_DEFAULT_HEAT_PERIOD_SECOND	(60)
+#define SBI_DEFAULT_DIO_SUBMIT_MB	4
 /*
  * per file-descriptor read-ahead data.
  */
@@ -931,6 +936,7 @@ enum {
 	LPROC_LL_SETXATTR,
 	LPROC_LL_GETXATTR,
 	LPROC_LL_GETXATTR_HITS,
+	LPROC_LL_GETXATTR_NEG_HITS,
 	LPROC_LL_LISTXATTR,
 	LPROC_LL_REMOVEXATTR,
 	LPROC_LL_INODE_PERM,
@@ -1608,9 +1614,6 @@ int ll_layout_restore(struct inode *inode, loff_t start, __u64 length);
 int ll_layout_write_intent(struct inode *inode, enum layout_intent_opc opc,
 			   struct lu_extent *ext);
 
-int ll_xattr_init(void);
-void ll_xattr_fini(void);
-
 int ll_page_sync_io(const struct lu_env *env, struct cl_io *io,
 		    struct cl_page *page, enum cl_req_type crt);
 
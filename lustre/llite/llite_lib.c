@@ -176,6 +176,8 @@ static struct ll_sb_info *ll_init_sbi(void)
 	/* Per-filesystem file heat */
 	sbi->ll_heat_decay_weight = SBI_DEFAULT_HEAT_DECAY_WEIGHT;
 	sbi->ll_heat_period_second = SBI_DEFAULT_HEAT_PERIOD_SECOND;
+
+	sbi->ll_dio_submit_mb = SBI_DEFAULT_DIO_SUBMIT_MB;
 	RETURN(sbi);
 out_destroy_ra:
 	destroy_workqueue(sbi->ll_ra_info.ll_readahead_wq);
@@ -979,6 +981,7 @@ void ll_lli_init(struct ll_inode_info *lli)
 	lli->lli_clob = NULL;
 
 	init_rwsem(&lli->lli_xattrs_list_rwsem);
+	RCU_INIT_POINTER(lli->lli_xattrs, NULL);
 	mutex_init(&lli->lli_xattrs_enq_lock);
 
 	LASSERT(lli->lli_vfs_inode.i_mode != 0);
@@ -1626,7 +1629,10 @@ void ll_clear_inode(struct inode *inode)
 
 	if (S_ISDIR(inode->i_mode))
 		ll_dir_clear_lsm_md(inode);
-	else if (S_ISREG(inode->i_mode) && !is_bad_inode(inode))
+	else
+		range_lock_tree_fini(&lli->lli_write_tree);
+
+	if (S_ISREG(inode->i_mode) && !is_bad_inode(inode))
 		LASSERT(list_empty(&lli->lli_agl_list));
 
 	/*
@@ -36,9 +36,27 @@
 #ifdef HAVE_SCHED_HEADERS
 #include <linux/sched/signal.h>
 #endif
+#include <obd_support.h>
 #include "range_lock.h"
 #include <uapi/linux/lustre/lustre_user.h>
 
+/**
+ * Initialize a range lock tree with a given number of shards
+ *
+ * \param tree    [in]	an empty range lock tree
+ * \param nshards [in]	number of shards the file regions are spread over
+ *
+ * Pre:  Caller should have allocated the range lock tree.
+ * Post: The range lock tree is ready to function, the shards are allocated
+ *	 by the first range_lock().
+ */
+void range_lock_tree_init_shards(struct range_lock_tree *tree,
+				 unsigned int nshards)
+{
+	tree->rlt_shards = NULL;
+	tree->rlt_nshards = max(nshards, 1U);
+}
+
 /**
  * Initialize a range lock tree
  *
@@ -49,9 +67,54 @@
  */
 void range_lock_tree_init(struct range_lock_tree *tree)
 {
-	tree->rlt_root = NULL;
-	tree->rlt_sequence = 0;
-	spin_lock_init(&tree->rlt_lock);
+	range_lock_tree_init_shards(tree, RL_SHARDS_DEFAULT);
+}
+
+/**
+ * Release the shards of a range lock tree
+ *
+ * \param tree [in]	range lock tree without any lock queued
+ */
+void range_lock_tree_fini(struct range_lock_tree *tree)
+{
+	unsigned int i;
+
+	if (tree->rlt_shards == NULL)
+		return;
+
+	for (i = 0; i < tree->rlt_nshards; i++)
+		LASSERT(tree->rlt_shards[i].rls_root == NULL);
+
+	OBD_FREE_PTR_ARRAY(tree->rlt_shards, tree->rlt_nshards);
+	tree->rlt_shards = NULL;
+}
+
+static struct range_lock_shard *
+range_lock_shards_get(struct range_lock_tree *tree)
+{
+	struct range_lock_shard *shards = READ_ONCE(tree->rlt_shards);
+	unsigned int i;
+
+	if (likely(shards != NULL))
+		return shards;
+
+	OBD_ALLOC_PTR_ARRAY(shards, tree->rlt_nshards);
+	if (shards == NULL)
+		return NULL;
+
+	for (i = 0; i < tree->rlt_nshards; i++) {
+		shards[i].rls_root = NULL;
+		shards[i].rls_sequence = 0;
+		spin_lock_init(&shards[i].rls_lock);
+	}
+
+	/* lost the race against another locker of this file */
+	if (cmpxchg(&tree->rlt_shards, NULL, shards) != NULL) {
+		OBD_FREE_PTR_ARRAY(shards, tree->rlt_nshards);
+		shards = tree->rlt_shards;
+	}
+
+	return shards;
 }
 
 /**
@@ -80,6 +143,9 @@ int range_lock_init(struct range_lock *lock, __u64 start, __u64 end)
 	lock->rl_lock_count = 0;
 	lock->rl_blocking_ranges = 0;
 	lock->rl_sequence = 0;
+	lock->rl_shard = 0;
+	lock->rl_sub_count = 0;
+	lock->rl_subs = NULL;
 	return rc;
 }
 
@@ -121,20 +187,12 @@ static enum interval_iter range_unlock_cb(struct interval_node *node, void *arg)
 }
 
 /**
- * Unlock a range lock, wake up locks blocked by this lock.
- *
- * \param tree [in]	range lock tree
- * \param lock [in]	range lock to be deleted
- *
- * If this lock has been granted, relase it; if not, just delete it from
- * the tree or the same region lock list. Wake up those locks only blocked
- * by this lock through range_unlock_cb().
+ * Remove a lock node from one shard, wake up locks blocked by it only.
  */
-void range_unlock(struct range_lock_tree *tree, struct range_lock *lock)
+static void range_unlock_shard(struct range_lock_shard *shard,
+			       struct range_lock *lock)
 {
-	ENTRY;
-
-	spin_lock(&tree->rlt_lock);
+	spin_lock(&shard->rls_lock);
 	if (!list_empty(&lock->rl_next_lock)) {
 		struct range_lock *next;
 
@@ -142,8 +200,8 @@ void range_unlock(struct range_lock_tree *tree, struct range_lock *lock)
 			/* Insert the next same range lock into the tree */
 			next = next_lock(lock);
 			next->rl_lock_count = lock->rl_lock_count - 1;
-			interval_erase(&lock->rl_node, &tree->rlt_root);
-			interval_insert(&next->rl_node, &tree->rlt_root);
+			interval_erase(&lock->rl_node, &shard->rls_root);
+			interval_insert(&next->rl_node, &shard->rls_root);
 		} else {
 			/* find the first lock in tree */
 			list_for_each_entry(next, &lock->rl_next_lock,
@@ -159,12 +217,56 @@ void range_unlock(struct range_lock_tree *tree, struct range_lock *lock)
 		list_del_init(&lock->rl_next_lock);
 	} else {
 		LASSERT(interval_is_intree(&lock->rl_node));
-		interval_erase(&lock->rl_node, &tree->rlt_root);
+		interval_erase(&lock->rl_node, &shard->rls_root);
 	}
 
-	interval_search(tree->rlt_root, &lock->rl_node.in_extent,
+	interval_search(shard->rls_root, &lock->rl_node.in_extent,
 			range_unlock_cb, lock);
-	spin_unlock(&tree->rlt_lock);
+	spin_unlock(&shard->rls_lock);
+}
+
+static inline struct range_lock *range_lock_sub(struct range_lock *lock,
+						unsigned int i)
+{
+	return i == 0 ? lock : &lock->rl_subs[i - 1];
+}
+
+/**
+ * Unlock the first \a count lock nodes of a range lock, in reverse order
+ * of their acquisition, and release the nodes of the other shards.
+ */
+static void range_unlock_shards(struct range_lock_tree *tree,
+				struct range_lock *lock, unsigned int count)
+{
+	struct range_lock *sub;
+
+	while (count-- > 0) {
+		sub = range_lock_sub(lock, count);
+		range_unlock_shard(&tree->rlt_shards[sub->rl_shard], sub);
+	}
+
+	if (lock->rl_subs != NULL) {
+		OBD_FREE_PTR_ARRAY(lock->rl_subs, lock->rl_sub_count);
+		lock->rl_subs = NULL;
+		lock->rl_sub_count = 0;
+	}
+}
+
+/**
+ * Unlock a range lock, wake up locks blocked by this lock.
+ *
+ * \param tree [in]	range lock tree
+ * \param lock [in]	range lock to be deleted
+ *
+ * If this lock has been granted, relase it; if not, just delete it from
+ * the tree or the same region lock list. Wake up those locks only blocked
+ * by this lock through range_unlock_cb().
+ */
+void range_unlock(struct range_lock_tree *tree, struct range_lock *lock)
+{
+	ENTRY;
+
+	range_unlock_shards(tree, lock, lock->rl_sub_count + 1);
 
 	EXIT;
 }
@@ -190,58 +292,162 @@ static enum interval_iter range_lock_cb(struct interval_node *node, void *arg)
 }
 
 /**
- * Lock a region
+ * Queue a lock node in one shard and wait until all the conflicting locks
+ * queued before it in this shard are released.
  *
- * \param tree [in]	range lock tree
- * \param lock [in]	range lock node containing the region span
- *
- * \retval 0	get the range lock
- * \retval <0	error code while not getting the range lock
- *
- * If there exists overlapping range lock, the new lock will wait and
- * retry, if later it find that it is not the chosen one to wake up,
- * it wait again.
+ * \retval 0		lock node granted
+ * \retval -ERESTARTSYS	interrupted, the node has been removed again
  */
-int range_lock(struct range_lock_tree *tree, struct range_lock *lock)
+static int range_lock_shard(struct range_lock_shard *shard,
+			    struct range_lock *lock)
 {
 	struct interval_node *node;
-	int rc = 0;
-	ENTRY;
 
-	spin_lock(&tree->rlt_lock);
+	spin_lock(&shard->rls_lock);
 	/*
 	 * We need to check for all conflicting intervals
 	 * already in the tree.
 	 */
-	interval_search(tree->rlt_root, &lock->rl_node.in_extent,
+	interval_search(shard->rls_root, &lock->rl_node.in_extent,
 			range_lock_cb, lock);
 	/*
 	 * Insert to the tree if I am unique, otherwise I've been linked to
 	 * the rl_next_lock of another lock which has the same range as mine
 	 * in range_lock_cb().
 	 */
-	node = interval_insert(&lock->rl_node, &tree->rlt_root);
+	node = interval_insert(&lock->rl_node, &shard->rls_root);
 	if (node != NULL) {
 		struct range_lock *tmp = node2rangelock(node);
 
 		list_add_tail(&lock->rl_next_lock, &tmp->rl_next_lock);
 		tmp->rl_lock_count++;
 	}
-	lock->rl_sequence = ++tree->rlt_sequence;
+	lock->rl_sequence = ++shard->rls_sequence;
 
 	while (lock->rl_blocking_ranges > 0) {
 		lock->rl_task = current;
 		__set_current_state(TASK_INTERRUPTIBLE);
-		spin_unlock(&tree->rlt_lock);
+		spin_unlock(&shard->rls_lock);
 		schedule();
 
 		if (signal_pending(current)) {
-			range_unlock(tree, lock);
-			GOTO(out, rc = -ERESTARTSYS);
+			range_unlock_shard(shard, lock);
+			return -ERESTARTSYS;
+		}
+		spin_lock(&shard->rls_lock);
+	}
+	spin_unlock(&shard->rls_lock);
+
+	return 0;
+}
+
+/**
+ * Whether the file regions of [\a start, \a end] (in pages) map to \a shard.
+ */
+static inline bool range_lock_covers(struct range_lock_tree *tree,
+				     unsigned int shard, __u64 start, __u64 end)
+{
+	__u64 first = start >> RL_REGION_SHIFT;
+	__u64 span = (end >> RL_REGION_SHIFT) - first;
+	unsigned int n = tree->rlt_nshards;
+
+	if (span >= n - 1)
+		return true;
+
+	/* distance from the shard of the first region to this one */
+	return (shard + n - do_div(first, n)) % n <= span;
+}
+
+/**
+ * Set up the lock nodes of \a lock, one per shard covered by its range,
+ * in ascending shard order.
+ */
+static int range_lock_prep(struct range_lock_tree *tree,
+			   struct range_lock *lock)
+{
+	__u64 start = lock->rl_node.in_extent.start;
+	__u64 end = lock->rl_node.in_extent.end;
+	unsigned int shards[RL_SHARDS_DEFAULT];
+	unsigned int *idx = shards;
+	unsigned int count = 0;
+	unsigned int i;
+	int rc = 0;
+
+	if (tree->rlt_nshards > ARRAY_SIZE(shards)) {
+		OBD_ALLOC_PTR_ARRAY(idx, tree->rlt_nshards);
+		if (idx == NULL)
+			return -ENOMEM;
+	}
+
+	for (i = 0; i < tree->rlt_nshards; i++)
+		if (range_lock_covers(tree, i, start, end))
+			idx[count++] = i;
+	LASSERT(count > 0);
+
+	lock->rl_shard = idx[0];
+	if (count > 1) {
+		OBD_ALLOC_PTR_ARRAY(lock->rl_subs, count - 1);
+		if (lock->rl_subs == NULL)
+			GOTO(out, rc = -ENOMEM);
+		lock->rl_sub_count = count - 1;
+
+		for (i = 1; i < count; i++) {
+			struct range_lock *sub = &lock->rl_subs[i - 1];
+
+			rc = range_lock_init(sub, 0, 0);
+			LASSERT(rc == 0);
+			sub->rl_node.in_extent = lock->rl_node.in_extent;
+			sub->rl_shard = idx[i];
 		}
-		spin_lock(&tree->rlt_lock);
 	}
-	spin_unlock(&tree->rlt_lock);
 out:
+	if (idx != shards)
+		OBD_FREE_PTR_ARRAY(idx, tree->rlt_nshards);
+	return rc;
+}
+
+/**
+ * Lock a region
+ *
+ * \param tree [in]	range lock tree
+ * \param lock [in]	range lock node containing the region span
+ *
+ * \retval 0	get the range lock
+ * \retval <0	error code while not getting the range lock
+ *
+ * The file is split into regions of 2^RL_REGION_SHIFT pages spread over
+ * the shards of the tree, so writers of different regions do not contend
+ * on a single spinlock. The lock is queued with its whole range in every
+ * shard its regions map to, in ascending shard order so that two locks
+ * can never wait for each other. Within each shard, if there exists
+ * overlapping range lock, the new lock will wait and retry, if later it
+ * find that it is not the chosen one to wake up, it wait again; waiters
+ * are granted in their queueing order.
+ */
+int range_lock(struct range_lock_tree *tree, struct range_lock *lock)
+{
+	struct range_lock_shard *shards;
+	struct range_lock *sub;
+	unsigned int i;
+	int rc;
+	ENTRY;
+
+	shards = range_lock_shards_get(tree);
+	if (shards == NULL)
+		RETURN(-ENOMEM);
+
+	rc = range_lock_prep(tree, lock);
+	if (rc < 0)
+		RETURN(rc);
+
+	for (i = 0; i <= lock->rl_sub_count; i++) {
+		sub = range_lock_sub(lock, i);
+		rc = range_lock_shard(&shards[sub->rl_shard], sub);
+		if (rc < 0) {
+			range_unlock_shards(tree, lock, i);
+			break;
+		}
+	}
+
 	RETURN(rc);
 }
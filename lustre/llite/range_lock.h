@@ -44,6 +44,16 @@
 	(range)->rl_node.in_extent.start,	\
 	(range)->rl_node.in_extent.end
 
+/**
+ * Number of pages of one file region, regions are spread over the shards
+ * of a range lock tree round-robin (1MiB).
+ */
+#define RL_REGION_SHIFT		(20 - PAGE_SHIFT)
+/**
+ * Default number of shards of a range lock tree.
+ */
+#define RL_SHARDS_DEFAULT	16
+
 struct range_lock {
 	struct interval_node	rl_node;
 	/**
@@ -67,6 +77,19 @@ struct range_lock {
 	 * the order the locks are queued; this is required for range_cancel().
 	 */
 	__u64			rl_sequence;
+	/**
+	 * Index of the shard this lock node is queued in.
+	 */
+	unsigned int		rl_shard;
+	/**
+	 * Number of lock nodes in rl_subs.
+	 */
+	unsigned int		rl_sub_count;
+	/**
+	 * Lock nodes queued in the other shards covered by the range, the
+	 * lock itself is queued in the lowest shard.
+	 */
+	struct range_lock	*rl_subs;
 };
 
 static inline struct range_lock *node2rangelock(const struct interval_node *n)
@@ -74,13 +97,25 @@ static inline struct range_lock *node2rangelock(const struct interval_node *n)
 	return container_of(n, struct range_lock, rl_node);
 }
 
+struct range_lock_shard {
+	struct interval_node	*rls_root;
+	spinlock_t		 rls_lock;
+	__u64			 rls_sequence;
+} ____cacheline_aligned_in_smp;
+
 struct range_lock_tree {
-	struct interval_node	*rlt_root;
-	spinlock_t		 rlt_lock;
-	__u64			 rlt_sequence;
+	/**
+	 * Shards, allocated on first lock so files never written do not
+	 * pay for them.
+	 */
+	struct range_lock_shard	*rlt_shards;
+	unsigned int		 rlt_nshards;
 };
 
 void range_lock_tree_init(struct range_lock_tree *tree);
+void range_lock_tree_init_shards(struct range_lock_tree *tree,
+				 unsigned int nshards);
+void range_lock_tree_fini(struct range_lock_tree *tree);
 int  range_lock_init(struct range_lock *lock, __u64 start, __u64 end);
 int  range_lock(struct range_lock_tree *tree, struct range_lock *lock);
 void range_unlock(struct range_lock_tree *tree, struct range_lock *lock);
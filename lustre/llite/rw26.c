@@ -398,6 +398,7 @@ ll_direct_IO_impl(struct kiocb *iocb, struct iov_iter *iter, int rw)
 	size_t count = iov_iter_count(iter);
 	ssize_t tot_bytes = 0, result = 0;
 	loff_t file_offset = iocb->ki_pos;
+	size_t window = (size_t)ll_i2sbi(inode)->ll_dio_submit_mb << 20;
 
 	/* Check EOF by ourselves */
 	if (rw == READ && file_offset >= i_size_read(inode))
@@ -442,6 +443,19 @@ ll_direct_IO_impl(struct kiocb *iocb, struct iov_iter *iter, int rw)
 		struct page **pages;
 
 		count = min_t(size_t, iov_iter_count(iter), MAX_DIO_SIZE);
+		/*
+		 * Submit large transfers in windows aligned on the file
+		 * offset, rather than in MAX_DIO_SIZE chunks, so the RPCs of
+		 * the first windows are in flight while the pages of the
+		 * next ones are pinned and set up. All windows share the
+		 * same aio, only the completion of the whole transfer is
+		 * waited for. lov already cuts the IO of striped files at
+		 * stripe boundaries, so this matters for files with a
+		 * single stripe or with stripes larger than the window.
+		 */
+		if (window > 0)
+			count = min_t(size_t, count,
+				      window - (file_offset & (window - 1)));
 		if (rw == READ) {
 			if (file_offset >= i_size_read(inode))
 				break;
@@ -466,6 +480,10 @@ ll_direct_IO_impl(struct kiocb *iocb, struct iov_iter *iter, int rw)
 		if (unlikely(result < 0))
 			GOTO(out, result);
 
+		CDEBUG(D_VFSTRACE, DFID": DIO window [%lld, %lld) submitted\n",
+		       PFID(ll_inode2fid(inode)), file_offset,
+		       file_offset + (loff_t)count);
+
 		iov_iter_advance(iter, count);
 		tot_bytes += count;
 		file_offset += count;
@@ -145,16 +145,10 @@ static int __init lustre_init(void)
 
 	cl_inode_fini_env->le_ctx.lc_cookie = 0x4;
 
-	rc = ll_xattr_init();
-	if (rc != 0)
-		GOTO(out_inode_fini_env, rc);
-
 	lustre_register_super_ops(THIS_MODULE, ll_fill_super, ll_kill_super);
 
 	RETURN(0);
 
-out_inode_fini_env:
-	cl_env_put(cl_inode_fini_env, &cl_inode_fini_refcheck);
 out_vvp:
 	vvp_global_fini();
 out_tunables:
@@ -172,7 +166,6 @@ static void __exit lustre_exit(void)
 
 	llite_tunables_unregister();
 
-	ll_xattr_fini();
 	cl_env_put(cl_inode_fini_env, &cl_inode_fini_refcheck);
 	vvp_global_fini();
 
@@ -35,218 +35,180 @@
 #include <linux/fs.h>
 #include <linux/sched.h>
 #include <linux/mm.h>
+#include <linux/rcupdate.h>
 #include <obd_support.h>
 #include <lustre_dlm.h>
 #include "llite_internal.h"
 
-/* If we ever have hundreds of extended attributes, we might want to consider
- * using a hash or a tree structure instead of list for faster lookups.
+/*
+ * The xattr cache of an inode is a single packed allocation built from the
+ * getxattr reply: an array of entries followed by the xattr names, stored
+ * back to back so that listxattr is a single copy, and then the values.
+ * The cache is never modified once built. It is published through
+ * lli_xattrs with RCU, so lookups take no lock, and it is replaced or freed
+ * as a whole under lli_xattrs_list_rwsem.
+ *
+ * The cache holds the complete set of xattrs of the inode and is valid
+ * while the client has the XATTR ibits lock, so a name missing from it is
+ * a cached negative entry: lookups of absent xattrs like
+ * security.capability are answered locally as well.
+ *
+ * If we ever have hundreds of extended attributes, we might want to consider
+ * sorting the entries for faster lookups.
  */
 struct ll_xattr_entry {
-	struct list_head	xe_list;    /* protected with
-					     * lli_xattrs_list_rwsem */
-	char			*xe_name;   /* xattr name, \0-terminated */
-	char			*xe_value;  /* xattr value */
-	unsigned		xe_namelen; /* strlen(xe_name) + 1 */
-	unsigned		xe_vallen;  /* xattr value length */
+	unsigned int		xe_name;    /* offset of \0-terminated name */
+	unsigned int		xe_namelen; /* strlen(xe_name) + 1 */
+	unsigned int		xe_value;   /* offset of xattr value */
+	unsigned int		xe_vallen;  /* xattr value length */
 };
 
-static struct kmem_cache *xattr_kmem;
-static struct lu_kmem_descr xattr_caches[] = {
-	{
-		.ckd_cache = &xattr_kmem,
-		.ckd_name  = "xattr_kmem",
-		.ckd_size  = sizeof(struct ll_xattr_entry)
-	},
-	{
-		.ckd_cache = NULL
-	}
+struct ll_xattr_cache {
+	struct rcu_head		xc_rcu;
+	size_t			xc_size;	/* allocated size */
+	unsigned int		xc_count;	/* number of entries */
+	unsigned int		xc_names_len;	/* size of the name list */
+	char			*xc_data;	/* names, then values */
+	struct ll_xattr_entry	xc_entries[0];
 };
 
-int ll_xattr_init(void)
+static inline const char *ll_xattr_name(const struct ll_xattr_cache *xc,
+					const struct ll_xattr_entry *xe)
 {
-	return lu_kmem_init(xattr_caches);
+	return xc->xc_data + xe->xe_name;
 }
 
-void ll_xattr_fini(void)
+static inline const char *ll_xattr_value(const struct ll_xattr_cache *xc,
+					 const struct ll_xattr_entry *xe)
 {
-	lu_kmem_fini(xattr_caches);
+	return xc->xc_data + xe->xe_value;
 }
 
 /**
- * Initializes xattr cache for an inode.
+ * Allocate an empty xattr cache.
  *
- * This initializes the xattr list and marks cache presence.
+ * \param[in] count	maximum number of xattrs
+ * \param[in] names	maximum size of all names, including \0
+ * \param[in] values	maximum size of all values
+ *
+ * \retval		new cache, or NULL if no memory
  */
-static void ll_xattr_cache_init(struct ll_inode_info *lli)
+static struct ll_xattr_cache *ll_xattr_cache_alloc(unsigned int count,
+						   size_t names, size_t values)
 {
-	ENTRY;
+	struct ll_xattr_cache *xc;
+	size_t size;
+
+	size = offsetof(struct ll_xattr_cache, xc_entries[count]) +
+	       names + values;
+	OBD_ALLOC_LARGE(xc, size);
+	if (xc == NULL)
+		return NULL;
 
-	LASSERT(lli != NULL);
+	xc->xc_size = size;
+	xc->xc_data = (char *)&xc->xc_entries[count];
 
-	INIT_LIST_HEAD(&lli->lli_xattrs);
-	ll_file_set_flag(lli, LLIF_XATTR_CACHE);
+	return xc;
+}
+
+static void ll_xattr_cache_free_rcu(struct rcu_head *head)
+{
+	struct ll_xattr_cache *xc = container_of(head, struct ll_xattr_cache,
+						 xc_rcu);
+
+	OBD_FREE_LARGE(xc, xc->xc_size);
 }
 
 /**
  *  This looks for a specific extended attribute.
  *
- *  Find in @cache and return @xattr_name attribute in @xattr,
- *  for the NULL @xattr_name return the first cached @xattr.
+ *  Find in @xc and return @xattr_name attribute in @xattr.
  *
  *  \retval 0        success
  *  \retval -ENODATA if not found
  */
-static int ll_xattr_cache_find(struct list_head *cache,
+static int ll_xattr_cache_find(const struct ll_xattr_cache *xc,
 			       const char *xattr_name,
-			       struct ll_xattr_entry **xattr)
+			       const struct ll_xattr_entry **xattr)
 {
-	struct ll_xattr_entry *entry;
+	unsigned int i;
 
-	ENTRY;
+	for (i = 0; i < xc->xc_count; i++) {
+		const struct ll_xattr_entry *xe = &xc->xc_entries[i];
 
-	list_for_each_entry(entry, cache, xe_list) {
-		/* xattr_name == NULL means look for any entry */
-		if (xattr_name == NULL ||
-		    strcmp(xattr_name, entry->xe_name) == 0) {
-			*xattr = entry;
-			CDEBUG(D_CACHE, "find: [%s]=%.*s\n",
-			       entry->xe_name, entry->xe_vallen,
-			       entry->xe_value);
-			RETURN(0);
+		if (strcmp(xattr_name, ll_xattr_name(xc, xe)) == 0) {
+			*xattr = xe;
+			CDEBUG(D_CACHE, "find: [%s]=%.*s\n", xattr_name,
+			       xe->xe_vallen, ll_xattr_value(xc, xe));
+			return 0;
 		}
 	}
 
-	RETURN(-ENODATA);
+	return -ENODATA;
 }
 
 /**
  * This adds an xattr.
  *
- * Add @xattr_name attr with @xattr_val value and @xattr_val_len length,
+ * Add @xattr_name attr with @xattr_val value and @xattr_val_len length.
+ * The name is appended to the name list, the value is stored at @val_off
+ * in the data area, which is advanced past it. The caller sized the cache
+ * for all xattrs of the reply.
  *
  * \retval 0       success
- * \retval -ENOMEM if no memory could be allocated for the cached attr
  * \retval -EPROTO if duplicate xattr is being added
  */
-static int ll_xattr_cache_add(struct list_head *cache,
+static int ll_xattr_cache_add(struct ll_xattr_cache *xc,
 			      const char *xattr_name,
 			      const char *xattr_val,
-			      unsigned xattr_val_len)
+			      unsigned int xattr_val_len,
+			      unsigned int *val_off)
 {
-	struct ll_xattr_entry *xattr;
-
-	ENTRY;
+	const struct ll_xattr_entry *dup;
+	struct ll_xattr_entry *xe;
 
-	if (ll_xattr_cache_find(cache, xattr_name, &xattr) == 0) {
+	if (ll_xattr_cache_find(xc, xattr_name, &dup) == 0) {
 		CDEBUG(D_CACHE, "duplicate xattr: [%s]\n", xattr_name);
-		RETURN(-EPROTO);
+		return -EPROTO;
 	}
 
-	OBD_SLAB_ALLOC_PTR_GFP(xattr, xattr_kmem, GFP_NOFS);
-	if (xattr == NULL) {
-		CDEBUG(D_CACHE, "failed to allocate xattr\n");
-		RETURN(-ENOMEM);
-	}
+	xe = &xc->xc_entries[xc->xc_count++];
+	xe->xe_namelen = strlen(xattr_name) + 1;
+	xe->xe_name = xc->xc_names_len;
+	memcpy(xc->xc_data + xe->xe_name, xattr_name, xe->xe_namelen);
+	xc->xc_names_len += xe->xe_namelen;
 
-	xattr->xe_namelen = strlen(xattr_name) + 1;
-
-	OBD_ALLOC(xattr->xe_name, xattr->xe_namelen);
-	if (!xattr->xe_name) {
-		CDEBUG(D_CACHE, "failed to alloc xattr name %u\n",
-		       xattr->xe_namelen);
-		goto err_name;
-	}
-	OBD_ALLOC(xattr->xe_value, xattr_val_len);
-	if (!xattr->xe_value) {
-		CDEBUG(D_CACHE, "failed to alloc xattr value %d\n",
-		       xattr_val_len);
-		goto err_value;
-	}
-
-	memcpy(xattr->xe_name, xattr_name, xattr->xe_namelen);
-	memcpy(xattr->xe_value, xattr_val, xattr_val_len);
-	xattr->xe_vallen = xattr_val_len;
-	list_add(&xattr->xe_list, cache);
+	xe->xe_vallen = xattr_val_len;
+	xe->xe_value = *val_off;
+	memcpy(xc->xc_data + xe->xe_value, xattr_val, xattr_val_len);
+	*val_off += xattr_val_len;
 
 	CDEBUG(D_CACHE, "set: [%s]=%.*s\n", xattr_name,
 		xattr_val_len, xattr_val);
 
-	RETURN(0);
-err_value:
-	OBD_FREE(xattr->xe_name, xattr->xe_namelen);
-err_name:
-	OBD_SLAB_FREE_PTR(xattr, xattr_kmem);
-
-	RETURN(-ENOMEM);
-}
-
-/**
- * This removes an extended attribute from cache.
- *
- * Remove @xattr_name attribute from @cache.
- *
- * \retval 0        success
- * \retval -ENODATA if @xattr_name is not cached
- */
-static int ll_xattr_cache_del(struct list_head *cache,
-			      const char *xattr_name)
-{
-	struct ll_xattr_entry *xattr;
-
-	ENTRY;
-
-	CDEBUG(D_CACHE, "del xattr: %s\n", xattr_name);
-
-	if (ll_xattr_cache_find(cache, xattr_name, &xattr) == 0) {
-		list_del(&xattr->xe_list);
-		OBD_FREE(xattr->xe_name, xattr->xe_namelen);
-		OBD_FREE(xattr->xe_value, xattr->xe_vallen);
-		OBD_SLAB_FREE_PTR(xattr, xattr_kmem);
-
-		RETURN(0);
-	}
-
-	RETURN(-ENODATA);
+	return 0;
 }
 
 /**
  * This iterates cached extended attributes.
  *
- * Walk over cached attributes in @cache and
- * fill in @xld_buffer or only calculate buffer
- * size if @xld_buffer is NULL.
+ * Fill in @xld_buffer with the names of cached attributes in @xc,
+ * or only calculate buffer size if @xld_buffer is NULL.
  *
  * \retval >= 0     buffer list size
- * \retval -ENODATA if the list cannot fit @xld_size buffer
+ * \retval -ERANGE  if the list cannot fit @xld_size buffer
  */
-static int ll_xattr_cache_list(struct list_head *cache,
+static int ll_xattr_cache_list(const struct ll_xattr_cache *xc,
 			       char *xld_buffer,
 			       int xld_size)
 {
-	struct ll_xattr_entry *xattr, *tmp;
-	int xld_tail = 0;
-
-	ENTRY;
-
-	list_for_each_entry_safe(xattr, tmp, cache, xe_list) {
-		CDEBUG(D_CACHE, "list: buffer=%p[%d] name=%s\n",
-			xld_buffer, xld_tail, xattr->xe_name);
-
-		if (xld_buffer) {
-			xld_size -= xattr->xe_namelen;
-			if (xld_size < 0)
-				break;
-			memcpy(&xld_buffer[xld_tail],
-			       xattr->xe_name, xattr->xe_namelen);
-		}
-		xld_tail += xattr->xe_namelen;
+	if (xld_buffer) {
+		if (xld_size < xc->xc_names_len)
+			return -ERANGE;
+		memcpy(xld_buffer, xc->xc_data, xc->xc_names_len);
 	}
 
-	if (xld_size < 0)
-		RETURN(-ERANGE);
-
-	RETURN(xld_tail);
+	return xc->xc_names_len;
 }
 
 /**
@@ -257,27 +219,30 @@ static int ll_xattr_cache_list(struct list_head *cache,
  */
 static int ll_xattr_cache_valid(struct ll_inode_info *lli)
 {
-	return ll_file_test_flag(lli, LLIF_XATTR_CACHE);
+	return rcu_access_pointer(lli->lli_xattrs) != NULL;
 }
 
 /**
  * This finalizes the xattr cache.
  *
- * Free all xattr memory. @lli is the inode info pointer.
+ * Unpublish the cache and free it once current readers are done.
+ * Must be called with lli_xattrs_list_rwsem held for write.
  *
  * \retval 0 no error occured
  */
 static int ll_xattr_cache_destroy_locked(struct ll_inode_info *lli)
 {
+	struct ll_xattr_cache *xc;
+
 	ENTRY;
 
-	if (!ll_xattr_cache_valid(lli))
+	xc = rcu_dereference_protected(lli->lli_xattrs,
+			lockdep_is_held(&lli->lli_xattrs_list_rwsem));
+	if (xc == NULL)
 		RETURN(0);
 
-	while (ll_xattr_cache_del(&lli->lli_xattrs, NULL) == 0)
-		/* empty loop */ ;
-
-	ll_file_clear_flag(lli, LLIF_XATTR_CACHE);
+	RCU_INIT_POINTER(lli->lli_xattrs, NULL);
+	call_rcu(&xc->xc_rcu, ll_xattr_cache_free_rcu);
 
 	RETURN(0);
 }
@@ -380,7 +345,9 @@ static int ll_xattr_cache_refill(struct inode *inode)
 	struct ptlrpc_request *req = NULL;
 	const char *xdata, *xval, *xtail, *xvtail;
 	struct ll_inode_info *lli = ll_i2info(inode);
+	struct ll_xattr_cache *xc;
 	struct mdt_body *body;
+	unsigned int val_off;
 	__u32 *xsizes;
 	int rc = 0, i;
 
@@ -394,7 +361,7 @@ static int ll_xattr_cache_refill(struct inode *inode)
 	if (ll_xattr_cache_valid(lli)) {
 		ll_stats_ops_tally(sbi, LPROC_LL_GETXATTR_HITS, 1);
 		ll_intent_drop_lock(&oit);
-		GOTO(err_req, rc = 0);
+		GOTO(err_unlock, rc = 0);
 	}
 
 	/* Matched but no cache? Cancelled on error by a parallel refill. */
@@ -427,7 +394,12 @@ static int ll_xattr_cache_refill(struct inode *inode)
 
 	CDEBUG(D_CACHE, "caching: xdata=%p xtail=%p\n", xdata, xtail);
 
-	ll_xattr_cache_init(lli);
+	/* names are packed first, values follow the largest name list */
+	xc = ll_xattr_cache_alloc(body->mbo_max_mdsize, body->mbo_eadatasize,
+				  body->mbo_aclsize);
+	if (xc == NULL)
+		GOTO(err_cancel, rc = -ENOMEM);
+	val_off = body->mbo_eadatasize;
 
 	for (i = 0; i < body->mbo_max_mdsize; i++) {
 		CDEBUG(D_CACHE, "caching [%s]=%.*s\n", xdata, *xsizes, xval);
@@ -450,11 +422,11 @@ static int ll_xattr_cache_refill(struct inode *inode)
 			CDEBUG(D_CACHE, "not caching security.selinux\n");
 			rc = 0;
 		} else {
-			rc = ll_xattr_cache_add(&lli->lli_xattrs, xdata, xval,
-						*xsizes);
+			rc = ll_xattr_cache_add(xc, xdata, xval, *xsizes,
+						&val_off);
 		}
 		if (rc < 0) {
-			ll_xattr_cache_destroy_locked(lli);
+			OBD_FREE_LARGE(xc, xc->xc_size);
 			GOTO(err_cancel, rc);
 		}
 		xdata += strlen(xdata) + 1;
@@ -465,9 +437,12 @@ static int ll_xattr_cache_refill(struct inode *inode)
 	if (xdata != xtail || xval != xvtail)
 		CERROR("a hole in xattr data\n");
 
+	rcu_assign_pointer(lli->lli_xattrs, xc);
+
 	ll_set_lock_data(sbi->ll_md_exp, inode, &oit, NULL);
 	ll_intent_drop_lock(&oit);
 
+	up_write(&lli->lli_xattrs_list_rwsem);
 	ptlrpc_req_finished(req);
 	RETURN(0);
 
@@ -498,6 +473,7 @@ err_req:
  * \retval -ENOMEM  not enough memory for the cache
  * \retval -ERANGE  the buffer is not large enough
  * \retval -ENODATA no such attr or the list is empty
+ * \retval -EAGAIN  the cache was dropped, fetch from the MDS directly
  */
 int ll_xattr_cache_get(struct inode *inode,
 			const char *name,
@@ -506,47 +482,56 @@ int ll_xattr_cache_get(struct inode *inode,
 			__u64 valid)
 {
 	struct ll_inode_info *lli = ll_i2info(inode);
+	struct ll_sb_info *sbi = ll_i2sbi(inode);
+	struct ll_xattr_cache *xc;
+	bool refilled = false;
 	int rc = 0;
 
 	ENTRY;
 
 	LASSERT(!!(valid & OBD_MD_FLXATTR) ^ !!(valid & OBD_MD_FLXATTRLS));
 
-	down_read(&lli->lli_xattrs_list_rwsem);
-	if (!ll_xattr_cache_valid(lli)) {
-		up_read(&lli->lli_xattrs_list_rwsem);
+again:
+	rcu_read_lock();
+	xc = rcu_dereference(lli->lli_xattrs);
+	if (xc == NULL) {
+		rcu_read_unlock();
+		/* cancelled again right after the refill, don't loop */
+		if (refilled)
+			RETURN(-EAGAIN);
+
 		rc = ll_xattr_cache_refill(inode);
 		if (rc)
 			RETURN(rc);
-		downgrade_write(&lli->lli_xattrs_list_rwsem);
-	} else {
-		ll_stats_ops_tally(ll_i2sbi(inode), LPROC_LL_GETXATTR_HITS, 1);
+		refilled = true;
+		goto again;
 	}
 
+	if (!refilled)
+		ll_stats_ops_tally(sbi, LPROC_LL_GETXATTR_HITS, 1);
+
 	if (valid & OBD_MD_FLXATTR) {
-		struct ll_xattr_entry *xattr;
+		const struct ll_xattr_entry *xattr;
 
-		rc = ll_xattr_cache_find(&lli->lli_xattrs, name, &xattr);
+		rc = ll_xattr_cache_find(xc, name, &xattr);
 		if (rc == 0) {
 			rc = xattr->xe_vallen;
 			/* zero size means we are only requested size in rc */
 			if (size != 0) {
 				if (size >= xattr->xe_vallen)
-					memcpy(buffer, xattr->xe_value,
-						xattr->xe_vallen);
+					memcpy(buffer, ll_xattr_value(xc, xattr),
+					       xattr->xe_vallen);
 				else
 					rc = -ERANGE;
 			}
 		}
 	} else if (valid & OBD_MD_FLXATTRLS) {
-		rc = ll_xattr_cache_list(&lli->lli_xattrs,
-					 size ? buffer : NULL, size);
+		rc = ll_xattr_cache_list(xc, size ? buffer : NULL, size);
 	}
+	rcu_read_unlock();
 
-	GOTO(out, rc);
-out:
-	up_read(&lli->lli_xattrs_list_rwsem);
+	if (rc == -ENODATA && !refilled)
+		ll_stats_ops_tally(sbi, LPROC_LL_GETXATTR_NEG_HITS, 1);
 
 	RETURN(rc);
 }
-
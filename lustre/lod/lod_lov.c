@@ -211,7 +211,9 @@ int lod_add_device(const struct lu_env *env, struct lod_device *lod,
 					   OBD_CONNECT_AT |
 					   OBD_CONNECT_FULL20 |
 					   OBD_CONNECT_LFSCK |
-					   OBD_CONNECT_BULK_MBITS;
+					   OBD_CONNECT_BULK_MBITS |
+					   OBD_CONNECT_FLAGS2;
+		data->ocd_connect_flags2 = OBD_CONNECT2_OUT_BATCH;
 		spin_lock(&imp->imp_lock);
 		imp->imp_server_timeout = 1;
 		spin_unlock(&imp->imp_lock);
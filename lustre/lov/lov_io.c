@@ -815,6 +815,36 @@ static int lov_io_iter_init(const struct lu_env *env,
 	RETURN(rc);
 }
 
+/**
+ * Whether an iteration of \a io may cover all the stripes of the component
+ * \a lse rather than one stripe chunk, so that lov_io_submit() fans the
+ * sub-queues of a single submit out to the lov_submit workers. Only DIO
+ * submits all the pages of an iteration at once, and only the stripes the
+ * IO range touches get pages.
+ */
+static bool lov_io_fanout(struct lov_io *lio, struct cl_io *io,
+			  struct lov_stripe_md_entry *lse)
+{
+	struct lov_obd *lov;
+	u64 first;
+	u64 last;
+
+	if (!io->ci_dio || io->u.ci_rw.crw_count == 0)
+		return false;
+
+	lov = lu2lov_dev(lio->lis_object->lo_cl.co_lu.lo_dev)->ld_lov;
+	if (lov->lov_submit_parallel == 0)
+		return false;
+
+	first = io->u.ci_rw.crw_pos;
+	last = io->u.ci_rw.crw_pos + io->u.ci_rw.crw_count - 1;
+	lov_do_div64(first, lse->lsme_stripe_size);
+	lov_do_div64(last, lse->lsme_stripe_size);
+
+	return min_t(u64, last - first + 1, lse->lsme_stripe_count) >=
+	       lov->lov_submit_parallel;
+}
+
 static int lov_io_rw_iter_init(const struct lu_env *env,
 			       const struct cl_io_slice *ios)
 {
@@ -853,7 +883,7 @@ static int lov_io_rw_iter_init(const struct lu_env *env,
 	lse = lov_lse(lio->lis_object, index);
 
 	next = MAX_LFS_FILESIZE;
-	if (lse->lsme_stripe_count > 1) {
+	if (lse->lsme_stripe_count > 1 && !lov_io_fanout(lio, io, lse)) {
 		unsigned long ssize = lse->lsme_stripe_size;
 
 		lov_do_div64(start, ssize);
@@ -1100,6 +1130,263 @@ static int lov_io_read_ahead(const struct lu_env *env,
 	RETURN(0);
 }
 
+/**
+ * Per-CPT workqueues running the sub-IO submissions of wide-striped IOs,
+ * see lov_io_submit().
+ */
+static struct workqueue_struct **lov_submit_wqs;
+
+int lov_submit_init(void)
+{
+	int ncpts = cfs_cpt_number(cfs_cpt_tab);
+	int rc;
+	int i;
+
+	OBD_ALLOC_PTR_ARRAY(lov_submit_wqs, ncpts);
+	if (lov_submit_wqs == NULL)
+		return -ENOMEM;
+
+	for (i = 0; i < ncpts; i++) {
+		lov_submit_wqs[i] = cfs_cpt_bind_workqueue("lov_submit",
+						cfs_cpt_tab, 0, i,
+						cfs_cpt_weight(cfs_cpt_tab, i));
+		if (IS_ERR(lov_submit_wqs[i])) {
+			rc = PTR_ERR(lov_submit_wqs[i]);
+			lov_submit_wqs[i] = NULL;
+			lov_submit_fini();
+			return rc;
+		}
+	}
+
+	return 0;
+}
+
+void lov_submit_fini(void)
+{
+	int i;
+
+	if (lov_submit_wqs == NULL)
+		return;
+
+	for (i = 0; i < cfs_cpt_number(cfs_cpt_tab); i++)
+		if (lov_submit_wqs[i] != NULL)
+			destroy_workqueue(lov_submit_wqs[i]);
+
+	OBD_FREE_PTR_ARRAY(lov_submit_wqs, cfs_cpt_number(cfs_cpt_tab));
+	lov_submit_wqs = NULL;
+}
+
+/** all the sub-queues of one lov_io_submit() call */
+struct lov_submit_batch {
+	enum cl_req_type	 lsb_crt;
+	/** sub-queues not submitted yet */
+	atomic_t		 lsb_pending;
+	struct completion	 lsb_done;
+	spinlock_t		 lsb_lock;
+	/** threads submitting a sub-queue now, and the most seen at once */
+	unsigned int		 lsb_active;
+	unsigned int		 lsb_max_active;
+};
+
+/** pages of a single stripe */
+struct lov_submit_item {
+	struct list_head	 lsi_linkage;
+	struct work_struct	 lsi_work;
+	struct cl_2queue	 lsi_queue;
+	struct lov_io_sub	*lsi_sub;
+	struct lov_submit_batch	*lsi_batch;
+	int			 lsi_rc;
+};
+
+static void lov_submit_item_done(struct lov_submit_item *lsi)
+{
+	struct lov_submit_batch *lsb = lsi->lsi_batch;
+
+	if (atomic_dec_and_test(&lsb->lsb_pending))
+		complete(&lsb->lsb_done);
+}
+
+/**
+ * Submit the pages of one stripe. \a env is lov_io_sub::sub_env of the
+ * stripe, the sub-IO was set up in it.
+ */
+static void lov_submit_item_run(const struct lu_env *env,
+				struct lov_submit_item *lsi)
+{
+	struct lov_submit_batch *lsb = lsi->lsi_batch;
+
+	spin_lock(&lsb->lsb_lock);
+	if (++lsb->lsb_active > lsb->lsb_max_active)
+		lsb->lsb_max_active = lsb->lsb_active;
+	spin_unlock(&lsb->lsb_lock);
+
+	OBD_FAIL_TIMEOUT_MS(OBD_FAIL_LOV_SUBMIT_DELAY, cfs_fail_val);
+	lsi->lsi_rc = cl_io_submit_rw(env, &lsi->lsi_sub->sub_io,
+				      lsb->lsb_crt, &lsi->lsi_queue);
+
+	spin_lock(&lsb->lsb_lock);
+	lsb->lsb_active--;
+	spin_unlock(&lsb->lsb_lock);
+
+	lov_submit_item_done(lsi);
+}
+
+/*
+ * The sub-IO is submitted under the sub_env it was set up in, which holds
+ * its osc_io state. Every item is a different stripe, and the IO thread does
+ * not use the sub_env of an item handed to a worker until the whole batch is
+ * done, so a sub_env is only used by one thread at a time.
+ */
+static void lov_submit_work(struct work_struct *work)
+{
+	struct lov_submit_item *lsi = container_of(work,
+						   struct lov_submit_item,
+						   lsi_work);
+
+	lov_submit_item_run(lsi->lsi_sub->sub_env, lsi);
+}
+
+/**
+ * Split \a qin by stripe into \a items. Pages of empty mirror components
+ * are completed right away.
+ *
+ * \retval	number of stripes
+ * \retval	negative errno, the pages not queued yet are left in \a qin
+ */
+static int lov_submit_split(const struct lu_env *env,
+			    const struct cl_io_slice *ios,
+			    enum cl_req_type crt, struct cl_2queue *queue,
+			    struct lov_submit_batch *lsb,
+			    struct list_head *items)
+{
+	struct cl_page_list *qin = &queue->c2_qin;
+	struct lov_io *lio = cl2lov_io(env, ios);
+	struct lov_submit_item *lsi;
+	struct lov_io_sub *sub;
+	struct cl_page *page;
+	struct cl_page *tmp;
+	int nr = 0;
+	int index;
+
+	while (qin->pl_nr > 0) {
+		page = cl_page_list_first(qin);
+		if (lov_page_is_empty(page)) {
+			cl_page_list_move(&queue->c2_qout, qin, page);
+			/* see lov_io_submit() */
+			(void) cl_page_prep(env, ios->cis_io, page, crt);
+			cl_page_completion(env, page, crt, 0);
+			continue;
+		}
+
+		index = page->cp_lov_index;
+		sub = lov_sub_get(env, lio, index);
+		if (IS_ERR(sub))
+			return PTR_ERR(sub);
+
+		OBD_ALLOC_PTR(lsi);
+		if (lsi == NULL)
+			return -ENOMEM;
+
+		cl_2queue_init(&lsi->lsi_queue);
+		cl_page_list_move(&lsi->lsi_queue.c2_qin, qin, page);
+		cl_page_list_for_each_safe(page, tmp, qin) {
+			/* this page is not on this stripe */
+			if (index != page->cp_lov_index)
+				continue;
+
+			cl_page_list_move(&lsi->lsi_queue.c2_qin, qin, page);
+		}
+
+		INIT_WORK(&lsi->lsi_work, lov_submit_work);
+		lsi->lsi_sub = sub;
+		lsi->lsi_batch = lsb;
+		list_add_tail(&lsi->lsi_linkage, items);
+		nr++;
+	}
+
+	return nr;
+}
+
+/**
+ * Submit the pages of a wide-striped IO with several threads: the queue is
+ * split by stripe first, then every sub-queue but the first is handed to
+ * the lov_submit workers of the local CPT while the IO thread submits the
+ * first one, so the pages of many OSCs are prepared and their RPCs built
+ * in parallel. A queue has pages of several stripes for DIO only, whose
+ * iterations are not cut at stripe boundaries, see lov_io_fanout().
+ *
+ * The BRW RPCs built by the workers get the jobid that vvp_io_init() saved
+ * for the IO thread, see vvp_req_attr_set().
+ */
+static int lov_io_submit_parallel(const struct lu_env *env,
+				  const struct cl_io_slice *ios,
+				  enum cl_req_type crt,
+				  struct cl_2queue *queue,
+				  struct lov_obd *lov)
+{
+	struct cl_page_list *plist = &lov_env_info(env)->lti_plist;
+	struct workqueue_struct *wq;
+	struct lov_submit_batch lsb;
+	struct lov_submit_item *lsi;
+	struct lov_submit_item *next;
+	LIST_HEAD(items);
+	bool serial;
+	int nr;
+	int rc = 0;
+	ENTRY;
+
+	lsb.lsb_crt = crt;
+	atomic_set(&lsb.lsb_pending, 1);
+	init_completion(&lsb.lsb_done);
+	spin_lock_init(&lsb.lsb_lock);
+	lsb.lsb_active = 0;
+	lsb.lsb_max_active = 0;
+
+	nr = lov_submit_split(env, ios, crt, queue, &lsb, &items);
+	if (nr < 0)
+		GOTO(out, rc = nr);
+
+	/* the IO thread takes the first stripe, or all of them if there
+	 * are too few to be worth the hand-off */
+	serial = nr < lov->lov_submit_parallel;
+	wq = lov_submit_wqs[cfs_cpt_current(cfs_cpt_tab, 1)];
+	list_for_each_entry(lsi, &items, lsi_linkage) {
+		atomic_inc(&lsb.lsb_pending);
+		if (serial || lsi->lsi_linkage.prev == &items)
+			continue;
+
+		queue_work(wq, &lsi->lsi_work);
+	}
+	list_for_each_entry(lsi, &items, lsi_linkage) {
+		if (serial || lsi->lsi_linkage.prev == &items)
+			lov_submit_item_run(lsi->lsi_sub->sub_env, lsi);
+	}
+	if (!atomic_dec_and_test(&lsb.lsb_pending))
+		wait_for_completion(&lsb.lsb_done);
+
+	if (nr > 0) {
+		lprocfs_oh_tally_log2(&lov->lov_submit_stripes_hist, nr);
+		lprocfs_oh_tally_log2(&lov->lov_submit_active_hist,
+				      lsb.lsb_max_active);
+	}
+out:
+	/* collect the results in stripe order, as the serial submit does */
+	cl_page_list_init(plist);
+	list_for_each_entry_safe(lsi, next, &items, lsi_linkage) {
+		if (rc == 0)
+			rc = lsi->lsi_rc;
+		cl_page_list_splice(&lsi->lsi_queue.c2_qin, plist);
+		cl_page_list_splice(&lsi->lsi_queue.c2_qout, &queue->c2_qout);
+		cl_2queue_fini(env, &lsi->lsi_queue);
+		list_del(&lsi->lsi_linkage);
+		OBD_FREE_PTR(lsi);
+	}
+	cl_page_list_splice(plist, &queue->c2_qin);
+	cl_page_list_fini(env, plist);
+
+	RETURN(rc);
+}
+
 /**
  * lov implementation of cl_operations::cio_submit() method. It takes a list
  * of pages in \a queue, splits it into per-stripe sub-lists, invokes
@@ -1121,14 +1408,24 @@ static int lov_io_submit(const struct lu_env *env,
 {
 	struct cl_page_list	*qin = &queue->c2_qin;
 	struct lov_io		*lio = cl2lov_io(env, ios);
+	struct lov_obd		*lov;
 	struct lov_io_sub	*sub;
 	struct cl_page_list	*plist = &lov_env_info(env)->lti_plist;
 	struct cl_page		*page;
 	struct cl_page		*tmp;
 	int index;
+	int nr = 0;
 	int rc = 0;
 	ENTRY;
 
+	/* DIO only, the allocations of the split must not be done from
+	 * memory reclaim; whether the stripes with pages are enough to fan
+	 * out is decided once the queue is split */
+	lov = lu2lov_dev(lio->lis_object->lo_cl.co_lu.lo_dev)->ld_lov;
+	if (lov->lov_submit_parallel > 0 && ios->cis_io->ci_dio &&
+	    lio->lis_nr_subios >= lov->lov_submit_parallel)
+		RETURN(lov_io_submit_parallel(env, ios, crt, queue, lov));
+
 	cl_page_list_init(plist);
 	while (qin->pl_nr > 0) {
 		struct cl_2queue  *cl2q = &lov_env_info(env)->lti_cl2q;
@@ -1170,6 +1467,7 @@ static int lov_io_submit(const struct lu_env *env,
 		cl_page_list_splice(&cl2q->c2_qin, plist);
 		cl_page_list_splice(&cl2q->c2_qout, &queue->c2_qout);
 		cl_2queue_fini(env, cl2q);
+		nr++;
 
 		if (rc != 0)
 			break;
@@ -1178,6 +1476,11 @@ static int lov_io_submit(const struct lu_env *env,
 	cl_page_list_splice(plist, qin);
 	cl_page_list_fini(env, plist);
 
+	if (nr > 0) {
+		lprocfs_oh_tally_log2(&lov->lov_submit_stripes_hist, nr);
+		lprocfs_oh_tally_log2(&lov->lov_submit_active_hist, 1);
+	}
+
 	RETURN(rc);
 }
 
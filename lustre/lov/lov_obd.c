@@ -759,6 +759,10 @@ int lov_setup(struct obd_device *obd, struct lustre_cfg *lcfg)
 
 	init_rwsem(&lov->lov_notify_lock);
 
+	lov->lov_submit_parallel = 0;
+	spin_lock_init(&lov->lov_submit_stripes_hist.oh_lock);
+	spin_lock_init(&lov->lov_submit_active_hist.oh_lock);
+
 	INIT_LIST_HEAD(&lov->lov_pool_list);
         lov->lov_pool_count = 0;
 	rc = lov_pool_hash_init(&lov->lov_pools_hash_body);
@@ -1362,9 +1366,17 @@ static int __init lov_init(void)
                 return -ENOMEM;
         }
 
+	rc = lov_submit_init();
+	if (rc) {
+		kmem_cache_destroy(lov_oinfo_slab);
+		lu_kmem_fini(lov_caches);
+		RETURN(rc);
+	}
+
 	rc = class_register_type(&lov_obd_ops, NULL, true, NULL,
 				 LUSTRE_LOV_NAME, &lov_device_type);
         if (rc) {
+		lov_submit_fini();
 		kmem_cache_destroy(lov_oinfo_slab);
                 lu_kmem_fini(lov_caches);
         }
@@ -1375,6 +1387,7 @@ static int __init lov_init(void)
 static void __exit lov_exit(void)
 {
 	class_unregister_type(LUSTRE_LOV_NAME);
+	lov_submit_fini();
 	kmem_cache_destroy(lov_oinfo_slab);
 	lu_kmem_fini(lov_caches);
 }
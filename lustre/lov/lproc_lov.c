@@ -210,6 +210,38 @@ static ssize_t desc_uuid_show(struct kobject *kobj, struct attribute *attr,
 }
 LUSTRE_RO_ATTR(desc_uuid);
 
+static ssize_t submit_parallel_show(struct kobject *kobj,
+				    struct attribute *attr, char *buf)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+
+	return sprintf(buf, "%u\n", obd->u.lov.lov_submit_parallel);
+}
+
+static ssize_t submit_parallel_store(struct kobject *kobj,
+				     struct attribute *attr,
+				     const char *buf, size_t count)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buf, 0, &val);
+	if (rc)
+		return rc;
+
+	/* a single stripe has nothing to run in parallel with */
+	if (val == 1)
+		return -ERANGE;
+
+	obd->u.lov.lov_submit_parallel = val;
+
+	return count;
+}
+LUSTRE_RW_ATTR(submit_parallel);
+
 #ifdef CONFIG_PROC_FS
 static void *lov_tgt_seq_start(struct seq_file *p, loff_t *pos)
 {
@@ -271,9 +303,71 @@ static int lov_target_seq_open(struct inode *inode, struct file *file)
 	return 0;
 }
 
+static void lov_submit_hist_show(struct seq_file *m, const char *name,
+				 struct obd_histogram *hist)
+{
+	unsigned long tot, t, cum = 0;
+	int i;
+
+	tot = lprocfs_oh_sum(hist);
+	if (tot == 0)
+		return;
+
+	seq_printf(m, "- %-15s\n", name);
+	for (i = 0; i < OBD_HIST_MAX; i++) {
+		t = hist->oh_buckets[i];
+		cum += t;
+		if (cum == 0)
+			continue;
+
+		seq_printf(m, "%6s%lu: { sample: %3lu, pct: %3u, cum_pct: %3u }\n",
+			   " ", 1UL << i, t, pct(t, tot), pct(cum, tot));
+		if (cum == tot)
+			break;
+	}
+}
+
+/*
+ * Histograms (log2, bucket upper bounds) of the number of stripes each
+ * submit of a cl_io was split into, and of the most threads, the IO thread
+ * plus lov_submit workers, seen submitting them at the same time.
+ */
+static int lov_submit_stats_seq_show(struct seq_file *m, void *v)
+{
+	struct obd_device *obd = m->private;
+	struct lov_obd *lov = &obd->u.lov;
+	struct timespec64 now;
+
+	/* this sampling races with updates */
+	ktime_get_real_ts64(&now);
+	seq_printf(m, "submit_stats:\n");
+	seq_printf(m, "- %-15s %llu.%9lu\n", "snapshot_time:",
+		   (s64)now.tv_sec, now.tv_nsec);
+	lov_submit_hist_show(m, "stripes", &lov->lov_submit_stripes_hist);
+	lov_submit_hist_show(m, "concurrent", &lov->lov_submit_active_hist);
+
+	return 0;
+}
+
+static ssize_t lov_submit_stats_seq_write(struct file *file,
+					  const char __user *buffer,
+					  size_t count, loff_t *off)
+{
+	struct seq_file *m = file->private_data;
+	struct obd_device *obd = m->private;
+
+	lprocfs_oh_clear(&obd->u.lov.lov_submit_stripes_hist);
+	lprocfs_oh_clear(&obd->u.lov.lov_submit_active_hist);
+
+	return count;
+}
+LPROC_SEQ_FOPS(lov_submit_stats);
+
 struct lprocfs_vars lprocfs_lov_obd_vars[] = {
 	{ .name =	"stripesize",
 	  .fops =	&lov_stripesize_fops	},
+	{ .name =	"submit_stats",
+	  .fops =	&lov_submit_stats_fops	},
 	{ NULL }
 };
 
@@ -293,6 +387,7 @@ static struct attribute *lov_attrs[] = {
 	&lustre_attr_stripeoffset.attr,
 	&lustre_attr_stripetype.attr,
 	&lustre_attr_stripecount.attr,
+	&lustre_attr_submit_parallel.attr,
 	NULL,
 };
 
@@ -97,6 +97,8 @@ struct chlg_reader_state {
 	unsigned int		    crs_last_catidx;
 	unsigned int		    crs_last_idx;
 	bool			    crs_poll;
+	/* Record filter set by OBD_IOC_CHLG_SET_FILTER, under crs_lock */
+	struct changelog_filter	    crs_filter;
 };
 
 struct chlg_rec_entry {
@@ -188,6 +190,37 @@ static inline void chlg_obd_put(struct chlg_registered_dev *dev,
 	class_decref(obd, "changelog", dev);
 }
 
+/**
+ * Check whether a record matches the reader filter.
+ * Must be called with crs_lock held.
+ *
+ * @param[in] cf   Filter installed by OBD_IOC_CHLG_SET_FILTER.
+ * @param[in] rec  Changelog record, as stored in the llog.
+ *
+ * @return true if the record should be delivered to the reader.
+ */
+static bool chlg_filter_match(const struct changelog_filter *cf,
+			      const struct changelog_rec *rec)
+{
+	if (cf->cf_type_mask != 0 && (rec->cr_type >= 64 ||
+	    !(cf->cf_type_mask & BIT_ULL(rec->cr_type))))
+		return false;
+
+	if (!fid_is_zero(&cf->cf_tfid) &&
+	    !lu_fid_eq(&cf->cf_tfid, &rec->cr_tfid))
+		return false;
+
+	if (cf->cf_jobid[0] != '\0') {
+		if (!(rec->cr_flags & CLF_JOBID))
+			return false;
+		if (strncmp(cf->cf_jobid, changelog_rec_jobid(rec)->cr_jobid,
+			    sizeof(cf->cf_jobid)) != 0)
+			return false;
+	}
+
+	return true;
+}
+
 /**
  * ChangeLog catalog processing callback invoked on each record.
  * If the current record is eligible to userland delivery, push
@@ -208,6 +241,7 @@ static int chlg_read_cat_process_cb(const struct lu_env *env,
 	struct chlg_reader_state *crs = data;
 	struct chlg_rec_entry *enq;
 	size_t len;
+	bool match;
 	int rc;
 	ENTRY;
 
@@ -232,6 +266,13 @@ static int chlg_read_cat_process_cb(const struct lu_env *env,
 	if (rec->cr.cr_index < crs->crs_start_offset)
 		RETURN(0);
 
+	/* Drop filtered records before they are copied and queued */
+	mutex_lock(&crs->crs_lock);
+	match = chlg_filter_match(&crs->crs_filter, &rec->cr);
+	mutex_unlock(&crs->crs_lock);
+	if (!match)
+		RETURN(0);
+
 	CDEBUG(D_HSM, "%llu %02d%-5s %llu 0x%x t="DFID" p="DFID" %.*s\n",
 	       rec->cr.cr_index, rec->cr.cr_type,
 	       changelog_type2str(rec->cr.cr_type), rec->cr.cr_time,
@@ -683,6 +724,40 @@ static unsigned int chlg_poll(struct file *file, poll_table *wait)
 	return mask;
 }
 
+/**
+ * Install a new record filter for this reader. Records already prefetched
+ * which do not match the new filter are dropped.
+ *
+ * @param[in,out] crs  Internal reader state.
+ * @param[in]     arg  Userspace pointer to struct changelog_filter.
+ * @return 0 on success, negated error code on failure.
+ */
+static int chlg_set_filter(struct chlg_reader_state *crs, unsigned long arg)
+{
+	struct changelog_filter cf;
+	struct chlg_rec_entry *rec;
+	struct chlg_rec_entry *tmp;
+
+	if (copy_from_user(&cf, (void __user *)arg, sizeof(cf)))
+		return -EFAULT;
+
+	cf.cf_jobid[sizeof(cf.cf_jobid) - 1] = '\0';
+
+	mutex_lock(&crs->crs_lock);
+	crs->crs_filter = cf;
+	list_for_each_entry_safe(rec, tmp, &crs->crs_rec_queue, enq_linkage) {
+		if (chlg_filter_match(&crs->crs_filter, rec->enq_record))
+			continue;
+
+		crs->crs_rec_count--;
+		enq_record_delete(rec);
+	}
+	mutex_unlock(&crs->crs_lock);
+	wake_up_all(&crs->crs_waitq_prod);
+
+	return 0;
+}
+
 static long chlg_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 {
 	int rc;
@@ -693,6 +768,9 @@ static long chlg_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		crs->crs_poll = !!arg;
 		rc = 0;
 		break;
+	case OBD_IOC_CHLG_SET_FILTER:
+		rc = chlg_set_filter(crs, arg);
+		break;
 	default:
 		rc = -EINVAL;
 		break;
@@ -42,6 +42,7 @@
 #include <linux/uidgid.h>
 #include <linux/device.h>
 #include <linux/xarray.h>
+#include <linux/workqueue.h>
 
 #include <lustre_errno.h>
 
@@ -1032,28 +1033,24 @@ out:
 	RETURN(rc < 0 ? rc : saved_rc);
 }
 
-static int mdc_getpage(struct obd_export *exp, const struct lu_fid *fid,
-		       u64 offset, struct page **pages, int npages,
-		       struct ptlrpc_request **request)
+static struct ptlrpc_request *mdc_getpage_prep(struct obd_export *exp,
+						const struct lu_fid *fid,
+						u64 offset, struct page **pages,
+						int npages)
 {
 	struct ptlrpc_request   *req;
 	struct ptlrpc_bulk_desc *desc;
 	int                      i;
-	int                      resends = 0;
 	int                      rc;
-	ENTRY;
-
-	*request = NULL;
 
-restart_bulk:
 	req = ptlrpc_request_alloc(class_exp2cliimp(exp), &RQF_MDS_READPAGE);
 	if (req == NULL)
-		RETURN(-ENOMEM);
+		return ERR_PTR(-ENOMEM);
 
 	rc = ptlrpc_request_pack(req, LUSTRE_MDS_VERSION, MDS_READPAGE);
 	if (rc) {
 		ptlrpc_request_free(req);
-		RETURN(rc);
+		return ERR_PTR(rc);
 	}
 
 	req->rq_request_portal = MDS_READPAGE_PORTAL;
@@ -1065,7 +1062,7 @@ restart_bulk:
 				    &ptlrpc_bulk_kiov_pin_ops);
 	if (desc == NULL) {
 		ptlrpc_req_finished(req);
-		RETURN(-ENOMEM);
+		return ERR_PTR(-ENOMEM);
 	}
 
 	/* NB req now owns desc and will free it when it gets freed */
@@ -1076,6 +1073,47 @@ restart_bulk:
 	mdc_readdir_pack(req, offset, PAGE_SIZE * npages, fid);
 
 	ptlrpc_request_set_replen(req);
+
+	return req;
+}
+
+/* check the bulk of a completed READPAGE request */
+static int mdc_getpage_check(struct obd_export *exp,
+			     struct ptlrpc_request *req)
+{
+	int rc;
+
+	rc = sptlrpc_cli_unwrap_bulk_read(req, req->rq_bulk,
+					  req->rq_bulk->bd_nob_transferred);
+	if (rc < 0)
+		return rc;
+
+	if (req->rq_bulk->bd_nob_transferred & ~LU_PAGE_MASK) {
+		CERROR("%s: unexpected bytes transferred: %d (%ld expected)\n",
+		       exp->exp_obd->obd_name, req->rq_bulk->bd_nob_transferred,
+		       PAGE_SIZE * req->rq_bulk->bd_iov_count);
+		return -EPROTO;
+	}
+
+	return 0;
+}
+
+static int mdc_getpage(struct obd_export *exp, const struct lu_fid *fid,
+		       u64 offset, struct page **pages, int npages,
+		       struct ptlrpc_request **request)
+{
+	struct ptlrpc_request   *req;
+	int                      resends = 0;
+	int                      rc;
+	ENTRY;
+
+	*request = NULL;
+
+restart_bulk:
+	req = mdc_getpage_prep(exp, fid, offset, pages, npages);
+	if (IS_ERR(req))
+		RETURN(PTR_ERR(req));
+
 	rc = ptlrpc_queue_wait(req);
 	if (rc) {
 		ptlrpc_req_finished(req);
@@ -1098,21 +1136,12 @@ restart_bulk:
 		goto restart_bulk;
 	}
 
-	rc = sptlrpc_cli_unwrap_bulk_read(req, req->rq_bulk,
-					  req->rq_bulk->bd_nob_transferred);
+	rc = mdc_getpage_check(exp, req);
 	if (rc < 0) {
 		ptlrpc_req_finished(req);
 		RETURN(rc);
 	}
 
-	if (req->rq_bulk->bd_nob_transferred & ~LU_PAGE_MASK) {
-		CERROR("%s: unexpected bytes transferred: %d (%ld expected)\n",
-		       exp->exp_obd->obd_name, req->rq_bulk->bd_nob_transferred,
-		       PAGE_SIZE * npages);
-		ptlrpc_req_finished(req);
-		RETURN(-EPROTO);
-	}
-
 	*request = req;
 	RETURN(0);
 }
@@ -1154,11 +1183,15 @@ static struct page *mdc_page_locate(struct address_space *mapping, __u64 *hash,
 		 * page cannot be truncated (while DLM lock is held) and,
 		 * hence, can avoid restart.
 		 *
-		 * In fact, page cannot be locked here at all, because
-		 * mdc_read_page_remote does synchronous io.
+		 * The page is locked while it is being read, either by
+		 * mdc_read_page_remote() or by a readdir prefetch RPC.
 		 */
 		wait_on_page_locked(page);
-		if (PageUptodate(page)) {
+		if (!PageUptodate(page) && page->mapping == NULL) {
+			/* failed prefetch was removed, read it again */
+			put_page(page);
+			page = NULL;
+		} else if (PageUptodate(page)) {
 			dp = kmap(page);
 			if (BITS_PER_LONG == 32 && hash64) {
 				*start = le64_to_cpu(dp->ldp_hash_start) >> 32;
@@ -1310,11 +1343,69 @@ static void mdc_adjust_dirpages(struct page **pages, int cfs_pgs, int lu_pgs)
 struct readpage_param {
 	struct md_op_data	*rp_mod;
 	__u64			rp_off;
+	__u64			rp_next;	/* hash following pages read */
 	int			rp_hash64;
 	struct obd_export	*rp_exp;
 	struct md_callback	*rp_cb;
 };
 
+/**
+ * Insert pages read by a READPAGE RPC into the directory page cache.
+ *
+ * The first page of \a page_pool was already added to the page cache by
+ * the caller, the others are added at the index of their start hash.
+ * The references on all pages but the first one are dropped.
+ *
+ * \retval		end hash of the last page read, or MDS_DIR_END_OFF
+ */
+static __u64 mdc_dirpages_cache(struct inode *inode, struct page **page_pool,
+				int npages, int rd_pgs, int hash64, int rc)
+{
+	__u64 next = MDS_DIR_END_OFF;
+	struct lu_dirpage *dp;
+	struct page *page;
+	int i;
+
+	if (rc == 0 && rd_pgs > 0) {
+		dp = kmap(page_pool[rd_pgs - 1]);
+		next = le64_to_cpu(dp->ldp_hash_end);
+		kunmap(page_pool[rd_pgs - 1]);
+	}
+
+	for (i = 1; i < npages; i++) {
+		unsigned long	offset;
+		__u64		hash;
+		int ret;
+
+		page = page_pool[i];
+
+		if (rc < 0 || i >= rd_pgs) {
+			put_page(page);
+			continue;
+		}
+
+		SetPageUptodate(page);
+
+		dp = kmap(page);
+		hash = le64_to_cpu(dp->ldp_hash_start);
+		kunmap(page);
+
+		offset = hash_x_index(hash, hash64);
+
+		prefetchw(&page->flags);
+		ret = add_to_page_cache_lru(page, inode->i_mapping, offset,
+					    GFP_KERNEL);
+		if (ret == 0)
+			unlock_page(page);
+		else
+			CDEBUG(D_VFSTRACE, "page %lu add to page cache failed:"
+			       " rc = %d\n", offset, ret);
+		put_page(page);
+	}
+
+	return next;
+}
+
 /**
  * Read pages from server.
  *
@@ -1330,7 +1421,6 @@ static int mdc_read_page_remote(void *data, struct page *page0)
 	struct readpage_param *rp = data;
 	struct page **page_pool;
 	struct page *page;
-	struct lu_dirpage *dp;
 	struct md_op_data *op_data = rp->rp_mod;
 	struct ptlrpc_request *req;
 	int max_pages;
@@ -1338,7 +1428,6 @@ static int mdc_read_page_remote(void *data, struct page *page0)
 	struct lu_fid *fid;
 	int rd_pgs = 0; /* number of pages actually read */
 	int npages;
-	int i;
 	int rc;
 	ENTRY;
 
@@ -1384,41 +1473,260 @@ static int mdc_read_page_remote(void *data, struct page *page0)
 
 	ptlrpc_req_finished(req);
 	CDEBUG(D_CACHE, "read %d/%d pages\n", rd_pgs, npages);
-	for (i = 1; i < npages; i++) {
-		unsigned long	offset;
-		__u64		hash;
-		int ret;
+	rp->rp_next = mdc_dirpages_cache(inode, page_pool, npages, rd_pgs,
+					 rp->rp_hash64, rc);
 
-		page = page_pool[i];
+	if (page_pool != &page0)
+		OBD_FREE_PTR_ARRAY(page_pool, max_pages);
 
-		if (rc < 0 || i >= rd_pgs) {
-			put_page(page);
-			continue;
-		}
+	RETURN(rc);
+}
 
-		SetPageUptodate(page);
+/* maximum number of READPAGE RPCs prefetched ahead of the readdir cursor */
+#define MDC_READDIR_RA_MAX	8
+
+/* completes readdir prefetch RPCs out of ptlrpcd context */
+static struct workqueue_struct *mdc_readdir_wq;
+
+/* state of a readdir prefetch RPC */
+struct mdc_readdir_ra {
+	struct work_struct	 mrr_work;
+	struct obd_export	*mrr_exp;
+	struct inode		*mrr_inode;
+	struct lu_fid		 mrr_fid;
+	struct lustre_handle	 mrr_lockh;
+	enum ldlm_mode		 mrr_mode;
+	int			 mrr_hash64;
+	/* number of RPCs still to be chained after this one */
+	int			 mrr_depth;
+	/* RPC result and bytes transferred, set by the interpreter */
+	int			 mrr_rc;
+	int			 mrr_nob;
+	int			 mrr_npages;
+	struct page		*mrr_pages[0];
+};
 
-		dp = kmap(page);
-		hash = le64_to_cpu(dp->ldp_hash_start);
-		kunmap(page);
+static void mdc_readdir_ra_start(struct obd_export *exp, struct inode *inode,
+				 const struct lu_fid *fid,
+				 const struct lustre_handle *lockh,
+				 enum ldlm_mode mode, __u64 hash, int hash64,
+				 int depth);
+
+/**
+ * Complete a readdir prefetch RPC.
+ *
+ * Inserting the pages into the page cache may enter memory reclaim, the
+ * next RPC of the chain is prepared here and the inode reference may be
+ * the last one, so this is not done by ptlrpcd in the RPC interpreter.
+ */
+static void mdc_readdir_ra_work(struct work_struct *work)
+{
+	struct mdc_readdir_ra *ra = container_of(work, struct mdc_readdir_ra,
+						 mrr_work);
+	struct page *page0 = ra->mrr_pages[0];
+	int rc = ra->mrr_rc;
+	__u64 next;
+	int rd_pgs = 0;
+
+	if (rc == 0) {
+		rd_pgs = (ra->mrr_nob + PAGE_SIZE - 1) >> PAGE_SHIFT;
+		mdc_adjust_dirpages(ra->mrr_pages, rd_pgs,
+				    ra->mrr_nob >> LU_PAGE_SHIFT);
+		SetPageUptodate(page0);
+	} else {
+		/* readers waiting on page0 will fetch it themselves */
+		delete_from_page_cache(page0);
+	}
+	unlock_page(page0);
 
-		offset = hash_x_index(hash, rp->rp_hash64);
+	CDEBUG(D_CACHE, "%s: prefetched %d/%d pages of "DFID": rc = %d\n",
+	       ra->mrr_exp->exp_obd->obd_name, rd_pgs, ra->mrr_npages,
+	       PFID(&ra->mrr_fid), rc);
 
-		prefetchw(&page->flags);
-		ret = add_to_page_cache_lru(page, inode->i_mapping, offset,
-					    GFP_KERNEL);
-		if (ret == 0)
-			unlock_page(page);
-		else
-			CDEBUG(D_VFSTRACE, "page %lu add to page cache failed:"
-			       " rc = %d\n", offset, ret);
+	next = mdc_dirpages_cache(ra->mrr_inode, ra->mrr_pages,
+				  ra->mrr_npages, rd_pgs, ra->mrr_hash64, rc);
+	put_page(page0);
+
+	if (rc == 0 && ra->mrr_depth > 0)
+		mdc_readdir_ra_start(ra->mrr_exp, ra->mrr_inode, &ra->mrr_fid,
+				     &ra->mrr_lockh, ra->mrr_mode, next,
+				     ra->mrr_hash64, ra->mrr_depth - 1);
+
+	ldlm_lock_decref(&ra->mrr_lockh, ra->mrr_mode);
+	iput(ra->mrr_inode);
+	class_export_put(ra->mrr_exp);
+	OBD_FREE(ra, offsetof(struct mdc_readdir_ra,
+			      mrr_pages[ra->mrr_npages]));
+}
+
+static int mdc_readdir_ra_interpret(const struct lu_env *env,
+				    struct ptlrpc_request *req, void *args,
+				    int rc)
+{
+	struct mdc_readdir_ra *ra = *(struct mdc_readdir_ra **)args;
+
+	if (rc == 0)
+		rc = mdc_getpage_check(ra->mrr_exp, req);
+	if (rc == 0)
+		ra->mrr_nob = req->rq_bulk->bd_nob_transferred;
+	ra->mrr_rc = rc;
+
+	queue_work(mdc_readdir_wq, &ra->mrr_work);
+
+	return 0;
+}
+
+/**
+ * Start an asynchronous READPAGE RPC for the pages following \a hash.
+ *
+ * The first page is added locked to the page cache before the RPC is
+ * sent, so a reader reaching it waits for the prefetch in
+ * mdc_page_locate() instead of sending the same RPC again, and
+ * concurrent prefetches of the same range are skipped. The RPC holds a
+ * reference on the UPDATE lock protecting the directory pages, so the
+ * lock cannot be cancelled and the pages truncated until they are in
+ * the cache. On completion the next range is prefetched until \a depth
+ * is exhausted.
+ */
+static void mdc_readdir_ra_start(struct obd_export *exp, struct inode *inode,
+				 const struct lu_fid *fid,
+				 const struct lustre_handle *lockh,
+				 enum ldlm_mode mode, __u64 hash, int hash64,
+				 int depth)
+{
+	struct address_space *mapping = inode->i_mapping;
+	struct mdc_readdir_ra **args;
+	struct mdc_readdir_ra *ra;
+	struct ptlrpc_request *req;
+	struct ldlm_lock *lock;
+	struct page *page0;
+	int max_pages;
+	bool cancel;
+
+	if (hash == MDS_DIR_END_OFF)
+		return;
+
+	/* don't hold up a lock which is being cancelled */
+	lock = ldlm_handle2lock(lockh);
+	if (lock == NULL)
+		return;
+	cancel = ldlm_is_cbpending(lock);
+	LDLM_LOCK_PUT(lock);
+	if (cancel)
+		return;
+
+	page0 = page_cache_alloc(mapping);
+	if (page0 == NULL)
+		return;
+
+	if (add_to_page_cache_lru(page0, mapping, hash_x_index(hash, hash64),
+				  GFP_NOFS)) {
+		/* already cached or being read */
+		put_page(page0);
+		return;
+	}
+
+	max_pages = exp->exp_obd->u.cli.cl_max_pages_per_rpc;
+	OBD_ALLOC(ra, offsetof(struct mdc_readdir_ra, mrr_pages[max_pages]));
+	if (ra == NULL)
+		goto out_page;
+
+	ra->mrr_inode = igrab(inode);
+	if (ra->mrr_inode == NULL)
+		goto out_free;
+
+	ra->mrr_pages[0] = page0;
+	for (ra->mrr_npages = 1; ra->mrr_npages < max_pages;
+	     ra->mrr_npages++) {
+		struct page *page = page_cache_alloc(mapping);
+
+		if (page == NULL)
+			break;
+		ra->mrr_pages[ra->mrr_npages] = page;
+	}
+
+	req = mdc_getpage_prep(exp, fid, hash, ra->mrr_pages, ra->mrr_npages);
+	if (IS_ERR(req)) {
+		int i;
+
+		for (i = 1; i < ra->mrr_npages; i++)
+			put_page(ra->mrr_pages[i]);
+		iput(ra->mrr_inode);
+		goto out_free;
+	}
+
+	INIT_WORK(&ra->mrr_work, mdc_readdir_ra_work);
+	ra->mrr_exp = class_export_get(exp);
+	ra->mrr_fid = *fid;
+	ra->mrr_lockh = *lockh;
+	ra->mrr_mode = mode;
+	ra->mrr_hash64 = hash64;
+	ra->mrr_depth = depth;
+	ldlm_lock_addref(&ra->mrr_lockh, mode);
+
+	/* a failed prefetch is simply retried by the reader */
+	req->rq_no_resend = 1;
+	req->rq_interpret_reply = mdc_readdir_ra_interpret;
+	args = ptlrpc_req_async_args(args, req);
+	*args = ra;
+
+	CDEBUG(D_CACHE, "%s: prefetch "DFID" at %#llx, depth %d\n",
+	       exp->exp_obd->obd_name, PFID(fid), hash, depth);
+	ptlrpcd_add_req(req);
+	return;
+
+out_free:
+	OBD_FREE(ra, offsetof(struct mdc_readdir_ra, mrr_pages[max_pages]));
+out_page:
+	delete_from_page_cache(page0);
+	unlock_page(page0);
+	put_page(page0);
+}
+
+/**
+ * Pipeline READPAGE RPCs ahead of the readdir cursor.
+ *
+ * Called with the page at the cursor. If the pages following it are not
+ * cached yet, prefetch them asynchronously, chaining as many RPCs as the
+ * directory size suggests are needed, up to MDC_READDIR_RA_MAX. Each
+ * stripe of a striped directory has its own chain, so stripes are read
+ * in parallel while LMV merges them.
+ *
+ * \param[in] exp	MDC export
+ * \param[in] op_data	readdir parameters, op_data->op_data is the inode
+ * \param[in] lockh	UPDATE lock protecting the directory pages
+ * \param[in] mode	mode of \a lockh
+ * \param[in] next	start hash of the pages following the cursor
+ */
+static void mdc_readdir_ra(struct obd_export *exp, struct md_op_data *op_data,
+			   const struct lustre_handle *lockh,
+			   enum ldlm_mode mode, __u64 next)
+{
+	struct inode *dir = op_data->op_data;
+	int hash64 = op_data->op_cli_flags & CLI_HASH64;
+	loff_t rpc_size;
+	struct page *page;
+	int depth;
+
+	if (next == MDS_DIR_END_OFF)
+		return;
+
+	page = find_get_page(dir->i_mapping, hash_x_index(next, hash64));
+	if (page != NULL) {
 		put_page(page);
+		return;
 	}
 
-	if (page_pool != &page0)
-		OBD_FREE_PTR_ARRAY(page_pool, max_pages);
+	/* don't prefetch more than the directory size needs */
+	rpc_size = (loff_t)exp->exp_obd->u.cli.cl_max_pages_per_rpc <<
+		   PAGE_SHIFT;
+	depth = min_t(loff_t, i_size_read(dir) / rpc_size,
+		      MDC_READDIR_RA_MAX);
+	if (depth <= 0)
+		return;
 
-	RETURN(rc);
+	mdc_readdir_ra_start(exp, dir, &op_data->op_fid1, lockh, mode, next,
+			     hash64, depth - 1);
 }
 
 /**
@@ -1475,6 +1783,7 @@ static int mdc_read_page(struct obd_export *exp, struct md_op_data *op_data,
 	mdc_set_lock_data(exp, &lockh, dir, NULL);
 
 	rp_param.rp_off = hash_offset;
+	rp_param.rp_next = MDS_DIR_END_OFF;
 	rp_param.rp_hash64 = op_data->op_cli_flags & CLI_HASH64;
 	page = mdc_page_locate(mapping, &rp_param.rp_off, &start, &end,
 			       rp_param.rp_hash64);
@@ -1558,6 +1867,11 @@ hash_collision:
 		 */
 		goto fail;
 	}
+
+	/* keep the following RPCs in flight while this page is consumed */
+	mdc_readdir_ra(exp, op_data, &lockh, it.it_lock_mode,
+		       rp_param.rp_next != MDS_DIR_END_OFF ?
+		       rp_param.rp_next : le64_to_cpu(dp->ldp_hash_end));
 	*ppage = page;
 out_unlock:
 	ldlm_lock_decref(&lockh, it.it_lock_mode);
@@ -2992,13 +3306,21 @@ static int __init mdc_init(void)
 		goto out_dev;
 	}
 
+	mdc_readdir_wq = alloc_workqueue("mdc_readdir", WQ_UNBOUND, 0);
+	if (mdc_readdir_wq == NULL) {
+		rc = -ENOMEM;
+		goto out_dev;
+	}
+
 	rc = class_register_type(&mdc_obd_ops, &mdc_md_ops, true, NULL,
 				 LUSTRE_MDC_NAME, &mdc_device_type);
 	if (rc)
-		goto out_dev;
+		goto out_wq;
 
 	return 0;
 
+out_wq:
+	destroy_workqueue(mdc_readdir_wq);
 out_dev:
 	unregister_chrdev_region(mdc_changelog_dev, MDC_CHANGELOG_DEV_COUNT);
 	return rc;
@@ -3009,6 +3331,7 @@ static void __exit mdc_exit(void)
 	class_destroy(mdc_changelog_class);
 	unregister_chrdev_region(mdc_changelog_dev, MDC_CHANGELOG_DEV_COUNT);
 	class_unregister_type(LUSTRE_MDC_NAME);
+	destroy_workqueue(mdc_readdir_wq);
 }
 
 MODULE_AUTHOR("OpenSFS, Inc. <http://www.lustre.org/>");
@@ -62,58 +62,83 @@ static void mdt_identity_entry_free(struct upcall_cache *cache,
 	}
 }
 
-static int mdt_identity_do_upcall(struct upcall_cache *cache,
-                                  struct upcall_cache_entry *entry)
+/* run the upcall to resolve \a count uids at once */
+static int mdt_identity_exec_upcall(struct upcall_cache *cache,
+				    __u64 *keys, int count)
 {
-        char keystr[16];
-        char *argv[] = {
-                  [0] = cache->uc_upcall,
-                  [1] = cache->uc_name,
-                  [2] = keystr,
-                  [3] = NULL
-        };
-        char *envp[] = {
-                  [0] = "HOME=/",
-                  [1] = "PATH=/sbin:/usr/sbin",
-                  [2] = NULL
-        };
+	char *envp[] = {
+		  [0] = "HOME=/",
+		  [1] = "PATH=/sbin:/usr/sbin",
+		  [2] = NULL
+	};
+	char **argv = NULL;
+	char *keystr = NULL;
 	ktime_t start, end;
-        int rc;
-        ENTRY;
+	int i, rc;
+	ENTRY;
+
+	LASSERT(count > 0 && count <= UC_CACHE_UPCALL_BATCH_MAX);
+
+	/* upcall, mdtname, the uids and NULL */
+	OBD_ALLOC_PTR_ARRAY(argv, count + 3);
+	OBD_ALLOC(keystr, count * 16);
+	if (!argv || !keystr)
+		GOTO(free, rc = -ENOMEM);
 
-        /* There is race condition:
-         * "uc_upcall" was changed just after "is_identity_get_disabled" check.
-         */
+	/* There is race condition:
+	 * "uc_upcall" was changed just after "is_identity_get_disabled" check.
+	 */
 	down_read(&cache->uc_upcall_rwsem);
-        CDEBUG(D_INFO, "The upcall is: '%s'\n", cache->uc_upcall);
+	CDEBUG(D_INFO, "The upcall is: '%s'\n", cache->uc_upcall);
 
-        if (unlikely(!strcmp(cache->uc_upcall, "NONE"))) {
-                CERROR("no upcall set\n");
-                GOTO(out, rc = -EREMCHG);
-        }
+	if (unlikely(!strcmp(cache->uc_upcall, "NONE"))) {
+		CERROR("no upcall set\n");
+		GOTO(out, rc = -EREMCHG);
+	}
 
 	argv[0] = cache->uc_upcall;
-	snprintf(keystr, sizeof(keystr), "%llu", entry->ue_key);
+	argv[1] = cache->uc_name;
+	for (i = 0; i < count; i++) {
+		argv[i + 2] = keystr + i * 16;
+		snprintf(argv[i + 2], 16, "%llu", keys[i]);
+	}
 
 	start = ktime_get();
 	rc = call_usermodehelper(argv[0], argv, envp, UMH_WAIT_EXEC);
 	end = ktime_get();
 	if (rc < 0) {
-		CERROR("%s: error invoking upcall %s %s %s: rc %d; check /proc/fs/lustre/mdt/%s/identity_upcall, time %ldus\n",
-		       cache->uc_name, argv[0], argv[1], argv[2], rc,
+		CERROR("%s: error invoking upcall %s %s %s (%d uids): rc %d; check /proc/fs/lustre/mdt/%s/identity_upcall, time %ldus\n",
+		       cache->uc_name, argv[0], argv[1], argv[2], count, rc,
 		       cache->uc_name, (long)ktime_us_delta(end, start));
 	} else {
-		CDEBUG(D_HA, "%s: invoked upcall %s %s %s, time %ldus\n",
-		       cache->uc_name, argv[0], argv[1], argv[2],
+		CDEBUG(D_HA, "%s: invoked upcall %s %s %s (%d uids), time %ldus\n",
+		       cache->uc_name, argv[0], argv[1], argv[2], count,
 		       (long)ktime_us_delta(end, start));
 		rc = 0;
 	}
 	EXIT;
 out:
 	up_read(&cache->uc_upcall_rwsem);
+free:
+	if (keystr)
+		OBD_FREE(keystr, count * 16);
+	if (argv)
+		OBD_FREE_PTR_ARRAY(argv, count + 3);
 	return rc;
 }
 
+static int mdt_identity_do_upcall(struct upcall_cache *cache,
+				  struct upcall_cache_entry *entry)
+{
+	return mdt_identity_exec_upcall(cache, &entry->ue_key, 1);
+}
+
+static int mdt_identity_do_batch_upcall(struct upcall_cache *cache,
+					__u64 *keys, int count)
+{
+	return mdt_identity_exec_upcall(cache, keys, count);
+}
+
 static int mdt_identity_parse_downcall(struct upcall_cache *cache,
 				       struct upcall_cache_entry *entry,
 				       void *args)
@@ -199,6 +224,7 @@ struct upcall_cache_ops mdt_identity_upcall_cache_ops = {
         .init_entry     = mdt_identity_entry_init,
         .free_entry     = mdt_identity_entry_free,
         .do_upcall      = mdt_identity_do_upcall,
+	.do_batch_upcall = mdt_identity_do_batch_upcall,
         .parse_downcall = mdt_identity_parse_downcall,
 };
 
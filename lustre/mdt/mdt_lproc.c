@@ -272,6 +272,76 @@ static ssize_t identity_acquire_expire_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(identity_acquire_expire);
 
+static ssize_t identity_neg_expire_show(struct kobject *kobj,
+					struct attribute *attr, char *buf)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	struct mdt_device *mdt = mdt_dev(obd->obd_lu_dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%lld\n",
+			 mdt->mdt_identity_cache->uc_neg_expire);
+}
+
+/* how long a uid which couldn't be resolved is denied, 0 to disable */
+static ssize_t identity_neg_expire_store(struct kobject *kobj,
+					 struct attribute *attr,
+					 const char *buffer, size_t count)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	struct mdt_device *mdt = mdt_dev(obd->obd_lu_dev);
+	time64_t val;
+	int rc;
+
+	rc = kstrtoll(buffer, 0, &val);
+	if (rc)
+		return rc;
+
+	if (val < 0 || val > INT_MAX)
+		return -ERANGE;
+
+	mdt->mdt_identity_cache->uc_neg_expire = val;
+
+	return count;
+}
+LUSTRE_RW_ATTR(identity_neg_expire);
+
+static ssize_t identity_upcall_batch_show(struct kobject *kobj,
+					  struct attribute *attr, char *buf)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	struct mdt_device *mdt = mdt_dev(obd->obd_lu_dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n",
+			 mdt->mdt_identity_cache->uc_upcall_batch);
+}
+
+/* max uids passed to one upcall, the upcall must accept several uids */
+static ssize_t identity_upcall_batch_store(struct kobject *kobj,
+					   struct attribute *attr,
+					   const char *buffer, size_t count)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	struct mdt_device *mdt = mdt_dev(obd->obd_lu_dev);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 0, &val);
+	if (rc)
+		return rc;
+
+	if (val < 1 || val > UC_CACHE_UPCALL_BATCH_MAX)
+		return -ERANGE;
+
+	mdt->mdt_identity_cache->uc_upcall_batch = val;
+
+	return count;
+}
+LUSTRE_RW_ATTR(identity_upcall_batch);
+
 static ssize_t identity_upcall_show(struct kobject *kobj,
 				    struct attribute *attr, char *buf)
 {
@@ -407,6 +477,29 @@ out:
 }
 LPROC_SEQ_FOPS_WR_ONLY(mdt, identity_info);
 
+static int mdt_identity_upcall_stats_seq_show(struct seq_file *m, void *data)
+{
+	struct obd_device *obd = m->private;
+	struct mdt_device *mdt = mdt_dev(obd->obd_lu_dev);
+
+	return upcall_cache_stats_seq_show(mdt->mdt_identity_cache, m);
+}
+
+static ssize_t
+mdt_identity_upcall_stats_seq_write(struct file *file,
+				    const char __user *buffer,
+				    size_t count, loff_t *off)
+{
+	struct seq_file *m = file->private_data;
+	struct obd_device *obd = m->private;
+	struct mdt_device *mdt = mdt_dev(obd->obd_lu_dev);
+
+	upcall_cache_stats_clear(mdt->mdt_identity_cache);
+
+	return count;
+}
+LPROC_SEQ_FOPS(mdt_identity_upcall_stats);
+
 static int mdt_site_stats_seq_show(struct seq_file *m, void *data)
 {
 	struct obd_device *obd = m->private;
@@ -1247,6 +1340,8 @@ LUSTRE_RW_ATTR(ir_factor);
 LUSTRE_RO_ATTR(tot_dirty);
 LUSTRE_RO_ATTR(tot_granted);
 LUSTRE_RO_ATTR(tot_pending);
+LUSTRE_RO_ATTR(tot_write_rpcs);
+LUSTRE_RO_ATTR(tot_sync_write_rpcs);
 LUSTRE_RW_ATTR(grant_compat_disable);
 LUSTRE_RO_ATTR(instance);
 
@@ -1256,6 +1351,8 @@ static struct attribute *mdt_attrs[] = {
 	&lustre_attr_tot_dirty.attr,
 	&lustre_attr_tot_granted.attr,
 	&lustre_attr_tot_pending.attr,
+	&lustre_attr_tot_write_rpcs.attr,
+	&lustre_attr_tot_sync_write_rpcs.attr,
 	&lustre_attr_grant_compat_disable.attr,
 	&lustre_attr_instance.attr,
 	&lustre_attr_recovery_time_hard.attr,
@@ -1264,6 +1361,8 @@ static struct attribute *mdt_attrs[] = {
 	&lustre_attr_num_exports.attr,
 	&lustre_attr_identity_expire.attr,
 	&lustre_attr_identity_acquire_expire.attr,
+	&lustre_attr_identity_neg_expire.attr,
+	&lustre_attr_identity_upcall_batch.attr,
 	&lustre_attr_identity_upcall.attr,
 	&lustre_attr_identity_flush.attr,
 	&lustre_attr_evict_tgt_nids.attr,
@@ -1296,6 +1395,8 @@ static struct lprocfs_vars lprocfs_mdt_obd_vars[] = {
 	  .fops =	&mdt_recovery_status_fops		},
 	{ .name =	"identity_info",
 	  .fops =	&mdt_identity_info_fops			},
+	{ .name =	"identity_upcall_stats",
+	  .fops =	&mdt_identity_upcall_stats_fops		},
 	{ .name =	"site_stats",
 	  .fops =	&mdt_site_stats_fops			},
 	{ .name =	"evict_client",
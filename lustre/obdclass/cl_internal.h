@@ -51,6 +51,9 @@ extern struct kmem_cache *cl_page_kmem_array[16];
 extern unsigned short cl_page_kmem_size_array[16];
 
 struct cl_thread_info *cl_env_info(const struct lu_env *env);
+int cl_page_magazine_init(void);
+void cl_page_magazine_fini(void);
+void cl_page_magazine_stats(struct cache_stats *cs);
 void cl_page_disown0(const struct lu_env *env,
 		     struct cl_io *io, struct cl_page *pg);
 
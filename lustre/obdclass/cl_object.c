@@ -541,6 +541,7 @@ int cl_site_stats_print(const struct cl_site *site, struct seq_file *m)
 		[CPS_PAGEIN]	= "r",
 		[CPS_FREEING]	= "f"
 	};
+	struct cache_stats pgbuf_stats;
 	size_t i;
 
 /*
@@ -548,6 +549,7 @@ int cl_site_stats_print(const struct cl_site *site, struct seq_file *m)
 pages: ...... ...... ...... ...... ...... [...... ...... ...... ......]
 locks: ...... ...... ...... ...... ...... [...... ...... ...... ...... ......]
   env: ...... ...... ...... ...... ......
+pgbuf: ...... ...... ...... ...... ......
  */
 	lu_site_stats_seq_print(&site->cs_lu, m);
 	cache_stats_print(&site->cs_pages, m, 1);
@@ -558,6 +560,10 @@ locks: ...... ...... ...... ...... ...... [...... ...... ...... ...... ......]
 	seq_printf(m, "]\n");
 	cache_stats_print(&cl_env_stats, m, 0);
 	seq_printf(m, "\n");
+	cache_stats_init(&pgbuf_stats, "pgbuf");
+	cl_page_magazine_stats(&pgbuf_stats);
+	cache_stats_print(&pgbuf_stats, m, 0);
+	seq_printf(m, "\n");
 	return 0;
 }
 EXPORT_SYMBOL(cl_site_stats_print);
@@ -1091,8 +1097,14 @@ int cl_global_init(void)
 	if (result) /* no cl_env_percpu_fini on error */
 		GOTO(out_keys, result);
 
+	result = cl_page_magazine_init();
+	if (result)
+		GOTO(out_percpu, result);
+
 	return 0;
 
+out_percpu:
+	cl_env_percpu_fini();
 out_keys:
 	lu_context_key_degister(&cl_key);
 out_kmem:
@@ -1110,6 +1122,7 @@ void cl_global_fini(void)
 {
 	int i;
 
+	cl_page_magazine_fini();
 	for (i = 0; i < ARRAY_SIZE(cl_page_kmem_array); i++) {
 		if (cl_page_kmem_array[i]) {
 			kmem_cache_destroy(cl_page_kmem_array[i]);
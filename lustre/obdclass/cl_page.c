@@ -143,6 +143,130 @@ cl_page_at_trusted(const struct cl_page *page,
 	RETURN(NULL);
 }
 
+/**
+ * Per-CPU magazines of free cl_page buffers, one for each of the
+ * cl_page_kmem_array caches.
+ *
+ * Pages are allocated and freed at a very high rate by buffered I/O, the
+ * magazines let most of them be recycled on the same CPU without going
+ * through the slab allocator, and return freed buffers to the slab half a
+ * magazine at a time.
+ */
+#define CL_PAGE_MAG_SIZE	16
+
+struct cl_page_magazine {
+	unsigned int		 cpm_count;
+	void			*cpm_bufs[CL_PAGE_MAG_SIZE];
+};
+
+struct cl_page_pcpu {
+	struct cl_page_magazine	 cpp_mags[ARRAY_SIZE(cl_page_kmem_array)];
+	/** allocations served by the magazines */
+	unsigned long		 cpp_hits;
+	/** allocations which had to go to the slab */
+	unsigned long		 cpp_misses;
+};
+
+static struct cl_page_pcpu __percpu *cl_page_pcpu;
+
+int cl_page_magazine_init(void)
+{
+	cl_page_pcpu = alloc_percpu(struct cl_page_pcpu);
+	return cl_page_pcpu != NULL ? 0 : -ENOMEM;
+}
+
+/**
+ * Release the buffers held by the magazines, called before the caches of
+ * cl_page_kmem_array are destroyed.
+ */
+void cl_page_magazine_fini(void)
+{
+	struct cl_page_magazine *mag;
+	int cpu;
+	int i;
+
+	if (cl_page_pcpu == NULL)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		for (i = 0; i < ARRAY_SIZE(cl_page_kmem_array); i++) {
+			mag = &per_cpu_ptr(cl_page_pcpu, cpu)->cpp_mags[i];
+			while (mag->cpm_count > 0)
+				OBD_SLAB_FREE(mag->cpm_bufs[--mag->cpm_count],
+					      cl_page_kmem_array[i],
+					      cl_page_kmem_size_array[i]);
+		}
+	}
+	free_percpu(cl_page_pcpu);
+	cl_page_pcpu = NULL;
+}
+
+/**
+ * Fill \a cs with the magazine statistics of all the CPUs: lookup counts
+ * the allocations, hit those served by a magazine, total the buffers held
+ * by the magazines and create those allocated from the slab.
+ */
+void cl_page_magazine_stats(struct cache_stats *cs)
+{
+	struct cl_page_pcpu *pcpu;
+	unsigned long hits = 0;
+	unsigned long misses = 0;
+	unsigned int cached = 0;
+	int cpu;
+	int i;
+
+	for_each_possible_cpu(cpu) {
+		pcpu = per_cpu_ptr(cl_page_pcpu, cpu);
+		hits += READ_ONCE(pcpu->cpp_hits);
+		misses += READ_ONCE(pcpu->cpp_misses);
+		for (i = 0; i < ARRAY_SIZE(cl_page_kmem_array); i++)
+			cached += READ_ONCE(pcpu->cpp_mags[i].cpm_count);
+	}
+	atomic_set(&cs->cs_stats[CS_lookup], hits + misses);
+	atomic_set(&cs->cs_stats[CS_hit], hits);
+	atomic_set(&cs->cs_stats[CS_total], cached);
+	atomic_set(&cs->cs_stats[CS_create], misses);
+}
+
+static struct cl_page *cl_page_magazine_get(int index, unsigned short bufsize)
+{
+	struct cl_page_magazine *mag;
+	struct cl_page_pcpu *pcpu;
+	void *buf = NULL;
+
+	pcpu = get_cpu_ptr(cl_page_pcpu);
+	mag = &pcpu->cpp_mags[index];
+	if (mag->cpm_count > 0) {
+		buf = mag->cpm_bufs[--mag->cpm_count];
+		pcpu->cpp_hits++;
+	} else {
+		pcpu->cpp_misses++;
+	}
+	put_cpu_ptr(cl_page_pcpu);
+
+	/* slab allocations are zeroed, so must be the recycled buffers */
+	if (buf != NULL)
+		memset(buf, 0, bufsize);
+
+	return buf;
+}
+
+static void cl_page_magazine_put(struct cl_page *cl_page, int index,
+				 unsigned short bufsize)
+{
+	struct cl_page_magazine *mag;
+
+	mag = &get_cpu_ptr(cl_page_pcpu)->cpp_mags[index];
+	if (mag->cpm_count == CL_PAGE_MAG_SIZE) {
+		/* return half of the magazine to the slab in one go */
+		while (mag->cpm_count > CL_PAGE_MAG_SIZE / 2)
+			OBD_SLAB_FREE(mag->cpm_bufs[--mag->cpm_count],
+				      cl_page_kmem_array[index], bufsize);
+	}
+	mag->cpm_bufs[mag->cpm_count++] = cl_page;
+	put_cpu_ptr(cl_page_pcpu);
+}
+
 static void __cl_page_free(struct cl_page *cl_page, unsigned short bufsize)
 {
 	int index = cl_page->cp_kmem_index;
@@ -150,7 +274,7 @@ static void __cl_page_free(struct cl_page *cl_page, unsigned short bufsize)
 	if (index >= 0) {
 		LASSERT(index < ARRAY_SIZE(cl_page_kmem_array));
 		LASSERT(cl_page_kmem_size_array[index] == bufsize);
-		OBD_SLAB_FREE(cl_page, cl_page_kmem_array[index], bufsize);
+		cl_page_magazine_put(cl_page, index, bufsize);
 	} else {
 		OBD_FREE(cl_page, bufsize);
 	}
@@ -209,8 +333,11 @@ check:
 	for ( ; i < ARRAY_SIZE(cl_page_kmem_array); i++) {
 		if (smp_load_acquire(&cl_page_kmem_size_array[i])
 		    == bufsize) {
-			OBD_SLAB_ALLOC_GFP(cl_page, cl_page_kmem_array[i],
-					   bufsize, GFP_NOFS);
+			cl_page = cl_page_magazine_get(i, bufsize);
+			if (cl_page == NULL)
+				OBD_SLAB_ALLOC_GFP(cl_page,
+						   cl_page_kmem_array[i],
+						   bufsize, GFP_NOFS);
 			if (cl_page)
 				cl_page->cp_kmem_index = i;
 			return cl_page;
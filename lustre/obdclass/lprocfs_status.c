@@ -631,6 +631,8 @@ static const char *obd_connect_names[] = {
 	"crush",		/* 0x2000 */
 	"async_discard",	/* 0x4000 */
 	"client_encryption",	/* 0x8000 */
+	"fidmap",		/* 0x10000 */
+	"out_batch",		/* 0x20000 */
 	NULL
 };
 
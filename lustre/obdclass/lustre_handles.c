@@ -36,6 +36,8 @@
 
 #define DEBUG_SUBSYSTEM S_CLASS
 
+#include <linux/hash.h>
+#include <linux/percpu.h>
 #include <linux/random.h>
 
 #include <obd_support.h>
@@ -43,17 +45,43 @@
 #include <lustre_lib.h>
 
 
+/*
+ * Each CPU generates its own cookies, the ones of CPU n are
+ * handle_base + (k * nr_cpu_ids + n) * HANDLE_INCR, so that no global
+ * lock is needed to keep them unique.
+ */
 static __u64 handle_base;
 #define HANDLE_INCR 7
-static DEFINE_SPINLOCK(handle_base_lock);
+static DEFINE_PER_CPU(__u64, handle_count);
 
 static struct handle_bucket {
 	spinlock_t lock;
 	struct hlist_head	head;
 } *handle_hash;
 
-#define HANDLE_HASH_SIZE (1 << 16)
-#define HANDLE_HASH_MASK (HANDLE_HASH_SIZE - 1)
+/* the hash grows with the number of CPUs, as the number of handles does */
+#define HANDLE_HASH_MIN_BITS	16
+#define HANDLE_HASH_MAX_BITS	18
+static unsigned int handle_hash_bits;
+
+#define HANDLE_HASH_SIZE	(1U << handle_hash_bits)
+
+static inline struct handle_bucket *handle_bucket(u64 cookie)
+{
+	return &handle_hash[hash_64(cookie, handle_hash_bits)];
+}
+
+static __u64 handle_cookie_alloc(void)
+{
+	__u64 count;
+	int cpu;
+
+	cpu = get_cpu();
+	count = __this_cpu_inc_return(handle_count);
+	put_cpu();
+
+	return handle_base + (count * nr_cpu_ids + cpu) * HANDLE_INCR;
+}
 
 /*
  * Generate a unique 64bit cookie (hash) for a handle and insert it into
@@ -72,24 +100,20 @@ void class_handle_hash(struct portals_handle *h, const char *owner)
 	 * This is fast, but simplistic cookie generation algorithm, it will
 	 * need a re-do at some point in the future for security.
 	 */
-	spin_lock(&handle_base_lock);
-	handle_base += HANDLE_INCR;
-
-	if (unlikely(handle_base == 0)) {
+	h->h_cookie = handle_cookie_alloc();
+	if (unlikely(h->h_cookie == 0)) {
 		/*
 		 * Cookie of zero is "dangerous", because in many places it's
 		 * assumed that 0 means "unassigned" handle, not bound to any
 		 * object.
 		 */
 		CWARN("The universe has been exhausted: cookie wrap-around.\n");
-		handle_base += HANDLE_INCR;
+		h->h_cookie = handle_cookie_alloc();
 	}
-	h->h_cookie = handle_base;
-	spin_unlock(&handle_base_lock);
 
 	h->h_owner = owner;
 
-	bucket = &handle_hash[h->h_cookie & HANDLE_HASH_MASK];
+	bucket = handle_bucket(h->h_cookie);
 	spin_lock(&bucket->lock);
 	hlist_add_head_rcu(&h->h_link, &bucket->head);
 	spin_unlock(&bucket->lock);
@@ -116,8 +140,7 @@ static void class_handle_unhash_nolock(struct portals_handle *h)
 
 void class_handle_unhash(struct portals_handle *h)
 {
-	struct handle_bucket *bucket;
-	bucket = handle_hash + (h->h_cookie & HANDLE_HASH_MASK);
+	struct handle_bucket *bucket = handle_bucket(h->h_cookie);
 
 	spin_lock(&bucket->lock);
 	class_handle_unhash_nolock(h);
@@ -139,7 +162,7 @@ void *class_handle2object(u64 cookie, const char *owner)
 	 * Be careful when you want to change this code. See the
 	 * rcu_read_lock() definition on top this file. - jxiong
 	 */
-	bucket = handle_hash + (cookie & HANDLE_HASH_MASK);
+	bucket = handle_bucket(cookie);
 
 	rcu_read_lock();
 	hlist_for_each_entry_rcu(h, &bucket->head, h_link) {
@@ -166,6 +189,9 @@ int class_handle_init(void)
 
 	LASSERT(handle_hash == NULL);
 
+	handle_hash_bits = clamp_t(unsigned int,
+				   ilog2(num_possible_cpus()) + 12,
+				   HANDLE_HASH_MIN_BITS, HANDLE_HASH_MAX_BITS);
 	OBD_ALLOC_PTR_ARRAY_LARGE(handle_hash, HANDLE_HASH_SIZE);
 	if (handle_hash == NULL)
 		return -ENOMEM;
@@ -46,6 +46,8 @@ static inline struct dt_device *scrub_obj2dev(struct dt_object *obj)
 
 static void scrub_file_to_cpu(struct scrub_file *des, struct scrub_file *src)
 {
+	int i;
+
 	uuid_copy(&des->sf_uuid, &src->sf_uuid);
 	des->sf_flags	= le64_to_cpu(src->sf_flags);
 	des->sf_magic	= le32_to_cpu(src->sf_magic);
@@ -75,11 +77,18 @@ static void scrub_file_to_cpu(struct scrub_file *des, struct scrub_file *src)
 	des->sf_success_count   = le32_to_cpu(src->sf_success_count);
 	des->sf_oi_count	= le16_to_cpu(src->sf_oi_count);
 	des->sf_internal_flags	= le16_to_cpu(src->sf_internal_flags);
+	des->sf_parts	= le32_to_cpu(src->sf_parts);
+	des->sf_pos_parts_checkpoint =
+				le64_to_cpu(src->sf_pos_parts_checkpoint);
+	for (i = 0; i < SCRUB_PARTS_MAX; i++)
+		des->sf_pos_parts[i] = le64_to_cpu(src->sf_pos_parts[i]);
 	memcpy(des->sf_oi_bitmap, src->sf_oi_bitmap, SCRUB_OI_BITMAP_SIZE);
 }
 
 static void scrub_file_to_le(struct scrub_file *des, struct scrub_file *src)
 {
+	int i;
+
 	uuid_copy(&des->sf_uuid, &src->sf_uuid);
 	des->sf_flags	= cpu_to_le64(src->sf_flags);
 	des->sf_magic	= cpu_to_le32(src->sf_magic);
@@ -109,6 +118,11 @@ static void scrub_file_to_le(struct scrub_file *des, struct scrub_file *src)
 	des->sf_success_count   = cpu_to_le32(src->sf_success_count);
 	des->sf_oi_count	= cpu_to_le16(src->sf_oi_count);
 	des->sf_internal_flags	= cpu_to_le16(src->sf_internal_flags);
+	des->sf_parts	= cpu_to_le32(src->sf_parts);
+	des->sf_pos_parts_checkpoint =
+				cpu_to_le64(src->sf_pos_parts_checkpoint);
+	for (i = 0; i < SCRUB_PARTS_MAX; i++)
+		des->sf_pos_parts[i] = cpu_to_le64(src->sf_pos_parts[i]);
 	memcpy(des->sf_oi_bitmap, src->sf_oi_bitmap, SCRUB_OI_BITMAP_SIZE);
 }
 
@@ -146,6 +160,7 @@ void scrub_file_reset(struct lustre_scrub *scrub, uuid_t uuid, u64 flags)
 	sf->sf_items_failed = 0;
 	sf->sf_items_noscrub = 0;
 	sf->sf_items_igif = 0;
+	sf->sf_parts = 0;
 	if (!scrub->os_in_join)
 		sf->sf_items_updated_prior = 0;
 }
@@ -983,7 +998,8 @@ int lustre_index_restore(const struct lu_env *env, struct dt_device *dev,
 			 const struct lu_fid *tgt_fid,
 			 const struct lu_fid *bak_fid, const char *name,
 			 struct list_head *head, spinlock_t *lock,
-			 char *buf, int bufsize)
+			 char *buf, int bufsize,
+			 lustre_index_restore_records_t restore_records)
 {
 	struct dt_object *parent_obj = NULL;
 	struct dt_object *tgt_obj = NULL;
@@ -1164,6 +1180,18 @@ int lustre_index_restore(const struct lu_env *env, struct dt_device *dev,
 		lbuf.lb_buf = buf;
 		lbuf.lb_len = size;
 		rc = dt_record_read(env, bak_obj, &lbuf, &pos);
+		if (!rc && restore_records) {
+			/* Tn: restore the records of the chunk at once. */
+			rc = restore_records(env, dev, tgt_obj, buf, items,
+					     keysize, recsize);
+			if (rc != -EOPNOTSUPP) {
+				count -= items;
+				continue;
+			}
+
+			rc = 0;
+		}
+
 		for (i = 0; i < items && !rc; i++) {
 			void *key = &buf[i * pairsize];
 			void *rec = &buf[i * pairsize + keysize];
@@ -37,8 +37,18 @@
 
 #include <libcfs/libcfs.h>
 #include <uapi/linux/lnet/lnet-types.h>
+#include <obd_support.h>
 #include <upcall_cache.h>
 
+/* refcount of an entry being freed, it can't be looked up anymore */
+#define UC_CACHE_DEAD_REF	(-1)
+
+static inline struct upcall_cache_bucket *
+cache_bucket(struct upcall_cache *cache, __u64 key)
+{
+	return &cache->uc_hashtable[UC_CACHE_HASH_INDEX(key)];
+}
+
 static struct upcall_cache_entry *alloc_entry(struct upcall_cache *cache,
 					      __u64 key, void *args)
 {
@@ -49,7 +59,7 @@ static struct upcall_cache_entry *alloc_entry(struct upcall_cache *cache,
 		return NULL;
 
 	UC_CACHE_SET_NEW(entry);
-	INIT_LIST_HEAD(&entry->ue_hash);
+	INIT_HLIST_NODE(&entry->ue_hash);
 	entry->ue_key = key;
 	atomic_set(&entry->ue_refcount, 0);
 	init_waitqueue_head(&entry->ue_waitq);
@@ -58,17 +68,36 @@ static struct upcall_cache_entry *alloc_entry(struct upcall_cache *cache,
 	return entry;
 }
 
-/* protected by cache lock */
+static void free_entry_rcu(struct rcu_head *head)
+{
+	struct upcall_cache_entry *entry;
+
+	entry = container_of(head, struct upcall_cache_entry, ue_rcu);
+	LIBCFS_FREE(entry, sizeof(*entry));
+}
+
+/* protected by bucket lock, lockless readers may still see the entry until
+ * the end of the RCU grace period */
 static void free_entry(struct upcall_cache *cache,
 		       struct upcall_cache_entry *entry)
 {
 	if (cache->uc_ops->free_entry)
 		cache->uc_ops->free_entry(cache, entry);
 
-	list_del(&entry->ue_hash);
+	if (!hlist_unhashed(&entry->ue_hash))
+		hlist_del_init_rcu(&entry->ue_hash);
 	CDEBUG(D_OTHER, "destroy cache entry %p for key %llu\n",
 		entry, entry->ue_key);
-	LIBCFS_FREE(entry, sizeof(*entry));
+	call_rcu(&entry->ue_rcu, free_entry_rcu);
+}
+
+/* free the entry unless somebody holds a reference, the last
+ * put_entry() will free it then */
+static inline void try_free_entry(struct upcall_cache *cache,
+				  struct upcall_cache_entry *entry)
+{
+	if (atomic_cmpxchg(&entry->ue_refcount, 0, UC_CACHE_DEAD_REF) == 0)
+		free_entry(cache, entry);
 }
 
 static inline int upcall_compare(struct upcall_cache *cache,
@@ -97,18 +126,40 @@ static inline int downcall_compare(struct upcall_cache *cache,
 	return 0;
 }
 
+/* negative entry: the upcall failed to resolve the key */
+static inline bool entry_is_negative(struct upcall_cache_entry *entry)
+{
+	return entry->ue_flags == UC_CACHE_INVALID;
+}
+
+static inline bool entry_refresh_due(struct upcall_cache *cache,
+				     struct upcall_cache_entry *entry,
+				     time64_t now)
+{
+	return entry->ue_expire - now <=
+	       cache->uc_entry_expire >> UC_CACHE_REFRESH_SHIFT;
+}
+
+/* protected by bucket lock */
 static inline void get_entry(struct upcall_cache_entry *entry)
 {
 	atomic_inc(&entry->ue_refcount);
 }
 
+static inline bool put_entry_should_free(struct upcall_cache_entry *entry)
+{
+	return UC_CACHE_IS_EXPIRED(entry) || hlist_unhashed(&entry->ue_hash) ||
+	       (UC_CACHE_IS_INVALID(entry) &&
+		ktime_get_seconds() >= entry->ue_expire);
+}
+
+/* protected by bucket lock */
 static inline void put_entry(struct upcall_cache *cache,
 			     struct upcall_cache_entry *entry)
 {
 	if (atomic_dec_and_test(&entry->ue_refcount) &&
-	    (UC_CACHE_IS_INVALID(entry) || UC_CACHE_IS_EXPIRED(entry))) {
-		free_entry(cache, entry);
-	}
+	    put_entry_should_free(entry))
+		try_free_entry(cache, entry);
 }
 
 static int check_unlink_entry(struct upcall_cache *cache,
@@ -116,7 +167,8 @@ static int check_unlink_entry(struct upcall_cache *cache,
 {
 	time64_t now = ktime_get_seconds();
 
-	if (UC_CACHE_IS_VALID(entry) && now < entry->ue_expire)
+	if ((UC_CACHE_IS_VALID(entry) || entry_is_negative(entry)) &&
+	    now < entry->ue_expire)
 		return 0;
 
 	if (UC_CACHE_IS_ACQUIRING(entry)) {
@@ -130,47 +182,223 @@ static int check_unlink_entry(struct upcall_cache *cache,
 		UC_CACHE_SET_EXPIRED(entry);
 	}
 
-	list_del_init(&entry->ue_hash);
-	if (!atomic_read(&entry->ue_refcount))
-		free_entry(cache, entry);
+	hlist_del_init_rcu(&entry->ue_hash);
+	try_free_entry(cache, entry);
 	return 1;
 }
 
-static inline int refresh_entry(struct upcall_cache *cache,
+/* the upcall for an acquiring entry couldn't be started, protected by
+ * bucket lock */
+static void fail_entry(struct upcall_cache *cache,
+		       struct upcall_cache_entry *entry)
+{
+	UC_CACHE_CLEAR_ACQUIRING(entry);
+	UC_CACHE_SET_INVALID(entry);
+	entry->ue_expire = 0;
+	hlist_del_init_rcu(&entry->ue_hash);
+	wake_up_all(&entry->ue_waitq);
+	try_free_entry(cache, entry);
+}
+
+static void fail_key(struct upcall_cache *cache, __u64 key)
+{
+	struct upcall_cache_bucket *bucket = cache_bucket(cache, key);
+	struct upcall_cache_entry *entry;
+
+	spin_lock(&bucket->ucb_lock);
+	hlist_for_each_entry(entry, &bucket->ucb_hash, ue_hash) {
+		if (entry->ue_key == key && UC_CACHE_IS_ACQUIRING(entry)) {
+			fail_entry(cache, entry);
+			break;
+		}
+	}
+	spin_unlock(&bucket->ucb_lock);
+}
+
+/*
+ * Start the upcall for an acquiring entry, the result comes back by
+ * upcall_cache_downcall().
+ *
+ * If the cache supports it, a single upcall resolves several keys: while
+ * an upcall is being started, the keys of the other entries to acquire are
+ * queued, and the thread which started it runs one more upcall for all of
+ * them afterwards. The entries of the queued keys are failed if that upcall
+ * can't be run.
+ */
+static int refresh_entry(struct upcall_cache *cache,
 			 struct upcall_cache_entry *entry)
 {
+	unsigned int batch = min_t(unsigned int, cache->uc_upcall_batch,
+				   UC_CACHE_UPCALL_BATCH_MAX);
+	bool first = true;
+	int count, i, rc, own_rc = 0;
+
 	LASSERT(cache->uc_ops->do_upcall);
-	return cache->uc_ops->do_upcall(cache, entry);
+	if (batch <= 1 || !cache->uc_ops->do_batch_upcall) {
+		lprocfs_oh_tally_log2(&cache->uc_batch_hist, 1);
+		return cache->uc_ops->do_upcall(cache, entry);
+	}
+
+	spin_lock(&cache->uc_batch_lock);
+	if (cache->uc_batch_running) {
+		if (cache->uc_batch_count < batch) {
+			cache->uc_batch_keys[cache->uc_batch_count++] =
+				entry->ue_key;
+			spin_unlock(&cache->uc_batch_lock);
+			return 0;
+		}
+		spin_unlock(&cache->uc_batch_lock);
+
+		/* the queue is full, don't wait for it */
+		lprocfs_oh_tally_log2(&cache->uc_batch_hist, 1);
+		return cache->uc_ops->do_upcall(cache, entry);
+	}
+
+	cache->uc_batch_running = true;
+	cache->uc_batch_keys[0] = entry->ue_key;
+	cache->uc_batch_count = 1;
+	while ((count = cache->uc_batch_count) > 0) {
+		/* only the running thread uses uc_batch_launch */
+		memcpy(cache->uc_batch_launch, cache->uc_batch_keys,
+		       count * sizeof(cache->uc_batch_keys[0]));
+		cache->uc_batch_count = 0;
+		spin_unlock(&cache->uc_batch_lock);
+
+		/* let more keys be queued for the next upcall */
+		if (first)
+			OBD_FAIL_TIMEOUT(OBD_FAIL_SEC_UPCALL_BATCH,
+					 cfs_fail_val);
+
+		lprocfs_oh_tally_log2(&cache->uc_batch_hist, count);
+		rc = cache->uc_ops->do_batch_upcall(cache,
+						    cache->uc_batch_launch,
+						    count);
+		for (i = 0; rc < 0 && i < count; i++) {
+			if (first && i == 0)
+				own_rc = rc;
+			else
+				fail_key(cache, cache->uc_batch_launch[i]);
+		}
+		first = false;
+		spin_lock(&cache->uc_batch_lock);
+	}
+	cache->uc_batch_running = false;
+	spin_unlock(&cache->uc_batch_lock);
+
+	return own_rc;
+}
+
+/* lockless lookup of a valid entry, which doesn't need to be refreshed */
+static struct upcall_cache_entry *
+lookup_entry_rcu(struct upcall_cache *cache, struct upcall_cache_bucket *bucket,
+		 __u64 key, void *args)
+{
+	struct upcall_cache_entry *entry;
+	time64_t now = ktime_get_seconds();
+	bool refreshing = false;
+
+	rcu_read_lock();
+	hlist_for_each_entry_rcu(entry, &bucket->ucb_hash, ue_hash) {
+		if (upcall_compare(cache, entry, key, args) != 0)
+			continue;
+
+		/* the refresh of an entry is added before it */
+		if (UC_CACHE_IS_ACQUIRING(entry)) {
+			refreshing = true;
+			continue;
+		}
+
+		if (!UC_CACHE_IS_VALID(entry) || now >= entry->ue_expire ||
+		    (!refreshing && entry_refresh_due(cache, entry, now)))
+			break;
+
+		if (!atomic_add_unless(&entry->ue_refcount, 1,
+				       UC_CACHE_DEAD_REF))
+			break;
+
+		/* raced with flush or unlink */
+		if (!UC_CACHE_IS_VALID(entry) ||
+		    hlist_unhashed(&entry->ue_hash)) {
+			rcu_read_unlock();
+			upcall_cache_put_entry(cache, entry);
+			return NULL;
+		}
+
+		rcu_read_unlock();
+		return entry;
+	}
+	rcu_read_unlock();
+
+	return NULL;
 }
 
 struct upcall_cache_entry *upcall_cache_get_entry(struct upcall_cache *cache,
 						  __u64 key, void *args)
 {
-	struct upcall_cache_entry *entry = NULL, *new = NULL, *next;
-	struct list_head *head;
+	struct upcall_cache_entry *entry = NULL, *new = NULL, *pos;
+	struct upcall_cache_entry *acquiring, *fresh = NULL;
+	struct hlist_node *tmp;
+	struct upcall_cache_bucket *bucket;
 	wait_queue_entry_t wait;
-	int rc, found;
+	int rc;
 	ENTRY;
 
 	LASSERT(cache);
 
-	head = &cache->uc_hashtable[UC_CACHE_HASH_INDEX(key)];
+	bucket = cache_bucket(cache, key);
+	entry = lookup_entry_rcu(cache, bucket, key, args);
+	if (entry)
+		RETURN(entry);
+
 find_again:
-	found = 0;
-	spin_lock(&cache->uc_lock);
-	list_for_each_entry_safe(entry, next, head, ue_hash) {
+	entry = NULL;
+	acquiring = NULL;
+	spin_lock(&bucket->ucb_lock);
+	hlist_for_each_entry_safe(pos, tmp, &bucket->ucb_hash, ue_hash) {
 		/* check invalid & expired items */
-		if (check_unlink_entry(cache, entry))
+		if (check_unlink_entry(cache, pos))
 			continue;
-		if (upcall_compare(cache, entry, key, args) == 0) {
-			found = 1;
-			break;
+		if (upcall_compare(cache, pos, key, args) != 0)
+			continue;
+		/* an entry being refreshed is still usable */
+		if (UC_CACHE_IS_ACQUIRING(pos)) {
+			if (!acquiring)
+				acquiring = pos;
+			continue;
+		}
+		entry = pos;
+		break;
+	}
+
+	if (entry && UC_CACHE_IS_VALID(entry) && !acquiring &&
+	    entry_refresh_due(cache, entry, ktime_get_seconds())) {
+		/* refresh it before it expires, without waiting for that */
+		if (!new) {
+			spin_unlock(&bucket->ucb_lock);
+			new = alloc_entry(cache, key, args);
+			if (!new) {
+				CERROR("fail to alloc entry\n");
+				RETURN(ERR_PTR(-ENOMEM));
+			}
+			goto find_again;
 		}
+		fresh = new;
+		new = NULL;
+		UC_CACHE_SET_ACQUIRING(fresh);
+		UC_CACHE_CLEAR_NEW(fresh);
+		fresh->ue_acquire_start = ktime_get();
+		fresh->ue_acquire_expire = ktime_get_seconds() +
+					   cache->uc_acquire_expire;
+		hlist_add_head_rcu(&fresh->ue_hash, &bucket->ucb_hash);
+		get_entry(fresh);
 	}
 
-	if (!found) {
+	if (!entry)
+		entry = acquiring;
+
+	if (!entry) {
 		if (!new) {
-			spin_unlock(&cache->uc_lock);
+			spin_unlock(&bucket->ucb_lock);
 			new = alloc_entry(cache, key, args);
 			if (!new) {
 				CERROR("fail to alloc entry\n");
@@ -178,31 +406,39 @@ find_again:
 			}
 			goto find_again;
 		} else {
-			list_add(&new->ue_hash, head);
+			hlist_add_head_rcu(&new->ue_hash, &bucket->ucb_hash);
 			entry = new;
 		}
-	} else {
-		if (new) {
-			free_entry(cache, new);
-			new = NULL;
-		}
-		list_move(&entry->ue_hash, head);
+	} else if (new) {
+		free_entry(cache, new);
+		new = NULL;
 	}
 	get_entry(entry);
 
+	if (fresh) {
+		spin_unlock(&bucket->ucb_lock);
+		rc = refresh_entry(cache, fresh);
+		spin_lock(&bucket->ucb_lock);
+		if (rc < 0)
+			fail_entry(cache, fresh);
+		put_entry(cache, fresh);
+		fresh = NULL;
+	}
+
 	/* acquire for new one */
 	if (UC_CACHE_IS_NEW(entry)) {
 		UC_CACHE_SET_ACQUIRING(entry);
 		UC_CACHE_CLEAR_NEW(entry);
-		spin_unlock(&cache->uc_lock);
+		entry->ue_acquire_start = ktime_get();
+		entry->ue_acquire_expire = ktime_get_seconds() +
+					   cache->uc_acquire_expire;
+		spin_unlock(&bucket->ucb_lock);
 		rc = refresh_entry(cache, entry);
-		spin_lock(&cache->uc_lock);
+		spin_lock(&bucket->ucb_lock);
 		entry->ue_acquire_expire = ktime_get_seconds() +
 					   cache->uc_acquire_expire;
-		if (rc < 0) {
-			UC_CACHE_CLEAR_ACQUIRING(entry);
-			UC_CACHE_SET_INVALID(entry);
-			wake_up_all(&entry->ue_waitq);
+		if (rc < 0 && UC_CACHE_IS_ACQUIRING(entry)) {
+			fail_entry(cache, entry);
 			if (unlikely(rc == -EREMCHG)) {
 				put_entry(cache, entry);
 				GOTO(out, entry = ERR_PTR(rc));
@@ -220,11 +456,11 @@ find_again:
 		init_waitqueue_entry(&wait, current);
 		add_wait_queue(&entry->ue_waitq, &wait);
 		set_current_state(TASK_INTERRUPTIBLE);
-		spin_unlock(&cache->uc_lock);
+		spin_unlock(&bucket->ucb_lock);
 
 		left = schedule_timeout(expiry);
 
-		spin_lock(&cache->uc_lock);
+		spin_lock(&bucket->ucb_lock);
 		remove_wait_queue(&entry->ue_waitq, &wait);
 		if (UC_CACHE_IS_ACQUIRING(entry)) {
 			/* we're interrupted or upcall failed in the middle */
@@ -254,7 +490,7 @@ find_again:
 		 */
 		if (entry != new) {
 			put_entry(cache, entry);
-			spin_unlock(&cache->uc_lock);
+			spin_unlock(&bucket->ucb_lock);
 			new = NULL;
 			goto find_again;
 		}
@@ -262,7 +498,7 @@ find_again:
 
 	/* Now we know it's good */
 out:
-	spin_unlock(&cache->uc_lock);
+	spin_unlock(&bucket->ucb_lock);
 	RETURN(entry);
 }
 EXPORT_SYMBOL(upcall_cache_get_entry);
@@ -270,6 +506,7 @@ EXPORT_SYMBOL(upcall_cache_get_entry);
 void upcall_cache_put_entry(struct upcall_cache *cache,
 			    struct upcall_cache_entry *entry)
 {
+	struct upcall_cache_bucket *bucket;
 	ENTRY;
 
 	if (!entry) {
@@ -278,41 +515,77 @@ void upcall_cache_put_entry(struct upcall_cache *cache,
 	}
 
 	LASSERT(atomic_read(&entry->ue_refcount) > 0);
-	spin_lock(&cache->uc_lock);
-	put_entry(cache, entry);
-	spin_unlock(&cache->uc_lock);
+	bucket = cache_bucket(cache, entry->ue_key);
+	if (atomic_dec_and_lock(&entry->ue_refcount, &bucket->ucb_lock)) {
+		if (put_entry_should_free(entry))
+			try_free_entry(cache, entry);
+		spin_unlock(&bucket->ucb_lock);
+	}
 	EXIT;
 }
 EXPORT_SYMBOL(upcall_cache_put_entry);
 
+/* is there a valid entry for \a key besides \a entry, protected by bucket
+ * lock */
+static bool other_valid_entry(struct upcall_cache *cache,
+			      struct upcall_cache_bucket *bucket,
+			      struct upcall_cache_entry *entry,
+			      __u64 key, void *args)
+{
+	struct upcall_cache_entry *pos;
+	time64_t now = ktime_get_seconds();
+
+	hlist_for_each_entry(pos, &bucket->ucb_hash, ue_hash) {
+		if (pos != entry && UC_CACHE_IS_VALID(pos) &&
+		    now < pos->ue_expire &&
+		    downcall_compare(cache, pos, key, args) == 0)
+			return true;
+	}
+
+	return false;
+}
+
 int upcall_cache_downcall(struct upcall_cache *cache, __u32 err, __u64 key,
 			  void *args)
 {
-	struct upcall_cache_entry *entry = NULL;
-	struct list_head *head;
-	int found = 0, rc = 0;
+	struct upcall_cache_entry *entry = NULL, *pos;
+	struct upcall_cache_bucket *bucket;
+	struct hlist_node *tmp;
+	bool acquiring = false;
+	int rc = 0;
 	ENTRY;
 
 	LASSERT(cache);
 
-	head = &cache->uc_hashtable[UC_CACHE_HASH_INDEX(key)];
+	bucket = cache_bucket(cache, key);
 
-	spin_lock(&cache->uc_lock);
-	list_for_each_entry(entry, head, ue_hash) {
-		if (downcall_compare(cache, entry, key, args) == 0) {
-			found = 1;
-			get_entry(entry);
+	spin_lock(&bucket->ucb_lock);
+	hlist_for_each_entry(pos, &bucket->ucb_hash, ue_hash) {
+		if (downcall_compare(cache, pos, key, args) != 0)
+			continue;
+		/* the refresh of a valid entry is the one expected */
+		if (!entry)
+			entry = pos;
+		if (UC_CACHE_IS_ACQUIRING(pos)) {
+			entry = pos;
 			break;
 		}
 	}
 
-	if (!found) {
+	if (!entry) {
 		CDEBUG(D_OTHER, "%s: upcall for key %llu not expected\n",
 		       cache->uc_name, key);
 		/* haven't found, it's possible */
-		spin_unlock(&cache->uc_lock);
+		spin_unlock(&bucket->ucb_lock);
 		RETURN(-EINVAL);
 	}
+	get_entry(entry);
+
+	acquiring = UC_CACHE_IS_ACQUIRING(entry);
+	if (acquiring)
+		lprocfs_oh_tally_log2(&cache->uc_upcall_hist,
+				      ktime_us_delta(ktime_get(),
+						     entry->ue_acquire_start));
 
 	if (err) {
 		CDEBUG(D_OTHER, "%s: upcall for key %llu returned %d\n",
@@ -320,7 +593,7 @@ int upcall_cache_downcall(struct upcall_cache *cache, __u32 err, __u64 key,
 		GOTO(out, rc = -EINVAL);
 	}
 
-	if (!UC_CACHE_IS_ACQUIRING(entry)) {
+	if (!acquiring) {
 		CDEBUG(D_RPCTRACE, "%s: found uptodate entry %p (key %llu)"
 		       "\n", cache->uc_name, entry, entry->ue_key);
 		GOTO(out, rc = 0);
@@ -332,10 +605,10 @@ int upcall_cache_downcall(struct upcall_cache *cache, __u32 err, __u64 key,
 		GOTO(out, rc = -EINVAL);
 	}
 
-	spin_unlock(&cache->uc_lock);
+	spin_unlock(&bucket->ucb_lock);
 	if (cache->uc_ops->parse_downcall)
 		rc = cache->uc_ops->parse_downcall(cache, entry, args);
-	spin_lock(&cache->uc_lock);
+	spin_lock(&bucket->ucb_lock);
 	if (rc)
 		GOTO(out, rc);
 
@@ -346,12 +619,33 @@ int upcall_cache_downcall(struct upcall_cache *cache, __u32 err, __u64 key,
 out:
 	if (rc) {
 		UC_CACHE_SET_INVALID(entry);
-		list_del_init(&entry->ue_hash);
+		/* a failed refresh keeps the entry it was started for, the
+		 * error may be transient */
+		if (err && acquiring && cache->uc_neg_expire > 0 &&
+		    !other_valid_entry(cache, bucket, entry, key, args))
+			/* keep it to fail the lookups until it expires */
+			entry->ue_expire = ktime_get_seconds() +
+					   cache->uc_neg_expire;
+		else
+			hlist_del_init_rcu(&entry->ue_hash);
+	}
+
+	/* the result of a refresh replaces the entry it was started for */
+	if (acquiring && rc == 0) {
+		hlist_for_each_entry_safe(pos, tmp, &bucket->ucb_hash,
+					  ue_hash) {
+			if (pos == entry || !UC_CACHE_IS_VALID(pos) ||
+			    downcall_compare(cache, pos, key, args) != 0)
+				continue;
+			UC_CACHE_SET_EXPIRED(pos);
+			hlist_del_init_rcu(&pos->ue_hash);
+			try_free_entry(cache, pos);
+		}
 	}
 	UC_CACHE_CLEAR_ACQUIRING(entry);
-	spin_unlock(&cache->uc_lock);
+	spin_unlock(&bucket->ucb_lock);
 	wake_up_all(&entry->ue_waitq);
-	put_entry(cache, entry);
+	upcall_cache_put_entry(cache, entry);
 
 	RETURN(rc);
 }
@@ -359,45 +653,45 @@ EXPORT_SYMBOL(upcall_cache_downcall);
 
 void upcall_cache_flush(struct upcall_cache *cache, int force)
 {
-	struct upcall_cache_entry *entry, *next;
+	struct upcall_cache_bucket *bucket;
+	struct upcall_cache_entry *entry;
+	struct hlist_node *tmp;
 	int i;
 	ENTRY;
 
-	spin_lock(&cache->uc_lock);
 	for (i = 0; i < UC_CACHE_HASH_SIZE; i++) {
-		list_for_each_entry_safe(entry, next,
-					 &cache->uc_hashtable[i], ue_hash) {
-			if (!force && atomic_read(&entry->ue_refcount)) {
-				UC_CACHE_SET_EXPIRED(entry);
+		bucket = &cache->uc_hashtable[i];
+		spin_lock(&bucket->ucb_lock);
+		hlist_for_each_entry_safe(entry, tmp, &bucket->ucb_hash,
+					  ue_hash) {
+			UC_CACHE_SET_EXPIRED(entry);
+			if (!force && atomic_read(&entry->ue_refcount))
 				continue;
-			}
-			LASSERT(!atomic_read(&entry->ue_refcount));
-			free_entry(cache, entry);
+			LASSERT(!force || !atomic_read(&entry->ue_refcount));
+			/* a lockless lookup may have just taken it */
+			try_free_entry(cache, entry);
 		}
+		spin_unlock(&bucket->ucb_lock);
 	}
-	spin_unlock(&cache->uc_lock);
 	EXIT;
 }
 EXPORT_SYMBOL(upcall_cache_flush);
 
 void upcall_cache_flush_one(struct upcall_cache *cache, __u64 key, void *args)
 {
-	struct list_head *head;
+	struct upcall_cache_bucket *bucket;
 	struct upcall_cache_entry *entry;
-	int found = 0;
+	struct hlist_node *tmp;
 	ENTRY;
 
-	head = &cache->uc_hashtable[UC_CACHE_HASH_INDEX(key)];
+	bucket = cache_bucket(cache, key);
 
-	spin_lock(&cache->uc_lock);
-	list_for_each_entry(entry, head, ue_hash) {
-		if (upcall_compare(cache, entry, key, args) == 0) {
-			found = 1;
-			break;
-		}
-	}
+	spin_lock(&bucket->ucb_lock);
+	/* an entry being refreshed may have a second copy */
+	hlist_for_each_entry_safe(entry, tmp, &bucket->ucb_hash, ue_hash) {
+		if (upcall_compare(cache, entry, key, args) != 0)
+			continue;
 
-	if (found) {
 		CWARN("%s: flush entry %p: key %llu, ref %d, fl %x, "
 		      "cur %lld, ex %lld/%lld\n",
 		      cache->uc_name, entry, entry->ue_key,
@@ -405,13 +699,64 @@ void upcall_cache_flush_one(struct upcall_cache *cache, __u64 key, void *args)
 		      ktime_get_real_seconds(), entry->ue_acquire_expire,
 		      entry->ue_expire);
 		UC_CACHE_SET_EXPIRED(entry);
-		if (!atomic_read(&entry->ue_refcount))
-			free_entry(cache, entry);
+		try_free_entry(cache, entry);
 	}
-	spin_unlock(&cache->uc_lock);
+	spin_unlock(&bucket->ucb_lock);
 }
 EXPORT_SYMBOL(upcall_cache_flush_one);
 
+static void upcall_cache_hist_seq_show(struct seq_file *m, const char *name,
+				       struct obd_histogram *hist)
+{
+	unsigned long tot, t, cum = 0;
+	int i;
+
+	tot = lprocfs_oh_sum(hist);
+	if (tot == 0)
+		return;
+
+	seq_printf(m, "- %-15s\n", name);
+	for (i = 0; i < OBD_HIST_MAX; i++) {
+		t = hist->oh_buckets[i];
+		cum += t;
+		if (cum == 0)
+			continue;
+
+		seq_printf(m, "%6s%lu: { sample: %3lu, pct: %3u, cum_pct: %3u }\n",
+			   " ", 1UL << i, t, pct(t, tot), pct(cum, tot));
+		if (cum == tot)
+			break;
+	}
+}
+
+/**
+ * Print the upcall statistics of \a cache.
+ *
+ * "latency_us" is the time from the start of an upcall to its downcall,
+ * "batch_keys" the number of keys resolved by a single upcall.
+ */
+int upcall_cache_stats_seq_show(struct upcall_cache *cache, struct seq_file *m)
+{
+	struct timespec64 now;
+
+	ktime_get_real_ts64(&now);
+	seq_printf(m, "upcall_stats:\n");
+	seq_printf(m, "- %-15s %llu.%9lu\n", "snapshot_time:",
+		   (s64)now.tv_sec, now.tv_nsec);
+	upcall_cache_hist_seq_show(m, "latency_us", &cache->uc_upcall_hist);
+	upcall_cache_hist_seq_show(m, "batch_keys", &cache->uc_batch_hist);
+
+	return 0;
+}
+EXPORT_SYMBOL(upcall_cache_stats_seq_show);
+
+void upcall_cache_stats_clear(struct upcall_cache *cache)
+{
+	lprocfs_oh_clear(&cache->uc_upcall_hist);
+	lprocfs_oh_clear(&cache->uc_batch_hist);
+}
+EXPORT_SYMBOL(upcall_cache_stats_clear);
+
 struct upcall_cache *upcall_cache_init(const char *name, const char *upcall,
 				       struct upcall_cache_ops *ops)
 {
@@ -423,16 +768,23 @@ struct upcall_cache *upcall_cache_init(const char *name, const char *upcall,
 	if (!cache)
 		RETURN(ERR_PTR(-ENOMEM));
 
-	spin_lock_init(&cache->uc_lock);
 	init_rwsem(&cache->uc_upcall_rwsem);
-	for (i = 0; i < UC_CACHE_HASH_SIZE; i++)
-		INIT_LIST_HEAD(&cache->uc_hashtable[i]);
+	for (i = 0; i < UC_CACHE_HASH_SIZE; i++) {
+		spin_lock_init(&cache->uc_hashtable[i].ucb_lock);
+		INIT_HLIST_HEAD(&cache->uc_hashtable[i].ucb_hash);
+	}
 	strlcpy(cache->uc_name, name, sizeof(cache->uc_name));
 	/* upcall pathname proc tunable */
 	strlcpy(cache->uc_upcall, upcall, sizeof(cache->uc_upcall));
 	cache->uc_entry_expire = 20 * 60;
 	cache->uc_acquire_expire = 30;
+	cache->uc_neg_expire = 30;
 	cache->uc_ops = ops;
+	spin_lock_init(&cache->uc_batch_lock);
+	/* one key per upcall, as custom upcalls may not take several */
+	cache->uc_upcall_batch = 1;
+	spin_lock_init(&cache->uc_upcall_hist.oh_lock);
+	spin_lock_init(&cache->uc_batch_hist.oh_lock);
 
 	RETURN(cache);
 }
@@ -443,6 +795,8 @@ void upcall_cache_cleanup(struct upcall_cache *cache)
 	if (!cache)
 		return;
 	upcall_cache_flush_all(cache);
+	/* wait for the entries freed after a grace period */
+	rcu_barrier();
 	LIBCFS_FREE(cache, sizeof(*cache));
 }
 EXPORT_SYMBOL(upcall_cache_cleanup);
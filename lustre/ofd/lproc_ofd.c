@@ -553,6 +553,146 @@ static ssize_t soft_sync_limit_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(soft_sync_limit);
 
+/**
+ * Show the sync write batching window.
+ *
+ * Sync writes arriving within this many microseconds of each other share
+ * a single journal commit. Zero disables batching.
+ *
+ * \param[in] kobj	kobject embedded in obd_device
+ * \param[in] attr	unused
+ * \param[in] buf	buffer for output
+ *
+ * \retval		number of bytes written to \a buf
+ */
+static ssize_t sync_batch_usec_show(struct kobject *kobj,
+				    struct attribute *attr, char *buf)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	struct ofd_device *ofd = ofd_dev(obd->obd_lu_dev);
+
+	return sprintf(buf, "%u\n", ofd->ofd_sync_batch_usec);
+}
+
+/**
+ * Change the sync write batching window.
+ *
+ * \param[in] kobj	kobject embedded in obd_device
+ * \param[in] attr	unused
+ * \param[in] buffer	string with the new window in microseconds
+ * \param[in] count	\a buffer length
+ *
+ * \retval		\a count on success
+ * \retval		negative number on error
+ */
+static ssize_t sync_batch_usec_store(struct kobject *kobj,
+				     struct attribute *attr,
+				     const char *buffer, size_t count)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	struct ofd_device *ofd = ofd_dev(obd->obd_lu_dev);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 0, &val);
+	if (rc < 0)
+		return rc;
+
+	if (val > OFD_SYNC_BATCH_USEC_MAX)
+		return -ERANGE;
+
+	ofd->ofd_sync_batch_usec = val;
+	return count;
+}
+LUSTRE_RW_ATTR(sync_batch_usec);
+
+static void ofd_sync_batch_hist_show(struct seq_file *m, const char *name,
+				     const char *units,
+				     struct obd_histogram *hist, bool log2)
+{
+	unsigned long tot, t, cum = 0;
+	int i;
+
+	tot = lprocfs_oh_sum(hist);
+	if (tot == 0)
+		return;
+
+	seq_printf(m, "- %-15s\n", name);
+	for (i = 0; i < OBD_HIST_MAX; i++) {
+		t = hist->oh_buckets[i];
+		cum += t;
+		if (cum == 0)
+			continue;
+
+		seq_printf(m, "%6s%lu%s: { sample: %3lu, pct: %3u, cum_pct: %3u }\n",
+			   " ", log2 ? 1UL << i : (unsigned long)i, units,
+			   t, pct(t, tot), pct(cum, tot));
+		if (cum == tot)
+			break;
+	}
+}
+
+/**
+ * Show sync write group commit statistics.
+ *
+ * Histograms of the number of RPCs and pages committed by each batched
+ * journal commit, and of the time each sync write waited for its commit.
+ *
+ * \param[in] m		seq_file handle
+ * \param[in] data	unused for single entry
+ *
+ * \retval		0 always
+ */
+static int ofd_sync_batch_stats_seq_show(struct seq_file *m, void *data)
+{
+	struct obd_device *obd = m->private;
+	struct ofd_device *ofd = ofd_dev(obd->obd_lu_dev);
+	struct obd_histogram *h = ofd->ofd_sync_batch_hist;
+	struct timespec64 now;
+
+	/* this sampling races with updates */
+	ktime_get_real_ts64(&now);
+	seq_printf(m, "sync_batch_stats:\n");
+	seq_printf(m, "- %-15s %llu.%9lu\n", "snapshot_time:",
+		   (s64)now.tv_sec, now.tv_nsec);
+	ofd_sync_batch_hist_show(m, "rpcs_per_commit", " rpcs",
+				 &h[OFD_SYNC_BATCH_RPCS], false);
+	ofd_sync_batch_hist_show(m, "pages_per_commit", " pages",
+				 &h[OFD_SYNC_BATCH_PAGES], true);
+	ofd_sync_batch_hist_show(m, "commit_wait", " usec",
+				 &h[OFD_SYNC_BATCH_WAIT], true);
+
+	return 0;
+}
+
+/**
+ * Clear sync write group commit statistics.
+ *
+ * \param[in] file	proc file
+ * \param[in] buffer	unused
+ * \param[in] count	\a buffer length
+ * \param[in] off	unused for single entry
+ *
+ * \retval		\a count always
+ */
+static ssize_t ofd_sync_batch_stats_seq_write(struct file *file,
+					      const char __user *buffer,
+					      size_t count, loff_t *off)
+{
+	struct seq_file *m = file->private_data;
+	struct obd_device *obd = m->private;
+	struct ofd_device *ofd = ofd_dev(obd->obd_lu_dev);
+	int i;
+
+	for (i = 0; i < OFD_SYNC_BATCH_LAST; i++)
+		lprocfs_oh_clear(&ofd->ofd_sync_batch_hist[i]);
+
+	return count;
+}
+LPROC_SEQ_FOPS(ofd_sync_batch_stats);
+
 /**
  * Show the LFSCK speed limit.
  *
@@ -996,6 +1136,8 @@ LUSTRE_RW_ATTR(job_cleanup_interval);
 LUSTRE_RO_ATTR(tot_dirty);
 LUSTRE_RO_ATTR(tot_granted);
 LUSTRE_RO_ATTR(tot_pending);
+LUSTRE_RO_ATTR(tot_write_rpcs);
+LUSTRE_RO_ATTR(tot_sync_write_rpcs);
 LUSTRE_RW_ATTR(grant_compat_disable);
 LUSTRE_RO_ATTR(instance);
 
@@ -1018,6 +1160,8 @@ struct lprocfs_vars lprocfs_ofd_obd_vars[] = {
 	  .fops	=	&ofd_lfsck_verify_pfid_fops	},
 	{ .name =	"site_stats",
 	  .fops =	&ofd_site_stats_fops		},
+	{ .name =	"sync_batch_stats",
+	  .fops =	&ofd_sync_batch_stats_fops	},
 	{ NULL }
 };
 
@@ -1064,6 +1208,8 @@ static struct attribute *ofd_attrs[] = {
 	&lustre_attr_tot_dirty.attr,
 	&lustre_attr_tot_granted.attr,
 	&lustre_attr_tot_pending.attr,
+	&lustre_attr_tot_write_rpcs.attr,
+	&lustre_attr_tot_sync_write_rpcs.attr,
 	&lustre_attr_grant_compat_disable.attr,
 	&lustre_attr_instance.attr,
 	&lustre_attr_recovery_time_hard.attr,
@@ -1082,6 +1228,7 @@ static struct attribute *ofd_attrs[] = {
 	&lustre_attr_sync_on_lock_cancel.attr,
 #endif
 	&lustre_attr_soft_sync_limit.attr,
+	&lustre_attr_sync_batch_usec.attr,
 	&lustre_attr_lfsck_speed_limit.attr,
 	&lustre_attr_access_log_mask.attr,
 	&lustre_attr_access_log_size.attr,
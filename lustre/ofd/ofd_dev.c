@@ -2927,6 +2927,7 @@ static int ofd_init0(const struct lu_env *env, struct ofd_device *m,
 	struct obd_device_target *obt;
 	u32 lmd_flags = 0;
 	int rc;
+	int i;
 
 	ENTRY;
 
@@ -2949,6 +2950,9 @@ static int ofd_init0(const struct lu_env *env, struct ofd_device *m,
 	m->ofd_sync_journal = 0;
 	ofd_slc_set(m);
 	m->ofd_soft_sync_limit = OFD_SOFT_SYNC_LIMIT_DEFAULT;
+	spin_lock_init(&m->ofd_sync_batch_lock);
+	for (i = 0; i < OFD_SYNC_BATCH_LAST; i++)
+		spin_lock_init(&m->ofd_sync_batch_hist[i].oh_lock);
 
 	m->ofd_seq_count = 0;
 	init_waitqueue_head(&m->ofd_inconsistency_thread.t_ctl_waitq);
@@ -53,6 +53,17 @@
 
 #define OFD_SOFT_SYNC_LIMIT_DEFAULT 16
 
+/* maximum time a sync write may wait for others to share its commit */
+#define OFD_SYNC_BATCH_USEC_MAX	100000
+
+/* sync write group commit histograms */
+enum {
+	OFD_SYNC_BATCH_RPCS = 0,	/* RPCs sharing one journal commit */
+	OFD_SYNC_BATCH_PAGES,		/* pages written by those RPCs */
+	OFD_SYNC_BATCH_WAIT,		/* usec an RPC waited for commit */
+	OFD_SYNC_BATCH_LAST,
+};
+
 /*
  * update atime if on-disk value older than client's one
  * by OFD_ATIME_DIFF or more
@@ -151,6 +162,13 @@ struct ofd_device {
 	struct seq_server_site	 ofd_seq_site;
 	/* the limit of SOFT_SYNC RPCs that will trigger a soft sync */
 	unsigned int		 ofd_soft_sync_limit;
+	/* group commit of sync writes, see ofd_sync_batch_wait() */
+	spinlock_t		 ofd_sync_batch_lock;
+	unsigned int		 ofd_sync_batch_usec;
+	unsigned int		 ofd_sync_batch_rpcs;
+	unsigned int		 ofd_sync_batch_pages;
+	bool			 ofd_sync_batch_pending;
+	struct obd_histogram	 ofd_sync_batch_hist[OFD_SYNC_BATCH_LAST];
 	/* Protect ::ofd_lastid_rebuilding */
 	struct rw_semaphore	 ofd_lastid_rwsem;
 	__u64			 ofd_lastid_gen;
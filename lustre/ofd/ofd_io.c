@@ -1174,6 +1174,133 @@ static int ofd_soft_sync_cb_add(struct thandle *th, struct obd_export *exp)
 	return rc;
 }
 
+struct ofd_sync_batch_waiter {
+	struct dt_txn_commit_cb	osbw_cb;
+	struct completion	osbw_done;
+	int			osbw_rc;
+};
+
+/**
+ * Commit callback for a sync write sharing a batched journal commit.
+ *
+ * \param[in] env	execution environment
+ * \param[in] th	transaction handle
+ * \param[in] cb	callback data
+ * \param[in] err	error code
+ */
+static void ofd_cb_sync_batch(struct lu_env *env, struct thandle *th,
+			      struct dt_txn_commit_cb *cb, int err)
+{
+	struct ofd_sync_batch_waiter *osbw;
+
+	osbw = container_of(cb, struct ofd_sync_batch_waiter, osbw_cb);
+	osbw->osbw_rc = err;
+	complete(&osbw->osbw_done);
+}
+
+/**
+ * Turn a sync write transaction into a member of a group commit.
+ *
+ * Instead of forcing a journal commit when the transaction stops, the
+ * caller is woken up by a commit callback once the transaction is on
+ * disk, see ofd_sync_batch_wait(). Must be called on a started
+ * transaction, so that the callback is guaranteed to run.
+ *
+ * \param[in] th	transaction handle
+ * \param[in] osbw	waiter, must stay valid until the callback runs
+ *
+ * \retval		0 on successful callback adding
+ * \retval		negative value on error
+ */
+static int ofd_sync_batch_cb_add(struct thandle *th,
+				 struct ofd_sync_batch_waiter *osbw)
+{
+	struct dt_txn_commit_cb *dcb = &osbw->osbw_cb;
+	int rc;
+
+	init_completion(&osbw->osbw_done);
+	osbw->osbw_rc = 0;
+
+	dcb->dcb_func = ofd_cb_sync_batch;
+	INIT_LIST_HEAD(&dcb->dcb_linkage);
+	strlcpy(dcb->dcb_name, "ofd_cb_sync_batch", sizeof(dcb->dcb_name));
+
+	rc = dt_trans_cb_add(th, dcb);
+	if (rc == 0)
+		th->th_sync = 0;
+
+	return rc;
+}
+
+/**
+ * Wait for the commit of a batched sync write.
+ *
+ * The first sync write arriving when no batch is open becomes the batch
+ * leader: it waits up to ofd_sync_batch_usec for other sync writes to
+ * stop their transactions in the same running journal transaction, then
+ * starts the commit for all of them at once. Other writers just wait for
+ * their commit callback. Replies are sent only once the data is stable
+ * and last_committed was updated by the target commit callbacks, so the
+ * per-RPC sync semantics are unchanged while the journal sees one commit
+ * per batch instead of one per RPC.
+ *
+ * \param[in] env	execution environment
+ * \param[in] ofd	OFD device
+ * \param[in] osbw	waiter registered by ofd_sync_batch_cb_add()
+ * \param[in] npages	number of pages written by this RPC
+ *
+ * \retval		0 when the transaction is committed
+ * \retval		negative value on commit error
+ */
+static int ofd_sync_batch_wait(const struct lu_env *env,
+			       struct ofd_device *ofd,
+			       struct ofd_sync_batch_waiter *osbw, int npages)
+{
+	struct obd_histogram *h = ofd->ofd_sync_batch_hist;
+	ktime_t start = ktime_get();
+	unsigned int rpcs;
+	unsigned int pages;
+	unsigned int usec;
+	bool leader;
+	int rc;
+
+	spin_lock(&ofd->ofd_sync_batch_lock);
+	leader = !ofd->ofd_sync_batch_pending;
+	ofd->ofd_sync_batch_pending = true;
+	ofd->ofd_sync_batch_rpcs++;
+	ofd->ofd_sync_batch_pages += npages;
+	spin_unlock(&ofd->ofd_sync_batch_lock);
+
+	if (leader) {
+		usec = READ_ONCE(ofd->ofd_sync_batch_usec);
+		if (usec > 0)
+			usleep_range(usec, usec + usec / 4 + 1);
+
+		spin_lock(&ofd->ofd_sync_batch_lock);
+		rpcs = ofd->ofd_sync_batch_rpcs;
+		pages = ofd->ofd_sync_batch_pages;
+		ofd->ofd_sync_batch_rpcs = 0;
+		ofd->ofd_sync_batch_pages = 0;
+		ofd->ofd_sync_batch_pending = false;
+		spin_unlock(&ofd->ofd_sync_batch_lock);
+
+		lprocfs_oh_tally(&h[OFD_SYNC_BATCH_RPCS], rpcs);
+		lprocfs_oh_tally_log2(&h[OFD_SYNC_BATCH_PAGES], pages);
+
+		/* if this fails the journal commits on its own timer */
+		rc = dt_commit_async(env, ofd->ofd_osd);
+		if (rc)
+			CDEBUG(D_INODE, "%s: async commit failed: rc = %d\n",
+			       ofd_name(ofd), rc);
+	}
+
+	wait_for_completion(&osbw->osbw_done);
+	lprocfs_oh_tally_log2(&h[OFD_SYNC_BATCH_WAIT],
+			      ktime_us_delta(ktime_get(), start));
+
+	return osbw->osbw_rc;
+}
+
 /**
  * Commit bulk IO buffers to the storage.
  *
@@ -1204,6 +1331,7 @@ ofd_commitrw_write(const struct lu_env *env, struct obd_export *exp,
 {
 	struct ofd_thread_info *info = ofd_info(env);
 	struct filter_export_data *fed = &exp->exp_filter_data;
+	struct ofd_sync_batch_waiter osbw;
 	struct ofd_object *fo;
 	struct dt_object *o;
 	struct thandle *th;
@@ -1214,6 +1342,7 @@ ofd_commitrw_write(const struct lu_env *env, struct obd_export *exp,
 	bool soft_sync = false;
 	bool cb_registered = false;
 	bool fake_write = false;
+	bool sync_batched;
 
 	ENTRY;
 
@@ -1265,6 +1394,7 @@ ofd_commitrw_write(const struct lu_env *env, struct obd_export *exp,
 	}
 
 retry:
+	sync_batched = false;
 	th = ofd_trans_create(env, ofd);
 	if (IS_ERR(th))
 		GOTO(out, rc = PTR_ERR(th));
@@ -1347,7 +1477,18 @@ out_stop:
 			granted = 0;
 	}
 
+	/* share the journal commit with concurrent sync writes */
+	if (rc == 0 && th->th_sync && ofd->ofd_sync_batch_usec > 0 &&
+	    ofd_sync_batch_cb_add(th, &osbw) == 0)
+		sync_batched = true;
+
 	rc2 = ofd_trans_stop(env, ofd, th, rc);
+	if (sync_batched) {
+		int rc3 = ofd_sync_batch_wait(env, ofd, &osbw, niocount);
+
+		if (!rc2)
+			rc2 = rc3;
+	}
 	if (!rc)
 		rc = rc2;
 	if (rc == -ENOSPC && retries++ < 3) {
@@ -7849,6 +7849,7 @@ static int osd_device_init0(const struct lu_env *env,
 
 	o->od_full_scrub_ratio = OFSR_DEFAULT;
 	o->od_full_scrub_threshold_rate = FULL_SCRUB_THRESHOLD_RATE_DEFAULT;
+	o->od_scrub_threads = OSD_SCRUB_THREADS_DEFAULT;
 	rc = osd_mount(env, o, cfg);
 	if (rc != 0)
 		GOTO(out, rc);
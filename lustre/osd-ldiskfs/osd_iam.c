@@ -2628,6 +2628,410 @@ int iam_delete(handle_t *h, struct iam_container *c, const struct iam_key *k,
 	return result;
 }
 
+/*
+ * Returns true iff keys of container @c are compared in index nodes in the
+ * same way as in leaves (i.e., index key is the key itself), so that the key
+ * range of a leaf can be deduced from the keys stored in it.
+ */
+static int iam_ikey_is_key(struct iam_container *c)
+{
+	return !strcmp(iam_container_descr(c)->id_ops->id_name, "lfix");
+}
+
+/*
+ * Position attached iterator @it at @k within the leaf it already holds,
+ * without a lookup from the root. This is only done when @k is known to fall
+ * into the key range of this leaf, that is when the leaf has both a record
+ * with a key smaller than @k and a record with a key larger than @k.
+ *
+ * Return values: 0: record with key @k found, -ENOENT: iterator is
+ * positioned to insert @k, -EAGAIN: @k may belong to another leaf.
+ */
+static int iam_it_get_leaf(struct iam_iterator *it, const struct iam_key *k)
+{
+	struct iam_leaf *leaf = &it->ii_path.ip_leaf;
+	struct iam_lentry *at;
+	int result;
+
+	assert_corr(it_state(it) != IAM_IT_DETACHED);
+
+	result = iam_leaf_ops(leaf)->lookup(leaf, k);
+	if (result == IAM_LOOKUP_EXACT) {
+		result = 0;
+	} else if (result == IAM_LOOKUP_OK) {
+		at = leaf->il_at;
+		iam_leaf_next(leaf);
+		result = iam_leaf_at_end(leaf) ? -EAGAIN : -ENOENT;
+		leaf->il_at = at;
+	} else {
+		/* before the first record or empty leaf */
+		result = -EAGAIN;
+	}
+
+	if (result != -EAGAIN) {
+		it->ii_state = IAM_IT_ATTACHED;
+		it->ii_path.ip_key_target = k;
+	}
+	return result;
+}
+
+/*
+ * Insert @*nr records into container @c (within context of transaction @h),
+ * the i-th record being @recs[i] with key @keys[i].
+ *
+ * When keys are sorted, records falling into the same leaf are inserted
+ * under a single leaf lock and without a new lookup from the root for each
+ * of them, as iam_insert() does.
+ *
+ * Insertion stops at the first failure, including -EEXIST when a record with
+ * some key is already present. On return @*nr is the number of records
+ * inserted.
+ *
+ * Return values: 0: success, -ve: error inserting record @keys[*nr].
+ */
+int iam_insert_batch(handle_t *h, struct iam_container *c,
+		     struct iam_key **keys, struct iam_rec **recs,
+		     int *nr, struct iam_path_descr *pd)
+{
+	struct iam_iterator it;
+	int same_leaf;
+	int result = 0;
+	int i;
+
+	same_leaf = iam_ikey_is_key(c);
+	iam_it_init(&it, c, IAM_IT_WRITE, pd);
+
+	for (i = 0; i < *nr; i++) {
+		result = -EAGAIN;
+		if (same_leaf && it_state(&it) != IAM_IT_DETACHED)
+			result = iam_it_get_leaf(&it, keys[i]);
+
+		if (result == -EAGAIN) {
+			iam_path_fini(&it.ii_path);
+			it.ii_state = IAM_IT_DETACHED;
+			result = iam_it_get_exact(&it, keys[i]);
+		}
+
+		if (result == -ENOENT)
+			result = iam_it_rec_insert(h, &it, keys[i], recs[i]);
+		else if (result == 0)
+			result = -EEXIST;
+		if (result != 0)
+			break;
+	}
+
+	iam_it_put(&it);
+	iam_it_fini(&it);
+	*nr = i;
+	return result;
+}
+
+/*
+ * Bulk load.
+ *
+ * Records with keys larger than all the keys in the container are appended
+ * to its rightmost leaf, and new nodes are linked at the right edge of the
+ * tree when the rightmost leaf or index node is full, so the tree is built
+ * bottom-up with all the nodes left behind filled completely, without any
+ * lookup or split.
+ *
+ * The load holds the container write lock between iam_bulk_load_start() and
+ * iam_bulk_load_fini(), and the container must not be otherwise accessed in
+ * the meantime, it is meant to fill a newly created container, such as a
+ * quota or nodemap index restored from its backup.
+ */
+
+/*
+ * Append index entry (@ik, @ptr) to the rightmost index node @depth levels
+ * above the leaves, growing the tree when the root is full.
+ */
+static int iam_bulk_push(handle_t *h, struct iam_bulk *ib, int depth,
+			 const struct iam_ikey *ik, iam_ptr_t ptr)
+{
+	struct iam_path *path = &ib->ib_path;
+	struct iam_container *c = path->ip_container;
+	struct iam_frame *frames = path->ip_frames;
+	struct iam_frame *frame = path->ip_frame - depth;
+	struct iam_entry *entries = frame->entries;
+	struct iam_entry *entries2;
+	struct iam_entry *next;
+	struct buffer_head *bh;
+	unsigned int count = dx_get_count(entries);
+	iam_ptr_t blknr;
+	int err = 0;
+
+	if (count < dx_get_limit(entries)) {
+		iam_lock_bh(frame->bh);
+		frame->at = iam_entry_shift(path, entries, count);
+		dx_set_ikey(path, frame->at, ik);
+		dx_set_block(path, frame->at, ptr);
+		dx_set_count(entries, count + 1);
+		iam_unlock_bh(frame->bh);
+		return 0;
+	}
+
+	if (frame == frames &&
+	    path->ip_indirect + 1 >= DX_MAX_TREE_HEIGHT)
+		return -ENOSPC;
+
+	bh = iam_new_node(h, c, &blknr, &err);
+	if (bh == NULL)
+		return err;
+
+	ib->ib_new_blocks++;
+	entries2 = dx_get_entries(path, bh->b_data, 0);
+	if (frame == frames) {
+		/*
+		 * Move the full root into the new node, as split_index_node()
+		 * does, the root is left with a single pointer to it. As
+		 * capacity of the root is smaller than that of other index
+		 * nodes, the new node still has room for the entry.
+		 */
+		memcpy(entries2, entries, count * iam_entry_size(path));
+		dx_set_limit(entries2, dx_node_limit(path));
+
+		iam_lock_bh(frame->bh);
+		next = c->ic_descr->id_ops->id_root_inc(c, path, frame);
+		dx_set_block(path, next, blknr);
+		iam_unlock_bh(frame->bh);
+
+		memmove(frames + 2, frames + 1,
+			(sizeof(path->ip_frames)) - 2 * sizeof(frames[0]));
+		frames[1].bh = bh;
+		frames[1].entries = entries2;
+		frames[1].at = iam_entry_shift(path, entries2, count - 1);
+		frames[1].curidx = blknr;
+		frames[1].leaf = dx_get_block(path, frames[1].at);
+		frames[0].leaf = blknr;
+		path->ip_indirect++;
+		path->ip_frame++;
+
+		return iam_bulk_push(h, ib, depth, ik, ptr);
+	}
+
+	/* Start a new rightmost node at this level with entry (@ik, @ptr). */
+	dx_set_limit(entries2, dx_node_limit(path));
+	dx_set_count(entries2, 2);
+	next = iam_entry_shift(path, entries2, 1);
+	dx_set_ikey(path, next, ik);
+	dx_set_block(path, next, ptr);
+
+	err = iam_txn_dirty(h, path, frame->bh);
+	if (err == 0)
+		err = iam_bulk_push(h, ib, depth + 1, ik, blknr);
+	if (err != 0) {
+		brelse(bh);
+		return err;
+	}
+
+	/* the parent may have been moved down by root growth */
+	frame = path->ip_frame - depth;
+	brelse(frame->bh);
+	frame->bh = bh;
+	frame->entries = entries2;
+	frame->at = next;
+	frame->curidx = blknr;
+	(frame - 1)->leaf = blknr;
+	return 0;
+}
+
+/*
+ * Replace the full rightmost leaf with a new one, whose first key is @k.
+ */
+static int iam_bulk_new_leaf(handle_t *h, struct iam_bulk *ib,
+			     const struct iam_key *k)
+{
+	struct iam_path *path = &ib->ib_path;
+	struct iam_container *c = path->ip_container;
+	struct iam_leaf *leaf = &path->ip_leaf;
+	struct buffer_head *bh;
+	iam_ptr_t blknr;
+	int err = 0;
+
+	bh = iam_new_node(h, c, &blknr, &err);
+	if (bh == NULL)
+		return err;
+
+	ib->ib_new_blocks++;
+	iam_leaf_ops(leaf)->init_new(c, bh);
+	err = iam_txn_dirty(h, path, leaf->il_bh);
+	if (err == 0)
+		err = iam_bulk_push(h, ib, 0, (const struct iam_ikey *)k,
+				    blknr);
+	if (err != 0) {
+		brelse(bh);
+		return err;
+	}
+
+	iam_leaf_ops(leaf)->fini(leaf);
+	brelse(leaf->il_bh);
+	leaf->il_bh = bh;
+	leaf->il_curidx = blknr;
+	path->ip_frame->leaf = blknr;
+	err = iam_leaf_ops(leaf)->init(leaf);
+	if (err == 0)
+		iam_leaf_start(leaf);
+	return err;
+}
+
+/*
+ * Prepare bulk load into container @c: lock the container and load its
+ * rightmost path.
+ */
+int iam_bulk_load_start(struct iam_container *c, struct iam_bulk *ib,
+			struct iam_path_descr *pd)
+{
+	struct iam_path *path = &ib->ib_path;
+	struct iam_descr *descr = iam_container_descr(c);
+	struct iam_frame *frame;
+	iam_ptr_t ptr;
+	int result = 0;
+	int i;
+
+	/* index keys are copied from the keys of the records as is */
+	if (!iam_ikey_is_key(c))
+		return -EOPNOTSUPP;
+
+	iam_container_write_lock(c);
+	iam_path_init(path, c, pd);
+	ib->ib_new_blocks = 0;
+
+	ptr = descr->id_ops->id_root_ptr(c);
+	for (frame = path->ip_frames, i = 0; i <= path->ip_indirect;
+	     ++frame, ++i) {
+		result = descr->id_ops->id_node_read(c, ptr, NULL, &frame->bh);
+		if (result != 0)
+			break;
+
+		result = descr->id_ops->id_node_check(path, frame);
+		if (result == 0)
+			result = descr->id_ops->id_node_load(path, frame);
+		if (result != 0)
+			break;
+
+		frame->at = iam_entry_shift(path, frame->entries,
+					    dx_get_count(frame->entries) - 1);
+		frame->curidx = ptr;
+		frame->leaf = ptr = dx_get_block(path, frame->at);
+	}
+	path->ip_frame = --frame;
+
+	if (result == 0)
+		result = iam_leaf_load(path);
+	if (result != 0) {
+		iam_path_fini(path);
+		iam_container_write_unlock(c);
+	}
+	return result;
+}
+
+/*
+ * Append @nr records to the container being bulk loaded (within context of
+ * transaction @h), the i-th record being @recs[i] with key @keys[i]. Keys
+ * must be in increasing order, and larger than all the keys already in the
+ * container.
+ *
+ * The transaction must have credits for iam_bulk_load_blocks(@nr) blocks.
+ *
+ * Return values: 0: success, -EINVAL: keys are out of order, -EEXIST: key
+ * is already present, -ve: other error.
+ */
+int iam_bulk_load(handle_t *h, struct iam_bulk *ib,
+		  struct iam_key **keys, struct iam_rec **recs,
+		  int nr)
+{
+	struct iam_path *path = &ib->ib_path;
+	struct iam_leaf *leaf = &path->ip_leaf;
+	struct iam_frame *frame;
+	int result = 0;
+	int i;
+
+	for (frame = path->ip_frames; frame <= path->ip_frame; ++frame) {
+		result = iam_txn_add(h, path, frame->bh);
+		if (result != 0)
+			return result;
+	}
+	result = iam_txn_add(h, path, leaf->il_bh);
+	if (result != 0)
+		return result;
+
+	ib->ib_new_blocks = 0;
+	for (i = 0; i < nr; i++) {
+		/* position the leaf past its last record, which is < @k */
+		result = iam_leaf_ops(leaf)->lookup(leaf, keys[i]);
+		if (result == IAM_LOOKUP_EXACT) {
+			result = -EEXIST;
+		} else if (result == IAM_LOOKUP_OK) {
+			iam_leaf_next(leaf);
+			result = iam_leaf_at_end(leaf) ? 0 : -EINVAL;
+		} else if (result == IAM_LOOKUP_EMPTY) {
+			iam_leaf_start(leaf);
+			result = 0;
+		} else {
+			result = -EINVAL;
+		}
+		if (result != 0)
+			break;
+
+		if (!iam_leaf_can_add(leaf, keys[i], recs[i])) {
+			result = iam_bulk_new_leaf(h, ib, keys[i]);
+			if (result != 0)
+				break;
+		}
+		iam_leaf_rec_add(leaf, keys[i], recs[i]);
+	}
+
+	if (result == 0)
+		result = iam_txn_dirty(h, path, leaf->il_bh);
+	for (frame = path->ip_frames; result == 0 && frame <= path->ip_frame;
+	     ++frame)
+		result = iam_txn_dirty(h, path, frame->bh);
+	if (result == 0 && ib->ib_new_blocks > 0)
+		result = ldiskfs_mark_inode_dirty(h, iam_path_obj(path));
+	return result;
+}
+
+/*
+ * Finish bulk load, release the rightmost path and the container lock.
+ */
+void iam_bulk_load_fini(struct iam_bulk *ib)
+{
+	struct iam_container *c = ib->ib_path.ip_container;
+
+	iam_path_fini(&ib->ib_path);
+	iam_container_write_unlock(c);
+}
+
+/*
+ * Upper bound of the number of blocks modified by iam_bulk_load() of @nr
+ * records into container @c, including the rightmost path and new nodes.
+ */
+int iam_bulk_load_blocks(struct iam_container *c, int nr)
+{
+	struct iam_descr *descr = iam_container_descr(c);
+	int blocksize = c->ic_object->i_sb->s_blocksize;
+	int leaf_recs;
+	int node_ptrs;
+	int blocks;
+	int total;
+	int i;
+
+	leaf_recs = max_t(int, blocksize /
+			  (descr->id_key_size + descr->id_rec_size) - 1, 1);
+	node_ptrs = max_t(int, blocksize /
+			  (descr->id_ikey_size + descr->id_ptr_size) - 2, 2);
+
+	/* new leaves and the current one */
+	blocks = nr / leaf_recs + 2;
+	total = blocks;
+	for (i = 0; i < DX_MAX_TREE_HEIGHT; i++) {
+		blocks = blocks / node_ptrs + 2;
+		total += blocks;
+	}
+	/* the inode */
+	return total + 1;
+}
+
 int iam_root_limit(int rootgap, int blocksize, int size)
 {
 	int limit;
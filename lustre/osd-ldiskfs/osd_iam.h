@@ -676,6 +676,31 @@ int iam_update(handle_t *h, struct iam_container *c, const struct iam_key *k,
 int iam_insert(handle_t *handle, struct iam_container *c,
                const struct iam_key *k,
                const struct iam_rec *r, struct iam_path_descr *pd);
+int iam_insert_batch(handle_t *h, struct iam_container *c,
+		     struct iam_key **keys, struct iam_rec **recs,
+		     int *nr, struct iam_path_descr *pd);
+
+/*
+ * State of a bulk load into iam container, see iam_bulk_load_start().
+ */
+struct iam_bulk {
+	/*
+	 * Rightmost path of the container, new records are appended to its
+	 * leaf.
+	 */
+	struct iam_path		ib_path;
+	/*
+	 * Number of nodes allocated by the current iam_bulk_load() call.
+	 */
+	int			ib_new_blocks;
+};
+
+int iam_bulk_load_start(struct iam_container *c, struct iam_bulk *ib,
+			struct iam_path_descr *pd);
+int iam_bulk_load(handle_t *h, struct iam_bulk *ib,
+		  struct iam_key **keys, struct iam_rec **recs, int nr);
+void iam_bulk_load_fini(struct iam_bulk *ib);
+int iam_bulk_load_blocks(struct iam_container *c, int nr);
 /*
  * Initialize container @c.
  */
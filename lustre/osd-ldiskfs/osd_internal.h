@@ -332,6 +332,11 @@ struct osd_device {
 	 * exceeds the osd_device::od_full_scrub_threshold_rate,
 	 * then trigger OI scrub to scan the whole device. */
 	__u64			 od_full_scrub_threshold_rate;
+	/* How many threads scan the device in parallel during the OI
+	 * scrub full speed scanning. */
+	unsigned int		 od_scrub_threads;
+	/* The max objects per second the OI scrub scans, 0 for no limit. */
+	__u32			 od_scrub_rate_limit;
 
 	/* a list of orphaned agent inodes, protected with od_osfs_lock */
 	struct list_head	 od_orphan_list;
@@ -366,6 +371,7 @@ enum osd_full_scrub_ratio {
 };
 
 #define FULL_SCRUB_THRESHOLD_RATE_DEFAULT	60
+#define OSD_SCRUB_THREADS_DEFAULT		1
 
 /* There are at most 15 uid/gid/projids are affected in a transaction, and
  * that's rename case:
@@ -461,6 +467,8 @@ enum {
         LPROC_OSD_CACHE_ACCESS  = 4,
         LPROC_OSD_CACHE_HIT     = 5,
         LPROC_OSD_CACHE_MISS    = 6,
+	LPROC_OSD_BIO_READ	= 7,
+	LPROC_OSD_BIO_WRITE	= 8,
 
 #if OSD_THANDLE_STATS
         LPROC_OSD_THANDLE_STARTING,
@@ -558,6 +566,7 @@ struct osd_iobuf {
 	int                dr_npages;
 	int                dr_error;
 	int                dr_frags;
+	unsigned int	   dr_bio_bytes; /* bytes submitted in dr_frags bios */
 	unsigned int       dr_elapsed_valid:1; /* we really did count time */
 	unsigned int       dr_rw:1;
 	struct lu_buf	   dr_pg_buf;
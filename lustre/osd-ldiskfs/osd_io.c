@@ -82,6 +82,7 @@ static int __osd_init_iobuf(struct osd_device *d, struct osd_iobuf *iobuf,
 	iobuf->dr_error = 0;
 	iobuf->dr_dev = d;
 	iobuf->dr_frags = 0;
+	iobuf->dr_bio_bytes = 0;
 	iobuf->dr_elapsed = ktime_set(0, 0);
 	/* must be counted before, so assert */
 	iobuf->dr_rw = rw;
@@ -152,6 +153,9 @@ void osd_fini_iobuf(struct osd_device *d, struct osd_iobuf *iobuf)
                                  iobuf->dr_frags);
 		lprocfs_oh_tally_log2(&d->od_brw_stats.hist[BRW_R_IO_TIME+rw],
 				      ktime_to_ms(iobuf->dr_elapsed));
+		CDEBUG(D_INODE, "%s: %s %d pages in %d bios, avg %u bytes\n",
+		       osd_name(d), rw ? "write" : "read", iobuf->dr_npages,
+		       iobuf->dr_frags, iobuf->dr_bio_bytes / iobuf->dr_frags);
         }
 }
 
@@ -236,14 +240,17 @@ static void record_start_io(struct osd_iobuf *iobuf, int size)
 	struct obd_histogram *h = osd->od_brw_stats.hist;
 
 	iobuf->dr_frags++;
+	iobuf->dr_bio_bytes += size;
 	atomic_inc(&iobuf->dr_numreqs);
 
 	if (iobuf->dr_rw == 0) {
+		lprocfs_counter_add(osd->od_stats, LPROC_OSD_BIO_READ, size);
 		atomic_inc(&osd->od_r_in_flight);
 		lprocfs_oh_tally(&h[BRW_R_RPC_HIST],
 				 atomic_read(&osd->od_r_in_flight));
 		lprocfs_oh_tally_log2(&h[BRW_R_DISK_IOSIZE], size);
 	} else if (iobuf->dr_rw == 1) {
+		lprocfs_counter_add(osd->od_stats, LPROC_OSD_BIO_WRITE, size);
 		atomic_inc(&osd->od_w_in_flight);
 		lprocfs_oh_tally(&h[BRW_W_RPC_HIST],
 				 atomic_read(&osd->od_w_in_flight));
@@ -651,6 +658,59 @@ static int osd_map_remote_to_local(loff_t offset, ssize_t len, int *nrpages,
 	RETURN(rc);
 }
 
+/* largest chunk of physically contiguous DIO pages allocated at once */
+#define OSD_DIO_PAGES_MAX_ORDER	(ilog2(ONE_MB_BRW_SIZE) - PAGE_SHIFT)
+
+/**
+ * Fill empty slots of the per-thread DIO page pool with contiguous pages
+ *
+ * Pages in the pool are kept for the lifetime of the service thread, so
+ * allocate them in high-order chunks split into individual pages.  Pages
+ * adjacent in the pool are then usually adjacent in memory too, and
+ * bio_add_page() can merge them into a single bio segment, so that each
+ * bio covers more data before hitting queue_max_segments() and the block
+ * layer has fewer segments to map.  Falls back to smaller orders (down to
+ * single pages in osd_get_page()) when memory is fragmented.
+ *
+ * \param[in] oti	thread info holding the DIO page pool
+ * \param[in] npages	number of pages about to be used from the pool
+ * \param[in] gfp_mask	allocation flags
+ */
+static void osd_dio_pages_prealloc(struct osd_thread_info *oti, int npages,
+				   gfp_t gfp_mask)
+{
+	int cur = oti->oti_dio_pages_used;
+	int end = min(cur + npages, PTLRPC_MAX_BRW_PAGES);
+
+	/* slots are populated in order, skip the ones already allocated */
+	while (cur < end && oti->oti_dio_pages[cur])
+		cur++;
+
+	while (cur < end) {
+		int order = min_t(int, ilog2(end - cur),
+				  OSD_DIO_PAGES_MAX_ORDER);
+		struct page *page = NULL;
+		int i;
+
+		for (; order > 0; order--) {
+			page = alloc_pages(gfp_mask | __GFP_NORETRY |
+					   __GFP_NOWARN, order);
+			if (page)
+				break;
+		}
+		/* leave the remaining slots to osd_get_page() */
+		if (!page)
+			return;
+
+		split_page(page, order);
+		for (i = 0; i < (1 << order); i++, cur++) {
+			oti->oti_dio_pages[cur] = page + i;
+			SetPagePrivate2(page + i);
+			lock_page(page + i);
+		}
+	}
+}
+
 static struct page *osd_get_page(const struct lu_env *env, struct dt_object *dt,
 				 loff_t offset, gfp_t gfp_mask, bool cache)
 {
@@ -865,6 +925,9 @@ bypass_checks:
 	/* this could also try less hard for DT_BUFS_TYPE_READAHEAD pages */
 	gfp_mask = rw & DT_BUFS_TYPE_LOCAL ? (GFP_NOFS | __GFP_HIGHMEM) :
 					     GFP_HIGHUSER;
+	if (!cache)
+		osd_dio_pages_prealloc(oti, npages, gfp_mask);
+
 	for (i = 0; i < npages; i++, lnb++) {
 		lnb->lnb_page = osd_get_page(env, dt, lnb->lnb_file_offset,
 					     gfp_mask, cache);
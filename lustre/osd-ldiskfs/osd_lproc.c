@@ -210,6 +210,12 @@ static int osd_stats_init(struct osd_device *osd)
                 lprocfs_counter_init(osd->od_stats, LPROC_OSD_CACHE_MISS,
                                      LPROCFS_CNTR_AVGMINMAX,
                                      "cache_miss", "pages");
+		lprocfs_counter_init(osd->od_stats, LPROC_OSD_BIO_READ,
+				     LPROCFS_CNTR_AVGMINMAX,
+				     "bio_read", "bytes");
+		lprocfs_counter_init(osd->od_stats, LPROC_OSD_BIO_WRITE,
+				     LPROCFS_CNTR_AVGMINMAX,
+				     "bio_write", "bytes");
 #if OSD_THANDLE_STATS
                 lprocfs_counter_init(osd->od_stats, LPROC_OSD_THANDLE_STARTING,
                                      LPROCFS_CNTR_AVGMINMAX,
@@ -528,6 +534,84 @@ static ssize_t full_scrub_threshold_rate_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(full_scrub_threshold_rate);
 
+static ssize_t scrub_threads_show(struct kobject *kobj, struct attribute *attr,
+				  char *buf)
+{
+	struct dt_device *dt = container_of(kobj, struct dt_device,
+					    dd_kobj);
+	struct osd_device *dev = osd_dt_dev(dt);
+
+	LASSERT(dev);
+	if (unlikely(!dev->od_mnt))
+		return -EINPROGRESS;
+
+	return sprintf(buf, "%u\n", dev->od_scrub_threads);
+}
+
+static ssize_t scrub_threads_store(struct kobject *kobj,
+				   struct attribute *attr,
+				   const char *buffer, size_t count)
+{
+	struct dt_device *dt = container_of(kobj, struct dt_device,
+					    dd_kobj);
+	struct osd_device *dev = osd_dt_dev(dt);
+	unsigned int val;
+	int rc;
+
+	LASSERT(dev);
+	if (unlikely(!dev->od_mnt))
+		return -EINPROGRESS;
+
+	rc = kstrtouint(buffer, 0, &val);
+	if (rc)
+		return rc;
+
+	if (val < 1 || val > SCRUB_PARTS_MAX)
+		return -ERANGE;
+
+	/* take effect since the next full speed scanning */
+	dev->od_scrub_threads = val;
+	return count;
+}
+LUSTRE_RW_ATTR(scrub_threads);
+
+static ssize_t scrub_rate_limit_show(struct kobject *kobj,
+				     struct attribute *attr, char *buf)
+{
+	struct dt_device *dt = container_of(kobj, struct dt_device,
+					    dd_kobj);
+	struct osd_device *dev = osd_dt_dev(dt);
+
+	LASSERT(dev);
+	if (unlikely(!dev->od_mnt))
+		return -EINPROGRESS;
+
+	return sprintf(buf, "%u\n", dev->od_scrub_rate_limit);
+}
+
+static ssize_t scrub_rate_limit_store(struct kobject *kobj,
+				      struct attribute *attr,
+				      const char *buffer, size_t count)
+{
+	struct dt_device *dt = container_of(kobj, struct dt_device,
+					    dd_kobj);
+	struct osd_device *dev = osd_dt_dev(dt);
+	u32 val;
+	int rc;
+
+	LASSERT(dev);
+	if (unlikely(!dev->od_mnt))
+		return -EINPROGRESS;
+
+	rc = kstrtou32(buffer, 0, &val);
+	if (rc)
+		return rc;
+
+	WRITE_ONCE(dev->od_scrub_rate_limit, val);
+	return count;
+}
+LUSTRE_RW_ATTR(scrub_rate_limit);
+
 static int ldiskfs_osd_oi_scrub_seq_show(struct seq_file *m, void *data)
 {
 	struct osd_device *dev = osd_dt_dev((struct dt_device *)m->private);
@@ -816,6 +900,8 @@ static struct attribute *ldiskfs_attrs[] = {
 	&lustre_attr_pdo.attr,
 	&lustre_attr_full_scrub_ratio.attr,
 	&lustre_attr_full_scrub_threshold_rate.attr,
+	&lustre_attr_scrub_threads.attr,
+	&lustre_attr_scrub_rate_limit.attr,
 	NULL,
 };
 
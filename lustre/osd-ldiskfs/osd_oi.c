@@ -777,6 +777,44 @@ update:
 	return rc;
 }
 
+/**
+ * Insert \a *nr OI mappings into the OI file \a oi, the keys and records
+ * being packed as osd_oi_insert() does. The keys should be sorted, so that
+ * the mappings going to the same leaf are inserted without a new lookup.
+ *
+ * \param[in,out] nr	number of mappings to insert, then inserted
+ *
+ * \retval 0		all inserted
+ * \retval -EEXIST	the key of mapping \a *nr is already in the OI
+ * \retval -ve		failed to insert mapping \a *nr
+ */
+int osd_oi_insert_batch(struct osd_thread_info *info, struct osd_oi *oi,
+			struct iam_key **keys, struct iam_rec **recs,
+			int *nr, handle_t *th)
+{
+	struct iam_container *bag;
+	struct iam_path_descr *ipd;
+	int rc;
+	ENTRY;
+
+	LASSERT(oi);
+	LASSERT(oi->oi_inode);
+	dquot_initialize(oi->oi_inode);
+
+	bag = &oi->oi_dir.od_container;
+	ipd = osd_idx_ipd_get(info->oti_env, bag);
+	if (unlikely(ipd == NULL)) {
+		*nr = 0;
+		RETURN(-ENOMEM);
+	}
+
+	LASSERT(th != NULL);
+	LASSERT(th->h_transaction != NULL);
+	rc = iam_insert_batch(th, bag, keys, recs, nr, ipd);
+	osd_ipd_put(info->oti_env, bag, ipd);
+	RETURN(rc);
+}
+
 static int osd_oi_iam_delete(struct osd_thread_info *oti, struct osd_oi *oi,
 			     const struct dt_key *key, handle_t *th)
 {
@@ -64,6 +64,8 @@ struct lu_site;
 struct dt_device;
 struct osd_device;
 struct osd_oi;
+struct iam_key;
+struct iam_rec;
 
 /*
  * Storage cookie. Datum uniquely identifying inode on the underlying file
@@ -146,6 +148,9 @@ int  osd_oi_lookup(struct osd_thread_info *info, struct osd_device *osd,
 int  osd_oi_insert(struct osd_thread_info *info, struct osd_device *osd,
 		   const struct lu_fid *fid, const struct osd_inode_id *id,
 		   handle_t *th, enum oi_check_flags flags, bool *exist);
+int  osd_oi_insert_batch(struct osd_thread_info *info, struct osd_oi *oi,
+			 struct iam_key **keys, struct iam_rec **recs,
+			 int *nr, handle_t *th);
 int  osd_oi_delete(struct osd_thread_info *info,
 		   struct osd_device *osd, const struct lu_fid *fid,
 		   handle_t *th, enum oi_check_flags flags);
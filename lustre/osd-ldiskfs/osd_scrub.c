@@ -38,6 +38,7 @@
 #define DEBUG_SUBSYSTEM S_LFSCK
 
 #include <linux/kthread.h>
+#include <linux/sort.h>
 #include <uapi/linux/lustre/lustre_idl.h>
 #include <lustre_disk.h>
 #include <dt_object.h>
@@ -159,6 +160,187 @@ static int osd_scrub_refresh_mapping(struct osd_thread_info *info,
 	RETURN(rc);
 }
 
+/* Only the plain OI mappings are batched, the others are not in OI files
+ * or need more than the OI insert. */
+static bool osd_scrub_oi_batchable(struct osd_thread_info *info,
+				   struct osd_device *dev,
+				   const struct lu_fid *fid, int val)
+{
+	if (val == SCRUB_NEXT_OSTOBJ || val == SCRUB_NEXT_OSTOBJ_OLD)
+		return false;
+
+	if (fid_is_last_id(fid) || fid_is_llog(fid) ||
+	    fid_seq(fid) == FID_SEQ_LOCAL_FILE)
+		return false;
+
+	return !fid_is_on_ost(info, dev, fid, 0);
+}
+
+static bool osd_scrub_oi_full(struct osd_device *dev,
+			      struct osd_scrub_oi_batch *batch)
+{
+	return batch->osb_count == OSD_SCRUB_OI_BATCH ||
+	       (batch->osb_count + 1) *
+	       osd_dto_credits_noquota[DTO_INDEX_INSERT] >
+	       osd_transaction_size(dev);
+}
+
+static void osd_scrub_oi_add(struct osd_device *dev,
+			     struct osd_scrub_oi_batch *batch,
+			     const struct lu_fid *fid,
+			     const struct osd_inode_id *id,
+			     struct inode *inode, bool recreated)
+{
+	struct osd_scrub_oi_item *item = &batch->osb_items[batch->osb_count++];
+
+	item->osi_fid = *fid;
+	item->osi_idx = osd_oi_fid2idx(dev, fid);
+	item->osi_id = *id;
+	fid_cpu_to_be(&item->osi_key, fid);
+	osd_id_pack(&item->osi_rec, id);
+	item->osi_inode = inode;
+	item->osi_rc = 0;
+	item->osi_recreated = recreated;
+	item->osi_exist = false;
+}
+
+/* Sort by OI file, then by key as the IAM lfix leaves are. */
+static int osd_scrub_oi_cmp(const void *a, const void *b)
+{
+	const struct osd_scrub_oi_item *ia = a;
+	const struct osd_scrub_oi_item *ib = b;
+
+	if (ia->osi_idx != ib->osi_idx)
+		return ia->osi_idx - ib->osi_idx;
+	return memcmp(&ia->osi_key, &ib->osi_key, sizeof(ia->osi_key));
+}
+
+/**
+ * Insert the OI mappings collected in \a batch in one transaction. Those
+ * going to the same OI file are inserted by one osd_oi_insert_batch(), in
+ * key order. A mapping whose key is already in the OI is checked and fixed
+ * by osd_oi_insert() as a single one.
+ *
+ * \retval 0		all the mappings processed, or failed without
+ *			SP_FAILOUT
+ * \retval -ve		the first failure, with SP_FAILOUT
+ */
+static int osd_scrub_oi_flush(struct osd_thread_info *info,
+			      struct osd_device *dev,
+			      struct osd_scrub_oi_batch *batch)
+{
+	struct lustre_scrub *scrub = &dev->od_scrub.os_scrub;
+	struct scrub_file *sf = &scrub->os_file;
+	struct osd_scrub_oi_item *items = batch->osb_items;
+	struct osd_scrub_oi_item *item;
+	int count = batch->osb_count;
+	handle_t *th;
+	int rc = 0;
+	int nr;
+	int i;
+	int j;
+	ENTRY;
+
+	if (count == 0)
+		RETURN(0);
+
+	down_read(&scrub->os_rwsem);
+	sort(items, count, sizeof(*items), osd_scrub_oi_cmp, NULL);
+	for (i = 0; i < count; i++) {
+		batch->osb_keys[i] = (struct iam_key *)&items[i].osi_key;
+		batch->osb_recs[i] = (struct iam_rec *)&items[i].osi_rec;
+	}
+
+	th = osd_journal_start_sb(osd_sb(dev), LDISKFS_HT_MISC,
+				  osd_dto_credits_noquota[DTO_INDEX_INSERT] *
+				  count);
+	if (IS_ERR(th)) {
+		rc = PTR_ERR(th);
+		CDEBUG(D_LFSCK, "%s: fail to start trans for scrub OI insert "
+		       "of %d mappings: rc = %d\n", osd_name(dev), count, rc);
+		for (i = 0; i < count; i++)
+			items[i].osi_rc = rc;
+		goto stat;
+	}
+
+	for (i = 0; i < count; i = j) {
+		struct osd_oi *oi = dev->od_oi_table[items[i].osi_idx];
+
+		j = i + 1;
+		while (j < count && items[j].osi_idx == items[i].osi_idx)
+			j++;
+
+		while (i < j) {
+			nr = j - i;
+			rc = osd_oi_insert_batch(info, oi, &batch->osb_keys[i],
+						 &batch->osb_recs[i], &nr, th);
+			i += nr;
+			if (rc == 0)
+				break;
+
+			item = &items[i];
+			if (rc == -EEXIST)
+				rc = osd_oi_insert(info, dev, &item->osi_fid,
+						   &item->osi_id, th, 0,
+						   &item->osi_exist);
+			/* the same mapping, or see osd_scrub_refresh_mapping()
+			 * for IGIF mapped to two objects */
+			if (rc == -EEXIST)
+				rc = 1;
+			if (rc < 0)
+				CDEBUG(D_LFSCK, "%s: fail to insert OI map "DFID
+				       " => %u/%u: rc = %d\n", osd_name(dev),
+				       PFID(&item->osi_fid),
+				       item->osi_id.oii_ino,
+				       item->osi_id.oii_gen, rc);
+			item->osi_rc = rc;
+			i++;
+		}
+	}
+	ldiskfs_journal_stop(th);
+	rc = 0;
+
+stat:
+	for (i = 0; i < count; i++) {
+		item = &items[i];
+		spin_lock(&scrub->os_lock);
+		if (item->osi_rc == 0) {
+			sf->sf_items_updated++;
+			if (item->osi_recreated && !item->osi_exist) {
+				sf->sf_flags |= SF_RECREATED;
+				if (unlikely(!ldiskfs_test_bit(item->osi_idx,
+							sf->sf_oi_bitmap)))
+					ldiskfs_set_bit(item->osi_idx,
+							sf->sf_oi_bitmap);
+			}
+		} else if (item->osi_rc < 0) {
+			sf->sf_items_failed++;
+			if (sf->sf_pos_first_inconsistent == 0 ||
+			    sf->sf_pos_first_inconsistent >
+			    item->osi_id.oii_ino)
+				sf->sf_pos_first_inconsistent =
+					item->osi_id.oii_ino;
+			if (rc == 0)
+				rc = item->osi_rc;
+		}
+		spin_unlock(&scrub->os_lock);
+
+		/* There may be conflict unlink during the OI scrub,
+		 * if happend, then remove the new added OI mapping. */
+		if (unlikely(ldiskfs_test_inode_state(item->osi_inode,
+					LDISKFS_STATE_LUSTRE_DESTROY)))
+			osd_scrub_refresh_mapping(info, dev, &item->osi_fid,
+						  &item->osi_id,
+						  DTO_INDEX_DELETE, false, 0,
+						  NULL);
+		iput(item->osi_inode);
+	}
+	batch->osb_count = 0;
+	up_read(&scrub->os_rwsem);
+
+	RETURN(sf->sf_param & SP_FAILOUT ? rc : 0);
+}
+
 static int
 osd_scrub_convert_ff(struct osd_thread_info *info, struct osd_device *dev,
 		     struct inode *inode, const struct lu_fid *fid)
@@ -248,9 +430,17 @@ stop:
 	return rc;
 }
 
+/* The parallel scanning threads may check different objects at the same
+ * time, so the scrub file and counters are updated under os_lock, the
+ * read lock of os_rwsem only keeps them from the checkpoint.
+ *
+ * A missing OI mapping is added to \a batch, if any, and inserted later by
+ * osd_scrub_oi_flush(), which the caller must do before its position moves
+ * past the object. */
 static int
 osd_scrub_check_update(struct osd_thread_info *info, struct osd_device *dev,
-		       struct osd_idmap_cache *oic, int val)
+		       struct osd_idmap_cache *oic, int val, bool prior,
+		       struct osd_scrub_oi_batch *batch)
 {
 	struct lustre_scrub *scrub = &dev->od_scrub.os_scrub;
 	struct scrub_file	     *sf     = &scrub->os_file;
@@ -265,20 +455,25 @@ osd_scrub_check_update(struct osd_thread_info *info, struct osd_device *dev,
 	bool			      exist	= false;
 	ENTRY;
 
-	down_write(&scrub->os_rwsem);
+	down_read(&scrub->os_rwsem);
+	spin_lock(&scrub->os_lock);
 	scrub->os_new_checked++;
+	spin_unlock(&scrub->os_lock);
 	if (val < 0)
 		GOTO(out, rc = val);
 
-	if (scrub->os_in_prior)
+	if (prior)
 		oii = list_entry(oic, struct osd_inconsistent_item,
 				 oii_cache);
 
 	if (lid->oii_ino < sf->sf_pos_latest_start && oii == NULL)
 		GOTO(out, rc = 0);
 
-	if (fid_is_igif(fid))
+	if (fid_is_igif(fid)) {
+		spin_lock(&scrub->os_lock);
 		sf->sf_items_igif++;
+		spin_unlock(&scrub->os_lock);
+	}
 
 	if (val == SCRUB_NEXT_OSTOBJ_OLD) {
 		inode = osd_iget(info, dev, lid);
@@ -294,8 +489,10 @@ osd_scrub_check_update(struct osd_thread_info *info, struct osd_device *dev,
 		if (unlikely(osd_is_ea_inode(inode)))
 			GOTO(out, rc = 0);
 
+		spin_lock(&scrub->os_lock);
 		sf->sf_flags |= SF_UPGRADE;
 		sf->sf_internal_flags &= ~SIF_NO_HANDLE_OLD_FID;
+		spin_unlock(&scrub->os_lock);
 		dev->od_check_ff = 1;
 		rc = osd_scrub_convert_ff(info, dev, inode, fid);
 		if (rc != 0)
@@ -339,12 +536,16 @@ iget:
 				GOTO(out, rc = 0);
 		}
 
+		spin_lock(&scrub->os_lock);
 		if (!scrub->os_partial_scan)
 			scrub->os_full_speed = 1;
+		spin_unlock(&scrub->os_lock);
 
 		switch (val) {
 		case SCRUB_NEXT_NOLMA:
+			spin_lock(&scrub->os_lock);
 			sf->sf_flags |= SF_UPGRADE;
+			spin_unlock(&scrub->os_lock);
 			if (!(sf->sf_param & SP_DRYRUN)) {
 				rc = osd_ea_fid_set(info, inode, fid, 0, 0);
 				if (rc != 0)
@@ -355,22 +556,29 @@ iget:
 				dev->od_igif_inoi = 0;
 			break;
 		case SCRUB_NEXT_OSTOBJ:
+			spin_lock(&scrub->os_lock);
 			sf->sf_flags |= SF_INCONSISTENT;
+			spin_unlock(&scrub->os_lock);
 		case SCRUB_NEXT_OSTOBJ_OLD:
 			break;
 		default:
 			break;
 		}
 	} else if (osd_id_eq(lid, lid2)) {
-		if (converted)
+		if (converted) {
+			spin_lock(&scrub->os_lock);
 			sf->sf_items_updated++;
+			spin_unlock(&scrub->os_lock);
+		}
 
 		GOTO(out, rc = 0);
 	} else {
+		spin_lock(&scrub->os_lock);
 		if (!scrub->os_partial_scan)
 			scrub->os_full_speed = 1;
 
 		sf->sf_flags |= SF_INCONSISTENT;
+		spin_unlock(&scrub->os_lock);
 
 		/* XXX: If the device is restored from file-level backup, then
 		 *	some IGIFs may have been already in OI files, and some
@@ -387,12 +595,23 @@ iget:
 		dev->od_igif_inoi = 1;
 	}
 
+	if (batch != NULL && oii == NULL && ops == DTO_INDEX_INSERT &&
+	    inode != NULL && !(sf->sf_param & SP_DRYRUN) &&
+	    !osd_scrub_oi_full(dev, batch) &&
+	    osd_scrub_oi_batchable(info, dev, fid, val)) {
+		/* the batch holds the inode reference */
+		osd_scrub_oi_add(dev, batch, fid, lid, inode, val == 0);
+		inode = NULL;
+		GOTO(out, rc = 0);
+	}
+
 	rc = osd_scrub_refresh_mapping(info, dev, fid, lid, ops, false,
 			(val == SCRUB_NEXT_OSTOBJ ||
 			 val == SCRUB_NEXT_OSTOBJ_OLD) ? OI_KNOWN_ON_OST : 0,
 			&exist);
 	if (rc == 0) {
-		if (scrub->os_in_prior)
+		spin_lock(&scrub->os_lock);
+		if (prior)
 			sf->sf_items_updated_prior++;
 		else
 			sf->sf_items_updated++;
@@ -404,16 +623,19 @@ iget:
 			if (unlikely(!ldiskfs_test_bit(idx, sf->sf_oi_bitmap)))
 				ldiskfs_set_bit(idx, sf->sf_oi_bitmap);
 		}
+		spin_unlock(&scrub->os_lock);
 	}
 
 	GOTO(out, rc);
 
 out:
 	if (rc < 0) {
+		spin_lock(&scrub->os_lock);
 		sf->sf_items_failed++;
 		if (sf->sf_pos_first_inconsistent == 0 ||
 		    sf->sf_pos_first_inconsistent > lid->oii_ino)
 			sf->sf_pos_first_inconsistent = lid->oii_ino;
+		spin_unlock(&scrub->os_lock);
 	} else {
 		rc = 0;
 	}
@@ -428,7 +650,7 @@ out:
 				(val == SCRUB_NEXT_OSTOBJ ||
 				 val == SCRUB_NEXT_OSTOBJ_OLD) ?
 				OI_KNOWN_ON_OST : 0, NULL);
-	up_write(&scrub->os_rwsem);
+	up_read(&scrub->os_rwsem);
 
 	if (inode != NULL && !IS_ERR(inode))
 		iput(inode);
@@ -499,12 +721,15 @@ static int osd_scrub_prep(const struct lu_env *env, struct osd_device *dev)
 	scrub->os_full_scrub = 0;
 	spin_unlock(&scrub->os_lock);
 	scrub->os_new_checked = 0;
-	if (drop_dryrun && sf->sf_pos_first_inconsistent != 0)
+	if (drop_dryrun && sf->sf_pos_first_inconsistent != 0) {
 		sf->sf_pos_latest_start = sf->sf_pos_first_inconsistent;
-	else if (sf->sf_pos_last_checkpoint != 0)
+		sf->sf_parts = 0;
+	} else if (sf->sf_pos_last_checkpoint != 0) {
 		sf->sf_pos_latest_start = sf->sf_pos_last_checkpoint + 1;
-	else
+	} else {
 		sf->sf_pos_latest_start = LDISKFS_FIRST_INO(osd_sb(dev)) + 1;
+		sf->sf_parts = 0;
+	}
 
 	scrub->os_pos_current = sf->sf_pos_latest_start;
 	sf->sf_status = SS_SCANNING;
@@ -548,6 +773,7 @@ static int osd_scrub_post(const struct lu_env *env, struct osd_device *dev,
 		dev->od_igif_inoi = 1;
 		dev->od_check_ff = 0;
 		sf->sf_status = SS_COMPLETED;
+		sf->sf_parts = 0;
 		if (!(sf->sf_param & SP_DRYRUN)) {
 			memset(sf->sf_oi_bitmap, 0, SCRUB_OI_BITMAP_SIZE);
 			sf->sf_flags &= ~(SF_RECREATED | SF_INCONSISTENT |
@@ -773,6 +999,45 @@ put:
 	return rc;
 }
 
+static void osd_scrub_noscrub(struct lustre_scrub *scrub)
+{
+	down_read(&scrub->os_rwsem);
+	spin_lock(&scrub->os_lock);
+	scrub->os_new_checked++;
+	scrub->os_file.sf_items_noscrub++;
+	spin_unlock(&scrub->os_lock);
+	up_read(&scrub->os_rwsem);
+}
+
+/* Hold the caller until the scanning is allowed by the rate limit, which
+ * is shared by all the threads scanning the device. */
+static void osd_scrub_throttle(struct osd_device *dev)
+{
+	struct osd_scrub *scrub = &dev->od_scrub;
+	unsigned long deadline;
+	__u32 limit;
+
+	while ((limit = READ_ONCE(dev->od_scrub_rate_limit)) != 0 &&
+	       thread_is_running(&scrub->os_scrub.os_thread)) {
+		spin_lock(&scrub->os_scrub.os_lock);
+		if (time_after_eq(jiffies, scrub->os_rate_start + HZ)) {
+			scrub->os_rate_start = jiffies;
+			scrub->os_rate_count = 0;
+		}
+
+		if (scrub->os_rate_count < limit) {
+			scrub->os_rate_count++;
+			spin_unlock(&scrub->os_scrub.os_lock);
+			return;
+		}
+
+		deadline = scrub->os_rate_start + HZ;
+		spin_unlock(&scrub->os_scrub.os_lock);
+		if (time_before(jiffies, deadline))
+			schedule_timeout_interruptible(deadline - jiffies);
+	}
+}
+
 static int osd_scrub_next(struct osd_thread_info *info, struct osd_device *dev,
 			  struct osd_iit_param *param,
 			  struct osd_idmap_cache **oic, const bool noslot)
@@ -823,6 +1088,7 @@ static int osd_scrub_next(struct osd_thread_info *info, struct osd_device *dev,
 	if (noslot)
 		return SCRUB_NEXT_WAIT;
 
+	osd_scrub_throttle(dev);
 	rc = osd_iit_next(param, &scrub->os_pos_current);
 	if (rc != 0)
 		return rc;
@@ -879,23 +1145,27 @@ static int osd_scrub_exec(struct osd_thread_info *info, struct osd_device *dev,
 			  struct osd_idmap_cache *oic, bool *noslot, int rc)
 {
 	struct lustre_scrub *scrub = &dev->od_scrub.os_scrub;
-	struct scrub_file *sf = &scrub->os_file;
 	struct ptlrpc_thread *thread = &scrub->os_thread;
 	struct osd_otable_it *it = dev->od_otable_it;
 	struct osd_otable_cache *ooc = it ? &it->ooi_cache : NULL;
+	struct osd_scrub_oi_batch *batch;
 
 	switch (rc) {
 	case SCRUB_NEXT_NOSCRUB:
-		down_write(&scrub->os_rwsem);
-		scrub->os_new_checked++;
-		sf->sf_items_noscrub++;
-		up_write(&scrub->os_rwsem);
+		osd_scrub_noscrub(scrub);
 	case SCRUB_NEXT_CONTINUE:
 	case SCRUB_NEXT_WAIT:
 		goto wait;
 	}
 
-	rc = osd_scrub_check_update(info, dev, oic, rc);
+	/* The LFSCK looks up the objects just scanned, the OI mappings are
+	 * not batched for it. */
+	batch = &dev->od_scrub.os_oi_batch;
+	rc = osd_scrub_check_update(info, dev, oic, rc, scrub->os_in_prior,
+				    it == NULL ? batch : NULL);
+	if (rc == 0 && (it != NULL || osd_scrub_oi_full(dev, batch) ||
+			ktime_get_seconds() >= scrub->os_time_next_checkpoint))
+		rc = osd_scrub_oi_flush(info, dev, batch);
 	if (rc != 0) {
 		scrub->os_in_prior = 0;
 		return rc;
@@ -999,10 +1269,12 @@ static void osd_scrub_join(const struct lu_env *env, struct osd_device *dev,
 	}
 
 	scrub->os_new_checked = 0;
-	if (sf->sf_pos_last_checkpoint != 0)
+	if (sf->sf_pos_last_checkpoint != 0) {
 		sf->sf_pos_latest_start = sf->sf_pos_last_checkpoint + 1;
-	else
+	} else {
 		sf->sf_pos_latest_start = LDISKFS_FIRST_INO(osd_sb(dev)) + 1;
+		sf->sf_parts = 0;
+	}
 
 	scrub->os_pos_current = sf->sf_pos_latest_start;
 	sf->sf_time_latest_start = ktime_get_real_seconds();
@@ -1026,6 +1298,361 @@ static void osd_scrub_join(const struct lu_env *env, struct osd_device *dev,
 	EXIT;
 }
 
+/* parallel scanning */
+
+static struct osd_scrub_part *
+osd_scrub_parts_init(struct osd_device *dev, unsigned int nparts)
+{
+	struct scrub_file *sf = &dev->od_scrub.os_scrub.os_file;
+	struct super_block *sb = osd_sb(dev);
+	ldiskfs_group_t ngroups = LDISKFS_SB(sb)->s_groups_count;
+	__u32 ipg = LDISKFS_INODES_PER_GROUP(sb);
+	struct osd_scrub_part *parts;
+	struct osd_scrub_part *part;
+	unsigned int i;
+	__u64 start;
+	__u64 end;
+
+	OBD_ALLOC_PTR_ARRAY(parts, nparts);
+	if (parts == NULL)
+		return NULL;
+
+	for (i = 0; i < nparts; i++) {
+		part = &parts[i];
+		part->osp_dev = dev;
+		part->osp_index = i;
+		part->osp_bg_start = div_u64((__u64)ngroups * i, nparts);
+		part->osp_bg_end = div_u64((__u64)ngroups * (i + 1), nparts);
+
+		start = 1 + (__u64)part->osp_bg_start * ipg;
+		end = 1 + (__u64)part->osp_bg_end * ipg;
+		part->osp_pos = max(start, sf->sf_pos_latest_start);
+		/* The partitions are the same as the last run and were
+		 * saved with the last checkpoint, then resume each of them
+		 * from its own checkpoint. */
+		if (sf->sf_parts == nparts &&
+		    sf->sf_pos_parts_checkpoint == sf->sf_pos_last_checkpoint)
+			part->osp_pos = max(part->osp_pos, sf->sf_pos_parts[i]);
+		if (part->osp_pos >= end) {
+			part->osp_pos = end;
+			part->osp_done = true;
+		}
+	}
+
+	return parts;
+}
+
+/* Sync the partitions' positions into the scrub file. The current position
+ * is the one before which all the inodes have been scanned, so that the
+ * OI scrub can always restart from the last checkpoint position. */
+static void osd_scrub_parts_sync(struct osd_device *dev)
+{
+	struct osd_scrub *oscrub = &dev->od_scrub;
+	struct lustre_scrub *scrub = &oscrub->os_scrub;
+	struct scrub_file *sf = &scrub->os_file;
+	struct osd_scrub_part *part;
+	unsigned int nparts = oscrub->os_nparts;
+	unsigned int i;
+	__u64 pos = 0;
+
+	down_write(&scrub->os_rwsem);
+	for (i = 0; i < nparts; i++) {
+		part = &oscrub->os_parts[i];
+		sf->sf_pos_parts[i] = READ_ONCE(part->osp_pos);
+		if (pos == 0 && !READ_ONCE(part->osp_done))
+			pos = sf->sf_pos_parts[i];
+	}
+	if (pos == 0)
+		pos = sf->sf_pos_parts[nparts - 1];
+	sf->sf_parts = nparts;
+	/* scrub_checkpoint() saves it as sf_pos_last_checkpoint */
+	sf->sf_pos_parts_checkpoint = pos - 1;
+	scrub->os_pos_current = pos - 1;
+	up_write(&scrub->os_rwsem);
+}
+
+static int osd_scrub_parts_prior(struct osd_thread_info *info,
+				 struct osd_device *dev)
+{
+	struct lustre_scrub *scrub = &dev->od_scrub.os_scrub;
+	struct osd_inconsistent_item *oii;
+	int rc = 0;
+
+	while (rc == 0 && thread_is_running(&scrub->os_thread)) {
+		spin_lock(&scrub->os_lock);
+		if (list_empty(&scrub->os_inconsistent_items)) {
+			spin_unlock(&scrub->os_lock);
+			break;
+		}
+
+		oii = list_entry(scrub->os_inconsistent_items.next,
+				 struct osd_inconsistent_item, oii_list);
+		scrub->os_in_prior = 1;
+		spin_unlock(&scrub->os_lock);
+
+		rc = osd_scrub_check_update(info, dev, &oii->oii_cache, 0,
+					    true, NULL);
+
+		spin_lock(&scrub->os_lock);
+		scrub->os_in_prior = 0;
+		spin_unlock(&scrub->os_lock);
+	}
+
+	return rc;
+}
+
+static int osd_scrub_part_main(void *args)
+{
+	struct osd_scrub_part *part = args;
+	struct osd_device *dev = part->osp_dev;
+	struct osd_scrub *oscrub = &dev->od_scrub;
+	struct lustre_scrub *scrub = &oscrub->os_scrub;
+	struct ptlrpc_thread *thread = &scrub->os_thread;
+	struct osd_iit_param *param = &part->osp_param;
+	struct osd_idmap_cache *oic = &part->osp_oic;
+	struct osd_scrub_oi_batch *batch = &part->osp_oi_batch;
+	struct osd_thread_info *info;
+	struct lu_env env;
+	__u32 ipg;
+	__u64 pos;
+	int rc;
+	int rc1;
+
+	rc = lu_env_init(&env, LCT_LOCAL | LCT_DT_THREAD);
+	if (rc != 0) {
+		CDEBUG(D_LFSCK, "%s: OI scrub thread %u fail to init env: "
+		       "rc = %d\n", osd_scrub2name(scrub), part->osp_index, rc);
+		GOTO(noenv, rc);
+	}
+
+	info = osd_oti_get(&env);
+	param->sb = osd_sb(dev);
+	ipg = LDISKFS_INODES_PER_GROUP(param->sb);
+	pos = part->osp_pos;
+	param->start = pos;
+	param->bg = (pos - 1) / ipg;
+	param->offset = (pos - 1) % ipg;
+	param->gbase = 1 + param->bg * ipg;
+
+	while (param->bg < part->osp_bg_end) {
+		struct ldiskfs_group_desc *desc;
+
+		desc = ldiskfs_get_group_desc(param->sb, param->bg, NULL);
+		if (!desc)
+			GOTO(out, rc = -EIO);
+
+		if (desc->bg_flags & cpu_to_le16(LDISKFS_BG_INODE_UNINIT))
+			goto next_group;
+
+		param->bitmap = ldiskfs_read_inode_bitmap(param->sb, param->bg);
+		if (!param->bitmap) {
+			CERROR("%s: fail to read bitmap for %u, "
+			       "scrub will stop, urgent mode\n",
+			       osd_scrub2name(scrub), (__u32)param->bg);
+			GOTO(out, rc = -EIO);
+		}
+
+		while (param->offset +
+		       ldiskfs_itable_unused_count(param->sb, desc) < ipg) {
+			if (unlikely(!thread_is_running(thread) ||
+				     READ_ONCE(oscrub->os_parts_abort)))
+				GOTO(out, rc = 0);
+
+			if (OBD_FAIL_CHECK(OBD_FAIL_OSD_SCRUB_CRASH)) {
+				spin_lock(&scrub->os_lock);
+				thread_set_flags(thread, SVC_STOPPING);
+				spin_unlock(&scrub->os_lock);
+				GOTO(out, rc = SCRUB_NEXT_CRASH);
+			}
+
+			if (OBD_FAIL_CHECK(OBD_FAIL_OSD_SCRUB_FATAL))
+				GOTO(out, rc = -EINVAL);
+
+			osd_scrub_throttle(dev);
+			rc = osd_iit_next(param, &pos);
+			if (rc == SCRUB_NEXT_BREAK)
+				break;
+
+			rc = osd_iit_iget(info, dev, &oic->oic_fid,
+					  &oic->oic_lid, pos, param->sb, true);
+			switch (rc) {
+			case SCRUB_NEXT_CONTINUE:
+				rc = 0;
+				break;
+			case SCRUB_NEXT_NOSCRUB:
+				osd_scrub_noscrub(scrub);
+				part->osp_checked++;
+				rc = 0;
+				break;
+			default:
+				rc = osd_scrub_check_update(info, dev, oic, rc,
+							    false, batch);
+				part->osp_checked++;
+				if (rc == 0 && osd_scrub_oi_full(dev, batch))
+					rc = osd_scrub_oi_flush(info, dev,
+								batch);
+				break;
+			}
+
+			/* not past the objects whose mappings are batched */
+			WRITE_ONCE(part->osp_pos, batch->osb_count > 0 ?
+				   batch->osb_items[0].osi_id.oii_ino :
+				   pos + 1);
+			if (rc != 0)
+				GOTO(out, rc);
+		}
+
+next_group:
+		if (param->bitmap) {
+			brelse(param->bitmap);
+			param->bitmap = NULL;
+		}
+
+		rc = osd_scrub_oi_flush(info, dev, batch);
+		if (rc != 0)
+			GOTO(out, rc);
+
+		param->bg++;
+		param->offset = 0;
+		param->gbase = 1 + param->bg * ipg;
+		pos = param->gbase;
+		param->start = pos;
+		WRITE_ONCE(part->osp_pos, pos);
+	}
+
+	WRITE_ONCE(part->osp_done, true);
+	rc = 0;
+
+out:
+	if (param->bitmap) {
+		brelse(param->bitmap);
+		param->bitmap = NULL;
+	}
+	rc1 = osd_scrub_oi_flush(info, dev, batch);
+	if (rc == 0)
+		rc = rc1;
+	lu_env_fini(&env);
+
+noenv:
+	part->osp_rc = rc;
+	if (rc != 0)
+		WRITE_ONCE(oscrub->os_parts_abort, true);
+	if (atomic_dec_and_test(&oscrub->os_parts_running))
+		wake_up_all(&thread->t_ctl_waitq);
+	return rc;
+}
+
+/* Split the block groups into dev->od_scrub_threads partitions, each of
+ * them is scanned by its own thread. The current thread processes the
+ * inconsistent items found by others and takes the checkpoints. */
+static int osd_scrub_parallel(struct osd_thread_info *info,
+			      struct osd_device *dev)
+{
+	struct osd_scrub *oscrub = &dev->od_scrub;
+	struct lustre_scrub *scrub = &oscrub->os_scrub;
+	struct ptlrpc_thread *thread = &scrub->os_thread;
+	unsigned int nparts = dev->od_scrub_threads;
+	struct osd_scrub_part *parts;
+	struct task_struct *task;
+	bool crash = false;
+	bool all = true;
+	bool done;
+	unsigned int i;
+	int rc = 0;
+	int rc1;
+	ENTRY;
+
+	parts = osd_scrub_parts_init(dev, nparts);
+	if (parts == NULL)
+		RETURN(-ENOMEM);
+
+	/* hold one reference during the threads startup */
+	atomic_set(&oscrub->os_parts_running, 1);
+	spin_lock(&scrub->os_lock);
+	oscrub->os_parts = parts;
+	oscrub->os_nparts = nparts;
+	oscrub->os_parts_abort = false;
+	spin_unlock(&scrub->os_lock);
+
+	CDEBUG(D_LFSCK, "%s: OI scrub scans with %u threads, pos = %llu\n",
+	       osd_scrub2name(scrub), nparts, scrub->os_pos_current);
+
+	for (i = 0; i < nparts; i++) {
+		if (parts[i].osp_done)
+			continue;
+
+		atomic_inc(&oscrub->os_parts_running);
+		task = kthread_run(osd_scrub_part_main, &parts[i],
+				   "OI_scrub_%u", i);
+		if (IS_ERR(task)) {
+			rc = PTR_ERR(task);
+			CERROR("%s: cannot start OI scrub thread %u: rc = %d\n",
+			       osd_scrub2name(scrub), i, rc);
+			atomic_dec(&oscrub->os_parts_running);
+			WRITE_ONCE(oscrub->os_parts_abort, true);
+			break;
+		}
+	}
+	atomic_dec(&oscrub->os_parts_running);
+
+	do {
+		struct osd_otable_it *it;
+
+		wait_event_idle_timeout(thread->t_ctl_waitq,
+			atomic_read(&oscrub->os_parts_running) == 0 ||
+			(!list_empty(&scrub->os_inconsistent_items) &&
+			 thread_is_running(thread)),
+			cfs_time_seconds(1));
+		done = atomic_read(&oscrub->os_parts_running) == 0;
+
+		rc1 = osd_scrub_parts_prior(info, dev);
+		if (rc1 != 0) {
+			if (rc == 0)
+				rc = rc1;
+			WRITE_ONCE(oscrub->os_parts_abort, true);
+		}
+
+		osd_scrub_parts_sync(dev);
+		rc1 = scrub_checkpoint(info->oti_env, scrub);
+		if (rc1)
+			CDEBUG(D_LFSCK, "%s: fail to checkpoint, pos = %llu: "
+			       "rc = %d\n", osd_scrub2name(scrub),
+			       scrub->os_pos_current, rc1);
+
+		it = dev->od_otable_it;
+		if (it != NULL && it->ooi_waiting &&
+		    it->ooi_cache.ooc_pos_preload < scrub->os_pos_current) {
+			spin_lock(&scrub->os_lock);
+			it->ooi_waiting = 0;
+			wake_up_all(&thread->t_ctl_waitq);
+			spin_unlock(&scrub->os_lock);
+		}
+	} while (!done);
+
+	spin_lock(&scrub->os_lock);
+	oscrub->os_parts = NULL;
+	oscrub->os_nparts = 0;
+	spin_unlock(&scrub->os_lock);
+
+	for (i = 0; i < nparts; i++) {
+		if (parts[i].osp_rc == SCRUB_NEXT_CRASH)
+			crash = true;
+		else if (parts[i].osp_rc < 0 && rc == 0)
+			rc = parts[i].osp_rc;
+		if (!parts[i].osp_done)
+			all = false;
+	}
+	OBD_FREE_PTR_ARRAY(parts, nparts);
+
+	if (crash)
+		RETURN(SCRUB_IT_CRASH);
+
+	if (rc < 0)
+		RETURN(rc);
+
+	RETURN(all ? SCRUB_IT_ALL : 0);
+}
+
 static int osd_inode_iteration(struct osd_thread_info *info,
 			       struct osd_device *dev, __u32 max, bool preload)
 {
@@ -1132,6 +1759,9 @@ full:
 
 		if (unlikely(!thread_is_running(thread)))
 			RETURN(0);
+
+		if (scrub->os_full_speed && dev->od_scrub_threads > 1)
+			RETURN(osd_scrub_parallel(info, dev));
 	}
 
 	noslot = false;
@@ -1265,6 +1895,7 @@ static int osd_scrub_main(void *args)
 	struct lustre_scrub *scrub = &dev->od_scrub.os_scrub;
 	struct ptlrpc_thread *thread = &scrub->os_thread;
 	int rc;
+	int rc1;
 	ENTRY;
 
 	rc = lu_env_init(&env, LCT_LOCAL | LCT_DT_THREAD);
@@ -1299,6 +1930,10 @@ static int osd_scrub_main(void *args)
 	       scrub->os_pos_current);
 
 	rc = osd_inode_iteration(osd_oti_get(&env), dev, ~0U, false);
+	rc1 = osd_scrub_oi_flush(osd_oti_get(&env), dev,
+				 &dev->od_scrub.os_oi_batch);
+	if (rc1 != 0 && rc >= 0)
+		rc = rc1;
 	if (unlikely(rc == SCRUB_IT_CRASH)) {
 		spin_lock(&scrub->os_lock);
 		thread_set_flags(&scrub->os_thread, SVC_STOPPING);
@@ -1819,6 +2454,123 @@ fini:
 		       osd_name(osd), PFID(fid), keysize, recsize);
 }
 
+/**
+ * Bulk load a chunk of records read from the backup of an index into the
+ * re-created index \a dt, in one transaction.
+ *
+ * The backup is written by iterating the index, so records come in key
+ * order and each chunk is appended to the right edge of the new index by
+ * iam_bulk_load(), without lookup nor split.
+ *
+ * \retval -EOPNOTSUPP	nothing inserted, records are not in increasing order
+ *			or the index is not lfix, insert them one by one
+ */
+static int osd_index_restore_records(const struct lu_env *env,
+				     struct dt_device *dev,
+				     struct dt_object *dt, char *buf,
+				     int count, __u32 keysize, __u32 recsize)
+{
+	struct osd_object *obj = osd_dt_obj(dt);
+	struct iam_container *bag = &obj->oo_dir->od_container;
+	struct iam_path_descr *ipd;
+	struct iam_bulk *ib = NULL;
+	struct iam_key **keys = NULL;
+	struct iam_rec **recs = NULL;
+	struct osd_thandle *oh;
+	struct thandle *th;
+	__u32 pairsize = keysize + recsize;
+	bool quota;
+	int rc;
+	int i;
+	ENTRY;
+
+	if (S_ISDIR(obj->oo_inode->i_mode))
+		RETURN(-EOPNOTSUPP);
+
+	quota = fid_is_quota(lu_object_fid(&dt->do_lu));
+	for (i = 0; quota && i < count; i++) {
+		char *key = &buf[i * pairsize];
+
+		/* pack quota uid/gid and record as osd_index_iam_insert() */
+		*(__u64 *)key = cpu_to_le64(*(__u64 *)key);
+		osd_quota_unpack(obj, (struct dt_rec *)(key + keysize));
+	}
+
+	for (i = 1; i < count; i++) {
+		if (memcmp(&buf[(i - 1) * pairsize], &buf[i * pairsize],
+			   keysize) >= 0)
+			GOTO(unpack, rc = -EOPNOTSUPP);
+	}
+
+	OBD_ALLOC_PTR(ib);
+	OBD_ALLOC_LARGE(keys, count * sizeof(*keys));
+	OBD_ALLOC_LARGE(recs, count * sizeof(*recs));
+	if (!ib || !keys || !recs)
+		GOTO(unpack, rc = -ENOMEM);
+
+	for (i = 0; i < count; i++) {
+		keys[i] = (struct iam_key *)&buf[i * pairsize];
+		recs[i] = (struct iam_rec *)&buf[i * pairsize + keysize];
+	}
+
+	th = dt_trans_create(env, dev);
+	if (IS_ERR(th))
+		GOTO(unpack, rc = PTR_ERR(th));
+
+	oh = container_of(th, struct osd_thandle, ot_super);
+	osd_trans_declare_op(env, oh, OSD_OT_INSERT,
+			     iam_bulk_load_blocks(bag, count) *
+			     osd_dto_credits_noquota[DTO_WRITE_BLOCK]);
+	rc = dt_trans_start_local(env, dev, th);
+	if (rc)
+		GOTO(stop, rc);
+
+	osd_trans_exec_op(env, th, OSD_OT_INSERT);
+	ipd = osd_idx_ipd_get(env, bag);
+	if (unlikely(ipd == NULL))
+		GOTO(stop, rc = -ENOMEM);
+
+	/* The container lock is not held across transactions. */
+	rc = iam_bulk_load_start(bag, ib, ipd);
+	if (!rc) {
+		rc = iam_bulk_load(oh->ot_handle, ib, keys, recs, count);
+		iam_bulk_load_fini(ib);
+		/* Keys are increasing within the chunk, so only the first
+		 * one can fail the order check, before anything is added. */
+		if (rc == -EINVAL || rc == -EEXIST)
+			rc = -EOPNOTSUPP;
+	}
+	osd_ipd_put(env, bag, ipd);
+	osd_trans_exec_check(env, th, OSD_OT_INSERT);
+
+	GOTO(stop, rc);
+
+stop:
+	dt_trans_stop(env, dev, th);
+unpack:
+	/* dt_insert() packs the records itself */
+	if (rc == -EOPNOTSUPP && quota) {
+		for (i = 0; i < count; i++) {
+			char *key = &buf[i * pairsize];
+
+			*(__u64 *)key = le64_to_cpu(*(__u64 *)key);
+			osd_quota_unpack(obj,
+					 (struct dt_rec *)(key + keysize));
+		}
+	}
+	if (recs)
+		OBD_FREE_LARGE(recs, count * sizeof(*recs));
+	if (keys)
+		OBD_FREE_LARGE(keys, count * sizeof(*keys));
+	if (ib)
+		OBD_FREE_PTR(ib);
+	if (!rc)
+		CDEBUG(D_LFSCK, "%s: bulk loaded %d records into "DFID"\n",
+		       osd_name(osd_dt_dev(dev)),
+		       count, PFID(lu_object_fid(&dt->do_lu)));
+	RETURN(rc);
+}
+
 static void osd_index_restore(const struct lu_env *env, struct osd_device *dev,
 			      struct lustre_index_restore_unit *liru,
 			      void *buf, int bufsize)
@@ -1857,7 +2609,7 @@ static void osd_index_restore(const struct lu_env *env, struct osd_device *dev,
 	rc = lustre_index_restore(env, &dev->od_dt_dev, &liru->liru_pfid,
 				  tgt_fid, &bak_fid, liru->liru_name,
 				  &dev->od_index_backup_list, &dev->od_lock,
-				  buf, bufsize);
+				  buf, bufsize, osd_index_restore_records);
 	GOTO(log, rc);
 
 log:
@@ -3117,4 +3869,25 @@ void osd_scrub_dump(struct seq_file *m, struct osd_device *dev)
 			"inconsistent" : "repaired",
 		   scrub->os_lf_repaired,
 		   scrub->os_lf_failed);
+
+	spin_lock(&scrub->os_scrub.os_lock);
+	if (scrub->os_parts != NULL) {
+		struct osd_scrub_part *part;
+		unsigned int i;
+
+		seq_printf(m, "threads: %u\n", scrub->os_nparts);
+		for (i = 0; i < scrub->os_nparts; i++) {
+			part = &scrub->os_parts[i];
+			seq_printf(m, "thread_%u: { groups: [%u, %u), "
+				   "position: %llu, checked: %llu, "
+				   "status: %s }\n", part->osp_index,
+				   (__u32)part->osp_bg_start,
+				   (__u32)part->osp_bg_end,
+				   READ_ONCE(part->osp_pos),
+				   part->osp_checked,
+				   part->osp_done ? "completed" :
+				   part->osp_rc != 0 ? "failed" : "scanning");
+		}
+	}
+	spin_unlock(&scrub->os_scrub.os_lock);
 }
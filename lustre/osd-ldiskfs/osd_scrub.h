@@ -51,11 +51,58 @@ struct osd_iit_param {
 	__u32 start;
 };
 
+/* Max number of missing OI mappings inserted in one transaction. */
+#define OSD_SCRUB_OI_BATCH	32
+
+/* A missing OI mapping found by the OI scrub scanning. */
+struct osd_scrub_oi_item {
+	struct lu_fid		 osi_fid;
+	struct osd_inode_id	 osi_id;
+	/* the OI key and record, in disk byte order */
+	struct lu_fid		 osi_key;
+	struct osd_inode_id	 osi_rec;
+	/* referenced until the mapping is inserted */
+	struct inode		*osi_inode;
+	/* index of the OI file */
+	int			 osi_idx;
+	int			 osi_rc;
+	/* the OI file has been re-created */
+	bool			 osi_recreated;
+	bool			 osi_exist;
+};
+
+/* The missing OI mappings found by one scanning thread, they are inserted
+ * together, sorted by key, see osd_scrub_oi_flush(). */
+struct osd_scrub_oi_batch {
+	int			 osb_count;
+	struct osd_scrub_oi_item osb_items[OSD_SCRUB_OI_BATCH];
+	struct iam_key		*osb_keys[OSD_SCRUB_OI_BATCH];
+	struct iam_rec		*osb_recs[OSD_SCRUB_OI_BATCH];
+};
+
+/* The block groups [osp_bg_start, osp_bg_end) scanned by one thread
+ * of the parallel OI scrub. */
+struct osd_scrub_part {
+	struct osd_device	*osp_dev;
+	struct osd_iit_param	 osp_param;
+	struct osd_idmap_cache	 osp_oic;
+	ldiskfs_group_t		 osp_bg_start;
+	ldiskfs_group_t		 osp_bg_end;
+	/* All the inodes before it in the partition have been scanned. */
+	__u64			 osp_pos;
+	__u64			 osp_checked;
+	struct osd_scrub_oi_batch osp_oi_batch;
+	int			 osp_rc;
+	unsigned int		 osp_index;
+	bool			 osp_done;
+};
+
 struct osd_scrub {
 	struct lustre_scrub	os_scrub;
 	struct lvfs_run_ctxt    os_ctxt;
 	struct osd_idmap_cache  os_oic;
 	struct osd_iit_param	os_iit_param;
+	struct osd_scrub_oi_batch os_oi_batch;
 
 	/* statistics for /lost+found are in ram only, it will be reset
 	 * when each time the device remount. */
@@ -69,6 +116,18 @@ struct osd_scrub {
 
 	__u64			os_bad_oimap_count;
 	time64_t		os_bad_oimap_time;
+
+	/* The partitions of the parallel scanning, protected by
+	 * os_scrub.os_lock, NULL if the scanning is not parallel. */
+	struct osd_scrub_part	*os_parts;
+	unsigned int		os_nparts;
+	atomic_t		os_parts_running;
+	bool			os_parts_abort;
+
+	/* Objects scanned in the current second, for the rate limit
+	 * shared by all the scanning threads. */
+	unsigned long		os_rate_start;
+	__u32			os_rate_count;
 };
 
 #endif /* _OSD_SCRUB_H */
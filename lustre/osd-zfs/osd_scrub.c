@@ -991,7 +991,7 @@ static void osd_index_restore(const struct lu_env *env, struct osd_device *dev,
 		rc = lustre_index_restore(env, &dev->od_dt_dev,
 				&liru->liru_pfid, tgt_fid, &bak_fid,
 				liru->liru_name, &dev->od_index_backup_list,
-				&dev->od_lock, buf, bufsize);
+				&dev->od_lock, buf, bufsize, NULL);
 	GOTO(log, rc);
 
 log:
@@ -751,6 +751,79 @@ static ssize_t lfsck_max_rpcs_in_flight_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(lfsck_max_rpcs_in_flight);
 
+/**
+ * Show the maximum number of transactions sent in one OUT RPC to the
+ * remote MDT
+ */
+static ssize_t max_update_batch_show(struct kobject *kobj,
+				     struct attribute *attr, char *buf)
+{
+	struct dt_device *dt = container_of(kobj, struct dt_device,
+					    dd_kobj);
+	struct osp_device *osp = dt2osp_dev(dt);
+
+	if (!osp->opd_update)
+		return -ENODEV;
+
+	return sprintf(buf, "%u\n", osp->opd_update->ou_batch_max);
+}
+
+/**
+ * Change the maximum number of transactions sent in one OUT RPC to the
+ * remote MDT, 1 sends every transaction in its own RPC
+ */
+static ssize_t max_update_batch_store(struct kobject *kobj,
+				      struct attribute *attr,
+				      const char *buffer, size_t count)
+{
+	struct dt_device *dt = container_of(kobj, struct dt_device,
+					    dd_kobj);
+	struct osp_device *osp = dt2osp_dev(dt);
+	unsigned int val;
+	int rc;
+
+	if (!osp->opd_update)
+		return -ENODEV;
+
+	rc = kstrtouint(buffer, 0, &val);
+	if (rc)
+		return rc;
+
+	if (val < 1 || val > OSP_UPDATE_BATCH_MAX)
+		return -ERANGE;
+
+	osp->opd_update->ou_batch_max = val;
+
+	return count;
+}
+LUSTRE_RW_ATTR(max_update_batch);
+
+/**
+ * Show the number of OUT RPCs sent by the update thread, and of the
+ * transactions they carried
+ */
+static ssize_t update_batch_stats_show(struct kobject *kobj,
+				       struct attribute *attr, char *buf)
+{
+	struct dt_device *dt = container_of(kobj, struct dt_device,
+					    dd_kobj);
+	struct osp_device *osp = dt2osp_dev(dt);
+	struct osp_updates *ou = osp->opd_update;
+	__u64 rpcs;
+	__u64 trans;
+
+	if (!ou)
+		return -ENODEV;
+
+	spin_lock(&ou->ou_lock);
+	rpcs = ou->ou_batch_rpcs;
+	trans = ou->ou_batch_trans;
+	spin_unlock(&ou->ou_lock);
+
+	return sprintf(buf, "rpcs: %llu\ntransactions: %llu\n", rpcs, trans);
+}
+LUSTRE_RO_ATTR(update_batch_stats);
+
 ssize_t ping_show(struct kobject *kobj, struct attribute *attr,
 		  char *buffer)
 {
@@ -1024,6 +1097,8 @@ static struct attribute *osp_md_attrs[] = {
 	&lustre_attr_mdt_conn_uuid.attr,
 	&lustre_attr_ping.attr,
 	&lustre_attr_prealloc_status.attr,
+	&lustre_attr_max_update_batch.attr,
+	&lustre_attr_update_batch_stats.attr,
 	NULL,
 };
 
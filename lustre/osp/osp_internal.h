@@ -117,11 +117,19 @@ struct osp_update_request {
 	spinlock_t			our_list_lock;
 	/* linked to the list(ou_list) in osp_updates */
 	struct list_head		our_list;
+	/* requests of later transactions sent in the same OUT RPC as this
+	 * one, or link into the batch list of the first request */
+	struct list_head		our_batch_list;
 	__u32				our_batchid;
 	__u32				our_req_ready:1;
 
 };
 
+/* default and maximum number of transactions packed into one OUT RPC by
+ * osp_send_update_thread() */
+#define OSP_UPDATE_BATCH_DEFAULT	8
+#define OSP_UPDATE_BATCH_MAX		64
+
 struct osp_updates {
 	struct list_head	ou_list;
 	spinlock_t		ou_lock;
@@ -143,6 +151,12 @@ struct osp_updates {
 	 * will cause update lllog corruption */
 	__u64			ou_generation;
 
+	/* maximum number of ready transactions sent in one OUT RPC */
+	unsigned int		ou_batch_max;
+	/* OUT RPCs sent by the update thread, and transactions in them */
+	__u64			ou_batch_rpcs;
+	__u64			ou_batch_trans;
+
 	/* dedicate update thread */
 	struct task_struct	*ou_update_task;
 	struct lu_env		ou_env;
@@ -190,6 +190,7 @@ struct osp_update_request *osp_update_request_create(struct dt_device *dt)
 	INIT_LIST_HEAD(&our->our_cb_items);
 	INIT_LIST_HEAD(&our->our_list);
 	INIT_LIST_HEAD(&our->our_invalidate_cb_list);
+	INIT_LIST_HEAD(&our->our_batch_list);
 	spin_lock_init(&our->our_list_lock);
 
 	rc = osp_object_update_request_create(our, PAGE_SIZE);
@@ -209,6 +210,7 @@ void osp_update_request_destroy(const struct lu_env *env,
 	if (our == NULL)
 		return;
 
+	LASSERT(list_empty(&our->our_batch_list));
 	list_for_each_entry_safe(ours, tmp, &our->our_req_list, ours_list) {
 		list_del(&ours->ours_list);
 		if (ours->ours_req != NULL)
@@ -590,6 +592,117 @@ static void osp_update_callback_fini(const struct lu_env *env,
 	OBD_FREE_PTR(ouc);
 }
 
+/**
+ * Get the result of one transaction in a batched OUT RPC.
+ *
+ * The updates of the transaction are at [\a base, \a base + \a nr) in the
+ * reply. The transaction failed if one of them failed, or if the peer did
+ * not handle all of them, because it stops at the first failed transaction.
+ *
+ * \param[in] reply	update reply, NULL if there is no reply
+ * \param[in] count	number of updates handled by the peer
+ * \param[in] base	index of the first update of the transaction
+ * \param[in] nr	number of updates of the transaction
+ * \param[in] rc	the RPC return value
+ *
+ * \retval		0 if all the updates succeeded
+ * \retval		negative errno of the transaction
+ */
+static int osp_update_batch_result(struct object_update_reply *reply,
+				   int count, int base, int nr, int rc)
+{
+	struct object_update_result *result;
+	int i;
+
+	for (i = base; i < base + nr; i++) {
+		if (i >= count || reply->ourp_lens[i] == 0)
+			return rc < 0 ? rc : -EINVAL;
+
+		result = object_update_result_get(reply, i, NULL);
+		if (result == NULL)
+			return -EPROTO;
+		if (result->our_rc < 0)
+			return result->our_rc;
+	}
+
+	return 0;
+}
+
+/**
+ * Call the interpreters of one request of a batched OUT RPC.
+ *
+ * \param[in] env	pointer to the thread context
+ * \param[in] req	pointer to the RPC
+ * \param[in] reply	update reply, NULL if there is no reply
+ * \param[in] count	number of updates handled by the peer
+ * \param[in] our	the request whose updates start at \a base
+ * \param[in] base	index of the first update of \a our in the reply
+ * \param[in] rc	the RPC return value
+ */
+static void osp_update_batch_interpret_one(const struct lu_env *env,
+					   struct ptlrpc_request *req,
+					   struct object_update_reply *reply,
+					   int count,
+					   struct osp_update_request *our,
+					   int base, int rc)
+{
+	struct osp_update_callback *ouc;
+	struct osp_update_callback *next;
+	int index = base;
+
+	our->our_rc = osp_update_batch_result(reply, count, base,
+					      our->our_update_nr, rc);
+	list_for_each_entry_safe(ouc, next, &our->our_cb_items, ouc_list) {
+		list_del_init(&ouc->ouc_list);
+		if (ouc->ouc_interpreter != NULL)
+			ouc->ouc_interpreter(env, reply, req, ouc->ouc_obj,
+					     ouc->ouc_data, index,
+					     our->our_rc);
+		osp_update_callback_fini(env, ouc);
+		index++;
+	}
+}
+
+/**
+ * Interpret the results of a batched OUT RPC.
+ *
+ * The RPC carries the updates of \a our followed by those of the requests
+ * in its batch list, each one executed in its own transaction by the peer.
+ * Call the interpreters of every request with the result of its own
+ * transaction, so that one failed transaction does not fail the ones which
+ * were executed before it, and run the stop callbacks of the batched
+ * transactions. The stop callbacks of \a our are left to the caller.
+ *
+ * \param[in] env	pointer to the thread context
+ * \param[in] req	pointer to the RPC
+ * \param[in] reply	update reply, NULL if there is no reply
+ * \param[in] count	number of updates handled by the peer
+ * \param[in] our	the first request of the batch
+ * \param[in] rc	the RPC return value
+ *
+ * \retval		result of the transaction of \a our
+ */
+static int osp_update_batch_interpret(const struct lu_env *env,
+				      struct ptlrpc_request *req,
+				      struct object_update_reply *reply,
+				      int count,
+				      struct osp_update_request *our, int rc)
+{
+	struct osp_update_request *sub;
+	int base;
+
+	osp_update_batch_interpret_one(env, req, reply, count, our, 0, rc);
+	base = our->our_update_nr;
+	list_for_each_entry(sub, &our->our_batch_list, our_batch_list) {
+		osp_update_batch_interpret_one(env, req, reply, count, sub,
+					       base, rc);
+		osp_trans_stop_cb(env, sub->our_th, sub->our_rc);
+		base += sub->our_update_nr;
+	}
+
+	return our->our_rc;
+}
+
 /**
  * Interpret the packaged OUT RPC results.
  *
@@ -656,6 +769,10 @@ static int osp_update_interpret(const struct lu_env *env,
 		}
 	}
 
+	if (!list_empty(&our->our_batch_list))
+		rc = osp_update_batch_interpret(env, req, reply, count, our,
+						rc);
+
 	list_for_each_entry_safe(ouc, next, &our->our_cb_items, ouc_list) {
 		list_del_init(&ouc->ouc_list);
 
@@ -1018,12 +1135,27 @@ static void osp_trans_commit_cb(struct osp_thandle *oth, int result)
 	}
 }
 
+static void osp_request_commit_one(struct ptlrpc_request *req,
+				   struct osp_thandle *oth, int result,
+				   __u64 last_committed_transno)
+{
+	/* If the transaction is not really committed, mark result = 1 */
+	if (req->rq_transno != 0 &&
+	    (req->rq_transno > last_committed_transno) && result == 0)
+		result = 1;
+
+	osp_trans_commit_cb(oth, result);
+	osp_thandle_put(NULL, oth);
+}
+
 static void osp_request_commit_cb(struct ptlrpc_request *req)
 {
 	struct thandle		*th = req->rq_cb_data;
 	struct osp_thandle	*oth;
+	struct osp_update_request *our;
+	struct osp_update_request *next;
 	__u64			last_committed_transno = 0;
-	int			result = req->rq_status;
+	int			result;
 	ENTRY;
 
 	if (th == NULL)
@@ -1043,14 +1175,21 @@ static void osp_request_commit_cb(struct ptlrpc_request *req)
 	CDEBUG(D_HA, "trans no %llu committed transno %llu\n",
 	       req->rq_transno, last_committed_transno);
 
-	/* If the transaction is not really committed, mark result = 1 */
-	if (req->rq_transno != 0 &&
-	    (req->rq_transno > last_committed_transno) && result == 0)
-		result = 1;
+	/* each transaction batched in the same RPC has its own result, see
+	 * osp_update_batch_interpret(), and they are committed together.
+	 * Drop the references held by the batch list, see
+	 * osp_update_batch_collect() */
+	result = list_empty(&oth->ot_our->our_batch_list) ?
+		 req->rq_status : oth->ot_our->our_rc;
+	list_for_each_entry_safe(our, next, &oth->ot_our->our_batch_list,
+				 our_batch_list) {
+		list_del_init(&our->our_batch_list);
+		osp_request_commit_one(req, our->our_th, our->our_rc,
+				       last_committed_transno);
+	}
 
-	osp_trans_commit_cb(oth, result);
+	osp_request_commit_one(req, oth, result, last_committed_transno);
 	req->rq_committed = 1;
-	osp_thandle_put(NULL, oth);
 	EXIT;
 }
 
@@ -1087,6 +1226,31 @@ void osp_trans_callback(const struct lu_env *env,
 	osp_trans_commit_cb(oth, rc);
 }
 
+/**
+ * Fail the transactions batched behind an update request
+ *
+ * Call the callbacks of the transactions in the batch list of \a our with
+ * \a rc, and drop the references held by the batch list. This is called
+ * when the batched OUT RPC could not be sent, or was not executed.
+ *
+ * \param [in] env	execution environment
+ * \param [in] our	the first request of the batch
+ * \param [in] rc	result of the transactions
+ */
+static void osp_update_batch_fini(const struct lu_env *env,
+				  struct osp_update_request *our, int rc)
+{
+	struct osp_update_request *sub;
+	struct osp_update_request *next;
+
+	list_for_each_entry_safe(sub, next, &our->our_batch_list,
+				 our_batch_list) {
+		list_del_init(&sub->our_batch_list);
+		osp_trans_callback(env, sub->our_th, rc);
+		osp_thandle_put(env, sub->our_th);
+	}
+}
+
 /**
  * Send the request for remote updates.
  *
@@ -1117,6 +1281,7 @@ static int osp_send_update_req(const struct lu_env *env,
 	rc = osp_prep_update_req(env, osp->opd_obd->u.cli.cl_import,
 				 our, &req);
 	if (rc != 0) {
+		osp_update_batch_fini(env, our, rc);
 		osp_trans_callback(env, oth, rc);
 		RETURN(rc);
 	}
@@ -1129,6 +1294,8 @@ static int osp_send_update_req(const struct lu_env *env,
 	osp_thandle_get(oth); /* hold for update interpret */
 	req->rq_interpret_reply = osp_update_interpret;
 	if (!oth->ot_super.th_wait_submit && !oth->ot_super.th_sync) {
+		/* only the ordered requests are batched */
+		LASSERT(list_empty(&our->our_batch_list));
 		if (!osp->opd_imp_active || !osp->opd_imp_connected) {
 			osp_trans_callback(env, oth, rc);
 			osp_thandle_put(env, oth);
@@ -1190,6 +1357,7 @@ static int osp_send_update_req(const struct lu_env *env,
 
 			req->rq_cb_data = NULL;
 			rc = rc == 0 ? req->rq_status : rc;
+			osp_update_batch_fini(env, our, rc);
 			osp_trans_callback(env, oth, rc);
 			osp_thandle_put(env, oth);
 			GOTO(out, rc);
@@ -1343,6 +1511,134 @@ osp_get_next_request(struct osp_updates *ou, struct osp_update_request **ourp)
 	return got_req;
 }
 
+/**
+ * Get the size of the update buffers of an update request
+ *
+ * \param [in] our	osp update request
+ *
+ * \retval		total size of the object update requests of \a our
+ */
+static size_t osp_update_request_size(struct osp_update_request *our)
+{
+	struct osp_update_request_sub *ours;
+	size_t size = 0;
+
+	list_for_each_entry(ours, &our->our_req_list, ours_list)
+		size += ours->ours_req_size;
+
+	return size;
+}
+
+/**
+ * Set the batch ID of all the updates in an update request
+ *
+ * The OUT handler executes the updates with the same batch ID in one
+ * transaction, see out_handle(), so the requests packed into the same
+ * RPC need different batch IDs.
+ *
+ * \param [in] our	osp update request
+ * \param [in] batchid	batch ID of the updates
+ */
+static void osp_update_request_set_batchid(struct osp_update_request *our,
+					   __u32 batchid)
+{
+	struct osp_update_request_sub *ours;
+	struct object_update *update;
+	unsigned int i;
+
+	list_for_each_entry(ours, &our->our_req_list, ours_list) {
+		for (i = 0; i < ours->ours_req->ourq_count; i++) {
+			update = object_update_request_get(ours->ours_req, i,
+							   NULL);
+			LASSERT(update != NULL);
+			update->ou_batchid = batchid;
+		}
+	}
+	our->our_batchid = batchid;
+}
+
+/**
+ * Batch the following ready update requests behind the next one
+ *
+ * While the update thread waits for the reply of one OUT RPC, the other
+ * transactions to the same MDT become ready in the sending list. Instead
+ * of sending them one RPC and one round trip each, move those which
+ * directly follow \a our in the version order to its batch list, up to
+ * ou_batch_max requests and OUT_MAXREQSIZE bytes of updates, so that
+ * they are packed into the same RPC. The update buffers are moved to
+ * \a our, and each request keeps its own batch ID, so the peer executes
+ * every transaction separately, in the version order.
+ *
+ * The reference on the thandle held by the sending list is moved to the
+ * batch list, and it is dropped once the batched RPC is committed, see
+ * osp_request_commit_cb(), or has failed, see osp_update_batch_fini().
+ *
+ * Nothing is batched unless the peer can tell which transactions of a
+ * resent RPC were executed, see out_check_resent().
+ *
+ * \param [in] osp	OSP device
+ * \param [in] our	the next update request to be sent
+ *
+ * \retval		version of the last request of the batch
+ */
+static __u64 osp_update_batch_collect(struct osp_device *osp,
+				      struct osp_update_request *our)
+{
+	struct osp_updates *ou = osp->opd_update;
+	struct osp_update_request *sub;
+	struct osp_update_request *tmp;
+	size_t size = osp_update_request_size(our);
+	__u64 version = our->our_version;
+	unsigned int count = 1;
+	unsigned int max = ou->ou_batch_max;
+	__u32 batchid = 0;
+
+	if (osp->opd_exp == NULL ||
+	    !(exp_connect_flags2(osp->opd_exp) & OBD_CONNECT2_OUT_BATCH))
+		max = 1;
+
+	spin_lock(&ou->ou_lock);
+	list_for_each_entry_safe(sub, tmp, &ou->ou_list, our_list) {
+		if (count >= max)
+			break;
+
+		spin_lock(&sub->our_list_lock);
+		if (sub->our_version != version + 1 || !sub->our_req_ready ||
+		    sub->our_generation != ou->ou_generation ||
+		    sub->our_th->ot_super.th_result != 0 ||
+		    size + osp_update_request_size(sub) > OUT_MAXREQSIZE) {
+			spin_unlock(&sub->our_list_lock);
+			break;
+		}
+		list_del_init(&sub->our_list);
+		list_add_tail(&sub->our_batch_list, &our->our_batch_list);
+		spin_unlock(&sub->our_list_lock);
+
+		size += osp_update_request_size(sub);
+		version = sub->our_version;
+		count++;
+	}
+	ou->ou_batch_rpcs++;
+	ou->ou_batch_trans += count;
+	spin_unlock(&ou->ou_lock);
+
+	if (count == 1)
+		return version;
+
+	osp_update_request_set_batchid(our, batchid);
+	list_for_each_entry(sub, &our->our_batch_list, our_batch_list) {
+		osp_update_request_set_batchid(sub, ++batchid);
+		list_splice_tail_init(&sub->our_req_list, &our->our_req_list);
+		our->our_req_nr += sub->our_req_nr;
+		sub->our_req_nr = 0;
+	}
+
+	CDEBUG(D_HA, "%s: batch %u requests version %llu-%llu size %zu\n",
+	       osp->opd_obd->obd_name, count, our->our_version, version, size);
+
+	return version;
+}
+
 /**
  * Invalidate update request
  *
@@ -1422,6 +1718,8 @@ void osp_invalidate_request(struct osp_device *osp)
  * Create thread to send update request to other MDTs, this thread will pull
  * out update request from the list in OSP by version number, i.e. it will
  * make sure the update request with lower version number will be sent first.
+ * The ready requests which follow it are sent in the same RPC, see
+ * osp_update_batch_collect().
  *
  * \param[in] arg	hold the OSP device.
  *
@@ -1435,6 +1733,7 @@ int osp_send_update_thread(void *arg)
 	struct osp_device	*osp = arg;
 	struct osp_updates	*ou = osp->opd_update;
 	struct osp_update_request *our = NULL;
+	__u64			last;
 	int			rc;
 	ENTRY;
 
@@ -1456,6 +1755,7 @@ int osp_send_update_thread(void *arg)
 		}
 
 		LASSERT(our->our_th != NULL);
+		last = our->our_version;
 		if (our->our_th->ot_super.th_result != 0) {
 			osp_trans_callback(env, our->our_th,
 				our->our_th->ot_super.th_result);
@@ -1465,13 +1765,16 @@ int osp_send_update_thread(void *arg)
 			rc = -EIO;
 			osp_trans_callback(env, our->our_th, rc);
 		} else {
+			/* the batched requests might be released once the
+			 * RPC is committed, get the last version first */
+			last = osp_update_batch_collect(osp, our);
 			rc = osp_send_update_req(env, osp, our);
 		}
 
 		/* Update the rpc version */
 		spin_lock(&ou->ou_lock);
 		if (our->our_version == ou->ou_rpc_version)
-			ou->ou_rpc_version++;
+			ou->ou_rpc_version = last + 1;
 		spin_unlock(&ou->ou_lock);
 
 		/* If one update request fails, let's fail all of the requests
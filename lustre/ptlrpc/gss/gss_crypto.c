@@ -48,6 +48,7 @@
 
 #define DEBUG_SUBSYSTEM S_SEC
 
+#include <linux/workqueue.h>
 #include <obd.h>
 #include <obd_support.h>
 
@@ -463,3 +464,115 @@ int gss_crypt_rawobjs(struct crypto_blkcipher *tfm, __u8 *iv,
 	outobj->len = datalen;
 	RETURN(0);
 }
+
+/* pages per bulk worker at least, 0 to handle bulk pages serially */
+unsigned int gss_bulk_parallel_pages = GSS_BULK_PARALLEL_PAGES;
+static struct workqueue_struct *gss_bulk_wq;
+
+struct gss_bulk_range {
+	struct work_struct	 gbr_work;
+	gss_bulk_range_fn	 gbr_fn;
+	void			*gbr_arg;
+	int			 gbr_start;
+	int			 gbr_end;
+	int			 gbr_rc;
+	atomic_t		*gbr_pending;
+	struct completion	*gbr_done;
+};
+
+static void gss_bulk_range_work(struct work_struct *work)
+{
+	struct gss_bulk_range *range = container_of(work, struct gss_bulk_range,
+						    gbr_work);
+
+	range->gbr_rc = range->gbr_fn(range->gbr_arg, range->gbr_start,
+				      range->gbr_end);
+	if (atomic_dec_and_test(range->gbr_pending))
+		complete(range->gbr_done);
+}
+
+/**
+ * Call \a fn on the pages [0, \a npages) of a bulk descriptor.
+ *
+ * The pages are split into contiguous ranges of at least
+ * gss_bulk_parallel_pages pages, at most one per online CPU. All the ranges
+ * but the first one are queued to the bulk workqueue, the caller handles the
+ * first range itself and then waits for the other ones to complete. \a fn
+ * must thus not depend on the order in which the ranges are handled.
+ *
+ * The ranges are handled by the caller alone if the bulk is too small to be
+ * split, or if the ranges cannot be allocated.
+ *
+ * \param[in] npages	number of bulk pages
+ * \param[in] fn	function handling a range of pages
+ * \param[in] arg	argument passed to \a fn
+ *
+ * \retval 0		on success
+ * \retval negative	first error returned by \a fn
+ */
+int gss_bulk_parallel(int npages, gss_bulk_range_fn fn, void *arg)
+{
+	DECLARE_COMPLETION_ONSTACK(done);
+	struct gss_bulk_range *ranges;
+	unsigned int per_range = READ_ONCE(gss_bulk_parallel_pages);
+	atomic_t pending;
+	int nranges;
+	int rc;
+	int i;
+
+	if (per_range == 0 || npages < 2 * per_range)
+		return fn(arg, 0, npages);
+
+	nranges = min_t(int, npages / per_range, num_online_cpus());
+	nranges = min(nranges, GSS_BULK_MAX_RANGES);
+	if (nranges < 2)
+		return fn(arg, 0, npages);
+
+	OBD_ALLOC_PTR_ARRAY(ranges, nranges);
+	if (ranges == NULL)
+		return fn(arg, 0, npages);
+
+	atomic_set(&pending, nranges - 1);
+	for (i = 0; i < nranges; i++) {
+		ranges[i].gbr_fn = fn;
+		ranges[i].gbr_arg = arg;
+		ranges[i].gbr_start = npages * i / nranges;
+		ranges[i].gbr_end = npages * (i + 1) / nranges;
+		ranges[i].gbr_rc = 0;
+		ranges[i].gbr_pending = &pending;
+		ranges[i].gbr_done = &done;
+	}
+
+	for (i = 1; i < nranges; i++) {
+		INIT_WORK(&ranges[i].gbr_work, gss_bulk_range_work);
+		queue_work(gss_bulk_wq, &ranges[i].gbr_work);
+	}
+
+	rc = fn(arg, ranges[0].gbr_start, ranges[0].gbr_end);
+	wait_for_completion(&done);
+
+	for (i = 1; i < nranges && rc == 0; i++)
+		rc = ranges[i].gbr_rc;
+
+	OBD_FREE_PTR_ARRAY(ranges, nranges);
+	return rc;
+}
+
+int __init gss_init_bulk_crypt(void)
+{
+	/* bulk pages might be encrypted on the writeback path */
+	gss_bulk_wq = alloc_workqueue("gss_bulk", WQ_UNBOUND | WQ_MEM_RECLAIM,
+				      0);
+	if (gss_bulk_wq == NULL)
+		return -ENOMEM;
+
+	return 0;
+}
+
+void gss_exit_bulk_crypt(void)
+{
+	if (gss_bulk_wq != NULL) {
+		destroy_workqueue(gss_bulk_wq);
+		gss_bulk_wq = NULL;
+	}
+}
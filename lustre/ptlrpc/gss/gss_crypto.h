@@ -5,6 +5,14 @@
 
 #include "gss_internal.h"
 
+/* minimum number of bulk pages handled by one worker, see gss_bulk_parallel */
+#define GSS_BULK_PARALLEL_PAGES	64
+/* maximum number of workers for a single bulk */
+#define GSS_BULK_MAX_RANGES	16
+
+/* handle the bulk pages [start, end), see gss_bulk_parallel() */
+typedef int (*gss_bulk_range_fn)(void *arg, int start, int end);
+
 struct gss_keyblock {
 	rawobj_t		 kb_key;
 	struct crypto_blkcipher *kb_tfm;
@@ -33,5 +41,6 @@ int gss_add_padding(rawobj_t *msg, int msg_buflen, int blocksize);
 int gss_crypt_rawobjs(struct crypto_blkcipher *tfm, __u8 *iv,
 		      int inobj_cnt, rawobj_t *inobjs, rawobj_t *outobj,
 		      int enc);
+int gss_bulk_parallel(int npages, gss_bulk_range_fn fn, void *arg);
 
 #endif /* PTLRPC_GSS_CRYPTO_H */
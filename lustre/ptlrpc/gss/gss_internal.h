@@ -482,6 +482,12 @@ int gss_svc_unwrap_bulk(struct ptlrpc_request *req,
 int gss_svc_wrap_bulk(struct ptlrpc_request *req,
                       struct ptlrpc_bulk_desc *desc);
 
+/* gss_crypto.c */
+extern unsigned int gss_bulk_parallel_pages;
+
+int  __init gss_init_bulk_crypt(void);
+void gss_exit_bulk_crypt(void);
+
 /* gss_generic_token.c */
 int g_token_size(rawobj_t *mech, unsigned int body_size);
 void g_make_token_header(rawobj_t *mech, int body_size, unsigned char **buf);
@@ -714,7 +714,8 @@ int krb5_encrypt_bulk(struct crypto_blkcipher *tfm,
                 return rc;
         }
 
-        /* encrypt clear pages */
+	/* encrypt clear pages, serially as each CBC block depends on the
+	 * previous cipher block */
         for (i = 0; i < desc->bd_iov_count; i++) {
 		sg_init_table(&src, 1);
 		sg_set_page(&src, desc->bd_vec[i].bv_page,
@@ -768,6 +769,86 @@ int krb5_encrypt_bulk(struct crypto_blkcipher *tfm,
         return 0;
 }
 
+/* state shared by the page ranges of a bulk being decrypted */
+struct krb5_bulk_crypt {
+	struct crypto_blkcipher	*kbc_tfm;
+	struct ptlrpc_bulk_desc	*kbc_desc;
+	rawobj_t		*kbc_cipher;
+	int			 kbc_blocksize;
+};
+
+/*
+ * With CBC the IV of page \a start is the last cipher block before it, which
+ * is the one of the previous non-empty page, or the encrypted confounder.
+ */
+static void krb5_bulk_range_iv(struct krb5_bulk_crypt *kbc, int start,
+			       __u8 *iv)
+{
+	struct bio_vec *ciov;
+	int i;
+
+	for (i = start - 1; i >= 0; i--) {
+		ciov = &kbc->kbc_desc->bd_enc_vec[i];
+		if (ciov->bv_len == 0)
+			continue;
+
+		memcpy(iv, page_address(ciov->bv_page) + ciov->bv_offset +
+		       ciov->bv_len - kbc->kbc_blocksize, kbc->kbc_blocksize);
+		return;
+	}
+
+	memcpy(iv, kbc->kbc_cipher->data, kbc->kbc_blocksize);
+}
+
+static int krb5_decrypt_bulk_range(void *arg, int start, int end)
+{
+	struct krb5_bulk_crypt *kbc = arg;
+	struct ptlrpc_bulk_desc *desc = kbc->kbc_desc;
+	struct blkcipher_desc ciph_desc;
+	__u8 local_iv[16] = {0};
+	struct scatterlist src, dst;
+	int blocksize = kbc->kbc_blocksize;
+	int i, rc;
+
+	ciph_desc.tfm = kbc->kbc_tfm;
+	ciph_desc.info = local_iv;
+	ciph_desc.flags = 0;
+
+	krb5_bulk_range_iv(kbc, start, local_iv);
+
+	for (i = start; i < end; i++) {
+		if (desc->bd_enc_vec[i].bv_len == 0)
+			continue;
+
+		sg_init_table(&src, 1);
+		sg_set_page(&src, desc->bd_enc_vec[i].bv_page,
+			    desc->bd_enc_vec[i].bv_len,
+			    desc->bd_enc_vec[i].bv_offset);
+		dst = src;
+		if (desc->bd_vec[i].bv_len % blocksize == 0)
+			sg_assign_page(&dst,
+				       desc->bd_vec[i].bv_page);
+
+		rc = crypto_blkcipher_decrypt_iv(&ciph_desc, &dst, &src,
+						 src.length);
+		if (rc) {
+			CERROR("error to decrypt page: %d\n", rc);
+			return rc;
+		}
+
+		if (desc->bd_vec[i].bv_len % blocksize != 0) {
+			memcpy(page_address(desc->bd_vec[i].bv_page) +
+			       desc->bd_vec[i].bv_offset,
+			       page_address(desc->bd_enc_vec[i].
+					    bv_page) +
+			       desc->bd_vec[i].bv_offset,
+			       desc->bd_vec[i].bv_len);
+		}
+	}
+
+	return 0;
+}
+
 /*
  * desc->bd_nob_transferred is the size of cipher text received.
  * desc->bd_nob is the target size of plain text supposed to be.
@@ -794,12 +875,15 @@ int krb5_decrypt_bulk(struct crypto_blkcipher *tfm,
                       rawobj_t *plain,
                       int adj_nob)
 {
+	struct krb5_bulk_crypt	kbc;
         struct blkcipher_desc   ciph_desc;
         __u8                    local_iv[16] = {0};
         struct scatterlist      src, dst;
 	struct sg_table		sg_src, sg_dst;
         int                     ct_nob = 0, pt_nob = 0;
         int                     blocksize, i, rc;
+	int			npages, last = -1, odd = -1;
+	bool			parallel = true;
 
         LASSERT(desc->bd_iov_count);
 	LASSERT(desc->bd_enc_vec);
@@ -877,34 +961,19 @@ int krb5_decrypt_bulk(struct crypto_blkcipher *tfm,
 		if (desc->bd_enc_vec[i].bv_len == 0)
 			continue;
 
-		sg_init_table(&src, 1);
-		sg_set_page(&src, desc->bd_enc_vec[i].bv_page,
-			    desc->bd_enc_vec[i].bv_len,
-			    desc->bd_enc_vec[i].bv_offset);
-		dst = src;
-		if (desc->bd_vec[i].bv_len % blocksize == 0)
-			sg_assign_page(&dst,
-				       desc->bd_vec[i].bv_page);
-
-		rc = crypto_blkcipher_decrypt_iv(&ciph_desc, &dst, &src,
-						 src.length);
-                if (rc) {
-                        CERROR("error to decrypt page: %d\n", rc);
-                        return rc;
-                }
-
+		/* a page with odd plain text is decrypted in place, which
+		 * destroys the IV of the next page */
 		if (desc->bd_vec[i].bv_len % blocksize != 0) {
-			memcpy(page_address(desc->bd_vec[i].bv_page) +
-			       desc->bd_vec[i].bv_offset,
-			       page_address(desc->bd_enc_vec[i].
-					    bv_page) +
-			       desc->bd_vec[i].bv_offset,
-			       desc->bd_vec[i].bv_len);
+			if (odd >= 0)
+				parallel = false;
+			odd = i;
 		}
+		last = i;
 
 		ct_nob += desc->bd_enc_vec[i].bv_len;
 		pt_nob += desc->bd_vec[i].bv_len;
 	}
+	npages = i;
 
         if (unlikely(ct_nob != desc->bd_nob_transferred)) {
                 CERROR("%d cipher text transferred but only %d decrypted\n",
@@ -923,6 +992,28 @@ int krb5_decrypt_bulk(struct crypto_blkcipher *tfm,
 		while (i < desc->bd_iov_count)
 			desc->bd_vec[i++].bv_len = 0;
 
+	kbc.kbc_tfm = tfm;
+	kbc.kbc_desc = desc;
+	kbc.kbc_cipher = cipher;
+	kbc.kbc_blocksize = blocksize;
+
+	/* the IV of the tail is the last cipher block of the pages, get it
+	 * before the pages are decrypted */
+	krb5_bulk_range_iv(&kbc, npages, local_iv);
+
+	/* CBC decryption only needs the cipher text of the previous block,
+	 * so the pages can be decrypted in parallel, unless the IV of a
+	 * page is overwritten by in place decryption */
+	if (odd >= 0 && odd != last)
+		parallel = false;
+
+	if (parallel)
+		rc = gss_bulk_parallel(npages, krb5_decrypt_bulk_range, &kbc);
+	else
+		rc = krb5_decrypt_bulk_range(&kbc, 0, npages);
+	if (rc)
+		return rc;
+
         /* decrypt tail (krb5 header) */
 	rc = gss_setup_sgtable(&sg_src, &src, cipher->data + blocksize,
 			       sizeof(*khdr));
@@ -627,39 +627,69 @@ __u32 gss_prep_bulk_sk(struct gss_ctx *gss_context,
 	return GSS_S_COMPLETE;
 }
 
-static __u32 sk_encrypt_bulk(struct crypto_blkcipher *tfm, __u8 *iv,
-			     struct ptlrpc_bulk_desc *desc, rawobj_t *cipher,
-			     int adj_nob)
+/* state shared by the page ranges of a bulk being encrypted or decrypted */
+struct sk_bulk_crypt {
+	struct crypto_blkcipher	*sbc_tfm;
+	struct ptlrpc_bulk_desc	*sbc_desc;
+	__u8			*sbc_iv;
+};
+
+/*
+ * Compute in \a iv the counter block of the first cipher block of page
+ * \a start.  ctr(aes) consumes a whole counter block for a partial block,
+ * so the counter is advanced by the rounded up number of blocks of each
+ * page before \a start, exactly as the serial processing of those pages
+ * would have advanced it.
+ */
+static void sk_bulk_range_iv(struct sk_bulk_crypt *sbc, int start, __u8 *iv)
 {
+	unsigned int ivsize = crypto_blkcipher_ivsize(sbc->sbc_tfm);
+	__u64 blocks = 0;
+	int i;
+
+	memcpy(iv, sbc->sbc_iv, SK_IV_SIZE);
+	if (ivsize == 0)
+		return;
+
+	for (i = 0; i < start; i++)
+		blocks += DIV_ROUND_UP(sbc->sbc_desc->bd_enc_vec[i].bv_len,
+				       ivsize);
+
+	/* the counter block is a big endian number */
+	for (i = ivsize - 1; i >= 0 && blocks != 0; i--) {
+		blocks += iv[i];
+		iv[i] = blocks & 0xff;
+		blocks >>= 8;
+	}
+}
+
+static int sk_encrypt_bulk_range(void *arg, int start, int end)
+{
+	struct sk_bulk_crypt *sbc = arg;
+	struct ptlrpc_bulk_desc *desc = sbc->sbc_desc;
+	__u8 local_iv[SK_IV_SIZE];
 	struct blkcipher_desc cdesc = {
-		.tfm = tfm,
-		.info = iv,
+		.tfm = sbc->sbc_tfm,
+		.info = local_iv,
 		.flags = 0,
 	};
 	struct scatterlist ptxt;
 	struct scatterlist ctxt;
-	int blocksize;
 	int i;
 	int rc;
-	int nob = 0;
 
-	blocksize = crypto_blkcipher_blocksize(tfm);
+	sk_bulk_range_iv(sbc, start, local_iv);
 
 	sg_init_table(&ptxt, 1);
 	sg_init_table(&ctxt, 1);
 
-	for (i = 0; i < desc->bd_iov_count; i++) {
+	for (i = start; i < end; i++) {
 		sg_set_page(&ptxt, desc->bd_vec[i].bv_page,
-			    sk_block_mask(desc->bd_vec[i].bv_len,
-					  blocksize),
+			    desc->bd_enc_vec[i].bv_len,
 			    desc->bd_vec[i].bv_offset);
-		nob += ptxt.length;
-
 		sg_set_page(&ctxt, desc->bd_enc_vec[i].bv_page,
-			    ptxt.length, ptxt.offset);
-
-		desc->bd_enc_vec[i].bv_offset = ctxt.offset;
-		desc->bd_enc_vec[i].bv_len = ctxt.length;
+			    desc->bd_enc_vec[i].bv_len,
+			    desc->bd_enc_vec[i].bv_offset);
 
 		rc = crypto_blkcipher_encrypt_iv(&cdesc, &ctxt, &ptxt,
 						 ptxt.length);
@@ -669,19 +699,53 @@ static __u32 sk_encrypt_bulk(struct crypto_blkcipher *tfm, __u8 *iv,
 		}
 	}
 
+	return 0;
+}
+
+static __u32 sk_encrypt_bulk(struct crypto_blkcipher *tfm, __u8 *iv,
+			     struct ptlrpc_bulk_desc *desc, rawobj_t *cipher,
+			     int adj_nob)
+{
+	struct sk_bulk_crypt sbc = {
+		.sbc_tfm = tfm,
+		.sbc_desc = desc,
+		.sbc_iv = iv,
+	};
+	int blocksize;
+	int i;
+	int rc;
+	int nob = 0;
+
+	blocksize = crypto_blkcipher_blocksize(tfm);
+
+	for (i = 0; i < desc->bd_iov_count; i++) {
+		desc->bd_enc_vec[i].bv_offset = desc->bd_vec[i].bv_offset;
+		desc->bd_enc_vec[i].bv_len =
+			sk_block_mask(desc->bd_vec[i].bv_len, blocksize);
+		nob += desc->bd_enc_vec[i].bv_len;
+	}
+
+	/* the counter of each page is known, so pages are encrypted
+	 * in parallel */
+	rc = gss_bulk_parallel(desc->bd_iov_count, sk_encrypt_bulk_range,
+			       &sbc);
+	if (rc)
+		return rc;
+
 	if (adj_nob)
 		desc->bd_nob = nob;
 
 	return 0;
 }
 
-static __u32 sk_decrypt_bulk(struct crypto_blkcipher *tfm, __u8 *iv,
-			     struct ptlrpc_bulk_desc *desc, rawobj_t *cipher,
-			     int adj_nob)
+static int sk_decrypt_bulk_range(void *arg, int start, int end)
 {
+	struct sk_bulk_crypt *sbc = arg;
+	struct ptlrpc_bulk_desc *desc = sbc->sbc_desc;
+	__u8 local_iv[SK_IV_SIZE];
 	struct blkcipher_desc cdesc = {
-		.tfm = tfm,
-		.info = iv,
+		.tfm = sbc->sbc_tfm,
+		.info = local_iv,
 		.flags = 0,
 	};
 	struct scatterlist ptxt;
@@ -689,12 +753,62 @@ static __u32 sk_decrypt_bulk(struct crypto_blkcipher *tfm, __u8 *iv,
 	int blocksize;
 	int i;
 	int rc;
+
+	blocksize = crypto_blkcipher_blocksize(sbc->sbc_tfm);
+	sk_bulk_range_iv(sbc, start, local_iv);
+
+	for (i = start; i < end; i++) {
+		struct bio_vec *piov = &desc->bd_vec[i];
+		struct bio_vec *ciov = &desc->bd_enc_vec[i];
+
+		if (ciov->bv_len == 0)
+			continue;
+
+		sg_init_table(&ctxt, 1);
+		sg_set_page(&ctxt, ciov->bv_page, ciov->bv_len,
+			    ciov->bv_offset);
+		ptxt = ctxt;
+
+		/* In the event the plain text size is not a multiple
+		 * of blocksize we decrypt in place and copy the result
+		 * after the decryption */
+		if (piov->bv_len % blocksize == 0)
+			sg_assign_page(&ptxt, piov->bv_page);
+
+		rc = crypto_blkcipher_decrypt_iv(&cdesc, &ptxt, &ctxt,
+						 ctxt.length);
+		if (rc) {
+			CERROR("Decryption failed for page: %d\n", rc);
+			return rc;
+		}
+
+		if (piov->bv_len % blocksize != 0) {
+			memcpy(page_address(piov->bv_page) +
+			       piov->bv_offset,
+			       page_address(ciov->bv_page) +
+			       ciov->bv_offset,
+			       piov->bv_len);
+		}
+	}
+
+	return 0;
+}
+
+static __u32 sk_decrypt_bulk(struct crypto_blkcipher *tfm, __u8 *iv,
+			     struct ptlrpc_bulk_desc *desc, rawobj_t *cipher,
+			     int adj_nob)
+{
+	struct sk_bulk_crypt sbc = {
+		.sbc_tfm = tfm,
+		.sbc_desc = desc,
+		.sbc_iv = iv,
+	};
+	int blocksize;
+	int npages;
+	int i;
 	int pnob = 0;
 	int cnob = 0;
 
-	sg_init_table(&ptxt, 1);
-	sg_init_table(&ctxt, 1);
-
 	blocksize = crypto_blkcipher_blocksize(tfm);
 	if (desc->bd_nob_transferred % blocksize != 0) {
 		CERROR("Transfer not a multiple of block size: %d\n",
@@ -737,38 +851,10 @@ static __u32 sk_decrypt_bulk(struct crypto_blkcipher *tfm, __u8 *iv,
 			}
 		}
 
-		if (ciov->bv_len == 0)
-			continue;
-
-		sg_init_table(&ctxt, 1);
-		sg_set_page(&ctxt, ciov->bv_page, ciov->bv_len,
-			    ciov->bv_offset);
-		ptxt = ctxt;
-
-		/* In the event the plain text size is not a multiple
-		 * of blocksize we decrypt in place and copy the result
-		 * after the decryption */
-		if (piov->bv_len % blocksize == 0)
-			sg_assign_page(&ptxt, piov->bv_page);
-
-		rc = crypto_blkcipher_decrypt_iv(&cdesc, &ptxt, &ctxt,
-						 ctxt.length);
-		if (rc) {
-			CERROR("Decryption failed for page: %d\n", rc);
-			return GSS_S_FAILURE;
-		}
-
-		if (piov->bv_len % blocksize != 0) {
-			memcpy(page_address(piov->bv_page) +
-			       piov->bv_offset,
-			       page_address(ciov->bv_page) +
-			       ciov->bv_offset,
-			       piov->bv_len);
-		}
-
 		cnob += ciov->bv_len;
 		pnob += piov->bv_len;
 	}
+	npages = i;
 
 	/* if needed, clear up the rest unused iovs */
 	if (adj_nob)
@@ -787,6 +873,11 @@ static __u32 sk_decrypt_bulk(struct crypto_blkcipher *tfm, __u8 *iv,
 		return GSS_S_FAILURE;
 	}
 
+	/* the sizes of all the pages are known now, so is the counter of
+	 * each page, decrypt the pages in parallel */
+	if (gss_bulk_parallel(npages, sk_decrypt_bulk_range, &sbc))
+		return GSS_S_FAILURE;
+
 	return 0;
 }
 
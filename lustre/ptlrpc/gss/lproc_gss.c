@@ -155,6 +155,30 @@ ssize_t sptlrpc_krb5_allow_old_client_csum_seq_write(struct file *file,
 }
 LPROC_SEQ_FOPS(sptlrpc_krb5_allow_old_client_csum);
 
+static int sptlrpc_bulk_parallel_pages_seq_show(struct seq_file *m,
+						void *data)
+{
+	seq_printf(m, "%u\n", gss_bulk_parallel_pages);
+	return 0;
+}
+
+static ssize_t
+sptlrpc_bulk_parallel_pages_seq_write(struct file *file,
+				      const char __user *buffer,
+				      size_t count, loff_t *off)
+{
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint_from_user(buffer, count, 0, &val);
+	if (rc)
+		return rc;
+
+	WRITE_ONCE(gss_bulk_parallel_pages, val);
+	return count;
+}
+LPROC_SEQ_FOPS(sptlrpc_bulk_parallel_pages);
+
 static struct lprocfs_vars gss_debugfs_vars[] = {
 	{ .name	=	"replays",
 	  .fops	=	&gss_proc_oos_fops	},
@@ -167,6 +191,8 @@ static struct lprocfs_vars gss_debugfs_vars[] = {
 static struct lprocfs_vars gss_lprocfs_vars[] = {
 	{ .name	=	"krb5_allow_old_client_csum",
 	  .fops	=	&sptlrpc_krb5_allow_old_client_csum_fops },
+	{ .name	=	"bulk_parallel_pages",
+	  .fops	=	&sptlrpc_bulk_parallel_pages_fops	},
 	{ NULL }
 };
 
@@ -49,7 +49,8 @@ bool nodemap_active;
 
 /* Lock protecting the active config, useful primarily when proc and
  * nodemap_hash might be replaced when loading a new config
- * Any time the active config is referenced, the lock should be held.
+ * Any time the active config is referenced, the lock should be held, except
+ * by nodemap_classify_nid_rcu() which only relies on RCU.
  */
 DEFINE_MUTEX(active_config_lock);
 struct nodemap_config *active_config;
@@ -82,7 +83,9 @@ static void nodemap_destroy(struct lu_nodemap *nodemap)
 
 	nm_member_delete_list(nodemap);
 
-	OBD_FREE_PTR(nodemap);
+	/* nodemap_classify_nid_rcu() might still be looking at it */
+	OBD_FREE_PRE(nodemap, sizeof(*nodemap), "kfree_rcu");
+	kfree_rcu(nodemap, nm_rcu);
 
 	EXIT;
 }
@@ -246,6 +249,28 @@ struct lu_nodemap *nodemap_lookup(const char *name)
 	return nodemap;
 }
 
+/* don't use 0@lo, use the first non-lo local NID instead */
+static int nodemap_nid_skip_lo(lnet_nid_t *nid)
+{
+	struct lnet_process_id id;
+	int i = 0;
+	int rc;
+
+	if (*nid != LNET_NID_LO_0)
+		return 0;
+
+	do {
+		rc = LNetGetId(i++, &id);
+		if (rc < 0)
+			return -EINVAL;
+	} while (id.nid == LNET_NID_LO_0);
+
+	*nid = id.nid;
+	CDEBUG(D_INFO, "found nid %s\n", libcfs_nid2str(*nid));
+
+	return 0;
+}
+
 /**
  * Classify the nid into the proper nodemap. Caller must hold active config and
  * nm_range_tree_lock, and call nodemap_putref when done with nodemap.
@@ -263,20 +288,9 @@ struct lu_nodemap *nodemap_classify_nid(lnet_nid_t nid)
 
 	ENTRY;
 
-	/* don't use 0@lo, use the first non-lo local NID instead */
-	if (nid == LNET_NID_LO_0) {
-		struct lnet_process_id id;
-		int i = 0;
-
-		do {
-			rc = LNetGetId(i++, &id);
-			if (rc < 0)
-				RETURN(ERR_PTR(-EINVAL));
-		} while (id.nid == LNET_NID_LO_0);
-
-		nid = id.nid;
-		CDEBUG(D_INFO, "found nid %s\n", libcfs_nid2str(nid));
-	}
+	rc = nodemap_nid_skip_lo(&nid);
+	if (rc < 0)
+		RETURN(ERR_PTR(rc));
 
 	range = range_search(&active_config->nmc_range_tree, nid);
 	if (range != NULL)
@@ -290,6 +304,53 @@ struct lu_nodemap *nodemap_classify_nid(lnet_nid_t nid)
 	RETURN(nodemap);
 }
 
+/**
+ * Classify the nid into the proper nodemap without taking any lock, using the
+ * compiled ranges of the active config. Call nodemap_putref when done with
+ * nodemap.
+ *
+ * \param	nid			nid to classify
+ * \retval	nodemap			nodemap containing the nid
+ * \retval	default_nodemap		default nodemap
+ * \retval	-EINVAL			LO nid given without other local nid
+ */
+static struct lu_nodemap *nodemap_classify_nid_rcu(lnet_nid_t nid)
+{
+	struct nodemap_config *config;
+	struct lu_nodemap *nodemap;
+	int rc;
+
+	ENTRY;
+
+	rc = nodemap_nid_skip_lo(&nid);
+	if (rc < 0)
+		RETURN(ERR_PTR(rc));
+
+	rcu_read_lock();
+	do {
+		config = rcu_dereference(active_config);
+		nodemap = range_search_rcu(&config->nmc_range_tree, nid);
+		if (IS_ERR(nodemap))
+			break;
+		if (nodemap == NULL)
+			nodemap = config->nmc_default_nodemap;
+		/* a nodemap is only released once its ranges are deleted, or
+		 * its config is replaced, so look again in that case */
+	} while (!atomic_inc_not_zero(&nodemap->nm_refcount));
+	rcu_read_unlock();
+
+	if (IS_ERR(nodemap)) {
+		/* ranges could not be compiled */
+		mutex_lock(&active_config_lock);
+		down_read(&active_config->nmc_range_tree_lock);
+		nodemap = nodemap_classify_nid(nid);
+		up_read(&active_config->nmc_range_tree_lock);
+		mutex_unlock(&active_config_lock);
+	}
+
+	RETURN(nodemap);
+}
+
 /**
  * simple check for default nodemap
  */
@@ -381,27 +442,36 @@ EXPORT_SYMBOL(nodemap_parse_idmap);
 int nodemap_add_member(lnet_nid_t nid, struct obd_export *exp)
 {
 	struct lu_nodemap *nodemap;
+	int gen;
 	int rc = 0;
 	ENTRY;
 
-	mutex_lock(&active_config_lock);
-	down_read(&active_config->nmc_range_tree_lock);
-
-	nodemap = nodemap_classify_nid(nid);
-
+	/* Classify without active_config_lock, so that reconnecting clients
+	 * are not serialized here. Ranges are changed before the members of
+	 * the affected nodemaps are reclassified, so if they changed while
+	 * this export was being added, it might have missed that and is
+	 * reclassified here.
+	 */
+	gen = atomic_read(&nodemap_range_gen);
+	smp_rmb();
+	nodemap = nodemap_classify_nid_rcu(nid);
 	if (IS_ERR(nodemap)) {
 		CWARN("%s: error adding to nodemap, no valid NIDs found\n",
 			  exp->exp_obd->obd_name);
-		rc = -EINVAL;
-	} else {
-		rc = nm_member_add(nodemap, exp);
+		RETURN(-EINVAL);
 	}
 
-	up_read(&active_config->nmc_range_tree_lock);
-	mutex_unlock(&active_config_lock);
+	rc = nm_member_add(nodemap, exp);
+	smp_mb();
+	if (rc == 0 && atomic_read(&nodemap_range_gen) != gen) {
+		mutex_lock(&active_config_lock);
+		down_read(&active_config->nmc_range_tree_lock);
+		nm_member_reclassify_nodemap(nodemap);
+		up_read(&active_config->nmc_range_tree_lock);
+		mutex_unlock(&active_config_lock);
+	}
 
-	if (!IS_ERR(nodemap))
-		nodemap_putref(nodemap);
+	nodemap_putref(nodemap);
 
 	RETURN(rc);
 }
@@ -660,7 +730,9 @@ __u32 nodemap_map_id(struct lu_nodemap *nodemap,
 		     enum nodemap_tree_type tree_type, __u32 id)
 {
 	struct lu_idmap		*idmap = NULL;
+	struct lu_idmap_hash	*hash;
 	__u32			 found_id;
+	int			 rc;
 
 	ENTRY;
 
@@ -689,6 +761,18 @@ __u32 nodemap_map_id(struct lu_nodemap *nodemap,
 	if (is_default_nodemap(nodemap))
 		goto squash;
 
+	rcu_read_lock();
+	hash = rcu_dereference(nodemap->nm_idmap_hash);
+	if (likely(hash != NULL)) {
+		rc = idmap_hash_search(hash, tree_type, id_type, id, &found_id);
+		rcu_read_unlock();
+		if (rc < 0)
+			goto squash;
+		RETURN(found_id);
+	}
+	rcu_read_unlock();
+
+	/* hash tables could not be allocated */
 	down_read(&nodemap->nm_idmap_lock);
 	idmap = idmap_search(nodemap, tree_type, id_type, id);
 	if (idmap == NULL) {
@@ -1156,6 +1240,8 @@ struct lu_nodemap *nodemap_create(const char *name,
 	nodemap->nm_client_to_fs_uidmap = RB_ROOT;
 	nodemap->nm_fs_to_client_gidmap = RB_ROOT;
 	nodemap->nm_client_to_fs_gidmap = RB_ROOT;
+	/* ids are mapped under nm_idmap_lock if this fails */
+	idmap_hash_rebuild(nodemap);
 
 	if (is_default) {
 		nodemap->nm_id = LUSTRE_NODEMAP_DEFAULT_ID;
@@ -1606,6 +1692,11 @@ void nodemap_config_dealloc(struct nodemap_config *config)
 	struct lu_nid_range	*range_temp;
 	LIST_HEAD(nodemap_list_head);
 
+	/* no need to maintain compiled ranges while deleting them */
+	down_write(&config->nmc_range_tree_lock);
+	range_tree_release(&config->nmc_range_tree);
+	up_write(&config->nmc_range_tree_lock);
+
 	cfs_hash_for_each_safe(config->nmc_nodemap_hash,
 			       nodemap_cleanup_iter_cb, &nodemap_list_head);
 	cfs_hash_putref(config->nmc_nodemap_hash);
@@ -1629,7 +1720,10 @@ void nodemap_config_dealloc(struct nodemap_config *config)
 		/* putref must be outside of ac lock if nm could be destroyed */
 		nodemap_putref(nodemap);
 	}
-	OBD_FREE_PTR(config);
+
+	/* nodemap_classify_nid_rcu() might still be looking at it */
+	OBD_FREE_PRE(config, sizeof(*config), "kfree_rcu");
+	kfree_rcu(config, nmc_rcu);
 }
 EXPORT_SYMBOL(nodemap_config_dealloc);
 
@@ -1663,6 +1757,13 @@ void nodemap_config_set_active(struct nodemap_config *config)
 
 	mutex_lock(&active_config_lock);
 
+	/* connecting clients are classified under active_config_lock if the
+	 * ranges can't be compiled */
+	down_write(&config->nmc_range_tree_lock);
+	if (range_tree_compile(&config->nmc_range_tree) < 0)
+		CWARN("cannot compile nodemap ranges, classifying with lock\n");
+	up_write(&config->nmc_range_tree_lock);
+
 	/* move proc entries from already existing nms, create for new nms */
 	cfs_hash_for_each_safe(config->nmc_nodemap_hash,
 			       nm_hash_list_cb, &nodemap_list_head);
@@ -1695,7 +1796,10 @@ void nodemap_config_set_active(struct nodemap_config *config)
 	/* if new config is inactive, deactivate live config before switching */
 	if (!config->nmc_nodemap_is_active)
 		nodemap_active = false;
-	active_config = config;
+	rcu_assign_pointer(active_config, config);
+	/* see nodemap_add_member() */
+	smp_mb__before_atomic();
+	atomic_inc(&nodemap_range_gen);
 	if (config->nmc_nodemap_is_active)
 		nodemap_active = true;
 
@@ -1771,6 +1875,77 @@ void nm_member_revoke_all(void)
 	mutex_unlock(&active_config_lock);
 }
 
+/*
+ * Time \a count classifications of \a nid under the config locks, as done
+ * before the ranges were compiled, then without lock. Used by sanity-sec
+ * test_36 with OBD_FAIL_SEC_NODEMAP_BENCH, cfs_fail_val being \a count.
+ */
+static void nodemap_classify_bench(lnet_nid_t nid, unsigned int count)
+{
+	struct lu_nodemap *nodemap;
+	ktime_t start;
+	s64 locked;
+	s64 lockless;
+	unsigned int i;
+
+	start = ktime_get();
+	for (i = 0; i < count; i++) {
+		mutex_lock(&active_config_lock);
+		down_read(&active_config->nmc_range_tree_lock);
+		nodemap = nodemap_classify_nid(nid);
+		up_read(&active_config->nmc_range_tree_lock);
+		mutex_unlock(&active_config_lock);
+		if (IS_ERR(nodemap))
+			return;
+		nodemap_putref(nodemap);
+	}
+	locked = ktime_us_delta(ktime_get(), start);
+
+	start = ktime_get();
+	for (i = 0; i < count; i++) {
+		nodemap = nodemap_classify_nid_rcu(nid);
+		if (IS_ERR(nodemap))
+			return;
+		nodemap_putref(nodemap);
+	}
+	lockless = ktime_us_delta(ktime_get(), start);
+
+	CDEBUG(D_CONSOLE,
+	       "nodemap bench: classify %s x%u: locked %lld us, lockless %lld us\n",
+	       libcfs_nid2str(nid), count, locked, lockless);
+}
+
+/*
+ * Time \a count mappings of \a id by \a nodemap through the idmap trees
+ * under nm_idmap_lock, then through the hash tables without lock.
+ */
+static void nodemap_map_bench(struct lu_nodemap *nodemap,
+			      enum nodemap_id_type idtype, __u32 id,
+			      unsigned int count)
+{
+	ktime_t start;
+	s64 locked;
+	s64 lockless;
+	unsigned int i;
+
+	start = ktime_get();
+	for (i = 0; i < count; i++) {
+		down_read(&nodemap->nm_idmap_lock);
+		idmap_search(nodemap, NODEMAP_CLIENT_TO_FS, idtype, id);
+		up_read(&nodemap->nm_idmap_lock);
+	}
+	locked = ktime_us_delta(ktime_get(), start);
+
+	start = ktime_get();
+	for (i = 0; i < count; i++)
+		nodemap_map_id(nodemap, idtype, NODEMAP_CLIENT_TO_FS, id);
+	lockless = ktime_us_delta(ktime_get(), start);
+
+	CDEBUG(D_CONSOLE,
+	       "nodemap bench: map %s id %u x%u: locked %lld us, lockless %lld us\n",
+	       nodemap->nm_name, id, count, locked, lockless);
+}
+
 /**
  * Returns the nodemap classification for a given nid into an ioctl buffer.
  * Useful for testing the nodemap configuration to make sure it is working as
@@ -1784,12 +1959,10 @@ void nodemap_test_nid(lnet_nid_t nid, char *name_buf, size_t name_len)
 {
 	struct lu_nodemap	*nodemap;
 
-	mutex_lock(&active_config_lock);
-	down_read(&active_config->nmc_range_tree_lock);
-	nodemap = nodemap_classify_nid(nid);
-	up_read(&active_config->nmc_range_tree_lock);
-	mutex_unlock(&active_config_lock);
+	if (OBD_FAIL_PRECHECK(OBD_FAIL_SEC_NODEMAP_BENCH))
+		nodemap_classify_bench(nid, cfs_fail_val);
 
+	nodemap = nodemap_classify_nid_rcu(nid);
 	if (IS_ERR(nodemap))
 		return;
 
@@ -1818,15 +1991,13 @@ int nodemap_test_id(lnet_nid_t nid, enum nodemap_id_type idtype,
 {
 	struct lu_nodemap	*nodemap;
 
-	mutex_lock(&active_config_lock);
-	down_read(&active_config->nmc_range_tree_lock);
-	nodemap = nodemap_classify_nid(nid);
-	up_read(&active_config->nmc_range_tree_lock);
-	mutex_unlock(&active_config_lock);
-
+	nodemap = nodemap_classify_nid_rcu(nid);
 	if (IS_ERR(nodemap))
 		return PTR_ERR(nodemap);
 
+	if (OBD_FAIL_PRECHECK(OBD_FAIL_SEC_NODEMAP_BENCH))
+		nodemap_map_bench(nodemap, idtype, client_id, cfs_fail_val);
+
 	*fs_id = nodemap_map_id(nodemap, idtype, NODEMAP_CLIENT_TO_FS,
 			       client_id);
 	nodemap_putref(nodemap);
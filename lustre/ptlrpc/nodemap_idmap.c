@@ -27,6 +27,8 @@
  * Author: Joshua Walgenbach <jjw@iu.edu>
  */
 
+#include <linux/hash.h>
+#include <linux/log2.h>
 #include <linux/rbtree.h>
 #include <lustre_net.h>
 #include "nodemap_internal.h"
@@ -65,6 +67,234 @@ static void idmap_destroy(struct lu_idmap *idmap)
 	OBD_FREE_PTR(idmap);
 }
 
+/*
+ * Idmap hash tables
+ *
+ * The idmap trees are only modified with nm_idmap_lock held for write. They
+ * are copied into open addressing hash tables, searched by nodemap_map_id()
+ * under RCU only. New maps fill free slots in place and deleted maps are
+ * only marked as such, so that a concurrent search never sees a slot change
+ * keys. The tables are rebuilt into a new copy once they are half full.
+ */
+
+static inline int idmap_hash_table(enum nodemap_id_type id_type,
+				   enum nodemap_tree_type tree_type)
+{
+	return (id_type == NODEMAP_UID ? 0 : 2) +
+	       (tree_type == NODEMAP_FS_TO_CLIENT ? 0 : 1);
+}
+
+static inline struct lu_idmap_slot *
+idmap_hash_slots(struct lu_idmap_hash *hash, int table)
+{
+	return &hash->ih_slots[table << hash->ih_bits];
+}
+
+static size_t idmap_hash_size(unsigned int bits)
+{
+	return offsetof(struct lu_idmap_hash,
+			ih_slots[IDMAP_HASH_TABLES << bits]);
+}
+
+static void idmap_hash_free_rcu(struct rcu_head *head)
+{
+	struct lu_idmap_hash *hash;
+	size_t size;
+
+	hash = container_of(head, struct lu_idmap_hash, ih_rcu);
+	size = idmap_hash_size(hash->ih_bits);
+	OBD_FREE_LARGE(hash, size);
+}
+
+static void idmap_hash_publish(struct lu_nodemap *nodemap,
+			       struct lu_idmap_hash *hash)
+{
+	struct lu_idmap_hash *old;
+
+	old = rcu_dereference_protected(nodemap->nm_idmap_hash, 1);
+	rcu_assign_pointer(nodemap->nm_idmap_hash, hash);
+	if (old != NULL)
+		call_rcu(&old->ih_rcu, idmap_hash_free_rcu);
+}
+
+static void idmap_hash_fill(struct lu_idmap_hash *hash, int table,
+			    __u32 key, __u32 val)
+{
+	struct lu_idmap_slot *slots = idmap_hash_slots(hash, table);
+	unsigned int mask = (1U << hash->ih_bits) - 1;
+	unsigned int i = hash_32(key, hash->ih_bits);
+
+	while (slots[i].is_state != IDMAP_SLOT_FREE)
+		i = (i + 1) & mask;
+
+	slots[i].is_key = key;
+	slots[i].is_val = val;
+	/* pairs with smp_load_acquire() in idmap_hash_search() */
+	smp_store_release(&slots[i].is_state, IDMAP_SLOT_USED);
+	hash->ih_fill[table]++;
+}
+
+static void idmap_hash_clear(struct lu_idmap_hash *hash, int table, __u32 key)
+{
+	struct lu_idmap_slot *slots = idmap_hash_slots(hash, table);
+	unsigned int mask = (1U << hash->ih_bits) - 1;
+	unsigned int i = hash_32(key, hash->ih_bits);
+
+	while (slots[i].is_state != IDMAP_SLOT_FREE) {
+		if (slots[i].is_state == IDMAP_SLOT_USED &&
+		    slots[i].is_key == key) {
+			WRITE_ONCE(slots[i].is_state, IDMAP_SLOT_DELETED);
+			return;
+		}
+		i = (i + 1) & mask;
+	}
+}
+
+static void idmap_hash_fill_tree(struct lu_idmap_hash *hash,
+				 enum nodemap_id_type id_type,
+				 struct rb_root *root)
+{
+	struct rb_node *node;
+
+	for (node = rb_first(root); node != NULL; node = rb_next(node)) {
+		struct lu_idmap *idmap = rb_entry(node, struct lu_idmap,
+						  id_client_to_fs);
+
+		idmap_hash_fill(hash,
+				idmap_hash_table(id_type, NODEMAP_CLIENT_TO_FS),
+				idmap->id_client, idmap->id_fs);
+		idmap_hash_fill(hash,
+				idmap_hash_table(id_type, NODEMAP_FS_TO_CLIENT),
+				idmap->id_fs, idmap->id_client);
+	}
+}
+
+static unsigned int idmap_tree_count(struct rb_root *root)
+{
+	struct rb_node *node;
+	unsigned int count = 0;
+
+	for (node = rb_first(root); node != NULL; node = rb_next(node))
+		count++;
+
+	return count;
+}
+
+/**
+ * Copy the idmap trees of a nodemap into new hash tables, sized so that
+ * they are at most a quarter full, and publish them. Requires nm_idmap_lock
+ * held for write.
+ *
+ * \param	nodemap		nodemap to rebuild the hash of
+ *
+ * \retval	0 on success
+ * \retval	-ENOMEM if the tables cannot be allocated, ids are then
+ *		mapped under nm_idmap_lock until the next rebuild
+ */
+int idmap_hash_rebuild(struct lu_nodemap *nodemap)
+{
+	struct lu_idmap_hash *hash;
+	unsigned int count;
+	unsigned int bits;
+
+	count = max(idmap_tree_count(&nodemap->nm_client_to_fs_uidmap),
+		    idmap_tree_count(&nodemap->nm_client_to_fs_gidmap));
+	bits = max_t(unsigned int, 3, order_base_2(count * 4));
+
+	OBD_ALLOC_LARGE(hash, idmap_hash_size(bits));
+	if (hash == NULL) {
+		idmap_hash_publish(nodemap, NULL);
+		return -ENOMEM;
+	}
+
+	hash->ih_bits = bits;
+	idmap_hash_fill_tree(hash, NODEMAP_UID,
+			     &nodemap->nm_client_to_fs_uidmap);
+	idmap_hash_fill_tree(hash, NODEMAP_GID,
+			     &nodemap->nm_client_to_fs_gidmap);
+	idmap_hash_publish(nodemap, hash);
+
+	return 0;
+}
+
+/*
+ * add a new idmap to the hash tables of a nodemap, already inserted in the
+ * trees
+ */
+static void idmap_hash_add(enum nodemap_id_type id_type,
+			   struct lu_idmap *idmap, struct lu_nodemap *nodemap)
+{
+	struct lu_idmap_hash *hash;
+	int fwd = idmap_hash_table(id_type, NODEMAP_CLIENT_TO_FS);
+	int bck = idmap_hash_table(id_type, NODEMAP_FS_TO_CLIENT);
+
+	hash = rcu_dereference_protected(nodemap->nm_idmap_hash, 1);
+	if (hash == NULL ||
+	    (max(hash->ih_fill[fwd], hash->ih_fill[bck]) + 1) * 2 >
+	    (1U << hash->ih_bits)) {
+		idmap_hash_rebuild(nodemap);
+		return;
+	}
+
+	idmap_hash_fill(hash, fwd, idmap->id_client, idmap->id_fs);
+	idmap_hash_fill(hash, bck, idmap->id_fs, idmap->id_client);
+}
+
+/*
+ * remove an idmap from the hash tables of a nodemap
+ */
+static void idmap_hash_del(enum nodemap_id_type id_type,
+			   struct lu_idmap *idmap, struct lu_nodemap *nodemap)
+{
+	struct lu_idmap_hash *hash;
+
+	hash = rcu_dereference_protected(nodemap->nm_idmap_hash, 1);
+	if (hash == NULL)
+		return;
+
+	idmap_hash_clear(hash, idmap_hash_table(id_type, NODEMAP_CLIENT_TO_FS),
+			 idmap->id_client);
+	idmap_hash_clear(hash, idmap_hash_table(id_type, NODEMAP_FS_TO_CLIENT),
+			 idmap->id_fs);
+}
+
+/**
+ * Search the idmap hash tables of a nodemap, without taking any lock.
+ * Caller must hold rcu_read_lock().
+ *
+ * \param	hash		nodemap hash tables
+ * \param	tree_type	NODEMAP_FS_TO_CLIENT or NODEMAP_CLIENT_TO_FS
+ * \param	id_type		NODEMAP_UID or NODEMAP_GID
+ * \param	id		numeric id for which to search
+ * \param[out]	mapped		mapped id
+ *
+ * \retval	0 on success
+ * \retval	-ENOENT if id is not mapped
+ */
+int idmap_hash_search(struct lu_idmap_hash *hash,
+		      enum nodemap_tree_type tree_type,
+		      enum nodemap_id_type id_type, __u32 id, __u32 *mapped)
+{
+	struct lu_idmap_slot *slots;
+	unsigned int mask = (1U << hash->ih_bits) - 1;
+	unsigned int i = hash_32(id, hash->ih_bits);
+	unsigned int n;
+
+	slots = idmap_hash_slots(hash, idmap_hash_table(id_type, tree_type));
+	for (n = 0; n <= mask; n++, i = (i + 1) & mask) {
+		__u32 state = smp_load_acquire(&slots[i].is_state);
+
+		if (state == IDMAP_SLOT_FREE)
+			break;
+		if (state == IDMAP_SLOT_USED && slots[i].is_key == id) {
+			*mapped = slots[i].is_val;
+			return 0;
+		}
+	}
+
+	return -ENOENT;
+}
+
 /**
  * Insert idmap into the proper trees
  *
@@ -155,6 +385,7 @@ struct lu_idmap *idmap_insert(enum nodemap_id_type id_type,
 		rb_insert_color(&idmap->id_client_to_fs, fwd_root);
 		rb_link_node(&idmap->id_fs_to_client, bck_parent, bck_node);
 		rb_insert_color(&idmap->id_fs_to_client, bck_root);
+		idmap_hash_add(id_type, idmap, nodemap);
 		RETURN(NULL);
 	}
 
@@ -184,6 +415,7 @@ void idmap_delete(enum nodemap_id_type id_type, struct lu_idmap *idmap,
 		bck_root = &nodemap->nm_fs_to_client_gidmap;
 	}
 
+	idmap_hash_del(id_type, idmap, nodemap);
 	rb_erase(&idmap->id_client_to_fs, fwd_root);
 	rb_erase(&idmap->id_fs_to_client, bck_root);
 
@@ -263,8 +495,18 @@ void idmap_delete_tree(struct lu_nodemap *nodemap)
 {
 	struct lu_idmap		*idmap;
 	struct lu_idmap		*temp;
+	struct lu_idmap_hash	*hash;
 	struct rb_root		root;
 
+	/* no more users of the nodemap */
+	hash = rcu_dereference_protected(nodemap->nm_idmap_hash, 1);
+	if (hash != NULL) {
+		size_t size = idmap_hash_size(hash->ih_bits);
+
+		RCU_INIT_POINTER(nodemap->nm_idmap_hash, NULL);
+		OBD_FREE_LARGE(hash, size);
+	}
+
 	root = nodemap->nm_fs_to_client_uidmap;
 	nm_rbtree_postorder_for_each_entry_safe(idmap, temp, &root,
 						id_fs_to_client) {
@@ -61,6 +61,26 @@ struct lu_nid_range {
 	struct interval_node	 rn_node;
 };
 
+/* a NID range in the compiled range array */
+struct nodemap_range_entry {
+	lnet_nid_t		 nre_start;
+	lnet_nid_t		 nre_end;
+	/* NULL once the range is deleted */
+	struct lu_nodemap	*nre_nodemap;
+};
+
+struct nodemap_range_array {
+	struct rcu_head			nra_rcu;
+	/* number of entries, including deleted ones */
+	unsigned int			nra_count;
+	/* number of deleted entries */
+	unsigned int			nra_deleted;
+	struct nodemap_range_entry	nra_ranges[0];
+};
+
+/* bumped each time the ranges of the active config change */
+extern atomic_t nodemap_range_gen;
+
 struct lu_idmap {
 	/* uid/gid of client */
 	__u32		id_client;
@@ -72,6 +92,35 @@ struct lu_idmap {
 	struct rb_node	id_fs_to_client;
 };
 
+enum lu_idmap_slot_state {
+	IDMAP_SLOT_FREE = 0,
+	IDMAP_SLOT_USED,
+	IDMAP_SLOT_DELETED,
+};
+
+struct lu_idmap_slot {
+	__u32		is_key;
+	__u32		is_val;
+	/* enum lu_idmap_slot_state */
+	__u32		is_state;
+};
+
+/* one table per id type and direction */
+#define IDMAP_HASH_TABLES	4
+
+/* Open addressing hash tables copying the idmap trees of a nodemap, so that
+ * ids are mapped without taking nm_idmap_lock. Slots are only filled or
+ * marked deleted in place, the tables are rebuilt into a new copy when they
+ * are half full.
+ */
+struct lu_idmap_hash {
+	struct rcu_head		ih_rcu;
+	unsigned int		ih_bits;
+	/* used or deleted slots in each table */
+	unsigned int		ih_fill[IDMAP_HASH_TABLES];
+	struct lu_idmap_slot	ih_slots[0];
+};
+
 /* first 4 bits of the nodemap_id is the index type */
 struct nodemap_key {
 	__u32 nk_nodemap_id;
@@ -131,6 +180,10 @@ struct lu_nid_range *range_search(struct nodemap_range_tree *nm_range_tree,
 				  lnet_nid_t nid);
 struct lu_nid_range *range_find(struct nodemap_range_tree *nm_range_tree,
 				lnet_nid_t start_nid, lnet_nid_t end_nid);
+int range_tree_compile(struct nodemap_range_tree *nm_range_tree);
+void range_tree_release(struct nodemap_range_tree *nm_range_tree);
+struct lu_nodemap *range_search_rcu(struct nodemap_range_tree *nm_range_tree,
+				    lnet_nid_t nid);
 int range_parse_nidstring(char *range_string, lnet_nid_t *start_nid,
 			  lnet_nid_t *end_nid);
 void range_init_tree(void);
@@ -145,6 +198,10 @@ struct lu_idmap *idmap_search(struct lu_nodemap *nodemap,
 			      enum nodemap_tree_type,
 			      enum nodemap_id_type id_type,
 			      __u32 id);
+int idmap_hash_rebuild(struct lu_nodemap *nodemap);
+int idmap_hash_search(struct lu_idmap_hash *hash,
+		      enum nodemap_tree_type tree_type,
+		      enum nodemap_id_type id_type, __u32 id, __u32 *mapped);
 int nm_member_add(struct lu_nodemap *nodemap, struct obd_export *exp);
 void nm_member_del(struct lu_nodemap *nodemap, struct obd_export *exp);
 void nm_member_delete_list(struct lu_nodemap *nodemap);
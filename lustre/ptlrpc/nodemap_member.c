@@ -87,7 +87,7 @@ void nm_member_delete_list(struct lu_nodemap *nodemap)
 /**
  * Add a member export to a nodemap
  *
- * Must be called under active_config_lock.
+ * Can be called without active_config_lock, see nodemap_add_member().
  *
  * \param	nodemap		nodemap to add to
  * \param	exp		obd_export to add
@@ -38,8 +38,201 @@
  * the lu_nid_range nodes will be added to linked links within the
  * lu_nodemap structure for reporting purposes. Access to range tree should be
  * controlled to prevent read access during update operations.
+ *
+ * Once the config is active, the ranges are also compiled into an array
+ * sorted by start nid, replaced with RCU when a range is inserted, so that
+ * connecting clients are classified without taking any lock. Deleted ranges
+ * are only cleared in the array, which is compacted when they outnumber
+ * the remaining ones.
  */
 
+atomic_t nodemap_range_gen = ATOMIC_INIT(0);
+
+static size_t range_array_size(unsigned int count)
+{
+	return offsetof(struct nodemap_range_array, nra_ranges[count]);
+}
+
+static struct nodemap_range_array *range_array_alloc(unsigned int count)
+{
+	struct nodemap_range_array *nra;
+
+	OBD_ALLOC_LARGE(nra, range_array_size(count));
+
+	return nra;
+}
+
+static void range_array_free_rcu(struct rcu_head *head)
+{
+	struct nodemap_range_array *nra;
+	size_t size;
+
+	nra = container_of(head, struct nodemap_range_array, nra_rcu);
+	size = range_array_size(nra->nra_count);
+	OBD_FREE_LARGE(nra, size);
+}
+
+/*
+ * replace the compiled range array of a tree
+ *
+ * \param	nra		new array, NULL to stop lockless lookups
+ */
+static void range_array_publish(struct nodemap_range_tree *nm_range_tree,
+				struct nodemap_range_array *nra)
+{
+	struct nodemap_range_array *old;
+
+	old = rcu_dereference_protected(nm_range_tree->nmrt_range_array, 1);
+	rcu_assign_pointer(nm_range_tree->nmrt_range_array, nra);
+	if (old != NULL)
+		call_rcu(&old->nra_rcu, range_array_free_rcu);
+
+	/* see nodemap_add_member() */
+	atomic_inc(&nodemap_range_gen);
+}
+
+/*
+ * find the last entry starting at or before an nid
+ *
+ * \retval	entry index, -1 if nid is before the first entry
+ */
+static int range_array_index(const struct nodemap_range_array *nra,
+			     lnet_nid_t nid)
+{
+	int lo = 0;
+	int hi = nra->nra_count - 1;
+	int found = -1;
+
+	while (lo <= hi) {
+		int mid = lo + (hi - lo) / 2;
+
+		if (nra->nra_ranges[mid].nre_start <= nid) {
+			found = mid;
+			lo = mid + 1;
+		} else {
+			hi = mid - 1;
+		}
+	}
+
+	return found;
+}
+
+static enum interval_iter range_compile_cb(struct interval_node *n,
+					   void *data)
+{
+	struct lu_nid_range		*range = container_of(n,
+							struct lu_nid_range,
+							rn_node);
+	struct nodemap_range_array	*nra = data;
+	struct nodemap_range_entry	*nre;
+
+	nre = &nra->nra_ranges[nra->nra_count++];
+	nre->nre_start = interval_low(n);
+	nre->nre_end = interval_high(n);
+	nre->nre_nodemap = range->rn_nodemap;
+
+	return INTERVAL_ITER_CONT;
+}
+
+/*
+ * compile the ranges of a tree into a new sorted array, and publish it for
+ * lockless classification. Requires nmc_range_tree_lock held for write.
+ *
+ * \retval	0 on success
+ * \retval	-ENOMEM if the array cannot be allocated, in which case
+ *		lockless lookups stay disabled
+ */
+int range_tree_compile(struct nodemap_range_tree *nm_range_tree)
+{
+	struct nodemap_range_array *nra;
+
+	nra = range_array_alloc(nm_range_tree->nmrt_range_count);
+	if (nra == NULL) {
+		range_array_publish(nm_range_tree, NULL);
+		return -ENOMEM;
+	}
+
+	nra->nra_count = 0;
+	nra->nra_deleted = 0;
+	interval_iterate(nm_range_tree->nmrt_range_interval_root,
+			 range_compile_cb, nra);
+	LASSERT(nra->nra_count == nm_range_tree->nmrt_range_count);
+
+	range_array_publish(nm_range_tree, nra);
+
+	return 0;
+}
+
+/*
+ * free the compiled range array of a tree being destroyed
+ */
+void range_tree_release(struct nodemap_range_tree *nm_range_tree)
+{
+	range_array_publish(nm_range_tree, NULL);
+}
+
+/*
+ * insert a range into a new copy of the compiled array, and publish it
+ */
+static int range_array_insert(struct nodemap_range_tree *nm_range_tree,
+			      struct lu_nid_range *range)
+{
+	struct nodemap_range_array	*old;
+	struct nodemap_range_array	*nra;
+	lnet_nid_t			 start = interval_low(&range->rn_node);
+	bool				 added = false;
+	unsigned int			 i;
+
+	old = rcu_dereference_protected(nm_range_tree->nmrt_range_array, 1);
+	nra = range_array_alloc(nm_range_tree->nmrt_range_count + 1);
+	if (nra == NULL)
+		return -ENOMEM;
+
+	nra->nra_count = 0;
+	nra->nra_deleted = 0;
+	for (i = 0; i < old->nra_count; i++) {
+		struct nodemap_range_entry *nre = &old->nra_ranges[i];
+
+		if (nre->nre_nodemap == NULL)
+			continue;
+		if (!added && start < nre->nre_start) {
+			range_compile_cb(&range->rn_node, nra);
+			added = true;
+		}
+		nra->nra_ranges[nra->nra_count++] = *nre;
+	}
+	if (!added)
+		range_compile_cb(&range->rn_node, nra);
+	LASSERT(nra->nra_count == nm_range_tree->nmrt_range_count + 1);
+
+	range_array_publish(nm_range_tree, nra);
+
+	return 0;
+}
+
+/*
+ * clear a deleted range in the compiled array, compact it if needed
+ */
+static void range_array_delete(struct nodemap_range_tree *nm_range_tree,
+			       struct lu_nid_range *range)
+{
+	struct nodemap_range_array	*nra;
+	int				 i;
+
+	nra = rcu_dereference_protected(nm_range_tree->nmrt_range_array, 1);
+	i = range_array_index(nra, interval_low(&range->rn_node));
+	LASSERT(i >= 0 && nra->nra_ranges[i].nre_nodemap == range->rn_nodemap);
+
+	WRITE_ONCE(nra->nra_ranges[i].nre_nodemap, NULL);
+	nra->nra_deleted++;
+	atomic_inc(&nodemap_range_gen);
+
+	/* the range is already out of the tree, compaction failure only
+	 * leaves the deleted entries in the array */
+	if (nra->nra_deleted > nm_range_tree->nmrt_range_count)
+		range_tree_compile(nm_range_tree);
+}
+
 /*
  * callback for iterating over the interval tree
  *
@@ -166,8 +359,16 @@ int range_insert(struct nodemap_range_tree *nm_range_tree,
 				   &ext) != 0)
 		return -EEXIST;
 
+	if (rcu_access_pointer(nm_range_tree->nmrt_range_array) != NULL) {
+		int rc = range_array_insert(nm_range_tree, range);
+
+		if (rc < 0)
+			return rc;
+	}
+
 	interval_insert(&range->rn_node,
 			&nm_range_tree->nmrt_range_interval_root);
+	nm_range_tree->nmrt_range_count++;
 
 	return 0;
 }
@@ -186,6 +387,9 @@ void range_delete(struct nodemap_range_tree *nm_range_tree,
 	list_del(&range->rn_list);
 	interval_erase(&range->rn_node,
 		       &nm_range_tree->nmrt_range_interval_root);
+	nm_range_tree->nmrt_range_count--;
+	if (rcu_access_pointer(nm_range_tree->nmrt_range_array) != NULL)
+		range_array_delete(nm_range_tree, range);
 	range_destroy(range);
 }
 
@@ -208,3 +412,29 @@ struct lu_nid_range *range_search(struct nodemap_range_tree *nm_range_tree,
 
 	return ret;
 }
+
+/*
+ * search the compiled range array for the nodemap of an nid, without taking
+ * any lock. Caller must hold rcu_read_lock().
+ *
+ * \param	nid		nid to search for
+ * \retval	nodemap of the range containing nid, not referenced
+ * \retval	NULL if no range contains nid
+ * \retval	-EAGAIN if the ranges are not compiled
+ */
+struct lu_nodemap *range_search_rcu(struct nodemap_range_tree *nm_range_tree,
+				    lnet_nid_t nid)
+{
+	struct nodemap_range_array	*nra;
+	int				 i;
+
+	nra = rcu_dereference(nm_range_tree->nmrt_range_array);
+	if (nra == NULL)
+		return ERR_PTR(-EAGAIN);
+
+	i = range_array_index(nra, nid);
+	if (i < 0 || nid > nra->nra_ranges[i].nre_end)
+		return NULL;
+
+	return READ_ONCE(nra->nra_ranges[i].nre_nodemap);
+}
@@ -2649,6 +2649,7 @@ void lustre_swab_quota_body(struct quota_body *b)
 	__swab64s(&b->qb_count);
 	__swab64s(&b->qb_usage);
 	__swab64s(&b->qb_slv_ver);
+	__swab64s(&b->qb_demand);
 }
 
 /* Dump functions */
@@ -1373,6 +1373,8 @@ void lustre_assert_wire_constants(void)
 		 OBD_CONNECT2_ENCRYPT);
 	LASSERTF(OBD_CONNECT2_FIDMAP== 0x10000ULL, "found 0x%.16llxULL\n",
 		 OBD_CONNECT2_FIDMAP);
+	LASSERTF(OBD_CONNECT2_OUT_BATCH == 0x20000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_OUT_BATCH);
 	LASSERTF(OBD_CKSUM_CRC32 == 0x00000001UL, "found 0x%.8xUL\n",
 		(unsigned)OBD_CKSUM_CRC32);
 	LASSERTF(OBD_CKSUM_ADLER == 0x00000002UL, "found 0x%.8xUL\n",
@@ -4444,10 +4446,14 @@ void lustre_assert_wire_constants(void)
 		 (long long)(int)offsetof(struct quota_body, qb_glb_lockh));
 	LASSERTF((int)sizeof(((struct quota_body *)0)->qb_glb_lockh) == 8, "found %lld\n",
 		 (long long)(int)sizeof(((struct quota_body *)0)->qb_glb_lockh));
-	LASSERTF((int)offsetof(struct quota_body, qb_padding1[4]) == 112, "found %lld\n",
-		 (long long)(int)offsetof(struct quota_body, qb_padding1[4]));
-	LASSERTF((int)sizeof(((struct quota_body *)0)->qb_padding1[4]) == 8, "found %lld\n",
-		 (long long)(int)sizeof(((struct quota_body *)0)->qb_padding1[4]));
+	LASSERTF((int)offsetof(struct quota_body, qb_demand) == 80, "found %lld\n",
+		 (long long)(int)offsetof(struct quota_body, qb_demand));
+	LASSERTF((int)sizeof(((struct quota_body *)0)->qb_demand) == 8, "found %lld\n",
+		 (long long)(int)sizeof(((struct quota_body *)0)->qb_demand));
+	LASSERTF((int)offsetof(struct quota_body, qb_padding1[3]) == 112, "found %lld\n",
+		 (long long)(int)offsetof(struct quota_body, qb_padding1[3]));
+	LASSERTF((int)sizeof(((struct quota_body *)0)->qb_padding1[3]) == 8, "found %lld\n",
+		 (long long)(int)sizeof(((struct quota_body *)0)->qb_padding1[3]));
 
 	/* Checks for struct mgs_target_info */
 	LASSERTF((int)sizeof(struct mgs_target_info) == 4544, "found %lld\n",
@@ -147,6 +147,19 @@ struct lquota_slv_entry {
 
 	/* when latest edquot set */
 	time64_t		lse_edquot_time;
+
+	/* consumption rate, in inodes or kbytes per second, averaged over
+	 * the latest sampling periods */
+	__u64			lse_rate;
+
+	/* space consumed since lse_rate_time, in inodes or kbytes */
+	__u64			lse_rate_space;
+
+	/* start of the current sampling period */
+	ktime_t			lse_rate_time;
+
+	/* when the master last granted nothing for our demand */
+	time64_t		lse_nodemand_time;
 };
 
 /* In-memory entry for each enforced quota id
@@ -255,6 +268,10 @@ struct lquota_site {
 #define lqe_acq_rc		u.se.lse_acq_rc
 #define lqe_acq_time		u.se.lse_acq_time
 #define lqe_edquot_time		u.se.lse_edquot_time
+#define lqe_rate		u.se.lse_rate
+#define lqe_rate_space		u.se.lse_rate_space
+#define lqe_rate_time		u.se.lse_rate_time
+#define lqe_nodemand_time	u.se.lse_nodemand_time
 
 #define LQUOTA_BUMP_VER 0x1
 #define LQUOTA_SET_VER  0x2
@@ -369,6 +386,10 @@ struct lquota_thread_info *lquota_info(const struct lu_env *env)
 #define req_is_rel(flags)    ((flags & QUOTA_DQACQ_FL_REL) != 0)
 #define req_has_rep(flags)   ((flags & QUOTA_DQACQ_FL_REPORT) != 0)
 
+/* A busy slave can pre-acquire up to that many qunits to cover its demand,
+ * see qsd_calc_demand() and qmt_alloc_demand() */
+#define LQUOTA_DEMAND_MAX_QUNITS	4
+
 /* debugging macros */
 #ifdef LIBCFS_DEBUG
 #define lquota_lqe_debug(msgdata, mask, cdls, lqe, fmt, a...) do {      \
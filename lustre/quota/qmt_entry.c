@@ -588,6 +588,32 @@ static __u64 qmt_calc_softlimit(struct lquota_entry *lqe, bool *oversoft)
 	}
 }
 
+/*
+ * Compute how much quota space can still be granted for an ID before the
+ * hard limit (or the soft limit when set) is reached.
+ */
+static __u64 qmt_lqe_remaining(struct lquota_entry *lqe)
+{
+	struct qmt_pool_info	*pool = lqe2qpi(lqe);
+	__u64			 remaining;
+
+	/* See comment in qmt_adjust_qunit(). LU-4139. */
+	if (lqe->lqe_softlimit != 0) {
+		bool oversoft;
+		remaining = qmt_calc_softlimit(lqe, &oversoft);
+		if (remaining == 0)
+			remaining = lqe->lqe_granted +
+				    pool->qpi_soft_least_qunit;
+	} else {
+		remaining = lqe->lqe_hardlimit;
+	}
+
+	if (lqe->lqe_granted >= remaining)
+		return 0;
+
+	return remaining - lqe->lqe_granted;
+}
+
 /*
  * Try to grant more quota space back to slave.
  *
@@ -610,22 +636,10 @@ __u64 qmt_alloc_expand(struct lquota_entry *lqe, __u64 granted, __u64 spare)
 	slv_cnt = qpi_slv_nr(lqe2qpi(lqe), lqe_qtype(lqe));
 	qunit = lqe->lqe_qunit;
 
-	/* See comment in qmt_adjust_qunit(). LU-4139. */
-	if (lqe->lqe_softlimit != 0) {
-		bool oversoft;
-		remaining = qmt_calc_softlimit(lqe, &oversoft);
-		if (remaining == 0)
-			remaining = lqe->lqe_granted +
-				    pool->qpi_soft_least_qunit;
-	} else {
-		remaining = lqe->lqe_hardlimit;
-	}
-
-	if (lqe->lqe_granted >= remaining)
+	remaining = qmt_lqe_remaining(lqe);
+	if (remaining == 0)
 		RETURN(0);
 
-	remaining -= lqe->lqe_granted;
-
 	do {
 		if (spare >= qunit)
 			break;
@@ -651,6 +665,41 @@ __u64 qmt_alloc_expand(struct lquota_entry *lqe, __u64 granted, __u64 spare)
 	RETURN(0);
 }
 
+/*
+ * Grant quota space to a slave consuming it quickly, beyond what
+ * qmt_alloc_expand() would grant, so that it does not have to stall on
+ * the master again soon. One qunit per slave is always left for the
+ * other slaves.
+ *
+ * \param lqe    - is the quota entry for which we would like to allocate more
+ *                 space
+ * \param spare  - is how much unused quota space the slave already owns
+ * \param demand - is how much spare space the slave expects to consume
+ *                 before its next pre-acquire
+ *
+ * \retval return how much additional space can be granted to the slave
+ */
+__u64 qmt_alloc_demand(struct lquota_entry *lqe, __u64 spare, __u64 demand)
+{
+	__u64	remaining, reserve;
+	int	slv_cnt;
+
+	LASSERT(lqe->lqe_enforced && lqe->lqe_qunit != 0);
+
+	demand = min_t(__u64, demand,
+		       LQUOTA_DEMAND_MAX_QUNITS * lqe->lqe_qunit);
+	if (spare >= demand)
+		return 0;
+
+	remaining = qmt_lqe_remaining(lqe);
+	slv_cnt = qpi_slv_nr(lqe2qpi(lqe), lqe_qtype(lqe));
+	reserve = slv_cnt * lqe->lqe_qunit;
+	if (remaining <= reserve)
+		return 0;
+
+	return min_t(__u64, demand - spare, remaining - reserve);
+}
+
 /*
  * Adjust qunit size according to quota limits and total granted count.
  * The caller must have locked the lqe.
@@ -574,6 +574,30 @@ static inline __u64 qmt_lqes_alloc_expand(const struct lu_env *env,
 	return min_count;
 }
 
+static inline __u64 qmt_lqes_alloc_demand(const struct lu_env *env,
+					  __u64 spare, __u64 demand)
+{
+	__u64 min_count, tmp;
+	bool flag = false;
+	int i;
+
+	for (i = 0, min_count = 0; i < qti_lqes_cnt(env); i++) {
+		/* see qmt_lqes_alloc_expand() */
+		if (!qti_lqes(env)[i]->lqe_enforced &&
+		    !qti_lqes(env)[i]->lqe_is_global)
+			continue;
+
+		tmp = qmt_alloc_demand(qti_lqes(env)[i], spare, demand);
+		if (flag) {
+			min_count = tmp < min_count ? tmp : min_count;
+		} else {
+			flag = true;
+			min_count = tmp;
+		}
+	}
+	return min_count;
+}
+
 static inline void qmt_lqes_tune_grace(const struct lu_env *env, __u64 now)
 {
 	int i;
@@ -607,6 +631,8 @@ static inline void qmt_lqes_tune_grace(const struct lu_env *env, __u64 now)
  * \param qb_count - is the amount of quota space the slave wants to
  *                   acquire/release
  * \param qb_usage - is the current space usage on the slave
+ * \param qb_demand - is how much spare space a pre-acquiring slave expects
+ *                    to consume soon, 0 if unknown
  * \param repbody - is the quota_body of reply
  *
  * \retval 0            : success
@@ -616,7 +642,7 @@ static inline void qmt_lqes_tune_grace(const struct lu_env *env, __u64 now)
  */
 int qmt_dqacq0(const struct lu_env *env, struct qmt_device *qmt,
 	       struct obd_uuid *uuid, __u32 qb_flags, __u64 qb_count,
-	       __u64 qb_usage, struct quota_body *repbody)
+	       __u64 qb_usage, __u64 qb_demand, struct quota_body *repbody)
 {
 	__u64			 now, count;
 	struct dt_object	*slv_obj = NULL;
@@ -658,8 +684,8 @@ int qmt_dqacq0(const struct lu_env *env, struct qmt_device *qmt,
 	qti_lqes_write_lock(env);
 
 	LQUOTA_DEBUG_LQES(env, "dqacq starts uuid:%s flags:0x%x wanted:%llu"
-		     " usage:%llu", obd_uuid2str(uuid), qb_flags, qb_count,
-		     qb_usage);
+		     " usage:%llu demand:%llu", obd_uuid2str(uuid), qb_flags,
+		     qb_count, qb_usage, qb_demand);
 
 	/* Legal race, limits have been removed on master, but slave didn't
 	 * receive the change yet. Just return EINPROGRESS until the slave gets
@@ -732,14 +758,24 @@ int qmt_dqacq0(const struct lu_env *env, struct qmt_device *qmt,
 		/* slave would like to pre-acquire quota space. To do so, it
 		 * reports in qb_count how much spare quota space it owns and we
 		 * can grant back quota space which is consistent with qunit
-		 * value. */
-		if (qb_count >= qti_lqes_min_qunit(env))
+		 * value. A slave consuming its space quickly also reports in
+		 * qb_demand how much it expects to need, which can be granted
+		 * beyond qunit as long as the other slaves can get a qunit. */
+		if (qb_count >= qti_lqes_min_qunit(env) &&
+		    qb_demand <= qb_count)
 			/* slave already own the maximum it should */
 			GOTO(out_write, rc = 0);
 
 		count = qmt_lqes_alloc_expand(env, slv_granted, qb_count);
-		if (count == 0)
-			GOTO(out_write, rc = -EDQUOT);
+		if (qb_demand > qb_count + count)
+			count = max(count, qmt_lqes_alloc_demand(env, qb_count,
+								 qb_demand));
+		if (count == 0) {
+			/* no more space for the demand is not an error when
+			 * the slave already owns a qunit */
+			rc = qb_count >= qti_lqes_min_qunit(env) ? 0 : -EDQUOT;
+			GOTO(out_write, rc);
+		}
 
 		repbody->qb_count += count;
 		qmt_grant_lqes(env, &slv_granted, count);
@@ -982,7 +1018,8 @@ static int qmt_dqacq(const struct lu_env *env, struct lu_device *ld,
 		RETURN(rc);
 
 	rc = qmt_dqacq0(env, qmt, uuid, qbody->qb_flags,
-			qbody->qb_count, qbody->qb_usage, repbody);
+			qbody->qb_count, qbody->qb_usage, qbody->qb_demand,
+			repbody);
 
 	if (lustre_handle_is_used(&qbody->qb_lockh))
 		/* return current qunit value only to slaves owning an per-ID
@@ -493,6 +493,7 @@ bool qmt_adjust_edquot_qunit_notify(const struct lu_env *, struct qmt_device *,
 bool qmt_revalidate(const struct lu_env *, struct lquota_entry *);
 void qmt_revalidate_lqes(const struct lu_env *, struct qmt_device *, __u32);
 __u64 qmt_alloc_expand(struct lquota_entry *, __u64, __u64);
+__u64 qmt_alloc_demand(struct lquota_entry *, __u64, __u64);
 
 void qti_lqes_init(const struct lu_env *env);
 int qti_lqes_add(const struct lu_env *env, struct lquota_entry *lqe);
@@ -523,7 +524,7 @@ int qmt_set_with_lqe(const struct lu_env *env, struct qmt_device *qmt,
 		     struct lquota_entry *lqe, __u64 hard, __u64 soft,
 		     __u64 time, __u32 valid, bool is_default, bool is_updated);
 int qmt_dqacq0(const struct lu_env *, struct qmt_device *, struct obd_uuid *,
-	       __u32, __u64, __u64, struct quota_body *);
+	       __u32, __u64, __u64, __u64, struct quota_body *);
 int qmt_uuid2idx(struct obd_uuid *, int *);
 
 /* qmt_lock.c */
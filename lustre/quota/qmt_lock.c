@@ -126,7 +126,8 @@ int qmt_intent_policy(const struct lu_env *env, struct lu_device *ld,
 		/* acquire quota space */
 		rc = qmt_dqacq0(env, qmt, uuid,
 				reqbody->qb_flags, reqbody->qb_count,
-				reqbody->qb_usage, repbody);
+				reqbody->qb_usage, reqbody->qb_demand,
+				repbody);
 		lqe_putref(lqe);
 		qti_lqes_fini(env);
 		if (rc)
@@ -409,7 +410,7 @@ int qmt_lvbo_update(struct lu_device *ld, struct ldlm_resource *res,
 		/* release quota space */
 		rc = qmt_dqacq0(env, qmt, &exp->exp_client_uuid,
 				QUOTA_DQACQ_FL_REL, lvb->lvb_id_rel,
-				0, &qti->qti_body);
+				0, 0, &qti->qti_body);
 		if (rc || qti->qti_body.qb_count != lvb->lvb_id_rel)
 			LQUOTA_ERROR(lqe,
 				     "failed to release quota space on glimpse %llu!=%llu : rc = %d\n",
@@ -142,6 +142,72 @@ static int qsd_ready(struct lquota_entry *lqe, struct lustre_handle *lockh)
 	RETURN(0);
 }
 
+/* the consumption rate is sampled over periods of at least one second */
+#define QSD_RATE_PERIOD_MS	MSEC_PER_SEC
+/* and is forgotten after that many seconds without any operation */
+#define QSD_RATE_IDLE		10
+
+/**
+ * Account \a space consumed by an operation in the consumption rate of \a lqe.
+ * The rate is averaged with the previous one at the end of each sampling
+ * period, so that pre-acquire follows a burst of writes within a couple of
+ * seconds. Called with the lqe write lock held.
+ */
+static void qsd_update_rate(struct lquota_entry *lqe, __u64 space)
+{
+	ktime_t	now = ktime_get();
+	s64	elapsed;
+	__u64	rate;
+
+	elapsed = ktime_ms_delta(now, lqe->lqe_rate_time);
+	if (elapsed > QSD_RATE_IDLE * MSEC_PER_SEC) {
+		/* first operation after a while, start sampling again */
+		lqe->lqe_rate = 0;
+		lqe->lqe_rate_space = space;
+		lqe->lqe_rate_time = now;
+		return;
+	}
+
+	lqe->lqe_rate_space += space;
+	if (elapsed < QSD_RATE_PERIOD_MS)
+		return;
+
+	rate = div64_u64(lqe->lqe_rate_space * MSEC_PER_SEC, elapsed);
+	lqe->lqe_rate = lqe->lqe_rate == 0 ? rate : (lqe->lqe_rate + rate) / 2;
+	lqe->lqe_rate_space = 0;
+	lqe->lqe_rate_time = now;
+}
+
+/**
+ * Compute how much quota space \a lqe is expected to consume within the
+ * pre-acquire horizon, given its consumption rate. This is capped to a few
+ * qunits, so that the master still controls how much space the slaves own by
+ * shrinking qunit.
+ *
+ * \param lqe - is the lquota entry, locked by the caller
+ *
+ * \retval how much space to pre-acquire, 0 if no more than qtune
+ */
+static __u64 qsd_calc_demand(struct lquota_entry *lqe)
+{
+	int horizon = lqe2qqi(lqe)->qqi_qsd->qsd_preacq_horizon;
+
+	if (horizon <= 0 || lqe->lqe_qunit == 0 || lqe->lqe_rate == 0)
+		return 0;
+
+	/* rate is stale */
+	if (ktime_ms_delta(ktime_get(), lqe->lqe_rate_time) >
+	    QSD_RATE_IDLE * MSEC_PER_SEC)
+		return 0;
+
+	/* master recently could not grant anything for our demand */
+	if (lqe->lqe_nodemand_time > ktime_get_seconds() - QSD_RATE_IDLE)
+		return 0;
+
+	return min_t(__u64, lqe->lqe_rate * horizon,
+		     LQUOTA_DEMAND_MAX_QUNITS * lqe->lqe_qunit);
+}
+
 /**
  * Check whether any quota space adjustment (pre-acquire/release/report) is
  * needed for a given quota ID. If a non-null \a qbody is passed, then the
@@ -158,7 +224,7 @@ static int qsd_ready(struct lquota_entry *lqe, struct lustre_handle *lockh)
  */
 static bool qsd_calc_adjust(struct lquota_entry *lqe, struct quota_body *qbody)
 {
-	__u64	usage, granted;
+	__u64	usage, granted, demand, keep;
 	ENTRY;
 
 	usage   = lqe->lqe_usage;
@@ -232,17 +298,21 @@ static bool qsd_calc_adjust(struct lquota_entry *lqe, struct quota_body *qbody)
 
 	/* valid per-ID lock
 	 * Apply good old quota qunit adjustment logic which has been around
-	 * since lustre 1.4:
+	 * since lustre 1.4, except that a busy ID keeps and pre-acquires
+	 * enough space to cover its demand:
 	 * 1. release spare quota space? */
-	if (granted > usage + lqe->lqe_qunit) {
+	demand = qsd_calc_demand(lqe);
+	keep = max(lqe->lqe_qunit, demand);
+	if (granted > usage + keep) {
 		/* pre-release quota space */
 		if (qbody == NULL)
 			RETURN(true);
 		qbody->qb_count = granted - usage;
 		/* if usage == 0, release all granted space */
 		if (usage) {
-			/* try to keep one qunit of quota space */
-			qbody->qb_count -= lqe->lqe_qunit;
+			/* try to keep one qunit of quota space, or our
+			 * demand */
+			qbody->qb_count -= keep;
 			/* but don't release less than qtune to avoid releasing
 			 * space too often */
 			if (qbody->qb_count < lqe->lqe_qtune)
@@ -265,7 +335,8 @@ static bool qsd_calc_adjust(struct lquota_entry *lqe, struct quota_body *qbody)
 
 	/* 3. Time to pre-acquire? */
 	if (!lqe->lqe_edquot && !lqe->lqe_nopreacq && usage > 0 &&
-	    lqe->lqe_qunit != 0 && granted < usage + lqe->lqe_qtune) {
+	    lqe->lqe_qunit != 0 &&
+	    granted < usage + max(lqe->lqe_qtune, demand)) {
 		/* To pre-acquire quota space, we report how much spare quota
 		 * space the slave currently owns, then the master will grant us
 		 * back how much we can pretend given the current state of
@@ -277,6 +348,8 @@ static bool qsd_calc_adjust(struct lquota_entry *lqe, struct quota_body *qbody)
 		else
 			qbody->qb_count = granted - usage;
 		qbody->qb_flags |= QUOTA_DQACQ_FL_PREACQ;
+		/* and how much we would like to own */
+		qbody->qb_demand = demand;
 		RETURN(true);
 	}
 
@@ -398,6 +471,12 @@ static void qsd_req_completion(const struct lu_env *env,
 	 * on again as soon as qunit is modified */
 	if (req_is_preacq(reqbody->qb_flags) && ret == -EDQUOT)
 		lqe->lqe_nopreacq = true;
+
+	/* stop asking for our demand for a while if the master can't afford
+	 * it, otherwise the adjustment below would send the same request */
+	if (req_is_preacq(reqbody->qb_flags) && reqbody->qb_demand != 0 &&
+	    (repbody == NULL || repbody->qb_count == 0))
+		lqe->lqe_nodemand_time = ktime_get_seconds();
 out:
 	adjust = qsd_adjust_needed(lqe);
 	if (reqbody && req_is_acq(reqbody->qb_flags) && ret != -EDQUOT) {
@@ -622,13 +701,14 @@ static int qsd_acquire_remote(const struct lu_env *env,
  * \param lqe   - is the qid entry to be processed
  * \param space - is the amount of quota required for the operation
  * \param ret   - is the return code (-EDQUOT, -EINPROGRESS, ...)
+ * \param remote - set if the operation had to wait for the master
  *
  * \retval true  - stop waiting in wait_event_idle_timeout,
  *                 and real return value in \a ret
  * \retval false - continue waiting
  */
 static bool qsd_acquire(const struct lu_env *env, struct lquota_entry *lqe,
-			long long space, int *ret)
+			long long space, int *ret, bool *remote)
 {
 	int rc = 0, count;
 	ENTRY;
@@ -659,6 +739,7 @@ static bool qsd_acquire(const struct lu_env *env, struct lquota_entry *lqe,
 			schedule_timeout_interruptible(cfs_time_seconds(1));
 
 		/* need to acquire more quota space from master */
+		*remote = true;
 		rc = qsd_acquire_remote(env, lqe);
 	}
 
@@ -694,6 +775,8 @@ static int qsd_op_begin0(const struct lu_env *env, struct qsd_qtype_info *qqi,
 {
 	struct lquota_entry *lqe;
 	enum osd_quota_local_flags qtype_flag = 0;
+	bool remote = false;
+	ktime_t start;
 	int rc, ret = -EINPROGRESS;
 	ENTRY;
 
@@ -731,13 +814,18 @@ static int qsd_op_begin0(const struct lu_env *env, struct qsd_qtype_info *qqi,
 
 	lqe_write_lock(lqe);
 	lqe->lqe_waiting_write += space;
+	qsd_update_rate(lqe, space);
 	lqe_write_unlock(lqe);
 
 	/* acquire quota space for the operation, cap overall wait time to
 	 * prevent a service thread from being stuck for too long */
+	start = ktime_get();
 	rc = wait_event_idle_timeout(
-		lqe->lqe_waiters, qsd_acquire(env, lqe, space, &ret),
+		lqe->lqe_waiters, qsd_acquire(env, lqe, space, &ret, &remote),
 		cfs_time_seconds(qsd_wait_timeout(qqi->qqi_qsd)));
+	if (remote)
+		lprocfs_oh_tally_log2(&qqi->qqi_stall_hist,
+				      ktime_us_delta(ktime_get(), start));
 
 	if (rc > 0 && ret == 0) {
 		qid->lqi_space += space;
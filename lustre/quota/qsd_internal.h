@@ -106,6 +106,10 @@ struct qsd_instance {
 	 * enforced here (via procfs) */
 	int			 qsd_timeout;
 
+	/* how far ahead, in seconds, quota space is pre-acquired based on the
+	 * consumption rate of each ID, 0 to only pre-acquire qtune */
+	int			 qsd_preacq_horizon;
+
 	unsigned long		qsd_is_md:1,    /* managing quota for mdt */
 				qsd_started:1,  /* instance is now started */
 				qsd_prepared:1, /* qsd_prepare() successfully
@@ -160,6 +164,9 @@ struct qsd_qtype_info {
 	/* statistics on operations performed by this slave */
 	struct lprocfs_stats	*qqi_stats;
 
+	/* time operations waited for quota space from the master, in usec */
+	struct obd_histogram	 qqi_stall_hist;
+
 	/* deferred update for the global index copy */
 	struct list_head	 qqi_deferred_glb;
 	/* deferred update for the slave index copy */
@@ -323,6 +330,9 @@ static inline void qsd_set_edquot(struct lquota_entry *lqe, bool edquot)
 
 #define QSD_WB_INTERVAL	60 /* 60 seconds */
 
+/* default qsd_preacq_horizon, in seconds */
+#define QSD_PREACQ_HORIZON	2
+
 /* helper function calculating how long a service thread should be waiting for
  * quota space */
 static inline int qsd_wait_timeout(struct qsd_instance *qsd)
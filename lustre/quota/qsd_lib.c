@@ -267,6 +267,105 @@ qsd_timeout_seq_write(struct file *file, const char __user *buffer,
 }
 LPROC_SEQ_FOPS(qsd_timeout);
 
+static int qsd_preacq_horizon_seq_show(struct seq_file *m, void *data)
+{
+	struct qsd_instance *qsd = m->private;
+	LASSERT(qsd != NULL);
+
+	seq_printf(m, "%d\n", qsd->qsd_preacq_horizon);
+	return 0;
+}
+
+static ssize_t
+qsd_preacq_horizon_seq_write(struct file *file, const char __user *buffer,
+			     size_t count, loff_t *off)
+{
+	struct seq_file *m = file->private_data;
+	struct qsd_instance *qsd = m->private;
+	int horizon;
+	int rc;
+
+	LASSERT(qsd != NULL);
+	rc = kstrtoint_from_user(buffer, count, 0, &horizon);
+	if (rc)
+		return rc;
+
+	if (horizon < 0)
+		return -EINVAL;
+
+	qsd->qsd_preacq_horizon = horizon;
+	return count;
+}
+LPROC_SEQ_FOPS(qsd_preacq_horizon);
+
+/*
+ * Histograms (log2, bucket upper bounds in usec) of the time operations
+ * waited for quota space to be acquired from the master, per quota type.
+ */
+static int qsd_stall_stats_seq_show(struct seq_file *m, void *data)
+{
+	struct qsd_instance *qsd = m->private;
+	struct timespec64 now;
+	int qtype;
+
+	LASSERT(qsd != NULL);
+
+	ktime_get_real_ts64(&now);
+	seq_printf(m, "stall_stats:\n");
+	seq_printf(m, "- %-15s %llu.%9lu\n", "snapshot_time:",
+		   (s64)now.tv_sec, now.tv_nsec);
+
+	if (!qsd->qsd_prepared)
+		return 0;
+
+	for (qtype = USRQUOTA; qtype < LL_MAXQUOTAS; qtype++) {
+		struct obd_histogram *hist;
+		unsigned long tot, t, cum = 0;
+		int i;
+
+		hist = &qsd->qsd_type_array[qtype]->qqi_stall_hist;
+		tot = lprocfs_oh_sum(hist);
+		if (tot == 0)
+			continue;
+
+		seq_printf(m, "- %-15s\n", qtype_name(qtype));
+		for (i = 0; i < OBD_HIST_MAX; i++) {
+			t = hist->oh_buckets[i];
+			cum += t;
+			if (cum == 0)
+				continue;
+
+			seq_printf(m, "%6s%lu: { sample: %3lu, pct: %3u, cum_pct: %3u }\n",
+				   " ", 1UL << i, t, pct(t, tot),
+				   pct(cum, tot));
+			if (cum == tot)
+				break;
+		}
+	}
+
+	return 0;
+}
+
+static ssize_t
+qsd_stall_stats_seq_write(struct file *file, const char __user *buffer,
+			  size_t count, loff_t *off)
+{
+	struct seq_file *m = file->private_data;
+	struct qsd_instance *qsd = m->private;
+	int qtype;
+
+	LASSERT(qsd != NULL);
+
+	if (!qsd->qsd_prepared)
+		return count;
+
+	for (qtype = USRQUOTA; qtype < LL_MAXQUOTAS; qtype++)
+		lprocfs_oh_clear(&qsd->qsd_type_array[qtype]->qqi_stall_hist);
+
+	return count;
+}
+LPROC_SEQ_FOPS(qsd_stall_stats);
+
 static struct lprocfs_vars lprocfs_quota_qsd_vars[] = {
 	{ .name	=	"info",
 	  .fops	=	&qsd_state_fops		},
@@ -276,6 +375,10 @@ static struct lprocfs_vars lprocfs_quota_qsd_vars[] = {
 	  .fops	=	&qsd_force_reint_fops	},
 	{ .name	=	"timeout",
 	  .fops	=	&qsd_timeout_fops	},
+	{ .name	=	"preacq_horizon",
+	  .fops	=	&qsd_preacq_horizon_fops	},
+	{ .name	=	"stall_stats",
+	  .fops	=	&qsd_stall_stats_fops	},
 	{ NULL }
 };
 
@@ -483,6 +586,7 @@ static int qsd_qtype_init(const struct lu_env *env, struct qsd_instance *qsd,
 	qqi->qqi_reint        = false;
 	INIT_LIST_HEAD(&qqi->qqi_deferred_glb);
 	INIT_LIST_HEAD(&qqi->qqi_deferred_slv);
+	spin_lock_init(&qqi->qqi_stall_hist.oh_lock);
 	lquota_generate_fid(&qqi->qqi_fid, QSD_RES_TYPE(qsd), qtype);
 
 	/* open accounting object */
@@ -677,6 +781,7 @@ struct qsd_instance *qsd_init(const struct lu_env *env, char *svname,
 	qsd->qsd_prepared = false;
 	qsd->qsd_started = false;
 	qsd->qsd_is_md = is_md;
+	qsd->qsd_preacq_horizon = QSD_PREACQ_HORIZON;
 
 	/* copy service name */
 	if (strlcpy(qsd->qsd_svname, svname, sizeof(qsd->qsd_svname))
@@ -64,39 +64,70 @@ typedef void (*out_reconstruct_t)(const struct lu_env *env,
 				  struct object_update_reply *reply,
 				  int index);
 
+/**
+ * Check whether an update of a resent OUT RPC was executed
+ *
+ * An OUT RPC may carry the updates of several transactions, see
+ * osp_update_batch_collect(). They are executed one after the other in
+ * the batch ID order, and each one records its batch ID in lcd_last_data
+ * with its transno and result, see out_handle(). So the updates of the
+ * transactions before the recorded one were executed successfully, the
+ * updates of the recorded one get its result, and the updates of the
+ * following ones were not executed: they are executed now, unless the
+ * recorded transaction failed, since the handling stops at the first
+ * failed transaction.
+ *
+ * \param[in] batchid	batch ID of the update
+ *
+ * \retval		0 if the update has to be executed
+ * \retval		1 if the reply of the update is rebuilt
+ * \retval		negative errno of the failed transaction if the update
+ *			must not be executed
+ */
 static inline int out_check_resent(const struct lu_env *env,
 				   struct dt_device *dt,
 				   struct dt_object *obj,
 				   struct ptlrpc_request *req,
 				   out_reconstruct_t reconstruct,
 				   struct object_update_reply *reply,
-				   int index)
+				   int index, __u64 batchid)
 {
+	struct lsd_client_data *lcd;
+	int result;
+
 	if (likely(!(lustre_msg_get_flags(req->rq_reqmsg) & MSG_RESENT)))
 		return 0;
 
-	if (req_xid_is_last(req)) {
-		struct lsd_client_data *lcd;
+	lcd = req->rq_export->exp_target_data.ted_lcd;
+	if (!req_xid_is_last(req)) {
+		DEBUG_REQ(D_HA, req, "no reply for RESENT req (have %lld)",
+			  lcd->lcd_last_xid);
+		return 0;
+	}
 
-		/* XXX this does not support mulitple transactions yet, i.e.
-		 * only 1 update RPC each time betwee MDTs */
-		lcd = req->rq_export->exp_target_data.ted_lcd;
+	result = (int)lcd->lcd_last_result;
+	if (batchid > lcd->lcd_last_data) {
+		DEBUG_REQ(D_RPCTRACE, req,
+			  "transaction %llu of resent RPC not executed (last %u): rc = %d",
+			  batchid, lcd->lcd_last_data, result);
+		return result;
+	}
 
-		req->rq_transno = lcd->lcd_last_transno;
-		req->rq_status = lcd->lcd_last_result;
-		if (req->rq_status != 0)
-			req->rq_transno = 0;
-		lustre_msg_set_transno(req->rq_repmsg, req->rq_transno);
-		lustre_msg_set_status(req->rq_repmsg, req->rq_status);
+	req->rq_transno = lcd->lcd_last_transno;
+	req->rq_status = result;
+	if (req->rq_status != 0)
+		req->rq_transno = 0;
+	lustre_msg_set_transno(req->rq_repmsg, req->rq_transno);
+	lustre_msg_set_status(req->rq_repmsg, req->rq_status);
 
-		DEBUG_REQ(D_RPCTRACE, req, "restoring resent RPC");
+	DEBUG_REQ(D_RPCTRACE, req, "restoring resent RPC transaction %llu/%u",
+		  batchid, lcd->lcd_last_data);
 
+	if (batchid == lcd->lcd_last_data && result != 0)
+		object_update_result_insert(reply, NULL, 0, index, result);
+	else
 		reconstruct(env, dt, obj, reply, index);
-		return 1;
-	}
-	DEBUG_REQ(D_HA, req, "no reply for RESENT req (have %lld)",
-		 req->rq_export->exp_target_data.ted_lcd->lcd_last_xid);
-	return 0;
+	return 1;
 }
 
 static int out_create(struct tgt_session_info *tsi)
@@ -966,6 +997,7 @@ int out_handle(struct tgt_session_info *tsi)
 	struct ptlrpc_bulk_desc		*desc = NULL;
 	void				**update_bufs;
 	int				current_batchid = -1;
+	bool				batched = false;
 	__u32				update_buf_count;
 	unsigned int			i;
 	unsigned int			reply_index = 0;
@@ -1073,6 +1105,8 @@ int out_handle(struct tgt_session_info *tsi)
 				GOTO(out, rc = err_serious(-EPROTO));
 			if (ptlrpc_req_need_swab(pill->rc_req))
 				lustre_swab_object_update(update);
+			if (update->ou_batchid != 0)
+				batched = true;
 
 			if (!fid_is_sane(&update->ou_fid)) {
 				CERROR("%s: invalid FID "DFID": rc = %d\n",
@@ -1164,10 +1198,12 @@ int out_handle(struct tgt_session_info *tsi)
 			if (h->th_flags & IS_MUTABLE) {
 				struct ptlrpc_request *req = tgt_ses_req(tsi);
 
-				if (out_check_resent(env, dt, dt_obj, req,
-						     out_reconstruct, reply,
-						     reply_index))
-					GOTO(next, rc = 0);
+				rc = out_check_resent(env, dt, dt_obj, req,
+						      out_reconstruct, reply,
+						      reply_index,
+						      update->ou_batchid);
+				if (rc != 0)
+					GOTO(next, rc = min(rc, 0));
 
 				if (dt->dd_rdonly)
 					GOTO(next, rc = -EROFS);
@@ -1182,6 +1218,8 @@ int out_handle(struct tgt_session_info *tsi)
 
 				if (update->ou_flags & UPDATE_FL_SYNC)
 					ta->ta_handle->th_sync = 1;
+				/* recorded in last_rcvd for out_check_resent() */
+				tsi->tsi_opdata = current_batchid;
 			}
 
 			/* Stop the current update transaction, if the update
@@ -1203,6 +1241,7 @@ int out_handle(struct tgt_session_info *tsi)
 					if (update->ou_flags & UPDATE_FL_SYNC)
 						ta->ta_handle->th_sync = 1;
 					current_batchid = update->ou_batchid;
+					tsi->tsi_opdata = current_batchid;
 				}
 			}
 
@@ -1221,6 +1260,10 @@ out:
 			rc = rc1;
 	}
 
+	/* drop the reply of an RPC which executed several transactions */
+	if (batched && OBD_FAIL_PRECHECK(OBD_FAIL_OUT_BATCH_NET_REP))
+		tsi->tsi_reply_fail_id = OBD_FAIL_OUT_BATCH_NET_REP;
+
 out_free:
 	if (update_bufs != NULL) {
 		if (oub != NULL) {
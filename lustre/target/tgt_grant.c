@@ -81,6 +81,54 @@
 /* Clients typically hold 2x their max_rpcs_in_flight of grant space */
 #define TGT_GRANT_SHRINK_LIMIT(exp)	(2ULL * 8 * exp_max_brw_size(exp))
 
+/* Exports which did not write for that many seconds are considered idle */
+#define TGT_GRANT_IDLE_AGE		30
+/* Active writers are granted enough space for that many seconds of writes */
+#define TGT_GRANT_PREDICT_SECS		2
+
+/**
+ * Update the recent write rate of an export.
+ *
+ * Bytes written are accumulated per second and folded into a decaying
+ * average on the first write of each new second. The rate of an export
+ * which did not write for TGT_GRANT_IDLE_AGE seconds is reset.
+ * Caller must hold tgd_grant_lock spinlock.
+ *
+ * \param[in] ted	target export data of the writing client
+ * \param[in] bytes	grant space consumed by the write
+ */
+static void tgt_grant_update_rate(struct tg_export_data *ted, u64 bytes)
+{
+	time64_t now = ktime_get_seconds();
+	time64_t age = now - ted->ted_write_time;
+
+	if (age > 0) {
+		if (age > TGT_GRANT_IDLE_AGE)
+			ted->ted_write_rate = 0;
+		else
+			ted->ted_write_rate = (ted->ted_write_rate +
+				div64_u64(ted->ted_write_bytes, age)) / 2;
+		ted->ted_write_bytes = 0;
+		ted->ted_write_time = now;
+	}
+	ted->ted_write_bytes += bytes;
+}
+
+static inline bool tgt_grant_export_idle(struct tg_export_data *ted)
+{
+	return ktime_get_seconds() - ted->ted_write_time > TGT_GRANT_IDLE_AGE;
+}
+
+/* Grant space an export is expected to consume in the near future */
+static inline u64 tgt_grant_predict(struct tg_export_data *ted)
+{
+	if (tgt_grant_export_idle(ted))
+		return 0;
+
+	return max(ted->ted_write_rate, ted->ted_write_bytes) *
+	       TGT_GRANT_PREDICT_SECS;
+}
+
 /* Helpers to inflate/deflate grants for clients that do not support the grant
  * parameters */
 static inline u64 tgt_grant_inflate(struct tg_grants_data *tgd, u64 val)
@@ -599,8 +647,11 @@ static void tgt_grant_shrink(struct obd_export *exp, struct obdo *oa,
 
 	assert_spin_locked(&tgd->tgd_grant_lock);
 	LASSERT(exp);
+	/* Always take grant back from idle exports, so that it can be handed
+	 * out to active writers instead of pushing them to sync writes. */
 	if (left_space >= tgd->tgd_tot_granted_clients *
-			  TGT_GRANT_SHRINK_LIMIT(exp))
+			  TGT_GRANT_SHRINK_LIMIT(exp) &&
+	    !tgt_grant_export_idle(ted))
 		return;
 
 	grant_shrink = oa->o_grant;
@@ -717,6 +768,8 @@ static void tgt_grant_check(const struct lu_env *env, struct obd_export *exp,
 	unsigned long		 granted = 0;
 	int			 i;
 	bool			 skip = false;
+	bool			 resend = false;
+	bool			 sync_write = false;
 
 	ENTRY;
 
@@ -729,12 +782,14 @@ static void tgt_grant_check(const struct lu_env *env, struct obd_export *exp,
 		 * replayed. If one page hasn't OBD_BRW_FROM_GRANT set, then
 		 * the whole bulk is written synchronously */
 		skip = true;
+		resend = true;
 		CDEBUG(D_CACHE, "Replaying write, skipping accounting\n");
 	} else if ((oa->o_valid & OBD_MD_FLFLAGS) &&
 		   (oa->o_flags & OBD_FL_RECOV_RESEND)) {
 		/* Recoverable resend, grant info have already been processed as
 		 * well */
 		skip = true;
+		resend = true;
 		CDEBUG(D_CACHE, "Recoverable resend arrived, skipping "
 				"accounting\n");
 	} else if (exp_grant_param_supp(exp) && oa->o_grant_used > 0) {
@@ -794,6 +849,12 @@ static void tgt_grant_check(const struct lu_env *env, struct obd_export *exp,
 			       "real grant %lu idx %d\n", obd->obd_name,
 			       exp->exp_client_uuid.uuid, exp, granted, bytes,
 			       ted->ted_grant, i);
+		} else if (!(rnb[i].rnb_flags &
+			     (OBD_BRW_NOCACHE | OBD_BRW_SRVLOCK))) {
+			/* a cached page is only sent without grant when the
+			 * client was refused grant for it and fell back to
+			 * sync I/O, unlike direct and lockless I/O */
+			sync_write = true;
 		}
 
 		if (obd->obd_recovering)
@@ -832,6 +893,13 @@ static void tgt_grant_check(const struct lu_env *env, struct obd_export *exp,
 	 * used later in tgt_grant_commmit() */
 	oa->o_grant_used = granted + ungranted;
 
+	if (!resend) {
+		tgd->tgd_tot_write_rpcs++;
+		if (sync_write)
+			tgd->tgd_tot_sync_write_rpcs++;
+		tgt_grant_update_rate(ted, oa->o_grant_used);
+	}
+
 	/* record space used for the I/O, will be used in tgt_grant_commmit() */
 	/* Now substract what the clients has used already.  We don't subtract
 	 * this from the tot_granted yet, so that other client's can't grab
@@ -944,9 +1012,12 @@ static long tgt_grant_alloc(struct obd_export *exp, u64 curgrant,
 	if (!grant)
 		RETURN(0);
 
-	/* Limit to grant_chunk if not reconnect/recovery */
+	/* Limit to grant_chunk if not reconnect/recovery, unless the export
+	 * writes fast enough to consume more than that before its next RPC,
+	 * in which case it gets enough for its predicted needs */
 	if ((grant > chunk) && conservative)
-		grant = chunk;
+		grant = min_t(u64, grant,
+			      max_t(u64, chunk, tgt_grant_predict(ted)));
 
 	/*
 	 * Limit grant so that export' grant does not exceed what the
@@ -1611,6 +1682,53 @@ ssize_t tot_pending_show(struct kobject *kobj, struct attribute *attr,
 }
 EXPORT_SYMBOL(tot_pending_show);
 
+/**
+ * Show number of bulk write RPCs processed.
+ *
+ * @kobj		kobject embedded in obd_device
+ * @attr		unused
+ * @buf			buf used by sysfs to print out data
+ *
+ * Return:		0 on success
+ *			negative value on error
+ */
+ssize_t tot_write_rpcs_show(struct kobject *kobj, struct attribute *attr,
+			    char *buf)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	struct tg_grants_data *tgd;
+
+	tgd = &obd->u.obt.obt_lut->lut_tgd;
+	return scnprintf(buf, PAGE_SIZE, "%llu\n", tgd->tgd_tot_write_rpcs);
+}
+EXPORT_SYMBOL(tot_write_rpcs_show);
+
+/**
+ * Show number of bulk write RPCs sent synchronously because the client did
+ * not hold enough grant. Compared with tot_write_rpcs, this gives the
+ * fraction of writes which missed the client writeback cache.
+ *
+ * @kobj		kobject embedded in obd_device
+ * @attr		unused
+ * @buf			buf used by sysfs to print out data
+ *
+ * Return:		0 on success
+ *			negative value on error
+ */
+ssize_t tot_sync_write_rpcs_show(struct kobject *kobj, struct attribute *attr,
+				 char *buf)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	struct tg_grants_data *tgd;
+
+	tgd = &obd->u.obt.obt_lut->lut_tgd;
+	return scnprintf(buf, PAGE_SIZE, "%llu\n",
+			 tgd->tgd_tot_sync_write_rpcs);
+}
+EXPORT_SYMBOL(tot_sync_write_rpcs_show);
+
 /**
  * Show if grants compatibility mode is disabled.
  *
@@ -39,6 +39,7 @@
 #include <pthread.h>
 #include <sys/file.h>
 #include <sys/wait.h>
+#include <time.h>
 #include <stdarg.h>
 
 #define MAX_PATH_LENGTH 4096
@@ -587,6 +588,103 @@ int t5(int argc, char *argv[])
 
 }
 
+#define T6_USAGE							      \
+"usage: flocks_test 6 nprocs count file\n"				      \
+"       nprocs: processes taking locks at once\n"			      \
+"       count: write locks taken and dropped by each process\n"		      \
+"       file: each process locks file.<index> of its own\n"
+
+/**
+ * lock enqueue rate: every lock is a new LDLM lock, with a new handle on
+ * the client and the server
+ */
+int t6(int argc, char *argv[])
+{
+	struct flock lock = {
+		.l_whence = SEEK_SET,
+	};
+	char path[MAX_PATH_LENGTH];
+	struct timespec start;
+	struct timespec end;
+	pid_t *pids;
+	int nprocs;
+	int count;
+	int child_status;
+	int fd;
+	int i;
+	int j;
+	double secs;
+	int rc = EXIT_SUCCESS;
+
+	if (argc != 5) {
+		fprintf(stderr, T6_USAGE);
+		return EXIT_FAILURE;
+	}
+
+	nprocs = atoi(argv[2]);
+	count = atoi(argv[3]);
+	if (nprocs <= 0 || count <= 0) {
+		fprintf(stderr, T6_USAGE);
+		return EXIT_FAILURE;
+	}
+
+	pids = calloc(nprocs, sizeof(*pids));
+	if (pids == NULL) {
+		fprintf(stderr, "cannot allocate %d pids\n", nprocs);
+		return EXIT_FAILURE;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < nprocs; i++) {
+		pids[i] = fork();
+		if (pids[i] < 0) {
+			fprintf(stderr, "cannot fork: %s\n", strerror(errno));
+			rc = EXIT_FAILURE;
+			break;
+		}
+		if (pids[i] > 0)
+			continue;
+
+		snprintf(path, sizeof(path), "%s.%d", argv[4], i);
+		fd = open(path, O_RDWR | O_CREAT, 0644);
+		if (fd < 0) {
+			fprintf(stderr, "cannot open '%s': %s\n", path,
+				strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+
+		for (j = 0; j < count; j++) {
+			lock.l_type = F_WRLCK;
+			if (t_fcntl(fd, F_SETLKW, &lock) < 0)
+				exit(EXIT_FAILURE);
+			lock.l_type = F_UNLCK;
+			if (t_fcntl(fd, F_SETLKW, &lock) < 0)
+				exit(EXIT_FAILURE);
+		}
+
+		close(fd);
+		exit(EXIT_SUCCESS);
+	}
+
+	for (j = 0; j < i; j++) {
+		if (waitpid(pids[j], &child_status, 0) < 0 ||
+		    !WIFEXITED(child_status) ||
+		    WEXITSTATUS(child_status) != EXIT_SUCCESS)
+			rc = EXIT_FAILURE;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	free(pids);
+
+	if (rc != EXIT_SUCCESS)
+		return rc;
+
+	secs = end.tv_sec - start.tv_sec +
+	       (end.tv_nsec - start.tv_nsec) / 1000000000.0;
+	printf("%d processes, %d locks each: %.0f enqueues/s\n", nprocs,
+	       count, nprocs * count / secs);
+	return rc;
+}
+
 /** ==============================================================
  * program entry
  */
@@ -621,6 +719,9 @@ int main(int argc, char *argv[])
 	case 5:
 		rc = t5(argc, argv);
 		break;
+	case 6:
+		rc = t6(argc, argv);
+		break;
 	default:
 		fprintf(stderr, "unknown test number '%s'\n", argv[1]);
 		break;
@@ -0,0 +1,190 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+
+/* Micro-benchmark of the llite range lock: a number of kthreads take
+ * and drop range locks on non-overlapping 1MiB regions of the same
+ * tree, as shared-file writers do, first with a single shard (the
+ * unsharded tree) then with the given number of shards, and the lock
+ * rate of both runs is printed. */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/completion.h>
+#include <linux/kthread.h>
+#include <linux/ktime.h>
+#include <linux/version.h>
+
+/* The range lock is not exported by llite, build our own copy. */
+#include "../../llite/range_lock.c"
+
+/* Random ID passed by userspace, and printed in messages, used to
+ * separate different runs of that module. */
+static int run_id;
+module_param(run_id, int, 0644);
+MODULE_PARM_DESC(run_id, "run ID");
+
+static unsigned int threads = 8;
+module_param(threads, uint, 0644);
+MODULE_PARM_DESC(threads, "number of locking threads");
+
+static unsigned int locks = 100000;
+module_param(locks, uint, 0644);
+MODULE_PARM_DESC(locks, "number of range locks taken per thread");
+
+static unsigned int shards = RL_SHARDS_DEFAULT;
+module_param(shards, uint, 0644);
+MODULE_PARM_DESC(shards, "number of shards of the sharded run");
+
+#define PREFIX "lustre_krangelock_%u:"
+
+struct krl_run {
+	struct range_lock_tree	kr_tree;
+	struct completion	kr_start;
+	atomic_t		kr_running;
+	struct completion	kr_done;
+	atomic_t		kr_errors;
+};
+
+struct krl_thread {
+	struct krl_run		*kt_run;
+	unsigned int		 kt_index;
+};
+
+static int krl_thread_main(void *data)
+{
+	struct krl_thread *kt = data;
+	struct krl_run *run = kt->kt_run;
+	struct range_lock range;
+	__u64 start;
+	unsigned int i;
+	int rc;
+
+	wait_for_completion(&run->kr_start);
+
+	for (i = 0; i < locks; i++) {
+		/* regions of all threads are interleaved along the file */
+		start = ((__u64)i * threads + kt->kt_index) << 20;
+		rc = range_lock_init(&range, start, start + (1 << 20) - 1);
+		if (rc == 0)
+			rc = range_lock(&run->kr_tree, &range);
+		if (rc < 0) {
+			atomic_inc(&run->kr_errors);
+			break;
+		}
+		range_unlock(&run->kr_tree, &range);
+	}
+
+	if (atomic_dec_and_test(&run->kr_running))
+		complete(&run->kr_done);
+
+	return 0;
+}
+
+static int krl_run(unsigned int nshards)
+{
+	struct krl_thread *kts;
+	struct task_struct *thr;
+	struct krl_run run;
+	ktime_t start;
+	s64 usec;
+	unsigned int i;
+	int rc = 0;
+
+	OBD_ALLOC_PTR_ARRAY(kts, threads);
+	if (kts == NULL)
+		return -ENOMEM;
+
+	range_lock_tree_init_shards(&run.kr_tree, nshards);
+	init_completion(&run.kr_start);
+	init_completion(&run.kr_done);
+	atomic_set(&run.kr_running, 1);
+	atomic_set(&run.kr_errors, 0);
+
+	for (i = 0; i < threads; i++) {
+		kts[i].kt_run = &run;
+		kts[i].kt_index = i;
+		atomic_inc(&run.kr_running);
+		thr = kthread_run(krl_thread_main, &kts[i], "krangelock_%u",
+				  i);
+		if (IS_ERR(thr)) {
+			pr_err(PREFIX " cannot create kthread: %ld\n",
+			       run_id, PTR_ERR(thr));
+			atomic_dec(&run.kr_running);
+			rc = PTR_ERR(thr);
+			break;
+		}
+	}
+
+	/* release all the threads at once, and drop our own reference */
+	start = ktime_get();
+	complete_all(&run.kr_start);
+	if (!atomic_dec_and_test(&run.kr_running))
+		wait_for_completion(&run.kr_done);
+	usec = max_t(s64, ktime_us_delta(ktime_get(), start), 1);
+
+	if (rc == 0 && atomic_read(&run.kr_errors) > 0)
+		rc = -EIO;
+	if (rc == 0)
+		pr_err(PREFIX " threads %u shards %u: %llu locks/s\n",
+		       run_id, threads, nshards,
+		       div64_u64((__u64)threads * locks * USEC_PER_SEC, usec));
+
+	range_lock_tree_fini(&run.kr_tree);
+	OBD_FREE_PTR_ARRAY(kts, threads);
+
+	return rc;
+}
+
+static int __init krangelock_init(void)
+{
+	int rc;
+
+	if (threads == 0 || locks == 0) {
+		pr_err(PREFIX " invalid parameters\n", run_id);
+		goto out;
+	}
+
+	rc = krl_run(1);
+	if (rc == 0)
+		rc = krl_run(shards);
+	if (rc)
+		pr_err(PREFIX " range lock run failed: %d\n", run_id, rc);
+	else
+		/* below message is checked in sanity.sh test_425 */
+		pr_err(PREFIX " range lock runs completed\n", run_id);
+
+out:
+	/* Don't load. */
+	return -EINVAL;
+}
+
+static void __exit krangelock_exit(void)
+{
+}
+
+MODULE_AUTHOR("OpenSFS, Inc. <http://www.lustre.org/>");
+MODULE_DESCRIPTION("Lustre range lock benchmark module");
+MODULE_VERSION(LUSTRE_VERSION_STRING);
+MODULE_LICENSE("GPL");
+
+module_init(krangelock_init);
+module_exit(krangelock_exit);
@@ -0,0 +1,288 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+
+/*
+ * The purpose of this test is to check the changelog reader filter and
+ * batch acknowledgement of liblustreapi (llapi_changelog_set_filter() and
+ * llapi_changelog_ack()). A changelog user must be registered on the MDT.
+ *
+ * The program will exit as soon a non zero error code is returned. The
+ * index of the last record acknowledged by test4 is printed on stdout as
+ * "acked <index>".
+ */
+
+#include <stdlib.h>
+#include <errno.h>
+#include <getopt.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include <lustre/lustreapi.h>
+
+static char *lustre_dir;	/* Test directory inside Lustre */
+static char *mdtname;		/* MDT device, e.g. lustre-MDT0000 */
+static char *cl_user;		/* Registered changelog user, e.g. cl1 */
+static struct lu_fid file_fid;	/* FID of lustre_dir/file */
+static struct lu_fid dir_fid;	/* FID of lustre_dir/dir */
+
+#define ERROR(fmt, ...)							\
+	fprintf(stderr, "%s: %s:%d: %s: " fmt "\n",			\
+		program_invocation_short_name, __FILE__, __LINE__,	\
+		__func__, ## __VA_ARGS__);
+
+#define DIE(fmt, ...)				\
+	do {					\
+		ERROR(fmt, ## __VA_ARGS__);	\
+		exit(EXIT_FAILURE);		\
+	} while (0)
+
+#define ASSERTF(cond, fmt, ...)						\
+	do {								\
+		if (!(cond))						\
+			DIE("assertion '%s' failed: "fmt,		\
+			    #cond, ## __VA_ARGS__);			\
+	} while (0)
+
+#define PERFORM(testfn) \
+	do {								\
+		fprintf(stderr, "Starting test " #testfn " at %llu\n",	\
+			(unsigned long long)time(NULL));		\
+		testfn();						\
+		fprintf(stderr, "Finishing test " #testfn " at %llu\n",	\
+		       (unsigned long long)time(NULL));			\
+	} while (0)
+
+/* Records read by read_records(), by type */
+struct read_stats {
+	int	rs_count;
+	int	rs_types[CL_LAST];
+	/* Records whose target is file_fid or dir_fid */
+	int	rs_file;
+	int	rs_dir;
+	/* Index of the last record read */
+	long long rs_last;
+};
+
+/*
+ * Read all the records of the changelog through a reader with \a filter,
+ * or without filter if it is NULL. When \a ack is set, acknowledge every
+ * batch of records received at once.
+ */
+static void read_records(const struct changelog_filter *filter, bool ack,
+			 struct read_stats *rs)
+{
+	struct changelog_rec *rec;
+	void *ctx;
+	int rc;
+
+	memset(rs, 0, sizeof(*rs));
+	rs->rs_last = -1;
+
+	rc = llapi_changelog_start(&ctx, CHANGELOG_FLAG_JOBID, mdtname, 0);
+	ASSERTF(rc == 0, "llapi_changelog_start failed: %s", strerror(-rc));
+
+	if (filter != NULL) {
+		rc = llapi_changelog_set_filter(ctx, filter);
+		ASSERTF(rc == 0, "llapi_changelog_set_filter failed: %s",
+			strerror(-rc));
+	}
+
+	while ((rc = llapi_changelog_recv(ctx, &rec)) == 0) {
+		rs->rs_count++;
+		if (rec->cr_type < CL_LAST)
+			rs->rs_types[rec->cr_type]++;
+		if (memcmp(&rec->cr_tfid, &file_fid, sizeof(file_fid)) == 0)
+			rs->rs_file++;
+		if (memcmp(&rec->cr_tfid, &dir_fid, sizeof(dir_fid)) == 0)
+			rs->rs_dir++;
+		rs->rs_last = rec->cr_index;
+		llapi_changelog_free(&rec);
+
+		if (ack && !llapi_changelog_in_buf(ctx)) {
+			rc = llapi_changelog_ack(ctx, cl_user, rs->rs_last);
+			ASSERTF(rc == 0, "llapi_changelog_ack failed: %s",
+				strerror(-rc));
+		}
+	}
+	ASSERTF(rc == 1, "llapi_changelog_recv failed: %s", strerror(-rc));
+
+	rc = llapi_changelog_fini(&ctx);
+	ASSERTF(rc == 0, "llapi_changelog_fini failed: %s", strerror(-rc));
+}
+
+/* Filter on record type: only mkdir records are delivered. */
+static void test1(void)
+{
+	struct changelog_filter cf = { .cf_type_mask = 1ULL << CL_MKDIR };
+	struct read_stats rs;
+
+	read_records(&cf, false, &rs);
+	ASSERTF(rs.rs_count > 0, "no record read");
+	ASSERTF(rs.rs_types[CL_MKDIR] == rs.rs_count,
+		"%d records read, %d mkdir", rs.rs_count,
+		rs.rs_types[CL_MKDIR]);
+	ASSERTF(rs.rs_dir > 0, "no record of "DFID, PFID(&dir_fid));
+	ASSERTF(rs.rs_file == 0, "%d records of "DFID, rs.rs_file,
+		PFID(&file_fid));
+}
+
+/* Filter on target FID: only records of the file are delivered. */
+static void test2(void)
+{
+	struct changelog_filter cf = { .cf_tfid = file_fid };
+	struct read_stats rs;
+
+	read_records(&cf, false, &rs);
+	ASSERTF(rs.rs_count > 0, "no record read");
+	ASSERTF(rs.rs_file == rs.rs_count, "%d records read, %d of "DFID,
+		rs.rs_count, rs.rs_file, PFID(&file_fid));
+	ASSERTF(rs.rs_types[CL_CREATE] > 0, "no create record of "DFID,
+		PFID(&file_fid));
+}
+
+/* Filter on jobid, and bad parameters to llapi_changelog_set_filter(). */
+static void test3(void)
+{
+	struct changelog_filter cf = { .cf_type_mask = 0 };
+	struct read_stats rs;
+	void *ctx;
+	int rc;
+
+	snprintf(cf.cf_jobid, sizeof(cf.cf_jobid), "nosuchjob.%d", getpid());
+	read_records(&cf, false, &rs);
+	ASSERTF(rs.rs_count == 0, "%d records of job '%s'", rs.rs_count,
+		cf.cf_jobid);
+
+	rc = llapi_changelog_set_filter(NULL, &cf);
+	ASSERTF(rc == -EINVAL, "llapi_changelog_set_filter error: %s",
+		strerror(-rc));
+
+	rc = llapi_changelog_start(&ctx, 0, mdtname, 0);
+	ASSERTF(rc == 0, "llapi_changelog_start failed: %s", strerror(-rc));
+
+	rc = llapi_changelog_set_filter(ctx, NULL);
+	ASSERTF(rc == -EINVAL, "llapi_changelog_set_filter error: %s",
+		strerror(-rc));
+
+	rc = llapi_changelog_fini(&ctx);
+	ASSERTF(rc == 0, "llapi_changelog_fini failed: %s", strerror(-rc));
+}
+
+/* Acknowledge every batch, the caller checks the user index. */
+static void test4(void)
+{
+	struct read_stats rs;
+	void *ctx;
+	int rc;
+
+	rc = llapi_changelog_ack(NULL, cl_user, 0);
+	ASSERTF(rc == -EINVAL, "llapi_changelog_ack error: %s",
+		strerror(-rc));
+
+	rc = llapi_changelog_start(&ctx, 0, mdtname, 0);
+	ASSERTF(rc == 0, "llapi_changelog_start failed: %s", strerror(-rc));
+
+	rc = llapi_changelog_ack(ctx, cl_user, -1);
+	ASSERTF(rc == -EINVAL, "llapi_changelog_ack error: %s",
+		strerror(-rc));
+
+	rc = llapi_changelog_fini(&ctx);
+	ASSERTF(rc == 0, "llapi_changelog_fini failed: %s", strerror(-rc));
+
+	read_records(NULL, true, &rs);
+	ASSERTF(rs.rs_count > 0, "no record read");
+	printf("acked %lld\n", rs.rs_last);
+}
+
+static void usage(char *prog)
+{
+	fprintf(stderr, "Usage: %s -d lustre_dir -m mdtname -u cl_user\n",
+		prog);
+	exit(EXIT_FAILURE);
+}
+
+static void process_args(int argc, char *argv[])
+{
+	int c;
+
+	while ((c = getopt(argc, argv, "d:m:u:")) != -1) {
+		switch (c) {
+		case 'd':
+			lustre_dir = optarg;
+			break;
+		case 'm':
+			mdtname = optarg;
+			break;
+		case 'u':
+			cl_user = optarg;
+			break;
+		case '?':
+		default:
+			fprintf(stderr, "Unknown option '%c'\n", optopt);
+			usage(argv[0]);
+			break;
+		}
+	}
+
+	if (lustre_dir == NULL || mdtname == NULL || cl_user == NULL)
+		usage(argv[0]);
+}
+
+int main(int argc, char *argv[])
+{
+	char path[PATH_MAX];
+	int rc;
+	int fd;
+
+	process_args(argc, argv);
+
+	/* Play nice with Lustre test scripts. Non-line buffered output
+	 * stream under I/O redirection may appear incorrectly. */
+	setvbuf(stdout, NULL, _IOLBF, 0);
+
+	/* Records of these two are looked for in the changelog */
+	snprintf(path, sizeof(path), "%s/file", lustre_dir);
+	fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0644);
+	ASSERTF(fd >= 0, "cannot create '%s': %s", path, strerror(errno));
+	close(fd);
+
+	rc = llapi_path2fid(path, &file_fid);
+	ASSERTF(rc == 0, "llapi_path2fid '%s' failed: %s", path,
+		strerror(-rc));
+
+	snprintf(path, sizeof(path), "%s/dir", lustre_dir);
+	rc = mkdir(path, 0755);
+	ASSERTF(rc == 0, "cannot mkdir '%s': %s", path, strerror(errno));
+
+	rc = llapi_path2fid(path, &dir_fid);
+	ASSERTF(rc == 0, "llapi_path2fid '%s' failed: %s", path,
+		strerror(-rc));
+
+	PERFORM(test1);
+	PERFORM(test2);
+	PERFORM(test3);
+	PERFORM(test4);
+
+	return EXIT_SUCCESS;
+}
@@ -673,6 +673,41 @@ test_9() {
 }
 run_test 9 "Replicate recursive directory removal"
 
+# Test 10 - Replicate data changes with parallel replay threads
+test_10() {
+	init_src
+	init_changelog
+
+	local numfiles=100
+	local i
+
+	createmany -o $DIR/$tdir/$tfile $numfiles || error "createmany failed"
+
+	local LRSYNC_LOG=$(generate_logname "lrsync_log")
+	$LRSYNC -s $DIR -t $TGT -t $TGT2 -m $MDT0 -u $CL_USER -l $LREPL_LOG \
+		-D $LRSYNC_LOG --threads 4
+	check_diff $DIR/$tdir $TGT/$tdir
+
+	for ((i = 0; i < numfiles; i++)); do
+		dd if=/dev/urandom of=$DIR/$tdir/$tfile$i bs=4k count=1 \
+			2>/dev/null || error "write $tfile$i failed"
+		chmod 0600 $DIR/$tdir/$tfile$i || error "chmod $tfile$i failed"
+		$TRUNCATE $DIR/$tdir/$tfile$i 1000 ||
+			error "truncate $tfile$i failed"
+	done
+	mv $DIR/$tdir/${tfile}0 $DIR/$tdir/${tfile}_moved ||
+		error "mv ${tfile}0 failed"
+
+	$LRSYNC -l $LREPL_LOG -D $LRSYNC_LOG --threads 4
+	check_diff $DIR/$tdir $TGT/$tdir
+	check_diff $DIR/$tdir $TGT2/$tdir
+
+	fini_changelog
+	cleanup_src_tgt
+	return 0
+}
+run_test 10 "Replicate data changes with parallel replay threads"
+
 cd $ORIG_PWD
 complete $SECONDS
 check_and_cleanup_lustre
@@ -5816,6 +5816,51 @@ test_40a() {
 }
 run_test 40a "LFSCK correctly fixes lmm_oi in composite layout"
 
+test_41() {
+	echo "#####"
+	echo "The layout LFSCK with several assistant threads repairs the"
+	echo "same inconsistencies as the single assistant thread does."
+	echo "#####"
+
+	local threads=$(do_facet $SINGLEMDS $LCTL get_param -n \
+			mdd.${MDT_DEV}.lfsck_assistant_threads)
+	[ -n "$threads" ] ||
+		skip "MDS does not support multi-threaded LFSCK assistant"
+
+	do_facet $SINGLEMDS $LCTL set_param \
+		mdd.${MDT_DEV}.lfsck_assistant_threads=4
+	stack_trap "do_facet $SINGLEMDS $LCTL set_param \
+		mdd.${MDT_DEV}.lfsck_assistant_threads=$threads" EXIT
+
+	check_mount_and_prep
+	$LFS setstripe -c 1 -i 0 $DIR/$tdir
+	for ((i = 0; i < 100; i++)); do
+		echo "foo" > $DIR/$tdir/f$i || error "(1) write f$i failed"
+	done
+	cancel_lru_locks osc
+
+	echo "Inject failure stub to skip OST-object owner changing"
+	#define OBD_FAIL_LFSCK_BAD_OWNER	0x1613
+	do_facet $SINGLEMDS $LCTL set_param fail_loc=0x1613
+	chown 1.1 $DIR/$tdir/f{0..49}
+	do_facet $SINGLEMDS $LCTL set_param fail_loc=0
+
+	$START_LAYOUT -r || error "(2) Fail to start LFSCK for layout!"
+
+	wait_update_facet $SINGLEMDS "$LCTL get_param -n \
+		mdd.${MDT_DEV}.lfsck_layout |
+		awk '/^status/ { print \\\$2 }'" "completed" 32 || {
+		$SHOW_LAYOUT
+		error "(3) unexpected status"
+	}
+
+	local repaired=$($SHOW_LAYOUT |
+			 awk '/^repaired_inconsistent_owner/ { print $2 }')
+	[ $repaired -eq 50 ] ||
+		error "(4) Fail to repair inconsistent owner: $repaired"
+}
+run_test 41 "multi-threaded layout LFSCK assistant"
+
 # restore MDS/OST size
 MDSSIZE=${SAVED_MDSSIZE}
 OSTSIZE=${SAVED_OSTSIZE}
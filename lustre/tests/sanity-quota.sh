@@ -4409,6 +4409,93 @@ test_70()
 }
 run_test 70 "check lfs setquota/quota with a pool option"
 
+test_71() {
+	local limit=20 # 20M
+	local testfile="$DIR/$tdir/$tfile-0"
+	local horizon
+	local granted
+	local used
+	local spare=()
+	local stats
+
+	setup_quota_test || error "setup quota failed with $?"
+	stack_trap cleanup_quota_test EXIT
+
+	# enable ost quota
+	set_ost_qtype $QTYPE || error "enable ost quota failed"
+
+	horizon=$(do_facet ost1 $LCTL get_param -n \
+		  osd-*.$FSNAME-OST0000.quota_slave.preacq_horizon)
+	[ -n "$horizon" ] || skip "no preacq_horizon on ost1"
+	stack_trap "do_facet ost1 $LCTL set_param \
+		osd-*.$FSNAME-OST0000.quota_slave.preacq_horizon=$horizon" EXIT
+	do_facet ost1 $LCTL set_param \
+		osd-*.$FSNAME-OST0000.quota_slave.stall_stats=clear
+
+	$LFS setquota -u $TSTUSR -b 0 -B ${limit}M -i 0 -I 0 $DIR ||
+		error "set user quota failed"
+	$LFS setstripe $testfile -c 1 -i 0 || error "setstripe $testfile failed"
+	chown $TSTUSR.$TSTUSR $testfile || error "chown $testfile failed"
+
+	for horizon in 0 2; do
+		do_facet ost1 $LCTL set_param \
+			osd-*.$FSNAME-OST0000.quota_slave.preacq_horizon=$horizon
+		# a fast writer must not be able to overrun the limit with
+		# the space it pre-acquired
+		$RUNAS $DD of=$testfile count=$((limit / 2)) ||
+			quota_error u $TSTUSR "write with horizon $horizon failed"
+		$RUNAS $DD of=$testfile count=$((limit / 2)) \
+			seek=$((limit / 2)) conv=fsync || true
+		$RUNAS $DD of=$testfile count=1 seek=$limit conv=fsync &&
+			quota_error u $TSTUSR \
+				"write beyond limit with horizon $horizon"
+		rm -f $testfile
+		wait_delete_completed || error "wait_delete_completed failed"
+		sync_all_data || true
+		$LFS setstripe $testfile -c 1 -i 0 ||
+			error "setstripe $testfile failed"
+		chown $TSTUSR.$TSTUSR $testfile || error "chown $testfile failed"
+	done
+
+	# far from the limit, a fast writer must keep more spare space than
+	# qunit with the horizon, but not without it
+	$LFS setquota -u $TSTUSR -b 0 -B $((limit * 10))M -i 0 -I 0 $DIR ||
+		error "set user quota failed"
+	for horizon in 0 2; do
+		do_facet ost1 $LCTL set_param \
+			osd-*.$FSNAME-OST0000.quota_slave.preacq_horizon=$horizon
+		# several direct writes, so that the rate spans a few periods
+		for ((i = 0; i < limit; i++)); do
+			$RUNAS $DD of=$testfile count=2 seek=$((i * 2)) \
+				oflag=direct conv=notrunc ||
+				quota_error u $TSTUSR \
+					"write with horizon $horizon failed"
+		done
+		used=$(getquota -u $TSTUSR global curspace)
+		granted=$(getgranted "0x0" "dt" $TSTID "usr")
+		spare[$horizon]=$((granted - used))
+		echo "horizon $horizon: granted $granted used $used"
+		rm -f $testfile
+		wait_delete_completed || error "wait_delete_completed failed"
+		sync_all_data || true
+		$LFS setstripe $testfile -c 1 -i 0 ||
+			error "setstripe $testfile failed"
+		chown $TSTUSR.$TSTUSR $testfile || error "chown $testfile failed"
+	done
+	(( ${spare[2]} > ${spare[0]} )) ||
+		quota_error u $TSTUSR \
+			"no pre-acquire by rate: spare ${spare[2]}KB <= ${spare[0]}KB"
+
+	stats=$(do_facet ost1 $LCTL get_param -n \
+		osd-*.$FSNAME-OST0000.quota_slave.stall_stats)
+	echo "$stats"
+	echo "$stats" | grep -q "^- usr" ||
+		error "no user quota stall recorded"
+
+	resetquota -u $TSTUSR
+}
+run_test 71 "pre-acquire by consumption rate"
+
 quota_fini()
 {
 	do_nodes $(comma_list $(nodes_list)) "lctl set_param debug=-quota"
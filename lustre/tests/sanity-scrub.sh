@@ -331,6 +331,15 @@ full_scrub_threshold_rate() {
 		osd-*.*.full_scrub_threshold_rate=$rate
 }
 
+scrub_threads() {
+	local threads=$1
+	local rate=$2
+
+	do_nodes $(comma_list $(mdts_nodes)) $LCTL set_param -n \
+		osd-*.*.scrub_threads=$threads \
+		osd-*.*.scrub_rate_limit=$rate
+}
+
 scrub_enable_index_backup() {
 	do_nodes $(comma_list $(all_server_nodes)) $LCTL set_param -n \
 		osd-*.*.index_backup=1
@@ -1273,6 +1282,89 @@ test_16() {
 }
 run_test 16 "Initial OI scrub can rebuild crashed index objects"
 
+test_16b() {
+	[ $(facet_fstype $SINGLEMDS) != "ldiskfs" ] &&
+		skip "ldiskfs special test" && return
+
+	local nr=1000
+	local start
+	local loaded
+	local uid
+
+	check_mount_and_prep
+	scrub_enable_index_backup
+	stack_trap scrub_disable_index_backup EXIT
+
+	# enough quota ids for the global index backup to span several
+	# restore chunks
+	for ((uid = 60000; uid < 60000 + nr; uid++)); do
+		$LFS setquota -u $uid -B 10M -I 100 $MOUNT ||
+			error "(1) setquota for $uid failed"
+	done
+
+	do_facet $SINGLEMDS $LCTL set_param debug=+lfsck
+	stack_trap "do_facet $SINGLEMDS $LCTL set_param debug=-lfsck" EXIT
+
+	#define OBD_FAIL_OSD_INDEX_CRASH	0x199
+	do_nodes $(comma_list $(mdts_nodes)) $LCTL set_param fail_loc=0x199
+	scrub_prep 0
+	do_nodes $(comma_list $(mdts_nodes)) $LCTL set_param fail_loc=0
+
+	do_facet $SINGLEMDS $LCTL clear
+	start=$SECONDS
+	echo "starting MDTs without disabling OI scrub"
+	scrub_start_mds 2 "$MOUNT_OPTS_SCRUB"
+	mount_client $MOUNT || error "(3) Fail to start client!"
+	echo "restarted in $((SECONDS - start))s"
+
+	loaded=$(do_facet $SINGLEMDS $LCTL dk |
+		 awk '/bulk loaded/ { n += $(NF - 3) } END { print n + 0 }')
+	echo "$loaded records bulk loaded"
+	(( loaded >= nr )) ||
+		error "(4) only $loaded records bulk loaded, expect >= $nr"
+
+	for uid in 60000 $((60000 + nr / 2)) $((60000 + nr - 1)); do
+		$LFS quota -u $uid $MOUNT | grep -q "10240.*100" ||
+			error "(5) quota limits of $uid are lost"
+	done
+}
+run_test 16b "Restore of crashed index objects loads them in bulk"
+
+test_17() {
+	[ $(facet_fstype $SINGLEMDS) != "ldiskfs" ] &&
+		skip "ldiskfs special test" && return
+
+	local threads
+
+	formatall > /dev/null
+	setupall > /dev/null
+
+	stack_trap "scrub_threads 1 0" EXIT
+	scrub_prep 20 1
+	echo "starting MDTs with OI scrub disabled"
+	scrub_start_mds 2 "$MOUNT_OPTS_NOSCRUB"
+	scrub_check_status 3 init
+	scrub_check_flags 4 recreated,inconsistent
+
+	# slow down the scanning to check the threads while running
+	scrub_threads 4 10
+	scrub_start 5
+	sleep 3
+	threads=$(scrub_status 1 | awk '/^threads:/ { print $2 }')
+	[ "$threads" == "4" ] ||
+		error "(6) Expect 4 scanning threads, but got '$threads'"
+	scrub_stop 7
+	scrub_check_status 8 stopped
+
+	# resume from the checkpoint of each partition
+	scrub_threads 4 0
+	scrub_start 9
+	scrub_check_status 10 completed
+	scrub_check_flags 11 ""
+	scrub_check_repaired 12 20 0
+}
+run_test 17 "Multi-threaded OI scrub"
+
 # restore MDS/OST size
 MDSSIZE=${SAVED_MDSSIZE}
 OSTSIZE=${SAVED_OSTSIZE}
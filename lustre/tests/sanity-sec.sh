@@ -2661,6 +2661,354 @@ test_35() {
 }
 run_test 35 "Check permissions when accessing changelogs"
 
+test_36() {
+	remote_mgs_nodsh && skip "remote MGS with nodsh"
+	nodemap_version_check || return 0
+
+	local count=200
+	local idmaps=100
+	local lookups=2000
+	local rc
+
+	stack_trap "do_facet mgs 'for ((i = 0; i < $count; i++)); do \
+		$LCTL nodemap_del n36_\$i; done' > /dev/null 2>&1" EXIT
+
+	# one nodemap per /24 range, each mapping $idmaps uids
+	do_facet mgs "for ((i = 0; i < $count; i++)); do
+		$LCTL nodemap_add n36_\$i &&
+		$LCTL nodemap_add_range --name n36_\$i \
+			--range 10.36.\$i.[1-254]@tcp || exit 1
+	done" || error "cannot add nodemaps"
+	do_facet mgs "for ((u = 1; u <= $idmaps; u++)); do
+		$LCTL nodemap_add_idmap --name n36_7 --idtype uid \
+			--idmap \$u:\$((u + 10000)) || exit 1
+	done" || error "cannot add idmaps"
+
+	# delete every other range, deleted ranges must fall back to default
+	do_facet mgs "for ((i = 0; i < $count; i += 2)); do
+		$LCTL nodemap_del_range --name n36_\$i \
+			--range 10.36.\$i.[1-254]@tcp || exit 1
+	done" || error "cannot delete ranges"
+
+	# this checks the results only, forking lctl for each lookup
+	# costs far more than the lookup itself
+	rc=$(do_facet mgs "rc=0
+		for ((l = 0; l < $lookups; l++)); do
+			i=\$((RANDOM % $count))
+			nm=\$($LCTL nodemap_test_nid 10.36.\$i.\$((l % 254 + 1))@tcp)
+			if ((i % 2)); then exp=n36_\$i; else exp=default; fi
+			[ \"\$nm\" == \"\$exp\" ] || rc=\$((rc + 1))
+		done
+		echo \$rc")
+	[ "$rc" == 0 ] || error "$rc nids misclassified"
+
+	# ids are only mapped with nodemap active
+	if [ "$(do_facet mgs $LCTL get_param -n nodemap.active)" != 1 ]; then
+		stack_trap cleanup_active EXIT
+		do_facet mgs $LCTL nodemap_activate 1
+	fi
+
+	rc=$(do_facet mgs "rc=0
+		for ((u = 1; u <= $idmaps; u++)); do
+			id=\$($LCTL nodemap_test_id --nid 10.36.7.1@tcp \
+				--idtype uid --id \$u)
+			[ \"\$id\" == \$((u + 10000)) ] || rc=\$((rc + 1))
+		done
+		echo \$rc")
+	[ "$rc" == 0 ] || error "$rc ids mismapped"
+
+	# time the lookups in the kernel, with the locks and without, from
+	# several threads at once
+	local threads=4
+	# also tells the timings of this run from older ones in dmesg
+	local loops=$((100000 + RANDOM % 1000))
+	local bench
+	local locked
+	local lockless
+
+	stack_trap "do_facet mgs $LCTL set_param fail_loc=0 fail_val=0" EXIT
+	#define OBD_FAIL_SEC_NODEMAP_BENCH 0x1206
+	do_facet mgs $LCTL set_param fail_val=$loops fail_loc=0x1206
+	do_facet mgs "for ((t = 0; t < $threads; t++)); do
+		$LCTL nodemap_test_nid 10.36.\$((t * 2 + 1)).1@tcp &
+		$LCTL nodemap_test_id --nid 10.36.7.1@tcp --idtype uid \
+			--id \$((t + 1)) &
+	done > /dev/null; wait"
+	do_facet mgs $LCTL set_param fail_loc=0 fail_val=0
+
+	bench=$(do_facet mgs "dmesg | grep 'nodemap bench: .* x$loops:'")
+	echo "$bench"
+	for op in map classify; do
+		(( $(grep -c " $op " <<< "$bench") == threads )) ||
+			error "missing $op timings"
+		read locked lockless <<< $(awk -v op=" $op " '$0 ~ op {
+			for (i = 1; i < NF; i++) {
+				if ($i == "locked") l += $(i + 1)
+				if ($i == "lockless") f += $(i + 1)
+			} } END { print l + 0, f + 0 }' <<< "$bench")
+		echo "$op x$((threads * loops)): locked ${locked}us," \
+			"lockless ${lockless}us"
+	done
+
+	# the locked classification serializes the threads on
+	# active_config_lock
+	(( lockless < locked )) ||
+		error "lockless classification ${lockless}us >= locked ${locked}us"
+}
+run_test 36 "classify nids and map ids with many nodemaps"
+
+test_37() {
+	local save_flvr=$SK_FLAVOR
+	local nodes=$(comma_list $(all_nodes))
+	local clients=$(comma_list ${CLIENTS:-$HOSTNAME})
+	local osses=$(comma_list $(osts_nodes))
+	local param=sptlrpc.gss.bulk_parallel_pages
+	local tmpfile=$TMP/$tfile
+	local mixed=true
+	local old
+	local pages
+	local pair
+
+	$SHARED_KEY || skip "need shared key feature for this test"
+	old=$(do_facet ost1 $LCTL get_param -n $param 2>/dev/null) ||
+		skip "no $param support"
+
+	stack_trap restore_to_default_flavor EXIT
+	stack_trap "do_nodes $nodes $LCTL set_param -n $param=$old" EXIT
+	stack_trap "rm -f $tmpfile" EXIT
+
+	# a node both client and OSS cannot be parallel on one side only
+	[[ -z "$(comm -12 <(tr ',' '\n' <<< $clients | sort -u) \
+			   <(tr ',' '\n' <<< $osses | sort -u))" ]] ||
+		mixed=false
+
+	# odd size, so the last page is not full
+	dd if=/dev/urandom of=$tmpfile bs=1M count=8 || error "dd $tmpfile"
+	echo "tail" >> $tmpfile
+
+	for flvr in ski skpi; do
+		SK_FLAVOR=$flvr
+		restore_to_default_flavor || error "cannot set $flvr flavor"
+		SK_FLAVOR=$save_flvr
+
+		# 0 is serial, 1 uses as many workers as possible
+		for pages in 0 1 16; do
+			do_nodes $nodes $LCTL set_param -n $param=$pages
+			cp $tmpfile $DIR/$tfile || error "$flvr/$pages: cp"
+			cancel_lru_locks osc
+			cmp $tmpfile $DIR/$tfile ||
+				error "$flvr/$pages: data corrupted"
+			rm -f $DIR/$tfile
+		done
+
+		$mixed || continue
+		# client parallel and OSS serial, then the reverse: each side
+		# decrypts and checks what the other encrypted, so the cipher
+		# text of both paths must be the same byte for byte
+		for pair in "1 0" "0 1" "16 0" "0 16"; do
+			set -- $pair
+			do_nodes $clients $LCTL set_param -n $param=$1
+			do_nodes $osses $LCTL set_param -n $param=$2
+			cp $tmpfile $DIR/$tfile ||
+				error "$flvr/client $1/OSS $2: cp"
+			cancel_lru_locks osc
+			cmp $tmpfile $DIR/$tfile ||
+				error "$flvr/client $1/OSS $2: data corrupted"
+
+			# read what was written with the other side parallel
+			do_nodes $clients $LCTL set_param -n $param=$2
+			do_nodes $osses $LCTL set_param -n $param=$1
+			cancel_lru_locks osc
+			cmp $tmpfile $DIR/$tfile ||
+				error "$flvr/client $2/OSS $1: data corrupted"
+			rm -f $DIR/$tfile
+		done
+	done
+	$mixed || echo "clients are also OSSes, mixed settings not run"
+}
+run_test 37 "parallel bulk encryption keeps data intact"
+
+identity_upcall_setup() {
+	local param=mdt.$MDT.identity_upcall_batch
+
+	do_facet $SINGLEMDS $LCTL get_param -n $param > /dev/null 2>&1 ||
+		skip "no identity_upcall_batch support"
+	[ "$(do_facet $SINGLEMDS $LCTL get_param -n $IDENTITY_UPCALL)" != \
+	  "NONE" ] || skip "no identity upcall"
+
+	mkdir $DIR/$tdir || error "mkdir $tdir"
+	chmod 0777 $DIR/$tdir
+	do_facet $SINGLEMDS $LCTL set_param -n \
+		mdt.$MDT.identity_upcall_stats=clear
+	do_facet $SINGLEMDS $LCTL set_param -n $IDENTITY_FLUSH=-1
+}
+
+# save an identity tunable of the MDT and restore it at the end of the test
+identity_param_save() {
+	local param=mdt.$MDT.$1
+	local old=$(do_facet $SINGLEMDS $LCTL get_param -n $param)
+
+	stack_trap "do_facet $SINGLEMDS $LCTL set_param -n $param=$old" EXIT
+}
+
+# number of upcalls which got their downcall
+identity_upcalls() {
+	do_facet $SINGLEMDS $LCTL get_param -n mdt.$MDT.identity_upcall_stats |
+		awk '/^- / { sect = $2 }
+		     sect == "latency_us" && /sample:/ {
+			gsub(",", "", $4); n += $4 }
+		     END { print n + 0 }'
+}
+
+# number of upcalls which resolved more than one uid
+identity_batched_upcalls() {
+	do_facet $SINGLEMDS $LCTL get_param -n mdt.$MDT.identity_upcall_stats |
+		awk '/^- / { sect = $2 }
+		     sect == "batch_keys" && /sample:/ {
+			sub(":", "", $1); gsub(",", "", $4);
+			if ($1 > 1) n += $4 }
+		     END { print n + 0 }'
+}
+
+test_38a() {
+	local pids=""
+	local pid
+	local id
+
+	identity_upcall_setup
+	identity_param_save identity_upcall_batch
+	do_facet $SINGLEMDS $LCTL set_param -n mdt.$MDT.identity_upcall_batch=64
+
+	# hold the first upcall, so that the other lookups are queued
+	#define OBD_FAIL_SEC_UPCALL_BATCH	0x1205
+	do_facet $SINGLEMDS $LCTL set_param fail_loc=0x1205 fail_val=2
+	stack_trap "do_facet $SINGLEMDS $LCTL set_param fail_loc=0 fail_val=0" EXIT
+
+	for id in $ID0 $ID1; do
+		$RUNAS_CMD -u $id touch $DIR/$tdir/f$id &
+		pids="$pids $!"
+	done
+	# unknown uids, only to have more lookups at once
+	for ((id = 60000; id < 60006; id++)); do
+		$RUNAS_CMD -u $id touch $DIR/$tdir/f$id 2> /dev/null &
+	done
+	for pid in $pids; do
+		wait $pid || error "touch as another user failed"
+	done
+	wait
+	do_facet $SINGLEMDS $LCTL set_param fail_loc=0 fail_val=0
+
+	for id in $ID0 $ID1; do
+		[ $(stat -c %u $DIR/$tdir/f$id) -eq $id ] ||
+			error "f$id not owned by $id"
+	done
+
+	do_facet $SINGLEMDS $LCTL get_param mdt.$MDT.identity_upcall_stats
+	(( $(identity_batched_upcalls) > 0 )) ||
+		error "no upcall resolved several uids"
+}
+run_test 38a "batched identity upcalls resolve concurrent uids"
+
+test_38b() {
+	local uid=60100
+	local n1
+	local n2
+
+	identity_upcall_setup
+	identity_param_save identity_neg_expire
+
+	do_facet $SINGLEMDS $LCTL set_param -n mdt.$MDT.identity_neg_expire=60
+	$RUNAS_CMD -u $uid touch $DIR/$tdir/f1 2> /dev/null
+	n1=$(identity_upcalls)
+	(( n1 > 0 )) || error "no upcall for unknown uid $uid"
+	$RUNAS_CMD -u $uid touch $DIR/$tdir/f2 2> /dev/null
+	n2=$(identity_upcalls)
+	(( n2 == n1 )) || error "unknown uid $uid not cached: $n1 -> $n2 upcalls"
+
+	# without negative caching, each lookup runs the upcall again
+	do_facet $SINGLEMDS $LCTL set_param -n mdt.$MDT.identity_neg_expire=0
+	do_facet $SINGLEMDS $LCTL set_param -n $IDENTITY_FLUSH=-1
+	n1=$(identity_upcalls)
+	$RUNAS_CMD -u $uid touch $DIR/$tdir/f3 2> /dev/null
+	$RUNAS_CMD -u $uid touch $DIR/$tdir/f4 2> /dev/null
+	n2=$(identity_upcalls)
+	(( n2 >= n1 + 2 )) || error "unknown uid $uid cached: $n1 -> $n2 upcalls"
+}
+run_test 38b "identity of unknown uids is negatively cached"
+
+test_38c() {
+	local expire=16
+	local n1
+	local n2
+	local n3
+
+	identity_upcall_setup
+	identity_param_save identity_expire
+
+	# the entry is refreshed during the last 1/8 of its life
+	do_facet $SINGLEMDS $LCTL set_param -n mdt.$MDT.identity_expire=$expire
+	do_facet $SINGLEMDS $LCTL set_param -n $IDENTITY_FLUSH=-1
+	$RUNAS_CMD -u $ID0 touch $DIR/$tdir/f0 || error "touch f0 failed"
+
+	sleep $((expire - 2))
+	n1=$(identity_upcalls)
+	$RUNAS_CMD -u $ID0 touch $DIR/$tdir/f1 || error "touch f1 failed"
+	sleep 1
+	n2=$(identity_upcalls)
+	(( n2 > n1 )) || error "identity of $ID0 not refreshed before expiry"
+
+	# the first entry has expired, the refreshed one is used
+	sleep 3
+	$RUNAS_CMD -u $ID0 touch $DIR/$tdir/f2 || error "touch f2 failed"
+	n3=$(identity_upcalls)
+	(( n3 == n2 )) || error "identity of $ID0 looked up again: $n2 -> $n3"
+}
+run_test 38c "identity is refreshed ahead of expiry"
+
+enc_pool_access() {
+	$LCTL get_param -n sptlrpc.encrypt_page_pools |
+		awk '/cache access:/ { n += $3 } END { print n + 0 }'
+}
+
+test_39() {
+	local save_flvr=$SK_FLAVOR
+	local tmpfile=$TMP/$tfile
+	local ncpts
+	local npools
+	local before
+	local after
+
+	$SHARED_KEY || skip "need shared key feature for this test"
+
+	ncpts=$($LCTL get_param -n cpu_partition_table | wc -l)
+	npools=$($LCTL get_param -n sptlrpc.encrypt_page_pools |
+		 grep -c "^cpt [0-9]*:")
+	$LCTL get_param sptlrpc.encrypt_page_pools
+	(( npools == ncpts )) ||
+		error "$npools encrypt page pools for $ncpts CPTs"
+
+	stack_trap restore_to_default_flavor EXIT
+	stack_trap "rm -f $tmpfile" EXIT
+
+	SK_FLAVOR=skpi
+	restore_to_default_flavor || error "cannot set skpi flavor"
+	SK_FLAVOR=$save_flvr
+
+	dd if=/dev/urandom of=$tmpfile bs=1M count=16 || error "dd $tmpfile"
+	before=$(enc_pool_access)
+	cp $tmpfile $DIR/$tfile || error "cp failed"
+	cancel_lru_locks osc
+	cmp $tmpfile $DIR/$tfile || error "data corrupted"
+	after=$(enc_pool_access)
+	$LCTL get_param sptlrpc.encrypt_page_pools
+
+	# the client encrypts the written pages in pages from the pools
+	(( after > before )) ||
+		error "encrypted bulk didn't use the page pools"
+	rm -f $DIR/$tfile
+}
+run_test 39 "per-CPT encrypt page pools serve encrypted bulk"
+
 log "cleanup: ======================================================"
 
 sec_unsetup() {
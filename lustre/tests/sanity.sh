@@ -1436,6 +1436,50 @@ test_24F () {
 }
 run_test 24F "hash order vs readdir (LU-11330)"
 
+test_24G() {
+	local nfiles=5000
+	local prefetched
+	local count
+
+	test_mkdir -i 0 -c 1 $DIR/$tdir
+	createmany -m $DIR/$tdir/$tfile-with-a-rather-long-name- $nfiles ||
+		error "createmany failed"
+	stack_trap "rm -rf $DIR/$tdir" EXIT
+
+	# small RPCs, so that the directory needs a chain of prefetches
+	save_lustre_params client "mdc.*.max_pages_per_rpc" > $TMP/$tfile.sav
+	stack_trap "restore_lustre_params < $TMP/$tfile.sav; \
+		rm -f $TMP/$tfile.sav" EXIT
+	$LCTL set_param mdc.*.max_pages_per_rpc=4
+	$LCTL set_param debug=+cache
+	stack_trap "$LCTL set_param debug=-cache" EXIT
+
+	cancel_lru_locks mdc
+	$LCTL clear
+	count=$(ls -f $DIR/$tdir | wc -l)
+	(( count == nfiles + 2 )) ||
+		error "cold readdir found $count entries, expect $((nfiles + 2))"
+
+	prefetched=$($LCTL dk | grep -c "prefetched .* rc = 0")
+	echo "$prefetched readdir prefetch RPCs completed"
+	(( prefetched > 0 )) || error "no readdir pages were prefetched"
+
+	count=$(ls -f $DIR/$tdir | sort -u | wc -l)
+	(( count == nfiles + 2 )) ||
+		error "cached readdir found $count entries, expect $((nfiles + 2))"
+
+	# drop the directory while prefetches are in flight, the last
+	# reference of the inode may be released by the prefetch
+	cancel_lru_locks mdc
+	ls -f $DIR/$tdir > /dev/null 2>&1 &
+	unlinkmany $DIR/$tdir/$tfile-with-a-rather-long-name- $nfiles ||
+		error "unlinkmany failed"
+	wait
+	rmdir $DIR/$tdir || error "rmdir failed"
+	cancel_lru_locks mdc
+}
+run_test 24G "readdir prefetches the pages ahead of the cursor"
+
 test_25a() {
 	echo '== symlink sanity ============================================='
 
@@ -7140,6 +7184,189 @@ test_56xf() {
 }
 run_test 56xf "FID is not lost during migration of a composite layout file"
 
+test_56xg() {
+	[[ $OSTCOUNT -ge 2 ]] || skip_env "needs >= 2 OSTs"
+	check_swap_layouts_support
+
+	local dir=$DIR/$tdir
+	local file=$dir/$tfile
+	local ref=$TMP/$tfile.ref
+
+	test_mkdir $dir || error "cannot create dir $dir"
+	stack_trap "rm -f $ref"
+
+	# data, a hole and a partial page at the end of the file
+	dd if=/dev/urandom of=$ref bs=1M count=5 || error "dd $ref failed"
+	dd if=/dev/urandom of=$ref bs=4097 count=1 seek=$((10 * 256)) \
+		conv=notrunc || error "dd $ref failed"
+
+	$LFS setstripe -c 2 -S 64K $file || error "setstripe $file failed"
+	cp --sparse=always $ref $file || error "cp $ref $file failed"
+
+	local threads
+
+	for threads in 1 4 16; do
+		$LFS migrate -c 1 -S 128K --threads $threads $file ||
+			error "migrate --threads $threads failed"
+		cmp $ref $file || error "$file differs, $threads threads"
+		$LFS migrate -c 2 -S 64K --non-direct --threads $threads \
+			$file || error "migrate -D --threads $threads failed"
+		cmp $ref $file || error "$file differs, -D, $threads threads"
+		$LFS migrate -c 1 --non-block --threads $threads $file ||
+			error "migrate -n --threads $threads failed"
+		cmp $ref $file || error "$file differs, -n, $threads threads"
+	done
+
+	local out=$($LFS migrate -c 2 --stats $file)
+
+	echo "$out"
+	[[ "$out" =~ "pct: 100%" ]] || error "no final progress report"
+	cmp $ref $file || error "$file differs after migrate --stats"
+
+	$LFS migrate --threads 0 $file && error "--threads 0 accepted"
+	$LFS setstripe --threads 2 $dir/$tfile.2 &&
+		error "--threads accepted by setstripe"
+	return 0
+}
+run_test 56xg "lfs migrate with several copy threads"
+
+test_56xh() {
+	[[ $OSTCOUNT -ge 2 ]] || skip_env "needs >= 2 OSTs"
+	[[ -x "$LLMIGRATE" ]] || skip_env "llmigrate not found"
+	check_swap_layouts_support
+
+	local dir=$DIR/$tdir
+	local list=$TMP/$tfile.fids
+	local ckpt=$TMP/$tfile.ckpt
+	local nfiles=20
+	local i
+
+	test_mkdir $dir || error "cannot create dir $dir"
+	stack_trap "rm -f $list $ckpt $TMP/$tfile.ref.*"
+
+	echo "# files to migrate" > $list
+	for ((i = 0; i < nfiles; i++)); do
+		$LFS setstripe -c 2 $dir/$tfile.$i ||
+			error "setstripe $dir/$tfile.$i failed"
+		dd if=/dev/urandom of=$TMP/$tfile.ref.$i bs=64K \
+			count=$((i + 1)) 2>/dev/null || error "dd $i failed"
+		cp $TMP/$tfile.ref.$i $dir/$tfile.$i || error "cp $i failed"
+		$LFS path2fid $dir/$tfile.$i >> $list ||
+			error "path2fid $dir/$tfile.$i failed"
+	done
+	# a missing file is skipped, and does not fail the run
+	echo "[0x200000400:0x1:0x0]" >> $list
+
+	$LLMIGRATE -f $list -c 1 -t 4 -o 1 -C 2 -k $ckpt -s 1 $MOUNT ||
+		error "llmigrate failed"
+
+	for ((i = 0; i < nfiles; i++)); do
+		local count=$($LFS getstripe -c $dir/$tfile.$i)
+
+		[[ $count == 1 ]] ||
+			error "$dir/$tfile.$i stripe count $count != 1"
+		cmp $TMP/$tfile.ref.$i $dir/$tfile.$i ||
+			error "$dir/$tfile.$i differs after llmigrate"
+	done
+
+	local lines=$(wc -l < $list)
+
+	[[ $(cat $ckpt) == $lines ]] ||
+		error "checkpoint $(cat $ckpt) != $lines lines"
+
+	# a restart from the checkpoint has nothing left to do
+	$LFS setstripe -c 2 $dir/$tfile.new || error "setstripe new failed"
+	$LFS path2fid $dir/$tfile.new >> $list || error "path2fid new failed"
+	$LLMIGRATE -f $list -c 1 -k $ckpt $MOUNT ||
+		error "llmigrate restart failed"
+	[[ $($LFS getstripe -c $dir/$tfile.new) == 1 ]] ||
+		error "$dir/$tfile.new not migrated on restart"
+	[[ $(cat $ckpt) == $((lines + 1)) ]] ||
+		error "checkpoint $(cat $ckpt) != $((lines + 1)) lines"
+}
+run_test 56xh "llmigrate migrates a list of FIDs"
+
+test_56xi() {
+	[[ $OSTCOUNT -ge 2 ]] || skip_env "needs >= 2 OSTs"
+	[[ -x "$LLMIGRATE" ]] || skip_env "llmigrate not found"
+	remote_mds_nodsh && skip "remote MDS with nodsh"
+	check_swap_layouts_support
+
+	local dir=$DIR/$tdir
+	local mdt=$(facet_svc $SINGLEMDS)
+	local out=$TMP/$tfile.out
+	local nfiles=10
+	local cl_user
+	local fid
+	local rec
+	local i
+
+	changelog_register || error "changelog_register failed"
+	cl_user="${CL_USERS[$SINGLEMDS]%% *}"
+	changelog_chmask "+CLOSE"
+	stack_trap "rm -f $out $TMP/$tfile.ref.*"
+
+	$LFS mkdir -i 0 -c 1 $dir || error "cannot create dir $dir"
+	for ((i = 0; i < nfiles; i++)); do
+		$LFS setstripe -c 2 $dir/$tfile.$i ||
+			error "setstripe $dir/$tfile.$i failed"
+		dd if=/dev/urandom of=$TMP/$tfile.ref.$i bs=64K \
+			count=$((i + 1)) 2>/dev/null || error "dd $i failed"
+		cp $TMP/$tfile.ref.$i $dir/$tfile.$i || error "cp $i failed"
+	done
+	# a file closed twice is migrated once
+	cat $TMP/$tfile.ref.0 > $dir/$tfile.0 || error "rewrite 0 failed"
+	# a file that cannot be migrated holds the changelog clear back
+	chattr +i $dir/$tfile.1 || error "chattr +i failed"
+	stack_trap "chattr -i $dir/$tfile.1"
+	fid=$($LFS path2fid $dir/$tfile.1 | tr -d '[]')
+	rec=$($LFS changelog $mdt | awk '/CLOSE/ && /t=\['$fid'\]/ {
+		print $1; exit }')
+	[[ -n "$rec" ]] || error "no CLOSE record for $dir/$tfile.1"
+
+	# without a target layout that can be recognized, each run would
+	# migrate the files of the previous one again
+	$LLMIGRATE -m $mdt -u $cl_user -d $MOUNT &&
+		error "-d without a target layout accepted"
+	$LLMIGRATE -m $mdt -u $cl_user $MOUNT &&
+		error "-m without a target layout accepted"
+	$LLMIGRATE -m $mdt -u $cl_user -c -1 -p pool1 -d $MOUNT &&
+		error "-m with -c -1 accepted"
+	$LLMIGRATE $MOUNT && error "no FID source accepted"
+
+	$LLMIGRATE -m $mdt -u $cl_user -c 1 -a 0 -t 4 $MOUNT > $out &&
+		error "llmigrate succeeded with an immutable file"
+	cat $out
+	grep -q "files: $((nfiles - 1))," $out ||
+		error "$((nfiles - 1)) files not migrated"
+	grep -q "failed: 1 " $out || error "immutable file not failed"
+	(( $(changelog_user_rec $SINGLEMDS $cl_user) < rec )) ||
+		error "changelog cleared past the failed record $rec"
+
+	for ((i = 0; i < nfiles; i++)); do
+		[[ $i == 1 ]] && continue
+		[[ $($LFS getstripe -c $dir/$tfile.$i) == 1 ]] ||
+			error "$dir/$tfile.$i not migrated"
+		cmp $TMP/$tfile.ref.$i $dir/$tfile.$i ||
+			error "$dir/$tfile.$i differs after llmigrate"
+	done
+
+	# the CLOSE records of the migration itself are skipped, and the
+	# failed file is migrated on restart
+	chattr -i $dir/$tfile.1 || error "chattr -i failed"
+	$LLMIGRATE -m $mdt -u $cl_user -c 1 -a 0 $MOUNT > $out ||
+		error "llmigrate restart failed"
+	cat $out
+	grep -q "files: 1," $out || error "files migrated again on restart"
+	[[ $($LFS getstripe -c $dir/$tfile.1) == 1 ]] ||
+		error "$dir/$tfile.1 not migrated on restart"
+	cmp $TMP/$tfile.ref.1 $dir/$tfile.1 ||
+		error "$dir/$tfile.1 differs after llmigrate"
+	(( $(changelog_user_rec $SINGLEMDS $cl_user) > rec )) ||
+		error "changelog not cleared past $rec"
+}
+run_test 56xi "llmigrate migrates the files of the changelog"
+
 test_56y() {
 	[ $MDS1_VERSION -lt $(version_code 2.4.53) ] &&
 		skip "No HSM $(lustre_build_version $SINGLEMDS) MDS < 2.4.53"
@@ -7376,6 +7603,36 @@ test_56ca() {
 }
 run_test 56ca "check lfs find --mirror-count|-N and --mirror-state"
 
+test_56cb() {
+	local dir=$DIR/$tdir
+	local serial=$TMP/$tfile.serial
+	local parallel=$TMP/$tfile.parallel
+
+	stack_trap "rm -f $serial $parallel" EXIT
+
+	test_mkdir $dir
+	for d in 1 2 3 4; do
+		test_mkdir -p $dir/d$d/sub1/sub2
+		createmany -o $dir/d$d/f 50 > /dev/null
+		createmany -o $dir/d$d/sub1/sub2/f 50 > /dev/null
+	done
+	dd if=/dev/zero of=$dir/d1/big bs=1M count=2 || error "dd failed"
+
+	for opts in "" "--type f" "--maxdepth 2" "--size +1M" "! --type d"; do
+		$LFS find $dir $opts | sort > $serial ||
+			error "lfs find $opts failed"
+		$LFS find --threads 4 $dir $opts | sort > $parallel ||
+			error "lfs find --threads 4 $opts failed"
+		[ -s $serial ] || error "lfs find $opts found nothing"
+		diff $serial $parallel ||
+			error "lfs find --threads 4 $opts differs"
+	done
+
+	$LFS find --threads 0 $dir && error "--threads 0 not rejected"
+	true
+}
+run_test 56cb "lfs find --threads matches the serial walk"
+
 test_57a() {
 	[ $PARALLEL == "yes" ] && skip "skip parallel run"
 	# note test will not do anything if MDS is not local
@@ -7905,6 +8162,101 @@ test_64d() {
 }
 run_test 64d "check grant limit exceed"
 
+test_64e() {
+	[ $OST1_VERSION -lt $(version_code 2.13.54) ] &&
+		skip "OST < 2.13.54 doesn't count sync write RPCs"
+
+	local tgt=$($LCTL dl | grep "0000-osc-[^mM]" | awk '{print $4}')
+	local param="obdfilter.$FSNAME-OST0000.tot_write_rpcs"
+	local sync_param="obdfilter.$FSNAME-OST0000.tot_sync_write_rpcs"
+	local granted_param="obdfilter.$FSNAME-OST0000.tot_granted"
+	local saved_debug=$($LCTL get_param -n debug)
+	local brw=$(($($LCTL get_param -n osc.$tgt.max_pages_per_rpc) *
+		     PAGE_SIZE))
+	local chunk=$(grant_chunk $tgt)
+	local before
+	local after
+	local sync
+	local extra
+
+	$LFS setstripe -i 0 -c 1 $DIR/$tfile || error "setstripe failed"
+	stack_trap "rm -f $DIR/$tfile" EXIT
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=16 conv=fsync ||
+		error "dd failed"
+
+	# the OST takes grant back from an export idle for 30s, even when
+	# it has plenty of space
+	sleep 32
+	before=$(do_facet ost1 $LCTL get_param -n $granted_param)
+	$LCTL set_param osc.$tgt.cur_grant_bytes=$brw
+	after=$(do_facet ost1 $LCTL get_param -n $granted_param)
+	echo "idle export shrink: OST granted $before -> $after"
+	(( after < before )) || error "grant of idle export not shrunk"
+
+	# a fast writer is granted more than one chunk at once
+	before=$(do_facet ost1 $LCTL get_param -n $param)
+	stack_trap "$LCTL set_param debug='$saved_debug'" EXIT
+	$LCTL set_param debug=+cache
+	$LCTL clear
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=64 conv=fsync ||
+		error "dd failed"
+	extra=$($LCTL dk | awk '/got [0-9]+ extra grant/ {
+		for (i = 1; i < NF; i++)
+			if ($i == "got" && $(i + 1) > max) max = $(i + 1) }
+		END { print max + 0 }')
+	echo "largest grant of one write reply: $extra, chunk $chunk"
+	(( extra > chunk )) || error "fast writer got $extra <= chunk $chunk"
+
+	after=$(do_facet ost1 $LCTL get_param -n $param)
+	sync=$(do_facet ost1 $LCTL get_param -n $sync_param)
+
+	echo "write RPCs: $before -> $after, sync write RPCs: $sync"
+	(( after > before )) || error "write RPCs not counted"
+	(( sync <= after )) || error "sync write RPCs $sync > total $after"
+
+	# direct I/O never asks for grant, it is not a sync fallback
+	before=$sync
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=16 oflag=direct ||
+		error "dd direct failed"
+	sync=$(do_facet ost1 $LCTL get_param -n $sync_param)
+	echo "sync write RPCs after direct I/O: $before -> $sync"
+	(( sync == before )) || error "direct writes counted as sync writes"
+}
+run_test 64e "check grant prediction and sync write RPC accounting"
+
+test_64f() {
+	[ $OST1_VERSION -lt $(version_code 2.13.54) ] &&
+		skip "OST < 2.13.54 doesn't batch sync writes"
+
+	local param="obdfilter.$FSNAME-OST0000.sync_batch_usec"
+	local stats="obdfilter.$FSNAME-OST0000.sync_batch_stats"
+	local old=$(do_facet ost1 $LCTL get_param -n $param)
+
+	do_facet ost1 $LCTL set_param $param=5000
+	stack_trap "do_facet ost1 $LCTL set_param $param=$old" EXIT
+	do_facet ost1 $LCTL set_param $stats=clear
+
+	local batched
+	local i
+
+	# page cache writes are sent as OBD_BRW_ASYNC even with oflag=sync,
+	# only direct writes are synchronous on the OST
+	for i in $(seq 8); do
+		$LFS setstripe -i 0 -c 1 $DIR/$tfile.$i ||
+			error "setstripe $tfile.$i failed"
+		dd if=/dev/zero of=$DIR/$tfile.$i bs=4k count=64 \
+			oflag=direct &
+	done
+	wait
+
+	do_facet ost1 $LCTL get_param $stats
+	# commits shared by more than one RPC
+	batched=$(do_facet ost1 $LCTL get_param -n $stats |
+		  awk '$2 == "rpcs:" && $1 > 1 { n += $5 } END { print n + 0 }')
+	(( batched > 0 )) || error "no commit shared by several sync writes"
+}
+run_test 64f "check sync write group commit"
+
 # bug 1414 - set/get directories' stripe info
 test_65a() {
 	[ $PARALLEL == "yes" ] && skip "skip parallel run"
@@ -10107,6 +10459,39 @@ test_102t() {
 }
 run_test 102t "zero length xattr values handled correctly"
 
+test_102u() {
+	[ $MDS1_VERSION -lt $(version_code 2.11.52) ] &&
+		skip "MDS needs to be at least 2.11.52"
+
+	local save="$TMP/$TESTSUITE-$TESTNAME.parameters"
+
+	save_lustre_params client "llite.*.xattr_cache" > $save
+	stack_trap "restore_lustre_params < $save" EXIT
+	lctl set_param llite.*.xattr_cache=1
+
+	touch $DIR/$tfile || error "touch failed"
+	setfattr -n user.u102 -v value $DIR/$tfile || error "setfattr failed"
+	cancel_lru_locks mdc
+	lctl set_param llite.*.stats=clear
+
+	local i
+
+	for i in $(seq 10); do
+		getfattr -n user.n102u $DIR/$tfile 2>/dev/null &&
+			error "getxattr 'user.n102u' should fail"
+	done
+	getfattr -n user.u102 --only-values $DIR/$tfile | grep -q value ||
+		error "wrong value of user.u102"
+
+	local neg=$(lctl get_param -n llite.*.stats |
+		    awk '/getxattr_neg_hits/ { print $2 }')
+
+	echo "negative hits: $neg"
+	(( ${neg:-0} >= 9 )) ||
+		error "missing xattr not cached: ${neg:-0} negative hits"
+}
+run_test 102u "nonexistent xattrs are cached as negative entries"
+
 run_acl_subtest()
 {
     $LUSTRE/tests/acl/run $LUSTRE/tests/acl/$1.test
@@ -10328,6 +10713,35 @@ test_105e() { # bug 22660 && 22040
 }
 run_test 105e "Two conflicting flocks from same process"
 
+test_105f() {
+	flock_is_enabled || skip_env "mount w/o flock enabled"
+
+	local nprocs=$(nproc)
+	local count=2000
+	local one
+	local many
+
+	(( nprocs > 1 )) || skip "need more than one CPU"
+	(( nprocs <= 16 )) || nprocs=16
+
+	test_mkdir $DIR/$tdir
+	stack_trap "rm -rf $DIR/$tdir" EXIT
+
+	# the same number of locks, each with a new handle on client and MDT
+	one=$(flocks_test 6 1 $((count * nprocs)) $DIR/$tdir/$tfile) ||
+		error "flocks_test with 1 process failed"
+	echo "$one"
+	many=$(flocks_test 6 $nprocs $count $DIR/$tdir/$tfile) ||
+		error "flocks_test with $nprocs processes failed"
+	echo "$many"
+
+	one=$(awk '{ print $(NF - 1) }' <<< "$one")
+	many=$(awk '{ print $(NF - 1) }' <<< "$many")
+	(( many > one )) ||
+		error "$nprocs processes enqueue $many locks/s, 1 does $one"
+}
+run_test 105f "flock enqueue rate scales with processes"
+
 test_106() { #bug 10921
 	test_mkdir $DIR/$tdir
 	$DIR/$tdir && error "exec $DIR/$tdir succeeded"
@@ -11167,6 +11581,106 @@ test_119d() # bug 15950
 }
 run_test 119d "The DIO path should try to send a new rpc once one is completed"
 
+test_119e()
+{
+	local params=$TMP/$tfile.params
+	local src=$TMP/$tfile.src
+	local saved_debug=$($LCTL get_param -n debug)
+	local windows
+	local size
+
+	save_lustre_params client "llite.*.dio_submit_mb" > $params
+	stack_trap "restore_lustre_params < $params; rm -f $params $src" EXIT
+	stack_trap "$LCTL set_param debug='$saved_debug'" EXIT
+	$LCTL set_param debug=+vfstrace
+
+	# lov cuts the IO of striped files at stripe boundaries, only the
+	# IO of a single stripe file is larger than the window
+	$LFS setstripe -c 1 $DIR/$tfile || error "setstripe failed"
+	dd if=/dev/urandom of=$src bs=1M count=16 || error "dd to $src failed"
+
+	for size in 0 1 4 16; do
+		$LCTL set_param llite.*.dio_submit_mb=$size
+		$LCTL clear
+		dd if=$src of=$DIR/$tfile bs=16M count=1 oflag=direct ||
+			error "DIO write with dio_submit_mb=$size failed"
+		windows=$($LCTL dk | grep -c "DIO window")
+		(( windows == (size ? 16 / size : 1) )) ||
+			error "$windows windows with dio_submit_mb=$size"
+		cancel_lru_locks osc
+		cmp $src $DIR/$tfile ||
+			error "data mismatch with dio_submit_mb=$size"
+		dd if=$DIR/$tfile of=$src.$size bs=16M count=1 iflag=direct ||
+			error "DIO read with dio_submit_mb=$size failed"
+		cmp $src $src.$size ||
+			error "DIO read mismatch with dio_submit_mb=$size"
+		rm -f $src.$size
+	done
+
+	$LCTL set_param llite.*.dio_submit_mb=3 &&
+		error "dio_submit_mb must be a power of two"
+	return 0
+}
+run_test 119e "large DIO submitted in windows"
+
+test_119f()
+{
+	[ $OSTCOUNT -lt 2 ] && skip_env "needs >= 2 OSTs"
+
+	local params=$TMP/$tfile.params
+	local src=$TMP/$tfile.src
+	local osts=$(comma_list $(osts_nodes))
+	local jobstats=false
+
+	save_lustre_params client "lov.*.submit_parallel" > $params
+	save_lustre_params client "llite.*.dio_submit_mb" >> $params
+	stack_trap "restore_lustre_params < $params; rm -f $params $src" EXIT
+
+	$LFS setstripe -c -1 -S 1M $DIR/$tfile || error "setstripe failed"
+	dd if=/dev/urandom of=$src bs=1M count=$((OSTCOUNT * 4)) ||
+		error "dd to $src failed"
+
+	if ! remote_ost_nodsh && [[ $($LCTL get_param -n jobid_var) != \
+	      disable ]]; then
+		jobstats=true
+		do_nodes $osts $LCTL set_param obdfilter.*.job_stats=clear
+	fi
+
+	# a single DIO window covering all the stripes, each of which takes
+	# 500ms to submit, so that the workers overlap
+	$LCTL set_param lov.*.submit_parallel=2 lov.*.submit_stats=clear \
+		llite.*.dio_submit_mb=0
+	#define OBD_FAIL_LOV_SUBMIT_DELAY	0x1416
+	$LCTL set_param fail_loc=0x1416 fail_val=500
+	stack_trap "$LCTL set_param fail_loc=0 fail_val=0" EXIT
+	dd if=$src of=$DIR/$tfile bs=$((OSTCOUNT * 4))M count=1 oflag=direct ||
+		error "DIO write failed"
+	$LCTL set_param fail_loc=0 fail_val=0
+	cancel_lru_locks osc
+	cmp $src $DIR/$tfile || error "data mismatch"
+
+	$LCTL get_param lov.*.submit_stats
+	$LCTL get_param -n lov.*.submit_stats |
+		awk '/- stripes/ { s = 1; next } /^-/ { s = 0 }
+		     s && $1 != "1:" && $4 + 0 > 0 { found = 1 }
+		     END { exit !found }' ||
+		error "no submit covered several stripes"
+	$LCTL get_param -n lov.*.submit_stats |
+		awk '/- concurrent/ { c = 1; next } /^-/ { c = 0 }
+		     c && $1 != "1:" && $4 + 0 > 0 { found = 1 }
+		     END { exit !found }' ||
+		error "no stripes submitted concurrently"
+
+	# the workers build RPCs with the jobid of the writer
+	if $jobstats; then
+		do_nodes $osts $LCTL get_param -n obdfilter.*.job_stats |
+			grep "job_id:.*kworker" &&
+			error "RPCs sent with the jobid of a worker"
+	fi
+	return 0
+}
+run_test 119f "stripe sub-IO submission fanned out to workers"
+
 test_120a() {
 	[ $PARALLEL == "yes" ] && skip "skip parallel run"
 	remote_mds_nodsh && skip "remote MDS with nodsh"
@@ -14085,6 +14599,58 @@ test_156() {
 }
 run_test 156 "Verification of tunables"
 
+test_157() {
+	local site=$($LCTL list_param llite.*.site 2>/dev/null | head -n 1)
+	local ncpus=$(nproc --all)
+	local pages=$((32 * 1048576 / PAGE_SIZE))
+	local before
+	local after
+	local lookup
+	local hit
+	local create
+
+	[[ -n "$site" ]] || skip "no llite site statistics"
+	$LCTL get_param -n $site | grep -q "^pgbuf:" ||
+		skip "no cl_page buffer magazines"
+
+	# "pgbuf:" then lookup, hit, total (held), busy and create, the
+	# columns are 8 characters wide and may touch each other
+	local fields='/^pgbuf:/ {
+		for (i = 7; i < length($0); i += 8)
+			printf("%d ", substr($0, i, 8)) }'
+
+	stack_trap "rm -f $DIR/$tfile" EXIT
+	$LFS setstripe -c 1 -i 0 $DIR/$tfile || error "setstripe failed"
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=32 conv=fsync ||
+		error "dd write failed"
+	# the freed pages fill the magazines of the CPUs that free them
+	cancel_lru_locks osc
+
+	before=($($LCTL get_param -n $site | awk "$fields"))
+	echo "pgbuf before read: ${before[*]}"
+	(( before[2] > 0 )) || error "no buffer held after freeing pages"
+
+	dd if=$DIR/$tfile of=/dev/null bs=1M || error "dd read failed"
+	cancel_lru_locks osc
+
+	after=($($LCTL get_param -n $site | awk "$fields"))
+	echo "pgbuf after read: ${after[*]}"
+	lookup=$((after[0] - before[0]))
+	hit=$((after[1] - before[1]))
+	create=$((after[4] - before[4]))
+
+	(( lookup >= pages )) ||
+		error "$lookup page buffers allocated for $pages pages"
+	(( hit > 0 )) || error "no freed page buffer reused"
+	(( create < lookup )) ||
+		error "all $lookup page buffers allocated from the slab"
+	# full magazines give half of their buffers back to the slab, only
+	# a few of the $pages freed buffers are kept
+	(( after[2] <= 16 * 16 * ncpus )) ||
+		error "${after[2]} buffers kept by $ncpus CPUs"
+}
+run_test 157 "cl_page buffers are reused and given back to the slab"
+
 test_160a() {
 	[ $PARALLEL == "yes" ] && skip "skip parallel run"
 	remote_mds_nodsh && skip "remote MDS with nodsh"
@@ -14842,6 +15408,29 @@ test_160k() {
 }
 run_test 160k "Verify that changelog records are not lost"
 
+test_160l() {
+	remote_mds_nodsh && skip "remote MDS with nodsh"
+
+	local acked
+	local user_rec
+
+	changelog_register || error "changelog_register failed"
+	local cl_user="${CL_USERS[$SINGLEMDS]%% *}"
+
+	changelog_chmask "+CREAT +MKDIR +CLOSE"
+	test_mkdir -i 0 -c 1 $DIR/$tdir
+	touch $DIR/$tdir/$tfile-{1..50}
+
+	acked=$(llapi_changelog_test -d $DIR/$tdir -m $(facet_svc $SINGLEMDS) \
+		-u $cl_user | awk '/^acked/ { print $2 }')
+	[[ -n "$acked" ]] || error "llapi_changelog_test failed"
+
+	user_rec=$(changelog_user_rec $SINGLEMDS $cl_user)
+	(( user_rec == acked )) ||
+		error "$cl_user index $user_rec, $acked acknowledged"
+}
+run_test 160l "changelog reader filter and batch acknowledgement"
+
 test_161a() {
 	[ $PARALLEL == "yes" ] && skip "skip parallel run"
 
@@ -17183,6 +17772,45 @@ test_228c() {
 }
 run_test 228c "NOT shrink the last entry in OI index node to recycle idle leaf"
 
+test_228d() {
+	local param="seq.cli-cli-$FSNAME-MDT0000-mdc-*"
+	local seqs
+	local hits
+	local i
+
+	$LCTL get_param -n $param.alloc_stats ||
+		skip "client does not have FID allocation stats"
+
+	test_mkdir -i 0 -c 1 $DIR/$tdir || error "mkdir $DIR/$tdir failed"
+	$LCTL set_param $param.alloc_stats=clear
+
+	for i in {1..4}; do
+		#define OBD_FAIL_SEQ_EXHAUST             0x1002
+		$LCTL set_param fail_loc=0x80001002
+		touch $DIR/$tdir/f$i || error "touch f$i failed"
+		$LCTL set_param fail_loc=0
+		# let the next sequence be prefetched
+		sleep 1
+	done
+	$LCTL get_param $param.alloc_stats
+
+	seqs=$(for i in {1..4}; do $LFS path2fid $DIR/$tdir/f$i; done |
+	       awk -F: '{ print $1 }' | sort -u | wc -l)
+	(( seqs == 4 )) || error "4 files in $seqs sequences, expect 4"
+
+	hits=$($LCTL get_param -n $param.alloc_stats |
+	       awk '/prefetch_hits:/ { print $2 }')
+	(( hits >= 3 )) || error "$hits prefetched sequences used, expect 3"
+
+	# FIDs allocated from several CPU partitions are still unique
+	createmany -o $DIR/$tdir/m- 2000 &
+	createmany -o $DIR/$tdir/n- 2000 &
+	wait
+	[[ -z "$($LFS path2fid $DIR/$tdir/* | awk '{ print $NF }' |
+		 sort | uniq -d)" ]] || error "duplicate FIDs allocated"
+}
+run_test 228d "FID sequences are prefetched by clients"
+
 test_229() { # LU-2482, LU-3448
 	[ $PARALLEL == "yes" ] && skip "skip parallel run"
 	[ $OSTCOUNT -lt 2 ] && skip_env "needs >= 2 OSTs"
@@ -21103,6 +21731,104 @@ test_300r() {
 }
 run_test 300r "test -1 striped directory"
 
+update_batch_count() {
+	do_facet mds1 $LCTL get_param -n osp.*-osp-MDT*.update_batch_stats |
+		awk -v key="$1:" '$1 == key { n += $2 } END { print n + 0 }'
+}
+
+test_300s() {
+	[ $MDSCOUNT -lt 2 ] && skip_env "needs >= 2 MDTs"
+	remote_mds_nodsh && skip "remote MDS with nodsh"
+
+	local params=$TMP/$tfile.params
+	local dirs=200
+	local batch
+	local rpcs
+	local trans
+
+	save_lustre_params mds1 "osp.*-osp-MDT*.max_update_batch" > $params
+	stack_trap "restore_lustre_params < $params; rm -f $params" EXIT
+
+	mkdir $DIR/$tdir || error "mkdir $tdir failed"
+	# 1 sends each transaction in its own RPC
+	for batch in 1 16; do
+		do_facet mds1 $LCTL set_param osp.*-osp-MDT*.max_update_batch=$batch
+		rpcs=$(update_batch_count rpcs)
+		trans=$(update_batch_count transactions)
+
+		mkdir $DIR/$tdir/b$batch || error "mkdir b$batch failed"
+		for ((i = 0; i < dirs; i++)); do
+			$LFS mkdir -i 0 -c $MDSCOUNT $DIR/$tdir/b$batch/d$i &
+		done
+		wait
+
+		for ((i = 0; i < dirs; i++)); do
+			[ $($LFS getdirstripe -c $DIR/$tdir/b$batch/d$i) -eq \
+			  $MDSCOUNT ] || error "bad stripe count of b$batch/d$i"
+			touch $DIR/$tdir/b$batch/d$i/f ||
+				error "touch b$batch/d$i/f failed"
+		done
+
+		do_facet mds1 $LCTL get_param osp.*-osp-MDT*.update_batch_stats
+		rpcs=$(($(update_batch_count rpcs) - rpcs))
+		trans=$(($(update_batch_count transactions) - trans))
+		echo "batch $batch: $trans transactions in $rpcs OUT RPCs"
+		(( rpcs > 0 )) || error "batch $batch: no OUT RPC counted"
+		if (( batch == 1 )); then
+			(( trans == rpcs )) ||
+				error "batch 1: $trans transactions in $rpcs RPCs"
+		else
+			(( trans > rpcs )) ||
+				error "batch $batch: no RPC carried several transactions ($trans in $rpcs)"
+		fi
+	done
+
+	rm -rf $DIR/$tdir || error "rm $tdir failed"
+}
+run_test 300s "striped directories created with batched OUT updates"
+
+test_300t() {
+	[ $MDSCOUNT -lt 2 ] && skip_env "needs >= 2 MDTs"
+	remote_mds_nodsh && skip "remote MDS with nodsh"
+
+	local params=$TMP/$tfile.params
+	local saved_debug=$(do_facet mds2 $LCTL get_param -n debug)
+	local dirs=200
+	local rebuilt
+
+	save_lustre_params mds1 "osp.*-osp-MDT*.max_update_batch" > $params
+	stack_trap "restore_lustre_params < $params; rm -f $params" EXIT
+	stack_trap "do_facet mds2 $LCTL set_param debug='$saved_debug'" EXIT
+	do_facet mds1 $LCTL set_param osp.*-osp-MDT*.max_update_batch=16
+	do_facet mds2 $LCTL set_param debug=+rpctrace
+	do_facet mds2 $LCTL clear
+
+	mkdir $DIR/$tdir || error "mkdir $tdir failed"
+	# drop the reply of the first OUT RPC of several transactions, so
+	# that the transactions are rebuilt from last_rcvd when it is resent
+	#define OBD_FAIL_OUT_BATCH_NET_REP	0x1706
+	do_facet mds2 $LCTL set_param fail_loc=0x80001706
+	stack_trap "do_facet mds2 $LCTL set_param fail_loc=0" EXIT
+	for ((i = 0; i < dirs; i++)); do
+		$LFS mkdir -i 0 -c $MDSCOUNT $DIR/$tdir/d$i &
+	done
+	wait
+
+	for ((i = 0; i < dirs; i++)); do
+		[ $($LFS getdirstripe -c $DIR/$tdir/d$i) -eq $MDSCOUNT ] ||
+			error "bad stripe count of d$i"
+		touch $DIR/$tdir/d$i/f || error "touch d$i/f failed"
+	done
+
+	rebuilt=$(do_facet mds2 $LCTL dk |
+		  grep -c "restoring resent RPC transaction [1-9]")
+	echo "$rebuilt batched updates rebuilt"
+	(( rebuilt > 0 )) || error "no batched OUT RPC was rebuilt"
+
+	rm -rf $DIR/$tdir || error "rm $tdir failed"
+}
+run_test 300t "resent batched OUT RPC is rebuilt per transaction"
+
 prepare_remote_file() {
 	mkdir $DIR/$tdir/src_dir ||
 		error "create remote source failed"
@@ -22946,6 +23672,23 @@ test_424() {
 }
 run_test 424 "simulate ENOMEM in ptl_send_rpc bulk reply ME attach"
 
+test_425() {
+	local mod=$LUSTRE/tests/kernel/krangelock.ko
+
+	[[ -f $mod ]] || skip "no $mod"
+
+	local run_id=$RANDOM
+
+	# Try to insert the module. This will always fail as the
+	# module is designed to not be inserted.
+	insmod $mod run_id=$run_id threads=$((2 * $(nproc))) &> /dev/null
+
+	dmesg | grep "lustre_krangelock_$run_id: threads"
+	dmesg | grep -q "lustre_krangelock_$run_id: range lock runs completed" ||
+		error "range lock benchmark failed"
+}
+run_test 425 "range lock scalability of shared file writers"
+
 prep_801() {
 	[[ $MDS1_VERSION -lt $(version_code 2.9.55) ]] ||
 	[[ $OST1_VERSION -lt $(version_code 2.9.55) ]] &&
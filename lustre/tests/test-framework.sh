@@ -333,6 +333,10 @@ init_test_env() {
 	[ ! -f "$LSOM_SYNC" ] &&
 		export LSOM_SYNC=$(which llsom_sync 2> /dev/null)
 	[ -z "$LSOM_SYNC" ] && export LSOM_SYNC="/usr/sbin/llsom_sync"
+	export LLMIGRATE=${LLMIGRATE:-"$LUSTRE/utils/llmigrate"}
+	[ ! -f "$LLMIGRATE" ] &&
+		export LLMIGRATE=$(which llmigrate 2> /dev/null)
+	[ -z "$LLMIGRATE" ] && export LLMIGRATE="/usr/sbin/llmigrate"
 	export NAME=${NAME:-local}
 	export LGSSD=${LGSSD:-"$LUSTRE/utils/gss/lgssd"}
 	[ "$GSS_PIPEFS" = "true" ] && [ ! -f "$LGSSD" ] &&
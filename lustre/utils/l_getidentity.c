@@ -72,7 +72,7 @@ static char *progname;
 static void usage(void)
 {
 	fprintf(stderr,
-		"\nusage: %s {-d|mdtname} {uid}\n"
+		"\nusage: %s {-d|mdtname} {uid} [uid ...]\n"
 		"Normally invoked as an upcall from Lustre, set via:\n"
 		"lctl set_param mdt.${mdtname}.identity_upcall={path to upcall}\n"
 		"\t-d: debug, print values to stdout instead of Lustre\n",
@@ -402,42 +402,14 @@ static void show_result(struct identity_downcall_data *data)
 	printf("\n");
 }
 
-int main(int argc, char **argv)
+/* resolve one uid and send the result to the MDT */
+static int get_identity(const char *mdtname, unsigned long uid,
+			struct identity_downcall_data *data, int maxgroups)
 {
-	char *end;
-	struct identity_downcall_data *data = NULL;
 	glob_t path;
-	unsigned long uid;
-	int fd, rc = -EINVAL, size, maxgroups;
-
-	progname = basename(argv[0]);
-	if (argc != 3) {
-		usage();
-		goto out;
-	}
-
-	uid = strtoul(argv[2], &end, 0);
-	if (*end) {
-		errlog("%s: invalid uid '%s'\n", progname, argv[2]);
-		goto out;
-	}
-
-	maxgroups = sysconf(_SC_NGROUPS_MAX);
-	if (maxgroups > NGROUPS_MAX)
-		maxgroups = NGROUPS_MAX;
-	if (maxgroups == -1) {
-		rc = -EINVAL;
-		goto out;
-	}
+	int fd, rc, size;
 
 	size = offsetof(struct identity_downcall_data, idd_groups[maxgroups]);
-	data = malloc(size);
-	if (!data) {
-		errlog("malloc identity downcall data(%d) failed!\n", size);
-		rc = -ENOMEM;
-		goto out;
-	}
-
 	memset(data, 0, size);
 	data->idd_magic = IDENTITY_DOWNCALL_MAGIC;
 	data->idd_uid = uid;
@@ -452,17 +424,14 @@ int main(int argc, char **argv)
 	rc = get_perms(data);
 
 downcall:
-	if (strcmp(argv[1], "-d") == 0 || getenv("L_GETIDENTITY_TEST")) {
+	if (strcmp(mdtname, "-d") == 0 || getenv("L_GETIDENTITY_TEST")) {
 		show_result(data);
-		rc = 0;
-		goto out;
+		return 0;
 	}
 
-	rc = cfs_get_param_paths(&path, "mdt/%s/identity_info", argv[1]);
-	if (rc != 0) {
-		rc = -errno;
-		goto out;
-	}
+	rc = cfs_get_param_paths(&path, "mdt/%s/identity_info", mdtname);
+	if (rc != 0)
+		return -errno;
 
 	fd = open(path.gl_pathv[0], O_WRONLY);
 	if (fd < 0) {
@@ -483,6 +452,55 @@ downcall:
 
 out_params:
 	cfs_free_param_data(&path);
+	return rc;
+}
+
+int main(int argc, char **argv)
+{
+	char *end;
+	struct identity_downcall_data *data = NULL;
+	unsigned long uid;
+	int rc = -EINVAL, rc2, size, maxgroups, i;
+
+	progname = basename(argv[0]);
+	if (argc < 3) {
+		usage();
+		goto out;
+	}
+
+	for (i = 2; i < argc; i++) {
+		strtoul(argv[i], &end, 0);
+		if (*end) {
+			errlog("%s: invalid uid '%s'\n", progname, argv[i]);
+			goto out;
+		}
+	}
+
+	maxgroups = sysconf(_SC_NGROUPS_MAX);
+	if (maxgroups > NGROUPS_MAX)
+		maxgroups = NGROUPS_MAX;
+	if (maxgroups == -1) {
+		rc = -EINVAL;
+		goto out;
+	}
+
+	size = offsetof(struct identity_downcall_data, idd_groups[maxgroups]);
+	data = malloc(size);
+	if (!data) {
+		errlog("malloc identity downcall data(%d) failed!\n", size);
+		rc = -ENOMEM;
+		goto out;
+	}
+
+	/* the MDT may ask for several uids at once, each gets a downcall */
+	rc = 0;
+	for (i = 2; i < argc; i++) {
+		uid = strtoul(argv[i], NULL, 0);
+		rc2 = get_identity(argv[1], uid, data, maxgroups);
+		if (rc2 && !rc)
+			rc = rc2;
+	}
+
 out:
 	if (data)
 		free(data);
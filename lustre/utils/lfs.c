@@ -265,12 +265,17 @@ static inline int lfs_mirror_delete(int argc, char **argv)
 	SSM_CMD_COMMON("migrate  ")					\
 	"                 [--block|-b] [--non-block|-n]\n"		\
 	"                 [--non-direct|-D] [--verbose|-v]\n"		\
+	"                 [--threads <n>] [--stats]\n"			\
+	"                 [--stats-interval <seconds>]\n"		\
 	"                 <filename>\n"					\
 	SSM_HELP_COMMON							\
 	"\n"								\
 	"\tblock:        Block file access during data migration (default)\n" \
 	"\tnon-block:    Abort migrations if concurrent access is detected\n" \
 	"\tnon-direct:   Do not use direct I/O to copy file contents\n"	\
+	"\tthreads:      Number of threads copying file contents (default 4)\n" \
+	"\tstats:        Print the copy progress every 5 seconds\n"	\
+	"\tstats-interval: Print the copy progress every <seconds>\n"	\
 	"\tverbose:      Print each filename as it is migrated\n"	\
 
 #define SETDIRSTRIPE_USAGE						\
@@ -473,6 +478,7 @@ command_t cmdlist[] = {
 	 "     [[!] --stripe-count|-c [+-]<stripes>]\n"
 	 "     [[!] --stripe-index|-i <index,...>]\n"
 	 "     [[!] --stripe-size|-S [+-]N[kMGT]] [[!] --type|-t <filetype>]\n"
+	 "     [--threads <n>]\n"
 	 "     [[!] --extension-size|--ext-size|-z [+-]N[kMGT]]\n"
 	 "     [[!] --gid|-g|--group|-G <gid>|<gname>]\n"
 	 "     [[!] --uid|-u|--user|-U <uid>|<uname>] [[!] --pool <pool>]\n"
@@ -652,6 +658,8 @@ command_t cmdlist[] = {
 	 "		[--block|-b]\n"
 	 "		[--non-block|-n]\n"
 	 "		[--non-direct|-D]\n"
+	 "		[--threads <n>] [--stats]\n"
+	 "		[--stats-interval <seconds>]\n"
 	 "		<file|directory>\n"
 	 "\tstripe_count:     number of OSTs to stripe a file over\n"
 	 "\t		  Using -C instead of -c allows overstriping, which\n"
@@ -663,7 +671,10 @@ command_t cmdlist[] = {
 	 "\tost_indices:      OSTs to stripe over, in order\n"
 	 "\tblock:        Block file access during data migration (default)\n"
 	 "\tnon-block:    Abort migrations if concurrent access is detected\n"
-	 "\tnon-direct:       do not use direct I/O to copy file contents.\n"},
+	 "\tnon-direct:       do not use direct I/O to copy file contents.\n"
+	 "\tthreads:          number of threads copying file contents.\n"
+	 "\tstats:            print the copy progress every 5 seconds.\n"
+	 "\tstats-interval:   print the copy progress every <seconds>.\n"},
 	{"mv", lfs_mv, 0,
 	 "To move directories between MDTs. This command is deprecated, "
 	 "use \"migrate\" instead.\n"
@@ -759,6 +770,14 @@ enum {
 	MIGRATION_VERBOSE	= 0x0008,
 };
 
+/* threads copying the data of a file being migrated, see --threads */
+#define MIGRATE_COPY_THREADS_DEFAULT	4
+static unsigned int migrate_copy_threads = MIGRATE_COPY_THREADS_DEFAULT;
+/* print the copy progress every migrate_stats_interval seconds */
+#define MIGRATE_STATS_INTERVAL_DEFAULT	5
+static bool migrate_stats;
+static unsigned int migrate_stats_interval = MIGRATE_STATS_INTERVAL_DEFAULT;
+
 static int lfs_component_create(char *fname, int open_flags, mode_t open_mode,
 				struct llapi_layout *layout);
 
@@ -894,72 +913,41 @@ out:
 	return rc;
 }
 
-static int migrate_copy_data(int fd_src, int fd_dst, int (*check_file)(int))
+static void migrate_copy_progress(const struct llapi_copy_stats *stats,
+				  void *data)
 {
-	struct llapi_layout *layout;
-	size_t	 buf_size = 4 * 1024 * 1024;
-	void	*buf = NULL;
-	ssize_t	 rsize = -1;
-	ssize_t	 wsize = 0;
-	size_t	 rpos = 0;
-	size_t	 wpos = 0;
-	off_t	 bufoff = 0;
-	int	 rc;
-
-	layout = llapi_layout_get_by_fd(fd_src, 0);
-	if (layout != NULL) {
-		uint64_t stripe_size;
-
-		rc = llapi_layout_stripe_size_get(layout, &stripe_size);
-		if (rc == 0)
-			buf_size = stripe_size;
+	double mbps = 0;
 
-		llapi_layout_free(layout);
-	}
-
-	/* Use a page-aligned buffer for direct I/O */
-	rc = posix_memalign(&buf, getpagesize(), buf_size);
-	if (rc != 0)
-		return -rc;
+	if (stats->lcs_seconds > 0)
+		mbps = stats->lcs_copied / stats->lcs_seconds / (1 << 20);
 
-	while (1) {
-		/* read new data only if we have written all
-		 * previously read data */
-		if (wpos == rpos) {
-			if (check_file) {
-				rc = check_file(fd_src);
-				if (rc < 0)
-					break;
-			}
+	printf("- { seconds: %.0f, copied: %llu, skipped: %llu, size: %llu, "
+	       "mbps: %.2f, pct: %.0f%% }\n", stats->lcs_seconds,
+	       (unsigned long long)stats->lcs_copied,
+	       (unsigned long long)stats->lcs_skipped,
+	       (unsigned long long)stats->lcs_size, mbps,
+	       stats->lcs_size == 0 ? 100.0 :
+	       100.0 * (stats->lcs_copied + stats->lcs_skipped) /
+	       stats->lcs_size);
+	fflush(stdout);
+}
 
-			rsize = read(fd_src, buf, buf_size);
-			if (rsize < 0) {
-				rc = -errno;
-				break;
-			}
-			rpos += rsize;
-			bufoff = 0;
-		}
-		/* eof ? */
-		if (rsize == 0)
-			break;
+static int migrate_copy_data(int fd_src, int fd_dst, int (*check_file)(int))
+{
+	struct llapi_copy_param param = {
+		.lcp_threads = migrate_copy_threads,
+		.lcp_stats_interval = migrate_stats_interval,
+		.lcp_check = check_file,
+	};
+	int rc;
 
-		wsize = write(fd_dst, buf + bufoff, rpos - wpos);
-		if (wsize < 0) {
-			rc = -errno;
-			break;
-		}
-		wpos += wsize;
-		bufoff += wsize;
-	}
+	if (migrate_stats)
+		param.lcp_progress = migrate_copy_progress;
 
-	if (rc == 0) {
-		rc = fsync(fd_dst);
-		if (rc < 0)
-			rc = -errno;
-	}
+	rc = llapi_file_copy_data(fd_src, fd_dst, &param);
+	if (rc == 0 && migrate_stats)
+		migrate_copy_progress(&param.lcp_stats, NULL);
 
-	free(buf);
 	return rc;
 }
 
@@ -3073,6 +3061,9 @@ enum {
 	LFS_LAYOUT_FOREIGN_OPT,
 	LFS_MODE_OPT,
 	LFS_NEWERXY_OPT,
+	LFS_THREADS_OPT,
+	LFS_STATS_OPT,
+	LFS_STATS_INTERVAL_OPT,
 };
 
 /* functions */
@@ -3158,6 +3149,15 @@ static int lfs_setstripe_internal(int argc, char **argv,
 			.name = "mode",		.has_arg = required_argument},
 	{ .val = LFS_LAYOUT_COPY,
 			.name = "copy",		.has_arg = required_argument},
+	/* --stats, --stats-interval and --threads are only valid in
+	 * migrate mode */
+	{ .val = LFS_STATS_OPT,
+			.name = "stats",	.has_arg = no_argument},
+	{ .val = LFS_STATS_INTERVAL_OPT,
+			.name = "stats-interval",
+						.has_arg = required_argument},
+	{ .val = LFS_THREADS_OPT,
+			.name = "threads",	.has_arg = required_argument},
 	{ .val = 'c',	.name = "stripe-count",	.has_arg = required_argument},
 	{ .val = 'c',	.name = "stripe_count",	.has_arg = required_argument},
 	{ .val = 'c',	.name = "mdt-count",	.has_arg = required_argument},
@@ -3336,6 +3336,46 @@ static int lfs_setstripe_internal(int argc, char **argv,
 				previous_umask = umask(0);
 			}
 			break;
+		case LFS_STATS_OPT:
+			if (!migrate_mode) {
+				fprintf(stderr,
+					"%s %s: --stats is valid only for migrate command\n",
+					progname, argv[0]);
+				goto usage_error;
+			}
+			migrate_stats = true;
+			break;
+		case LFS_STATS_INTERVAL_OPT:
+			if (!migrate_mode) {
+				fprintf(stderr,
+					"%s %s: --stats-interval is valid only for migrate command\n",
+					progname, argv[0]);
+				goto usage_error;
+			}
+			migrate_stats_interval = strtoul(optarg, &end, 0);
+			if (*end != '\0' || migrate_stats_interval == 0) {
+				fprintf(stderr,
+					"%s %s: invalid stats interval '%s'\n",
+					progname, argv[0], optarg);
+				goto usage_error;
+			}
+			migrate_stats = true;
+			break;
+		case LFS_THREADS_OPT:
+			if (!migrate_mode) {
+				fprintf(stderr,
+					"%s %s: --threads is valid only for migrate command\n",
+					progname, argv[0]);
+				goto usage_error;
+			}
+			migrate_copy_threads = strtoul(optarg, &end, 0);
+			if (*end != '\0' || migrate_copy_threads == 0) {
+				fprintf(stderr,
+					"%s %s: invalid thread count '%s'\n",
+					progname, argv[0], optarg);
+				goto usage_error;
+			}
+			break;
 		case LFS_LAYOUT_COPY:
 			from_copy = true;
 			template = optarg;
@@ -4343,6 +4383,8 @@ static int lfs_find(int argc, char **argv)
 	{ .val = 'S',	.name = "stripe_size",	.has_arg = required_argument },
 	{ .val = 't',	.name = "type",		.has_arg = required_argument },
 	{ .val = 'T',	.name = "mdt-count",	.has_arg = required_argument },
+	{ .val = LFS_THREADS_OPT,
+			.name = "threads",	.has_arg = required_argument },
 	{ .val = 'u',	.name = "uid",		.has_arg = required_argument },
 	{ .val = 'U',	.name = "user",		.has_arg = required_argument },
 	{ .val = 'z',	.name = "extension-size",
@@ -4545,6 +4587,16 @@ static int lfs_find(int argc, char **argv)
 		case 'D':
 			param.fp_max_depth = strtol(optarg, 0, 0);
 			break;
+		case LFS_THREADS_OPT:
+			param.fp_thread_count = strtoul(optarg, &endptr, 0);
+			if (*endptr != '\0' || param.fp_thread_count == 0) {
+				fprintf(stderr,
+					"error: bad thread count '%s'\n",
+					optarg);
+				ret = -1;
+				goto err;
+			}
+			break;
 		case 'E':
 			if (optarg[0] == '+') {
 				param.fp_comp_end_sign = -1;
@@ -69,6 +69,7 @@
 #include <unistd.h>
 #endif
 #include <poll.h>
+#include <pthread.h>
 #include <time.h>
 #include <inttypes.h>
 
@@ -2246,6 +2247,352 @@ out:
 	return ret < 0 ? ret : 0;
 }
 
+/*
+ * Parallel traversal for llapi_find().
+ *
+ * Each thread owns a queue of directories still to be scanned. A thread
+ * scans the directories of its own queue newest first, which keeps the
+ * traversal depth first and the queues short, and handles the entries of
+ * a directory in readdir order itself, so the statahead of the client
+ * still sees a readdir + stat pattern. Subdirectories found are pushed to
+ * the queue of the thread. Once its queue is empty, a thread steals the
+ * oldest directory of the queue of another thread, which is usually the
+ * root of the largest subtree left.
+ */
+struct find_work {
+	struct find_work	*fw_next;
+	struct find_work	*fw_prev;
+	unsigned int		 fw_depth;
+	char			 fw_path[0];
+};
+
+struct find_pool;
+
+struct find_worker {
+	pthread_t		 fwk_thread;
+	struct find_pool	*fwk_pool;
+	/* private copy of the parameters, with its own buffers */
+	struct find_param	 fwk_param;
+	char			 fwk_path[PATH_MAX + 1];
+	/* directories to scan, fwk_head is the newest */
+	pthread_mutex_t		 fwk_lock;
+	struct find_work	*fwk_head;
+	struct find_work	*fwk_tail;
+	unsigned int		 fwk_index;
+	int			 fwk_rc;
+};
+
+struct find_pool {
+	pthread_mutex_t		 fpl_lock;
+	pthread_cond_t		 fpl_cond;
+	/* directories queued or being scanned, 0 when the walk is over */
+	unsigned long		 fpl_pending;
+	/* bumped each time a directory is queued */
+	unsigned long		 fpl_generation;
+	semantic_func_t		*fpl_sem_init;
+	semantic_func_t		*fpl_sem_fini;
+	struct find_worker	*fpl_workers;
+	unsigned int		 fpl_count;
+};
+
+static int find_work_add(struct find_worker *w, const char *path,
+			 unsigned int depth)
+{
+	struct find_pool *pool = w->fwk_pool;
+	struct find_work *fw;
+	size_t len = strlen(path) + 1;
+
+	fw = malloc(sizeof(*fw) + len);
+	if (fw == NULL)
+		return -ENOMEM;
+
+	fw->fw_depth = depth;
+	memcpy(fw->fw_path, path, len);
+	fw->fw_prev = NULL;
+
+	pthread_mutex_lock(&w->fwk_lock);
+	fw->fw_next = w->fwk_head;
+	if (w->fwk_head != NULL)
+		w->fwk_head->fw_prev = fw;
+	else
+		w->fwk_tail = fw;
+	w->fwk_head = fw;
+	pthread_mutex_unlock(&w->fwk_lock);
+
+	pthread_mutex_lock(&pool->fpl_lock);
+	pool->fpl_pending++;
+	pool->fpl_generation++;
+	pthread_cond_signal(&pool->fpl_cond);
+	pthread_mutex_unlock(&pool->fpl_lock);
+
+	return 0;
+}
+
+/* take the newest directory of our queue, or the oldest one of \a w */
+static struct find_work *find_work_take(struct find_worker *w, bool own)
+{
+	struct find_work *fw;
+
+	pthread_mutex_lock(&w->fwk_lock);
+	fw = own ? w->fwk_head : w->fwk_tail;
+	if (fw != NULL) {
+		if (fw->fw_prev != NULL)
+			fw->fw_prev->fw_next = fw->fw_next;
+		else
+			w->fwk_head = fw->fw_next;
+		if (fw->fw_next != NULL)
+			fw->fw_next->fw_prev = fw->fw_prev;
+		else
+			w->fwk_tail = fw->fw_prev;
+	}
+	pthread_mutex_unlock(&w->fwk_lock);
+
+	return fw;
+}
+
+/* get the next directory to scan, NULL once the whole tree is done */
+static struct find_work *find_work_get(struct find_worker *w)
+{
+	struct find_pool *pool = w->fwk_pool;
+	struct find_work *fw;
+	unsigned long generation;
+	unsigned int i;
+
+	while (1) {
+		pthread_mutex_lock(&pool->fpl_lock);
+		generation = pool->fpl_generation;
+		pthread_mutex_unlock(&pool->fpl_lock);
+
+		fw = find_work_take(w, true);
+		for (i = 1; fw == NULL && i < pool->fpl_count; i++)
+			fw = find_work_take(&pool->fpl_workers[(w->fwk_index +
+							       i) %
+							      pool->fpl_count],
+					    false);
+		if (fw != NULL)
+			return fw;
+
+		/* nothing to steal, wait for a new directory or the end */
+		pthread_mutex_lock(&pool->fpl_lock);
+		while (pool->fpl_pending > 0 &&
+		       pool->fpl_generation == generation)
+			pthread_cond_wait(&pool->fpl_cond, &pool->fpl_lock);
+		if (pool->fpl_pending == 0) {
+			pthread_mutex_unlock(&pool->fpl_lock);
+			return NULL;
+		}
+		pthread_mutex_unlock(&pool->fpl_lock);
+	}
+}
+
+static void find_work_done(struct find_pool *pool, struct find_work *fw)
+{
+	free(fw);
+
+	pthread_mutex_lock(&pool->fpl_lock);
+	if (--pool->fpl_pending == 0)
+		pthread_cond_broadcast(&pool->fpl_cond);
+	pthread_mutex_unlock(&pool->fpl_lock);
+}
+
+/*
+ * Scan one directory as llapi_semantic_traverse() does, except that the
+ * subdirectories are queued instead of being walked recursively.
+ */
+static int find_work_scan(struct find_worker *w, struct find_work *fw)
+{
+	struct find_pool *pool = w->fwk_pool;
+	struct find_param *param = &w->fwk_param;
+	struct dirent64 dirent = { .d_type = DT_DIR };
+	struct dirent64 *dent;
+	char *path = w->fwk_path;
+	int len, ret = 0;
+	DIR *d;
+
+	snprintf(path, sizeof(w->fwk_path), "%s", fw->fw_path);
+	len = strlen(path);
+
+	d = opendir(path);
+	if (d == NULL) {
+		ret = -errno;
+		llapi_error(LLAPI_MSG_ERROR, ret, "%s: Failed to open '%s'",
+			    __func__, path);
+		return ret;
+	}
+
+	param->fp_depth = fw->fw_depth;
+	ret = pool->fpl_sem_init(path, NULL, &d, param,
+				 fw->fw_depth == 0 ? NULL : &dirent);
+	if (ret)
+		goto out;
+
+	while ((dent = readdir64(d)) != NULL) {
+		int rc;
+
+		if (!strcmp(dent->d_name, ".") || !strcmp(dent->d_name, ".."))
+			continue;
+
+		path[len] = 0;
+		if ((len + dent->d_reclen + 2) > sizeof(w->fwk_path)) {
+			llapi_err_noerrno(LLAPI_MSG_ERROR,
+					  "error: %s: string buffer too small",
+					  __func__);
+			break;
+		}
+		strcat(path, "/");
+		strcat(path, dent->d_name);
+
+		if (dent->d_type == DT_UNKNOWN) {
+			struct lov_user_mds_data *lmd = param->fp_lmd;
+
+			rc = get_lmd_info(path, d, NULL, lmd,
+					  param->fp_lum_size, GET_LMD_INFO);
+			if (rc == 0)
+				dent->d_type = IFTODT(lmd->lmd_stx.stx_mode);
+			else if (ret == 0)
+				ret = rc;
+
+			if (rc == -ENOENT)
+				continue;
+		}
+		switch (dent->d_type) {
+		case DT_UNKNOWN:
+			llapi_err_noerrno(LLAPI_MSG_ERROR,
+					  "error: %s: '%s' is UNKNOWN type %d",
+					  __func__, dent->d_name, dent->d_type);
+			break;
+		case DT_DIR:
+			rc = find_work_add(w, path, param->fp_depth);
+			if (rc != 0 && ret == 0)
+				ret = rc;
+			break;
+		default:
+			rc = pool->fpl_sem_init(path, d, NULL, param, dent);
+			if (rc < 0 && ret == 0) {
+				ret = rc;
+				break;
+			}
+			if (pool->fpl_sem_fini && rc == 0)
+				pool->fpl_sem_fini(path, d, NULL, param, dent);
+		}
+	}
+
+	path[len] = 0;
+	if (pool->fpl_sem_fini)
+		pool->fpl_sem_fini(path, NULL, &d, param, NULL);
+out:
+	closedir(d);
+	return ret;
+}
+
+static void *find_worker_main(void *arg)
+{
+	struct find_worker *w = arg;
+	struct find_work *fw;
+	int rc;
+
+	while ((fw = find_work_get(w)) != NULL) {
+		rc = find_work_scan(w, fw);
+		if (rc < 0 && w->fwk_rc == 0)
+			w->fwk_rc = rc;
+		find_work_done(w->fwk_pool, fw);
+	}
+
+	return NULL;
+}
+
+/*
+ * Same as param_callback(), with param->fp_thread_count threads walking
+ * the tree. Matching entries are printed in no particular order.
+ */
+static int param_callback_parallel(char *path, semantic_func_t sem_init,
+				   semantic_func_t sem_fini,
+				   struct find_param *param)
+{
+	struct find_pool pool = {
+		.fpl_lock = PTHREAD_MUTEX_INITIALIZER,
+		.fpl_cond = PTHREAD_COND_INITIALIZER,
+		.fpl_sem_init = sem_init,
+		.fpl_sem_fini = sem_fini,
+	};
+	struct find_worker *w;
+	unsigned int started = 0;
+	unsigned int i;
+	int ret = 0;
+	DIR *d;
+
+	if (strlen(path) > PATH_MAX) {
+		ret = -EINVAL;
+		llapi_error(LLAPI_MSG_ERROR, ret,
+			    "Path name '%s' is too long", path);
+		return ret;
+	}
+
+	/* a file, or an error to report, leave it to the serial walk */
+	d = opendir(path);
+	if (d == NULL)
+		return param_callback(path, sem_init, sem_fini, param);
+	closedir(d);
+
+	pool.fpl_count = param->fp_thread_count;
+	pool.fpl_workers = calloc(pool.fpl_count, sizeof(*pool.fpl_workers));
+	if (pool.fpl_workers == NULL)
+		return -ENOMEM;
+
+	for (i = 0; i < pool.fpl_count; i++) {
+		w = &pool.fpl_workers[i];
+		w->fwk_pool = &pool;
+		w->fwk_index = i;
+		pthread_mutex_init(&w->fwk_lock, NULL);
+		w->fwk_param = *param;
+		ret = common_param_init(&w->fwk_param, path);
+		if (ret)
+			goto out;
+	}
+
+	ret = find_work_add(&pool.fpl_workers[0], path, 0);
+	if (ret)
+		goto out;
+
+	for (i = 0; i < pool.fpl_count; i++) {
+		w = &pool.fpl_workers[i];
+		ret = pthread_create(&w->fwk_thread, NULL, find_worker_main, w);
+		if (ret) {
+			llapi_error(LLAPI_MSG_ERROR, -ret,
+				    "cannot start find thread %u", i);
+			break;
+		}
+		started++;
+	}
+
+	if (started == 0) {
+		/* run the walk in this thread instead */
+		find_worker_main(&pool.fpl_workers[0]);
+		started = 1;
+	} else {
+		for (i = 0; i < started; i++)
+			pthread_join(pool.fpl_workers[i].fwk_thread, NULL);
+	}
+
+	ret = 0;
+	for (i = 0; i < pool.fpl_count; i++) {
+		if (pool.fpl_workers[i].fwk_rc < 0 && ret == 0)
+			ret = pool.fpl_workers[i].fwk_rc;
+	}
+out:
+	for (i = 0; i < pool.fpl_count; i++) {
+		w = &pool.fpl_workers[i];
+		/* only left on error */
+		while (w->fwk_head != NULL)
+			free(find_work_take(w, true));
+		find_param_fini(&w->fwk_param);
+		pthread_mutex_destroy(&w->fwk_lock);
+	}
+	free(pool.fpl_workers);
+
+	return ret;
+}
+
 int llapi_file_fget_lov_uuid(int fd, struct obd_uuid *lov_name)
 {
 	int rc = ioctl(fd, OBD_IOC_GETNAME, lov_name);
@@ -5073,11 +5420,9 @@ obd_matches:
 	}
 
 foreign:
-	llapi_printf(LLAPI_MSG_NORMAL, "%s", path);
-	if (param->fp_zero_end)
-		llapi_printf(LLAPI_MSG_NORMAL, "%c", '\0');
-	else
-		llapi_printf(LLAPI_MSG_NORMAL, "\n");
+	/* a single call, so lines of parallel threads do not mix */
+	llapi_printf(LLAPI_MSG_NORMAL, "%s%c", path,
+		     param->fp_zero_end ? '\0' : '\n');
 
 decided:
 	ret = 0;
@@ -5257,6 +5602,10 @@ int llapi_mv(char *path, struct find_param *param)
 
 int llapi_find(char *path, struct find_param *param)
 {
+	if (param->fp_thread_count > 1)
+		return param_callback_parallel(path, cb_find_init,
+					       cb_common_fini, param);
+
 	return param_callback(path, cb_find_init, cb_common_fini, param);
 }
 
@@ -57,7 +57,8 @@ static int chlg_dev_path(char *path, size_t path_len, const char *device)
 }
 
 #define CHANGELOG_PRIV_MAGIC 0xCA8E1080
-#define CHANGELOG_BUFFER_SZ  4096
+/* Large enough to drain the whole kernel prefetch queue in one read() */
+#define CHANGELOG_BUFFER_SZ  (256 * 1024)
 
 /**
  * Record state for efficient changelog consumption.
@@ -68,6 +69,10 @@ struct changelog_private {
 	int				 clp_magic;
 	/* File descriptor on the changelog character device */
 	int				 clp_fd;
+	/* Write descriptor used to clear records, opened on first use */
+	int				 clp_ack_fd;
+	/* Path of the changelog character device */
+	char				 clp_dev_path[PATH_MAX];
 	/* Changelog delivery mode */
 	enum changelog_send_flag	 clp_send_flags;
 	/* Changelog extra flags */
@@ -109,6 +114,8 @@ int llapi_changelog_start(void **priv, enum changelog_send_flag flags,
 
 	cp->clp_magic = CHANGELOG_PRIV_MAGIC;
 	cp->clp_send_flags = flags;
+	cp->clp_ack_fd = -1;
+	snprintf(cp->clp_dev_path, sizeof(cp->clp_dev_path), "%s", cdev_path);
 
 	cp->clp_buf_len = 0;
 	cp->clp_buf_pos = cp->clp_buf;
@@ -177,6 +184,8 @@ int llapi_changelog_fini(void **priv)
 		return -EINVAL;
 
 	close(cp->clp_fd);
+	if (cp->clp_ack_fd >= 0)
+		close(cp->clp_ack_fd);
 	free(cp);
 	*priv = NULL;
 	return 0;
@@ -303,13 +312,10 @@ int llapi_changelog_in_buf(void *priv)
 	return 0;
 }
 
-int llapi_changelog_clear(const char *mdtname, const char *idstr,
-			  long long endrec)
+static int chlg_clear_fd(int fd, const char *idstr, long long endrec)
 {
-	char dev_path[PATH_MAX];
 	char cmd[64];
 	size_t cmd_len = sizeof(cmd);
-	int fd;
 	int rc;
 
 	if (endrec < 0) {
@@ -318,14 +324,32 @@ int llapi_changelog_clear(const char *mdtname, const char *idstr,
 		return -EINVAL;
 	}
 
-	chlg_dev_path(dev_path, sizeof(dev_path), mdtname);
-
 	rc = snprintf(cmd, cmd_len, "clear:%s:%lld", idstr, endrec);
 	if (rc >= sizeof(cmd))
 		return -EINVAL;
 
 	cmd_len = rc + 1;
 
+	rc = write(fd, cmd, cmd_len);
+	if (rc < 0) {
+		rc = -errno;
+		llapi_error(LLAPI_MSG_ERROR, rc,
+			    "cannot purge records for '%s'", idstr);
+		return rc;
+	}
+
+	return 0;
+}
+
+int llapi_changelog_clear(const char *mdtname, const char *idstr,
+			  long long endrec)
+{
+	char dev_path[PATH_MAX];
+	int fd;
+	int rc;
+
+	chlg_dev_path(dev_path, sizeof(dev_path), mdtname);
+
 	fd = open(dev_path, O_WRONLY);
 	if (fd < 0) {
 		rc = -errno;
@@ -333,18 +357,71 @@ int llapi_changelog_clear(const char *mdtname, const char *idstr,
 		return rc;
 	}
 
-	rc = write(fd, cmd, cmd_len);
+	rc = chlg_clear_fd(fd, idstr, endrec);
+	close(fd);
+	return rc;
+}
+
+/**
+ * Acknowledge a whole batch of records received through \a priv, allowing
+ * all records up to and including \a endrec to be destroyed.
+ *
+ * Unlike llapi_changelog_clear(), the changelog device is only opened once
+ * per reader, so consumers can cheaply clear after every batch they process.
+ *
+ * @param priv		Opaque private control structure
+ * @param idstr		Registered changelog user id (e.g. "cl1")
+ * @param endrec	Last record index of the processed batch
+ * @return 0 on success, negated errno code on failure.
+ */
+int llapi_changelog_ack(void *priv, const char *idstr, long long endrec)
+{
+	struct changelog_private *cp = priv;
+	int rc;
+
+	if (!cp || cp->clp_magic != CHANGELOG_PRIV_MAGIC)
+		return -EINVAL;
+
+	if (cp->clp_ack_fd < 0) {
+		cp->clp_ack_fd = open(cp->clp_dev_path, O_WRONLY);
+		if (cp->clp_ack_fd < 0) {
+			rc = -errno;
+			llapi_error(LLAPI_MSG_ERROR, rc, "cannot open '%s'",
+				    cp->clp_dev_path);
+			return rc;
+		}
+	}
+
+	return chlg_clear_fd(cp->clp_ack_fd, idstr, endrec);
+}
+
+/**
+ * Only deliver records matching \a filter to this reader. Filtering is done
+ * by the client kernel once records are read from the MDT and before they
+ * are copied to userspace, records already buffered by the library are not
+ * affected. The MDT does not filter, see struct changelog_filter.
+ *
+ * @param priv		Opaque private control structure
+ * @param filter	Record type mask, target FID and jobid to match
+ *
+ * Call this function right after llapi_changelog_start().
+ */
+int llapi_changelog_set_filter(void *priv,
+			       const struct changelog_filter *filter)
+{
+	struct changelog_private *cp = priv;
+	int rc;
+
+	if (!cp || cp->clp_magic != CHANGELOG_PRIV_MAGIC || filter == NULL)
+		return -EINVAL;
+
+	rc = ioctl(cp->clp_fd, OBD_IOC_CHLG_SET_FILTER, filter);
 	if (rc < 0) {
 		rc = -errno;
 		llapi_error(LLAPI_MSG_ERROR, rc,
-			    "cannot purge records for '%s'", idstr);
-		goto out_close;
+			    "cannot set changelog filter");
 	}
 
-	rc = 0;
-
-out_close:
-	close(fd);
 	return rc;
 }
 
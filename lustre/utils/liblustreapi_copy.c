@@ -0,0 +1,436 @@
+/*
+ * LGPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the GNU Lesser General Public License
+ * (LGPL) version 2.1 or (at your discretion) any later version.
+ * (LGPL) version 2.1 accompanies this distribution, and is available at
+ * http://www.gnu.org/licenses/lgpl-2.1.html
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * LGPL HEADER END
+ */
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ *
+ * lustre/utils/liblustreapi_copy.c
+ *
+ * Parallel copy of file data, used by data migration.
+ *
+ * The source file is split into segments aligned on the stripe size, so
+ * that each segment maps to a single OST object, and several threads
+ * claim the segments in file order and copy them with pread()/pwrite()
+ * or copy_file_range(). Regions reported as holes by SEEK_DATA/SEEK_HOLE
+ * are not copied.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <lustre/lustreapi.h>
+#include "lustreapi_internal.h"
+#include "lstddef.h"
+
+/* used when the stripe size of the source cannot be found */
+#define COPY_SEG_SIZE_DEFAULT	(4ULL << 20)
+/* limit the memory used by each copy thread for huge stripe sizes */
+#define COPY_BUF_SIZE_MAX	(64ULL << 20)
+
+struct copy_engine {
+	pthread_mutex_t		 ce_lock;
+	struct llapi_copy_param	*ce_param;
+	int			 ce_fd_src;
+	int			 ce_fd_dst;
+	uint64_t		 ce_size;	/* bytes to copy */
+	uint64_t		 ce_seg_size;
+	size_t			 ce_buf_size;
+	size_t			 ce_page_size;
+	uint64_t		 ce_next;	/* next offset to hand out */
+	uint64_t		 ce_data_end;	/* end of the current data */
+	bool			 ce_seek_data;	/* SEEK_DATA is usable */
+	bool			 ce_cfr;	/* copy_file_range is usable */
+	bool			 ce_dst_direct;	/* fd_dst has O_DIRECT */
+	int			 ce_rc;		/* first error seen */
+	struct timespec		 ce_start;
+	struct timespec		 ce_last_report;
+};
+
+static double copy_elapsed(const struct timespec *start,
+			   const struct timespec *now)
+{
+	return (now->tv_sec - start->tv_sec) +
+	       (now->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/**
+ * Find the next data region of the source file at or after ce_next.
+ * Holes in front of it are accounted as skipped. If SEEK_DATA is not
+ * supported, the rest of the file is treated as data.
+ *
+ * Called with ce_lock held, so the file offset of fd_src changed by
+ * lseek() is not shared with other threads, which only use pread().
+ */
+static void copy_find_data(struct copy_engine *ce)
+{
+	struct llapi_copy_stats *stats = &ce->ce_param->lcp_stats;
+	off_t data;
+	off_t hole;
+
+	if (!ce->ce_seek_data) {
+		ce->ce_data_end = ce->ce_size;
+		return;
+	}
+
+	data = lseek(ce->ce_fd_src, ce->ce_next, SEEK_DATA);
+	if (data < 0) {
+		if (errno == ENXIO) {
+			/* only a hole up to the end of file */
+			stats->lcs_skipped += ce->ce_size - ce->ce_next;
+			ce->ce_next = ce->ce_size;
+		} else {
+			ce->ce_seek_data = false;
+		}
+		ce->ce_data_end = ce->ce_size;
+		return;
+	}
+
+	hole = lseek(ce->ce_fd_src, data, SEEK_HOLE);
+	if (hole < 0)
+		hole = ce->ce_size;
+
+	/* keep the I/O page aligned for O_DIRECT */
+	data = min_t(uint64_t, round_down(data, ce->ce_page_size),
+		     ce->ce_size);
+	hole = round_up(hole, ce->ce_page_size);
+
+	if (data > ce->ce_next) {
+		stats->lcs_skipped += data - ce->ce_next;
+		ce->ce_next = data;
+	}
+	ce->ce_data_end = clamp_t(uint64_t, hole, ce->ce_next, ce->ce_size);
+}
+
+/**
+ * Hand out the next segment to copy. A segment never crosses a
+ * stripe boundary nor the end of the current data region.
+ *
+ * \retval true		[*pos, *pos + *len) has to be copied
+ * \retval false	nothing left to copy, or the copy failed
+ */
+static bool copy_claim(struct copy_engine *ce, uint64_t *pos, uint64_t *len,
+		       bool *cfr)
+{
+	uint64_t end;
+	bool found = false;
+
+	pthread_mutex_lock(&ce->ce_lock);
+	if (ce->ce_rc != 0)
+		goto out;
+
+	if (ce->ce_next >= ce->ce_data_end && ce->ce_next < ce->ce_size)
+		copy_find_data(ce);
+	if (ce->ce_next >= ce->ce_size)
+		goto out;
+
+	end = (ce->ce_next / ce->ce_seg_size + 1) * ce->ce_seg_size;
+	end = min(end, ce->ce_data_end);
+	*pos = ce->ce_next;
+	*len = end - ce->ce_next;
+	*cfr = ce->ce_cfr;
+	ce->ce_next = end;
+	found = true;
+out:
+	pthread_mutex_unlock(&ce->ce_lock);
+
+	return found;
+}
+
+/**
+ * Account a copied segment or an error, and call the progress callback
+ * if the stats interval has elapsed.
+ */
+static void copy_done(struct copy_engine *ce, uint64_t bytes, int rc)
+{
+	struct llapi_copy_param *param = ce->ce_param;
+	struct timespec now;
+
+	pthread_mutex_lock(&ce->ce_lock);
+	param->lcp_stats.lcs_copied += bytes;
+	if (rc < 0 && ce->ce_rc == 0)
+		ce->ce_rc = rc;
+
+	if (rc == 0 && param->lcp_progress != NULL) {
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		if (copy_elapsed(&ce->ce_last_report, &now) >=
+		    param->lcp_stats_interval) {
+			ce->ce_last_report = now;
+			param->lcp_stats.lcs_seconds =
+				copy_elapsed(&ce->ce_start, &now);
+			param->lcp_progress(&param->lcp_stats,
+					    param->lcp_data);
+		}
+	}
+	pthread_mutex_unlock(&ce->ce_lock);
+}
+
+static int copy_segment_cfr(struct copy_engine *ce, uint64_t pos,
+			    uint64_t len, uint64_t *copied)
+{
+	loff_t off_src = pos;
+	loff_t off_dst = pos;
+	ssize_t rc;
+
+	while (len > 0) {
+		rc = copy_file_range(ce->ce_fd_src, &off_src, ce->ce_fd_dst,
+				     &off_dst, len, 0);
+		if (rc < 0) {
+			rc = -errno;
+			/* not supported between these files, fall back to
+			 * read/write from where we are */
+			if (rc == -EXDEV || rc == -ENOSYS || rc == -EINVAL ||
+			    rc == -EOPNOTSUPP) {
+				pthread_mutex_lock(&ce->ce_lock);
+				ce->ce_cfr = false;
+				pthread_mutex_unlock(&ce->ce_lock);
+				return 1;
+			}
+			return rc;
+		}
+		if (rc == 0) /* end of file */
+			break;
+
+		*copied += rc;
+		len -= rc;
+	}
+
+	return 0;
+}
+
+static int copy_segment_rw(struct copy_engine *ce, void *buf, uint64_t pos,
+			   uint64_t len, uint64_t *copied)
+{
+	size_t mask = ce->ce_page_size - 1;
+	ssize_t rsize;
+	ssize_t wsize;
+	size_t count;
+	size_t done;
+
+	while (len > 0) {
+		/* O_DIRECT needs a page aligned length, the read is short
+		 * at the end of the file anyway */
+		count = min_t(uint64_t, len, ce->ce_buf_size);
+		rsize = pread(ce->ce_fd_src, buf,
+			      round_up(count, ce->ce_page_size), pos);
+		if (rsize < 0)
+			return -errno;
+		if (rsize == 0) /* end of file */
+			break;
+		if ((size_t)rsize > count)
+			rsize = count;
+
+		count = rsize;
+		if (ce->ce_dst_direct && (count & mask)) {
+			/* the file is truncated to its size once copied */
+			memset(buf + count, 0,
+			       round_up(count, ce->ce_page_size) - count);
+			count = round_up(count, ce->ce_page_size);
+		}
+
+		for (done = 0; done < count; done += wsize) {
+			wsize = pwrite(ce->ce_fd_dst, buf + done, count - done,
+				       pos + done);
+			if (wsize < 0)
+				return -errno;
+			/* no progress, don't loop forever */
+			if (wsize == 0)
+				return -EIO;
+		}
+
+		*copied += rsize;
+		pos += rsize;
+		len -= rsize;
+		if (rsize & mask) /* end of file */
+			break;
+	}
+
+	return 0;
+}
+
+static void *copy_thread(void *arg)
+{
+	struct copy_engine *ce = arg;
+	struct llapi_copy_param *param = ce->ce_param;
+	void *buf = NULL;
+	uint64_t copied;
+	uint64_t pos;
+	uint64_t len;
+	bool cfr;
+	int rc;
+
+	while (copy_claim(ce, &pos, &len, &cfr)) {
+		copied = 0;
+		rc = 0;
+		if (param->lcp_check != NULL)
+			rc = param->lcp_check(ce->ce_fd_src);
+
+		if (rc == 0 && cfr) {
+			rc = copy_segment_cfr(ce, pos, len, &copied);
+			if (rc <= 0) {
+				copy_done(ce, copied, rc);
+				continue;
+			}
+			/* copy the rest of the segment with read/write */
+			pos += copied;
+			len -= copied;
+			rc = 0;
+		}
+
+		if (rc == 0 && buf == NULL) {
+			rc = posix_memalign(&buf, ce->ce_page_size,
+					    ce->ce_buf_size);
+			if (rc != 0) {
+				buf = NULL;
+				rc = -rc;
+			}
+		}
+		if (rc == 0)
+			rc = copy_segment_rw(ce, buf, pos, len, &copied);
+		copy_done(ce, copied, rc);
+	}
+
+	free(buf);
+
+	return NULL;
+}
+
+/**
+ * Copy the data of \a fd_src to \a fd_dst with several threads.
+ *
+ * The file is cut into segments of \a param->lcp_seg_size bytes (the
+ * stripe size of \a fd_src by default), copied concurrently by up to
+ * \a param->lcp_threads threads at their own offset, so the I/O of the
+ * different stripes is in flight at the same time. Buffers are page
+ * aligned, so \a fd_src may be opened with O_DIRECT. copy_file_range()
+ * is used when neither file is opened with O_DIRECT, and data regions
+ * are found with SEEK_DATA/SEEK_HOLE, holes being left unwritten in
+ * \a fd_dst which is truncated to the size of \a fd_src at the end.
+ *
+ * \a param->lcp_check is called on \a fd_src before each segment and
+ * aborts the copy if it fails. \a param->lcp_progress is called at most
+ * every \a param->lcp_stats_interval seconds, serialized with itself.
+ *
+ * \param[in] fd_src	source file descriptor
+ * \param[in] fd_dst	destination file descriptor
+ * \param[in,out] param	copy parameters, lcp_stats is filled on return
+ *
+ * \retval 0		data copied and \a fd_dst synced
+ * \retval -errno	first error seen
+ */
+int llapi_file_copy_data(int fd_src, int fd_dst,
+			 struct llapi_copy_param *param)
+{
+	struct copy_engine ce = {
+		.ce_param	= param,
+		.ce_fd_src	= fd_src,
+		.ce_fd_dst	= fd_dst,
+		.ce_seg_size	= param->lcp_seg_size,
+		.ce_page_size	= sysconf(_SC_PAGESIZE),
+		.ce_seek_data	= true,
+	};
+	unsigned int threads = max(param->lcp_threads, 1U);
+	pthread_t *tids = NULL;
+	unsigned int started = 0;
+	struct stat st;
+	int flags_src;
+	int flags_dst;
+	int rc;
+	int i;
+
+	memset(&param->lcp_stats, 0, sizeof(param->lcp_stats));
+
+	if (fstat(fd_src, &st) < 0)
+		return -errno;
+
+	flags_src = fcntl(fd_src, F_GETFL);
+	flags_dst = fcntl(fd_dst, F_GETFL);
+	if (flags_src < 0 || flags_dst < 0)
+		return -errno;
+	ce.ce_dst_direct = flags_dst & O_DIRECT;
+	ce.ce_cfr = !(flags_src & O_DIRECT) && !ce.ce_dst_direct;
+
+	if (ce.ce_seg_size == 0) {
+		struct llapi_layout *layout;
+		uint64_t stripe_size;
+
+		ce.ce_seg_size = COPY_SEG_SIZE_DEFAULT;
+		layout = llapi_layout_get_by_fd(fd_src, 0);
+		if (layout != NULL) {
+			if (llapi_layout_stripe_size_get(layout,
+							 &stripe_size) == 0 &&
+			    stripe_size != 0)
+				ce.ce_seg_size = stripe_size;
+			llapi_layout_free(layout);
+		}
+	}
+	ce.ce_seg_size = round_up(ce.ce_seg_size, ce.ce_page_size);
+	ce.ce_buf_size = min_t(uint64_t, ce.ce_seg_size, COPY_BUF_SIZE_MAX);
+
+	ce.ce_size = st.st_size;
+	param->lcp_stats.lcs_size = ce.ce_size;
+
+	/* no need for more threads than segments */
+	threads = min_t(uint64_t, threads,
+			(ce.ce_size + ce.ce_seg_size - 1) / ce.ce_seg_size);
+
+	pthread_mutex_init(&ce.ce_lock, NULL);
+	clock_gettime(CLOCK_MONOTONIC, &ce.ce_start);
+	ce.ce_last_report = ce.ce_start;
+
+	if (threads > 1) {
+		tids = calloc(threads, sizeof(*tids));
+		for (i = 0; tids != NULL && i < threads; i++) {
+			if (pthread_create(&tids[i], NULL, copy_thread,
+					   &ce) != 0)
+				break;
+			started++;
+		}
+	}
+
+	/* the caller copies too, alone if threads cannot be started */
+	if (started == 0)
+		copy_thread(&ce);
+	for (i = 0; i < started; i++)
+		pthread_join(tids[i], NULL);
+	free(tids);
+
+	rc = ce.ce_rc;
+	if (rc == 0 && ce.ce_size > 0 &&
+	    (param->lcp_stats.lcs_skipped > 0 || ce.ce_dst_direct)) {
+		/* extend over trailing holes, or cut the padding */
+		if (ftruncate(fd_dst, ce.ce_size) < 0)
+			rc = -errno;
+	}
+	if (rc == 0 && fsync(fd_dst) < 0)
+		rc = -errno;
+
+	clock_gettime(CLOCK_MONOTONIC, &ce.ce_last_report);
+	param->lcp_stats.lcs_seconds = copy_elapsed(&ce.ce_start,
+						    &ce.ce_last_report);
+	pthread_mutex_destroy(&ce.ce_lock);
+
+	return rc;
+}
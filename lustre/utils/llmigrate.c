@@ -0,0 +1,1131 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; if not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+/*
+ * lustre/utils/llmigrate.c
+ *
+ * Tool to migrate batches of files to a new OST layout.
+ *
+ * The files are given by FID, either in a list file or by the CLOSE
+ * records of an MDT changelog, and are migrated by a pool of threads
+ * like "lfs migrate" does for one file: data copy to a volatile file
+ * then layout swap. The number of files migrated at once from a single
+ * OST is bounded, and the progress is checkpointed so that an interrupted
+ * run restarts where it stopped.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <linux/lustre/lustre_user.h>
+#include <lustre/lustreapi.h>
+#include <libcfs/util/list.h>
+#include <libcfs/util/parser.h>
+
+#define MIG_THREADS_DEF		8
+#define MIG_OST_LIMIT_DEF	2
+#define MIG_QUEUE_MAX		1024
+#define MIG_STATS_INTV		60
+#define CHLG_POLL_INTV		60
+#define REC_MIN_AGE		600
+
+struct options {
+	const char	*o_mntpt;
+	const char	*o_fid_file;
+	const char	*o_chlg_user;
+	const char	*o_mdtname;
+	const char	*o_checkpoint;
+	bool		 o_daemonize;
+	bool		 o_non_block;
+	int		 o_verbose;
+	int		 o_intv;
+	int		 o_stats_intv;
+	int		 o_min_age;
+	int		 o_threads;
+	int		 o_ost_limit;
+	int		 o_copy_threads;
+};
+
+struct options opt;
+
+/* layout of the migrated files */
+struct llapi_stripe_param mig_param = {
+	.lsp_stripe_offset	= -1,
+};
+
+struct mig_item {
+	struct list_head	mi_queue;	/* on mh_queue until started */
+	struct list_head	mi_pending;	/* on mh_pending until done */
+	struct lu_fid		mi_fid;
+	__u64			mi_index;	/* list line or record index */
+};
+
+struct mig_head {
+	pthread_mutex_t		 mh_lock;
+	pthread_cond_t		 mh_cond;
+	pthread_mutex_t		 mh_ckpt_lock;	/* serializes checkpoints */
+	struct list_head	 mh_queue;	/* items to migrate */
+	struct list_head	 mh_pending;	/* items not done, by index */
+	unsigned int		 mh_count;	/* items on mh_pending */
+	bool			 mh_eof;	/* no more items to queue */
+	__u64			 mh_last_index;	/* last queued index */
+	__u64			 mh_done_index;	/* all items up to it done */
+	__u64			 mh_fail_index;	/* first failed item, or 0 */
+	__u64			 mh_ckpt_index;	/* last checkpointed index */
+	unsigned short		*mh_ost_busy;	/* files migrated per OST */
+	unsigned int		 mh_ost_count;
+	int			 mh_fid_dir;	/* fd of <mntpt>/.lustre/fid */
+	__u64			 mh_files;
+	__u64			 mh_bytes;
+	__u64			 mh_skipped;
+	__u64			 mh_failed;
+	struct timespec		 mh_start;
+	struct timespec		 mh_last_report;
+} head;
+
+static void usage(char *prog, int rc)
+{
+	printf("\nUsage: %s [options] {-f <fid_file> | -m <mdtdev> -u <userid>} <mntpt>\n"
+	       "options:\n"
+	       "\t-f, --fid-file, file of FIDs to migrate, '-' for stdin\n"
+	       "\t-m, --mdt, MDT whose changelog gives the files to migrate\n"
+	       "\t-u, --user, changelog user id\n"
+	       "\t-p, --pool, OST pool of the new layout\n"
+	       "\t-c, --stripe-count, stripe count of the new layout\n"
+	       "\t-S, --stripe-size, stripe size of the new layout\n"
+	       "\t-t, --threads, number of files migrated at once\n"
+	       "\t-o, --ost-limit, files migrated at once from an OST, 0 for no limit\n"
+	       "\t-C, --copy-threads, threads copying the data of a file\n"
+	       "\t-n, --non-block, abort migration of files being accessed\n"
+	       "\t-k, --checkpoint, file recording the progress in the FID file\n"
+	       "\t-d, --daemonize\n"
+	       "\t-i, --interval, changelog poll interval in second\n"
+	       "\t-a, --min-age, min age before a record is processed\n"
+	       "\t-s, --stats-interval, seconds between statistics reports\n"
+	       "\t-v, --verbose, produce more verbose ouput\n",
+	       prog);
+	exit(rc);
+}
+
+static double mig_elapsed(const struct timespec *start,
+			  const struct timespec *now)
+{
+	return (now->tv_sec - start->tv_sec) +
+	       (now->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static int mig_setup(void)
+{
+	char path[PATH_MAX];
+
+	llapi_msg_set_level(opt.o_verbose);
+
+	memset(&head, 0, sizeof(head));
+	pthread_mutex_init(&head.mh_lock, NULL);
+	pthread_cond_init(&head.mh_cond, NULL);
+	pthread_mutex_init(&head.mh_ckpt_lock, NULL);
+	INIT_LIST_HEAD(&head.mh_queue);
+	INIT_LIST_HEAD(&head.mh_pending);
+	clock_gettime(CLOCK_MONOTONIC, &head.mh_start);
+	head.mh_last_report = head.mh_start;
+
+	/* files are opened relative to it, without a path walk from the
+	 * mount point nor a search of the mount table each time */
+	snprintf(path, sizeof(path), "%s/.lustre/fid", opt.o_mntpt);
+	head.mh_fid_dir = open(path, O_RDONLY | O_DIRECTORY);
+	if (head.mh_fid_dir < 0) {
+		llapi_error(LLAPI_MSG_ERROR, -errno, "cannot open '%s'", path);
+		return -errno;
+	}
+
+	return 0;
+}
+
+static void mig_cleanup(void)
+{
+	close(head.mh_fid_dir);
+	free(head.mh_ost_busy);
+	pthread_cond_destroy(&head.mh_cond);
+	pthread_mutex_destroy(&head.mh_ckpt_lock);
+	pthread_mutex_destroy(&head.mh_lock);
+}
+
+/**
+ * Update the index up to which all the items are done, called with
+ * mh_lock held. It never goes past a failed item, so that the checkpoint
+ * keeps it and a restart retries it.
+ */
+static void mig_done_index_update(void)
+{
+	__u64 done;
+
+	if (list_empty(&head.mh_pending))
+		done = head.mh_last_index;
+	else
+		done = list_entry(head.mh_pending.next, struct mig_item,
+				  mi_pending)->mi_index - 1;
+	if (head.mh_fail_index != 0 && done >= head.mh_fail_index)
+		done = head.mh_fail_index - 1;
+	head.mh_done_index = done;
+}
+
+/**
+ * Check whether \a fid is queued or being migrated, called with mh_lock
+ * held. The pending list has at most MIG_QUEUE_MAX items.
+ */
+static bool mig_queue_find(const struct lu_fid *fid)
+{
+	struct mig_item *mi;
+
+	list_for_each_entry(mi, &head.mh_pending, mi_pending)
+		if (memcmp(&mi->mi_fid, fid, sizeof(*fid)) == 0)
+			return true;
+
+	return false;
+}
+
+/**
+ * Queue a FID for migration, waiting while too many are not done yet.
+ * A FID already queued or being migrated is not queued twice, its index
+ * is done with the first item.
+ */
+static int mig_queue_add(const struct lu_fid *fid, __u64 index)
+{
+	struct mig_item *mi;
+
+	mi = malloc(sizeof(*mi));
+	if (mi == NULL) {
+		llapi_error(LLAPI_MSG_ERROR, -ENOMEM,
+			    "failed to alloc memory for mig_item");
+		return -ENOMEM;
+	}
+	mi->mi_fid = *fid;
+	mi->mi_index = index;
+
+	pthread_mutex_lock(&head.mh_lock);
+	while (head.mh_count >= MIG_QUEUE_MAX)
+		pthread_cond_wait(&head.mh_cond, &head.mh_lock);
+	if (mig_queue_find(fid)) {
+		head.mh_last_index = index;
+		head.mh_skipped++;
+		pthread_mutex_unlock(&head.mh_lock);
+		free(mi);
+		llapi_printf(LLAPI_MSG_DEBUG, "skipped queued "DFID"\n",
+			     PFID(fid));
+		return 0;
+	}
+	list_add_tail(&mi->mi_queue, &head.mh_queue);
+	/* indexes are queued in ascending order */
+	list_add_tail(&mi->mi_pending, &head.mh_pending);
+	head.mh_count++;
+	head.mh_last_index = index;
+	pthread_cond_broadcast(&head.mh_cond);
+	pthread_mutex_unlock(&head.mh_lock);
+
+	return 0;
+}
+
+/**
+ * Mark all the items up to \a index done, when there is nothing to
+ * migrate in them (skipped lines or records).
+ */
+static void mig_queue_skip(__u64 index)
+{
+	pthread_mutex_lock(&head.mh_lock);
+	head.mh_last_index = index;
+	mig_done_index_update();
+	pthread_mutex_unlock(&head.mh_lock);
+}
+
+static void mig_queue_eof(void)
+{
+	pthread_mutex_lock(&head.mh_lock);
+	head.mh_eof = true;
+	pthread_cond_broadcast(&head.mh_cond);
+	pthread_mutex_unlock(&head.mh_lock);
+}
+
+static struct mig_item *mig_queue_get(void)
+{
+	struct mig_item *mi = NULL;
+
+	pthread_mutex_lock(&head.mh_lock);
+	while (list_empty(&head.mh_queue) && !head.mh_eof)
+		pthread_cond_wait(&head.mh_cond, &head.mh_lock);
+	if (!list_empty(&head.mh_queue)) {
+		mi = list_entry(head.mh_queue.next, struct mig_item, mi_queue);
+		list_del_init(&mi->mi_queue);
+	}
+	pthread_mutex_unlock(&head.mh_lock);
+
+	return mi;
+}
+
+/**
+ * Save the progress: clear the changelog records or record the last line
+ * of the FID file for which all files are done.
+ */
+static void mig_checkpoint(__u64 index)
+{
+	char tmp[PATH_MAX];
+	FILE *fp;
+	int rc;
+
+	pthread_mutex_lock(&head.mh_ckpt_lock);
+	if (index <= head.mh_ckpt_index)
+		goto out;
+
+	if (opt.o_mdtname != NULL) {
+		rc = llapi_changelog_clear(opt.o_mdtname, opt.o_chlg_user,
+					   index);
+		if (rc) {
+			llapi_error(LLAPI_MSG_ERROR, rc,
+				    "failed to clear changelog record: %s:%llu",
+				    opt.o_chlg_user,
+				    (unsigned long long)index);
+			goto out;
+		}
+	} else if (opt.o_checkpoint != NULL) {
+		/* the checkpoint is replaced atomically */
+		snprintf(tmp, sizeof(tmp), "%s.tmp", opt.o_checkpoint);
+		fp = fopen(tmp, "w");
+		if (fp == NULL) {
+			llapi_error(LLAPI_MSG_ERROR, -errno,
+				    "cannot open '%s'", tmp);
+			goto out;
+		}
+		fprintf(fp, "%llu\n", (unsigned long long)index);
+		if (fclose(fp) != 0 || rename(tmp, opt.o_checkpoint) != 0) {
+			llapi_error(LLAPI_MSG_ERROR, -errno,
+				    "cannot write checkpoint '%s'",
+				    opt.o_checkpoint);
+			goto out;
+		}
+	}
+	head.mh_ckpt_index = index;
+out:
+	pthread_mutex_unlock(&head.mh_ckpt_lock);
+}
+
+static void mig_report(double seconds, __u64 files, __u64 bytes,
+		       __u64 skipped, __u64 failed)
+{
+	if (seconds <= 0)
+		seconds = 1;
+
+	llapi_printf(LLAPI_MSG_NORMAL,
+		     "- { seconds: %.0f, files: %llu, files_per_sec: %.1f, "
+		     "mbytes: %llu, mbytes_per_sec: %.1f, skipped: %llu, "
+		     "failed: %llu }\n", seconds,
+		     (unsigned long long)files, files / seconds,
+		     (unsigned long long)bytes >> 20,
+		     bytes / seconds / (1 << 20),
+		     (unsigned long long)skipped, (unsigned long long)failed);
+}
+
+/**
+ * Account a finished item, and report and checkpoint the progress every
+ * stats interval.
+ */
+static void mig_item_done(struct mig_item *mi, int rc, __u64 bytes)
+{
+	struct timespec now;
+	bool report = false;
+	__u64 files = 0, total = 0, skipped = 0, failed = 0;
+	__u64 done;
+	double seconds = 0;
+
+	pthread_mutex_lock(&head.mh_lock);
+	if (rc < 0) {
+		head.mh_failed++;
+		if (head.mh_fail_index == 0 ||
+		    mi->mi_index < head.mh_fail_index)
+			head.mh_fail_index = mi->mi_index;
+	} else if (rc > 0) {
+		head.mh_skipped++;
+	} else {
+		head.mh_files++;
+	}
+	head.mh_bytes += bytes;
+
+	list_del(&mi->mi_pending);
+	head.mh_count--;
+	mig_done_index_update();
+	done = head.mh_done_index;
+	pthread_cond_broadcast(&head.mh_cond);
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	if (mig_elapsed(&head.mh_last_report, &now) >= opt.o_stats_intv) {
+		head.mh_last_report = now;
+		seconds = mig_elapsed(&head.mh_start, &now);
+		files = head.mh_files;
+		total = head.mh_bytes;
+		skipped = head.mh_skipped;
+		failed = head.mh_failed;
+		report = true;
+	}
+	pthread_mutex_unlock(&head.mh_lock);
+
+	free(mi);
+
+	if (report) {
+		mig_report(seconds, files, total, skipped, failed);
+		mig_checkpoint(done);
+	}
+}
+
+/**
+ * Collect the distinct OST indexes of the instantiated components of
+ * \a layout into \a osts, up to \a max of them.
+ */
+static int mig_layout_osts(struct llapi_layout *layout, __u32 *osts, int max)
+{
+	uint64_t idx;
+	int count = 0;
+	int rc;
+	int i;
+	int j;
+
+	rc = llapi_layout_comp_use(layout, LLAPI_LAYOUT_COMP_USE_FIRST);
+	while (rc == 0) {
+		for (i = 0; llapi_layout_ost_index_get(layout, i, &idx) == 0;
+		     i++) {
+			if (idx == LLAPI_LAYOUT_DEFAULT)
+				break;
+			for (j = 0; j < count; j++)
+				if (osts[j] == idx)
+					break;
+			if (j == count && count < max)
+				osts[count++] = idx;
+		}
+		rc = llapi_layout_comp_use(layout, LLAPI_LAYOUT_COMP_USE_NEXT);
+	}
+
+	return count;
+}
+
+/**
+ * Check whether \a layout already has the layout given on the command
+ * line: a single component with the target pool, stripe count and stripe
+ * size, where given. A stripe count of -1 never matches, and neither
+ * does any layout when no pool, stripe count nor size is given, as the
+ * file is then migrated to the default layout.
+ */
+static bool mig_layout_match(struct llapi_layout *layout)
+{
+	char pool[LOV_MAXPOOLNAME + 1];
+	char *target = mig_param.lsp_pool;
+	uint64_t val;
+
+	if (target == NULL && mig_param.lsp_stripe_count <= 0 &&
+	    mig_param.lsp_stripe_size == 0)
+		return false;
+	if (mig_param.lsp_stripe_count < 0)
+		return false;
+
+	if (llapi_layout_comp_use(layout, LLAPI_LAYOUT_COMP_USE_FIRST) != 0)
+		return false;
+
+	if (target != NULL) {
+		/* the pool name can be given as <fsname>.<poolname> */
+		if (strchr(target, '.') != NULL)
+			target = strchr(target, '.') + 1;
+		if (llapi_layout_pool_name_get(layout, pool,
+					       sizeof(pool)) != 0 ||
+		    strcmp(pool, target) != 0)
+			return false;
+	}
+	if (mig_param.lsp_stripe_count > 0 &&
+	    (llapi_layout_stripe_count_get(layout, &val) != 0 ||
+	     val != (uint64_t)mig_param.lsp_stripe_count))
+		return false;
+	if (mig_param.lsp_stripe_size != 0 &&
+	    (llapi_layout_stripe_size_get(layout, &val) != 0 ||
+	     val != mig_param.lsp_stripe_size))
+		return false;
+
+	/* a composite file is migrated to the plain layout */
+	return llapi_layout_comp_use(layout, LLAPI_LAYOUT_COMP_USE_NEXT) == 1;
+}
+
+/**
+ * Wait until all \a osts have less than o_ost_limit files being migrated,
+ * and take a slot on each of them. All the slots are taken at once, so
+ * no thread waits while holding a part of them.
+ */
+static int mig_ost_get(const __u32 *osts, int count)
+{
+	unsigned int max = 0;
+	bool busy;
+	int i;
+
+	if (opt.o_ost_limit == 0 || count == 0)
+		return 0;
+
+	for (i = 0; i < count; i++)
+		max = osts[i] + 1 > max ? osts[i] + 1 : max;
+
+	pthread_mutex_lock(&head.mh_lock);
+	if (max > head.mh_ost_count) {
+		unsigned short *busy_new;
+
+		busy_new = realloc(head.mh_ost_busy,
+				   max * sizeof(*busy_new));
+		if (busy_new == NULL) {
+			pthread_mutex_unlock(&head.mh_lock);
+			return -ENOMEM;
+		}
+		memset(busy_new + head.mh_ost_count, 0,
+		       (max - head.mh_ost_count) * sizeof(*busy_new));
+		head.mh_ost_busy = busy_new;
+		head.mh_ost_count = max;
+	}
+
+	do {
+		busy = false;
+		for (i = 0; i < count && !busy; i++)
+			busy = head.mh_ost_busy[osts[i]] >= opt.o_ost_limit;
+		if (busy)
+			pthread_cond_wait(&head.mh_cond, &head.mh_lock);
+	} while (busy);
+
+	for (i = 0; i < count; i++)
+		head.mh_ost_busy[osts[i]]++;
+	pthread_mutex_unlock(&head.mh_lock);
+
+	return 0;
+}
+
+static void mig_ost_put(const __u32 *osts, int count)
+{
+	int i;
+
+	if (opt.o_ost_limit == 0 || count == 0)
+		return;
+
+	pthread_mutex_lock(&head.mh_lock);
+	for (i = 0; i < count; i++)
+		head.mh_ost_busy[osts[i]]--;
+	pthread_cond_broadcast(&head.mh_cond);
+	pthread_mutex_unlock(&head.mh_lock);
+}
+
+static int mig_check_lease(int fd)
+{
+	return llapi_lease_check(fd) > 0 ? 0 : -EBUSY;
+}
+
+/**
+ * Copy the data of \a fd to \a fdv and swap their layouts, under a group
+ * lock, or under a read lease with the --non-block option.
+ */
+static int mig_copy_swap(int fd, int fdv, __u64 *bytes)
+{
+	struct llapi_copy_param param = {
+		.lcp_threads = opt.o_copy_threads,
+	};
+	struct stat st;
+	__u64 dv1;
+	__u64 dv2;
+	int gid = 0;
+	int rc;
+	int rc2;
+
+	if (opt.o_non_block) {
+		rc = llapi_lease_acquire(fd, LL_LEASE_RDLCK);
+		if (rc < 0)
+			return rc;
+		param.lcp_check = mig_check_lease;
+	}
+
+	rc = llapi_get_data_version(fd, &dv1, LL_DV_RD_FLUSH);
+	if (rc < 0)
+		goto out;
+
+	if (!opt.o_non_block) {
+		do
+			gid = random();
+		while (gid == 0);
+
+		rc = llapi_group_lock(fd, gid);
+		if (rc < 0)
+			goto out;
+	}
+
+	rc = llapi_file_copy_data(fd, fdv, &param);
+	if (rc < 0)
+		goto out;
+	*bytes = param.lcp_stats.lcs_copied;
+
+	if (opt.o_non_block) {
+		rc = llapi_get_data_version(fd, &dv2, LL_DV_RD_FLUSH);
+		if (rc < 0)
+			goto out;
+		if (dv1 != dv2) {
+			rc = -EAGAIN;
+			goto out;
+		}
+	}
+
+	/* keep the original atime/mtime */
+	if (fstat(fd, &st) == 0) {
+		struct timeval tv[2] = {
+			{ .tv_sec = st.st_atime },
+			{ .tv_sec = st.st_mtime },
+		};
+
+		if (futimes(fdv, tv) < 0) {
+			rc = -errno;
+			goto out;
+		}
+	}
+
+	if (opt.o_non_block) {
+		/* put the lease, swap layouts and close atomically */
+		rc = llapi_fswap_layouts(fd, fdv, 0, 0, SWAP_LAYOUTS_CLOSE);
+		return rc;
+	}
+
+	rc = llapi_fswap_layouts_grouplock(fd, fdv, dv1, 0, 0,
+					   SWAP_LAYOUTS_CHECK_DV1);
+out:
+	if (gid != 0) {
+		rc2 = llapi_group_unlock(fd, gid);
+		if (rc2 < 0 && rc == 0)
+			rc = rc2;
+	}
+	if (opt.o_non_block && rc < 0)
+		llapi_lease_release(fd);
+
+	return rc;
+}
+
+/**
+ * Migrate one file.
+ *
+ * \retval 0		file migrated
+ * \retval 1		file skipped, deleted, not a regular file or already
+ *			with the target layout
+ * \retval -errno	migration failed
+ */
+static int mig_one(struct mig_item *mi, __u64 *bytes)
+{
+	struct llapi_layout *layout;
+	__u32 osts[LOV_MAX_STRIPE_COUNT];
+	char fidstr[FID_NOBRACE_LEN + 1];
+	struct stat st;
+	struct stat stv;
+	int count = 0;
+	int mdt_index;
+	int fd;
+	int fdv = -1;
+	int rc;
+
+	snprintf(fidstr, sizeof(fidstr), DFID_NOBRACE, PFID(&mi->mi_fid));
+	/* the layout swap needs a file open for write, whose close adds a
+	 * CLOSE record to the changelog. That record is skipped below, the
+	 * file having the target layout by then */
+	fd = openat(head.mh_fid_dir, fidstr, O_RDWR | O_DIRECT | O_NOFOLLOW);
+	if (fd < 0) {
+		rc = -errno;
+		/* deleted or not a regular file */
+		if (rc == -ENOENT || rc == -EISDIR || rc == -ELOOP)
+			return 1;
+		return rc;
+	}
+
+	rc = fstat(fd, &st);
+	if (rc < 0 || !S_ISREG(st.st_mode)) {
+		rc = rc < 0 ? -errno : 1;
+		goto out;
+	}
+
+	layout = llapi_layout_get_by_fd(fd, 0);
+	if (layout == NULL) {
+		rc = -errno;
+		goto out;
+	}
+	if (mig_layout_match(layout)) {
+		llapi_layout_free(layout);
+		rc = 1;
+		goto out;
+	}
+	count = mig_layout_osts(layout, osts, LOV_MAX_STRIPE_COUNT);
+	llapi_layout_free(layout);
+
+	rc = mig_ost_get(osts, count);
+	if (rc < 0) {
+		count = 0;
+		goto out;
+	}
+
+	rc = llapi_file_fget_mdtidx(fd, &mdt_index);
+	if (rc < 0)
+		goto out;
+
+	/* create the volatile file on the MDT of the file, with caching */
+	fdv = llapi_create_volatile_param(opt.o_mntpt, mdt_index, O_WRONLY,
+					  S_IRUSR | S_IWUSR, &mig_param);
+	if (fdv < 0) {
+		rc = fdv;
+		goto out;
+	}
+
+	/* the owner must match for the layout swap */
+	rc = fstat(fdv, &stv);
+	if (rc == 0 && (st.st_uid != stv.st_uid || st.st_gid != stv.st_gid))
+		rc = fchown(fdv, st.st_uid, st.st_gid);
+	if (rc < 0) {
+		rc = -errno;
+		goto out;
+	}
+
+	rc = mig_copy_swap(fd, fdv, bytes);
+out:
+	mig_ost_put(osts, count);
+	if (fdv >= 0)
+		close(fdv);
+	close(fd);
+
+	if (rc < 0)
+		llapi_error(LLAPI_MSG_ERROR, rc, "cannot migrate "DFID,
+			    PFID(&mi->mi_fid));
+	else
+		llapi_printf(LLAPI_MSG_DEBUG, "%s "DFID"\n",
+			     rc == 0 ? "migrated" : "skipped",
+			     PFID(&mi->mi_fid));
+
+	return rc;
+}
+
+static void *mig_thread(void *arg)
+{
+	struct mig_item *mi;
+	__u64 bytes;
+	int rc;
+
+	while ((mi = mig_queue_get()) != NULL) {
+		bytes = 0;
+		rc = mig_one(mi, &bytes);
+		mig_item_done(mi, rc, bytes);
+	}
+
+	return NULL;
+}
+
+/**
+ * Read the FIDs to migrate from the list file, one per line. Lines up to
+ * the one recorded in the checkpoint file are skipped.
+ */
+static int mig_read_fid_file(void)
+{
+	struct lu_fid fid;
+	char line[PATH_MAX];
+	__u64 start = 0;
+	__u64 lineno = 0;
+	FILE *fp;
+	int rc = 0;
+
+	if (opt.o_checkpoint != NULL) {
+		fp = fopen(opt.o_checkpoint, "r");
+		if (fp != NULL) {
+			unsigned long long val;
+
+			if (fscanf(fp, "%llu", &val) == 1)
+				start = val;
+			fclose(fp);
+		}
+		if (start > 0)
+			llapi_printf(LLAPI_MSG_INFO,
+				     "Restart after line %llu of '%s'\n",
+				     (unsigned long long)start,
+				     opt.o_fid_file);
+	}
+
+	if (strcmp(opt.o_fid_file, "-") == 0) {
+		fp = stdin;
+	} else {
+		fp = fopen(opt.o_fid_file, "r");
+		if (fp == NULL) {
+			rc = -errno;
+			llapi_error(LLAPI_MSG_ERROR, rc, "cannot open '%s'",
+				    opt.o_fid_file);
+			return rc;
+		}
+	}
+
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		char *ptr = line;
+
+		if (++lineno <= start)
+			continue;
+
+		ptr[strcspn(ptr, "\n")] = '\0';
+		while (*ptr == ' ' || *ptr == '\t')
+			ptr++;
+		if (*ptr == '#' || *ptr == '\0') {
+			mig_queue_skip(lineno);
+			continue;
+		}
+
+		rc = llapi_fid_parse(ptr, &fid, NULL);
+		if (rc < 0) {
+			llapi_error(LLAPI_MSG_ERROR, rc,
+				    "%s:%llu: invalid FID '%s'",
+				    opt.o_fid_file,
+				    (unsigned long long)lineno, ptr);
+			mig_queue_skip(lineno);
+			continue;
+		}
+
+		rc = mig_queue_add(&fid, lineno);
+		if (rc < 0)
+			break;
+	}
+
+	if (fp != stdin)
+		fclose(fp);
+
+	return rc < 0 ? rc : 0;
+}
+
+/**
+ * Read the files to migrate from the CLOSE records of the changelog,
+ * once they are o_min_age seconds old, so that files being written are
+ * left alone. In daemon mode, poll the changelog every o_intv seconds.
+ */
+static int mig_read_changelog(void)
+{
+	struct changelog_rec *rec;
+	void *chglog_hdlr;
+	__u64 startrec = 0;
+	bool stop = false;
+	int rc = 0;
+
+	while (!stop) {
+		bool eof = false;
+
+		llapi_printf(LLAPI_MSG_DEBUG, "Start receiving records\n");
+		rc = llapi_changelog_start(&chglog_hdlr,
+					   CHANGELOG_FLAG_BLOCK |
+					   CHANGELOG_FLAG_JOBID |
+					   CHANGELOG_FLAG_EXTRA_FLAGS,
+					   opt.o_mdtname, startrec);
+		if (rc) {
+			llapi_error(LLAPI_MSG_ERROR, rc,
+				    "unable to open changelog of MDT '%s'",
+				    opt.o_mdtname);
+			return rc;
+		}
+
+		while (!eof && !stop) {
+			rc = llapi_changelog_recv(chglog_hdlr, &rec);
+			switch (rc) {
+			case 0: {
+				time_t age = time(NULL) - (rec->cr_time >> 30);
+
+				startrec = rec->cr_index + 1;
+				if (rec->cr_type != CL_CLOSE) {
+					mig_queue_skip(rec->cr_index);
+					llapi_changelog_free(&rec);
+					break;
+				}
+
+				if (age < opt.o_min_age)
+					sleep(opt.o_min_age - age);
+
+				rc = mig_queue_add(&rec->cr_tfid,
+						   rec->cr_index);
+				llapi_changelog_free(&rec);
+				if (rc < 0)
+					stop = true;
+				break;
+			}
+			case 1: /* EOF */
+				llapi_printf(LLAPI_MSG_DEBUG,
+					     "finished reading [%s]\n",
+					     opt.o_mdtname);
+				rc = 0;
+				eof = true;
+				break;
+			default:
+				stop = true;
+				llapi_error(LLAPI_MSG_ERROR, rc,
+					    "failed to get changelog record");
+				break;
+			}
+		}
+
+		llapi_changelog_fini(&chglog_hdlr);
+
+		if (!opt.o_daemonize)
+			break;
+		if (!stop)
+			sleep(opt.o_intv);
+	}
+
+	return rc;
+}
+
+int main(int argc, char **argv)
+{
+	pthread_t		*tids;
+	int			 started = 0;
+	unsigned long		 size;
+	char			 fsname[MAX_OBD_NAME + 1];
+	struct timespec		 now;
+	int			 i;
+	int			 c;
+	int			 rc;
+	static struct option options[] = {
+		{ "fid-file", required_argument, NULL, 'f' },
+		{ "mdt", required_argument, NULL, 'm' },
+		{ "user", required_argument, NULL, 'u' },
+		{ "pool", required_argument, NULL, 'p' },
+		{ "stripe-count", required_argument, NULL, 'c' },
+		{ "stripe-size", required_argument, NULL, 'S' },
+		{ "threads", required_argument, NULL, 't' },
+		{ "ost-limit", required_argument, NULL, 'o' },
+		{ "copy-threads", required_argument, NULL, 'C' },
+		{ "non-block", no_argument, NULL, 'n' },
+		{ "checkpoint", required_argument, NULL, 'k' },
+		{ "daemonize", no_argument, NULL, 'd' },
+		{ "interval", required_argument, NULL, 'i' },
+		{ "min-age", required_argument, NULL, 'a' },
+		{ "stats-interval", required_argument, NULL, 's' },
+		{ "verbose", no_argument, NULL, 'v' },
+		{ "help", no_argument, NULL, 'h' },
+		{ NULL }
+	};
+
+	memset(&opt, 0, sizeof(opt));
+	opt.o_verbose = LLAPI_MSG_INFO;
+	opt.o_intv = CHLG_POLL_INTV;
+	opt.o_min_age = REC_MIN_AGE;
+	opt.o_stats_intv = MIG_STATS_INTV;
+	opt.o_threads = MIG_THREADS_DEF;
+	opt.o_ost_limit = MIG_OST_LIMIT_DEF;
+	opt.o_copy_threads = 1;
+
+	while ((c = getopt_long(argc, argv, "a:c:C:df:hi:k:m:no:p:s:S:t:u:v",
+				options, NULL)) != EOF) {
+		switch (c) {
+		default:
+			rc = -EINVAL;
+			llapi_error(LLAPI_MSG_ERROR, rc,
+				    "%s: unknown option '%c'",
+				    argv[0], optopt);
+			return rc;
+		case 'a':
+			opt.o_min_age = atoi(optarg);
+			if (opt.o_min_age < 0) {
+				rc = -EINVAL;
+				llapi_error(LLAPI_MSG_ERROR, rc,
+					    "bad value for -a %s", optarg);
+				return rc;
+			}
+			break;
+		case 'c':
+			mig_param.lsp_stripe_count = atoi(optarg);
+			if (mig_param.lsp_stripe_count < -1) {
+				rc = -EINVAL;
+				llapi_error(LLAPI_MSG_ERROR, rc,
+					    "bad value for -c %s", optarg);
+				return rc;
+			}
+			break;
+		case 'C':
+			opt.o_copy_threads = atoi(optarg);
+			if (opt.o_copy_threads <= 0) {
+				rc = -EINVAL;
+				llapi_error(LLAPI_MSG_ERROR, rc,
+					    "bad value for -C %s", optarg);
+				return rc;
+			}
+			break;
+		case 'd':
+			opt.o_daemonize = true;
+			break;
+		case 'f':
+			opt.o_fid_file = optarg;
+			break;
+		case 'h':
+			usage(argv[0], 0);
+			break;
+		case 'i':
+			opt.o_intv = atoi(optarg);
+			if (opt.o_intv < 0) {
+				rc = -EINVAL;
+				llapi_error(LLAPI_MSG_ERROR, rc,
+					    "bad value for -i %s", optarg);
+				return rc;
+			}
+			break;
+		case 'k':
+			opt.o_checkpoint = optarg;
+			break;
+		case 'm':
+			opt.o_mdtname = optarg;
+			break;
+		case 'n':
+			opt.o_non_block = true;
+			break;
+		case 'o':
+			opt.o_ost_limit = atoi(optarg);
+			if (opt.o_ost_limit < 0) {
+				rc = -EINVAL;
+				llapi_error(LLAPI_MSG_ERROR, rc,
+					    "bad value for -o %s", optarg);
+				return rc;
+			}
+			break;
+		case 'p':
+			mig_param.lsp_pool = optarg;
+			break;
+		case 's':
+			opt.o_stats_intv = atoi(optarg);
+			if (opt.o_stats_intv < 0) {
+				rc = -EINVAL;
+				llapi_error(LLAPI_MSG_ERROR, rc,
+					    "bad value for -s %s", optarg);
+				return rc;
+			}
+			break;
+		case 'S':
+			rc = Parser_size(&size, optarg);
+			if (rc < 0) {
+				rc = -EINVAL;
+				llapi_error(LLAPI_MSG_ERROR, rc,
+					    "bad value for -S '%s'", optarg);
+				return rc;
+			}
+			mig_param.lsp_stripe_size = size;
+			break;
+		case 't':
+			opt.o_threads = atoi(optarg);
+			if (opt.o_threads <= 0) {
+				rc = -EINVAL;
+				llapi_error(LLAPI_MSG_ERROR, rc,
+					    "bad value for -t %s", optarg);
+				return rc;
+			}
+			break;
+		case 'u':
+			opt.o_chlg_user = optarg;
+			break;
+		case 'v':
+			opt.o_verbose++;
+			break;
+		}
+	}
+
+	if (argc != optind + 1) {
+		llapi_err_noerrno(LLAPI_MSG_ERROR,
+				  "%s: no mount point specified\n", argv[0]);
+		usage(argv[0], 1);
+	}
+
+	opt.o_mntpt = argv[optind];
+	rc = llapi_search_fsname(opt.o_mntpt, fsname);
+	if (rc < 0) {
+		llapi_error(LLAPI_MSG_ERROR, rc,
+			    "cannot find a Lustre file system mounted at '%s'",
+			    opt.o_mntpt);
+		return rc;
+	}
+
+	/* exactly one source of FIDs */
+	if ((opt.o_fid_file == NULL) == (opt.o_mdtname == NULL))
+		usage(argv[0], 1);
+	if (opt.o_mdtname != NULL && opt.o_chlg_user == NULL)
+		usage(argv[0], 1);
+	/* the CLOSE record of a migration would migrate the file again, by
+	 * the next run or poll, if its layout cannot be recognized, see
+	 * mig_layout_match() */
+	if (opt.o_mdtname != NULL &&
+	    (mig_param.lsp_stripe_count < 0 ||
+	     (mig_param.lsp_pool == NULL && mig_param.lsp_stripe_size == 0 &&
+	      mig_param.lsp_stripe_count == 0))) {
+		llapi_err_noerrno(LLAPI_MSG_ERROR,
+				  "%s: -m needs -p, -S or -c > 0, and no -c -1\n",
+				  argv[0]);
+		usage(argv[0], 1);
+	}
+
+	if (opt.o_daemonize) {
+		rc = daemon(1, 1);
+		if (rc < 0) {
+			rc = -errno;
+			llapi_error(LLAPI_MSG_ERROR, rc, "cannot daemonize");
+			return rc;
+		}
+
+		setbuf(stdout, NULL);
+	}
+
+	rc = mig_setup();
+	if (rc < 0)
+		return rc;
+
+	tids = calloc(opt.o_threads, sizeof(*tids));
+	for (i = 0; tids != NULL && i < opt.o_threads; i++) {
+		rc = pthread_create(&tids[i], NULL, mig_thread, NULL);
+		if (rc != 0) {
+			llapi_error(LLAPI_MSG_ERROR, -rc,
+				    "cannot start migration thread");
+			break;
+		}
+		started++;
+	}
+
+	if (started == 0) {
+		rc = -ENOMEM;
+		llapi_error(LLAPI_MSG_ERROR, rc, "no migration thread");
+	} else if (opt.o_fid_file != NULL) {
+		rc = mig_read_fid_file();
+	} else {
+		rc = mig_read_changelog();
+	}
+
+	mig_queue_eof();
+	for (i = 0; i < started; i++)
+		pthread_join(tids[i], NULL);
+	free(tids);
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	mig_report(mig_elapsed(&head.mh_start, &now), head.mh_files,
+		   head.mh_bytes, head.mh_skipped, head.mh_failed);
+	mig_checkpoint(head.mh_done_index);
+	if (rc == 0 && head.mh_failed > 0)
+		rc = -EIO;
+
+	mig_cleanup();
+	return rc;
+}
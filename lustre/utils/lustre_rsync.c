@@ -111,6 +111,7 @@
 #include <getopt.h>
 #include <stdarg.h>
 #include <fcntl.h>
+#include <pthread.h>
 #include <signal.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -178,6 +179,33 @@ struct lr_parent_child_list {
 	struct lr_parent_child_list *pc_next;
 };
 
+/*
+ * A changelog record handed off to a replay worker. Only records that
+ * touch the data or attributes of an existing file are replayed in
+ * parallel, so the target FID and the record type are all that is needed.
+ */
+struct lr_work {
+	struct lr_work *lw_next;
+	long long lw_recno;
+	enum changelog_rec_type lw_type;
+	char lw_tfid[LR_FID_STR_LEN];
+	char lw_pfid[LR_FID_STR_LEN];
+	char lw_name[NAME_MAX + 1];
+};
+
+/*
+ * Replay worker. Records are assigned to workers by hashing the target
+ * FID, so all records of a given file are replayed in changelog order by
+ * the same worker.
+ */
+struct lr_worker {
+	pthread_t lwk_thread;
+	struct lr_info *lwk_info;
+	struct lr_work *lwk_head;
+	struct lr_work *lwk_tail;
+	long long lwk_done;
+};
+
 struct lustre_rsync_status *status;
 char *statuslog;  /* Name of the status log file */
 int logbackedup;
@@ -194,6 +222,16 @@ int quit;       /* Flag to stop processing the changelog; set on the
 		 * receipt of a signal
 		 */
 int abort_on_err;
+int lr_threads = 1; /* Number of replay worker threads */
+
+/* Replay worker pool, protected by lr_pool_lock */
+struct lr_worker *lr_workers;
+pthread_mutex_t lr_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t lr_pool_work = PTHREAD_COND_INITIALIZER;
+pthread_cond_t lr_pool_idle = PTHREAD_COND_INITIALIZER;
+int lr_pool_busy;   /* Records queued or being replayed */
+int lr_pool_stop;
+long long lr_parallel_count; /* No of records replayed by the workers */
 
 char rsync[PATH_MAX + 128];
 char rsync_ver[PATH_MAX * 2];
@@ -207,6 +245,7 @@ struct option long_opts[] = {
 	{ .val = 'm',	.name = "mdt",		.has_arg = required_argument },
 	{ .val = 's',	.name = "source",	.has_arg = required_argument },
 	{ .val = 't',	.name = "target",	.has_arg = required_argument },
+	{ .val = 'T',	.name = "threads",	.has_arg = required_argument },
 	{ .val = 'u',	.name = "user",		.has_arg = required_argument },
 	{ .val = 'v',	.name = "verbose",	.has_arg = no_argument },
 	{ .val = 'x',	.name = "xattr",	.has_arg = required_argument },
@@ -232,6 +271,7 @@ void lr_usage(void)
 		"\tlustre_rsync -l <log_file>\n"
 		"options:\n"
 		"\t--xattr <yes|no> replicate EAs\n"
+		"\t--threads <num>  parallel data/attribute replay threads\n"
 		"\t--abort-on-err   abort at first err\n"
 		"\t--verbose\n"
 		"\t--dry-run        don't write anything\n");
@@ -256,6 +296,14 @@ void lr_debug(int level, const char *fmt, ...)
 	va_end(ap);
 }
 
+/* Count a replication error, may be called by the replay workers */
+void lr_inc_errors(void)
+{
+	pthread_mutex_lock(&lr_pool_lock);
+	errors++;
+	pthread_mutex_unlock(&lr_pool_lock);
+}
+
 void *lr_grow_buf(void *buf, int size)
 {
 	void *ptr;
@@ -506,7 +554,7 @@ int lr_copy_xattr(struct lr_info *info)
 					fprintf(stderr, "cannot replicate xattrs from '%s' to '%s': %s\n",
 						info->src, info->dest,
 						strerror(errno));
-					errors++;
+					lr_inc_errors();
 				}
 				rc = 0;
 			}
@@ -694,7 +742,7 @@ void lr_cascade_move(const char *fid, const char *dest, struct lr_info *info)
 			if (rc == -1) {
 				fprintf(stderr, "Error renaming file %s to %s: %d\n",
 					info->src, d, errno);
-				errors++;
+				lr_inc_errors();
 			}
 			if (curr == parents)
 				parents = curr->pc_next;
@@ -1262,9 +1310,14 @@ void lr_backup_log(void)
 	logbackedup = 1;
 }
 
-/* Save replication parameters to a statuslog. */
+/*
+ * Save replication parameters to a statuslog. The log is written to a
+ * temporary file which then replaces the statuslog, so a crash never
+ * leaves a partially written checkpoint behind.
+ */
 int lr_write_log(void)
 {
+	char tmplog[PATH_MAX];
 	int fd;
 	size_t size;
 	size_t write_size = status->ls_size;
@@ -1276,18 +1329,21 @@ int lr_write_log(void)
 
 	lr_backup_log();
 
-	fd = open(statuslog, O_WRONLY | O_CREAT | O_SYNC, S_IRUSR | S_IWUSR);
+	snprintf(tmplog, sizeof(tmplog), "%s.tmp", statuslog);
+	fd = open(tmplog, O_WRONLY | O_CREAT | O_TRUNC | O_SYNC,
+		  S_IRUSR | S_IWUSR);
 	if (fd == -1) {
 		fprintf(stderr, "Error opening log file for writing (%s)\n",
-			statuslog);
+			tmplog);
 		return -1;
 	}
 	errno = 0;
 	size = write(fd, status, write_size);
 	if (size != write_size) {
 		fprintf(stderr, "Error writing to log file (%s) %d\n",
-			statuslog, errno);
+			tmplog, errno);
 		close(fd);
+		unlink(tmplog);
 		return -1;
 	}
 
@@ -1295,12 +1351,20 @@ int lr_write_log(void)
 		size = write(fd, &curr->pc_log, sizeof(curr->pc_log));
 		if (size != sizeof(curr->pc_log)) {
 			fprintf(stderr, "Error writing to log file (%s) %d\n",
-				statuslog, errno);
+				tmplog, errno);
 			rc = -1;
 			break;
 		}
 	}
 	close(fd);
+
+	if (rc == 0 && rename(tmplog, statuslog) == -1) {
+		fprintf(stderr, "Error renaming log file (%s) %d\n",
+			tmplog, errno);
+		rc = -1;
+	}
+	if (rc)
+		unlink(tmplog);
 	return rc;
 }
 
@@ -1417,16 +1481,21 @@ out:
 	return rc;
 }
 
+void lr_pool_drain(void);
+
 /*
- * Clear changelogs every CLEAR_INTERVAL records or at the end of
- * processing.
+ * Clear changelogs every CLEAR_INTERVAL records per replay thread or at the
+ * end of processing. Outstanding parallel replays are completed first, so
+ * the checkpointed record number never gets ahead of the target.
  */
 int lr_clear_cl(struct lr_info *info, int force)
 {
 	char		mdt_device[LR_NAME_MAXLEN + 1];
 	int		rc = 0;
 
-	if (force || info->recno > status->ls_last_recno + CLEAR_INTERVAL) {
+	if (force || info->recno > status->ls_last_recno +
+				   CLEAR_INTERVAL * lr_threads) {
+		lr_pool_drain();
 		if (!noclear && !dryrun) {
 			/*
 			 * llapi_changelog_clear modifies the mdt
@@ -1531,6 +1600,234 @@ void lr_print_failure(struct lr_info *info, int rc)
 		info->tfid, info->pfid, info->name);
 }
 
+/* Replay a single changelog record on all targets */
+int lr_replay(struct lr_info *info)
+{
+	int rc = 0;
+
+	lr_debug(DTRACE, "***** Start %lld %s (%d) %s %s %s *****\n",
+		 info->recno, changelog_type2str(info->type),
+		 info->type, info->tfid, info->pfid, info->name);
+
+	switch (info->type) {
+	case CL_CREATE:
+	case CL_MKDIR:
+	case CL_MKNOD:
+	case CL_SOFTLINK:
+		rc = lr_create(info);
+		break;
+	case CL_RMDIR:
+	case CL_UNLINK:
+		rc = lr_remove(info);
+		break;
+	case CL_RENAME:
+		rc = lr_move(info);
+		break;
+	case CL_HARDLINK:
+		rc = lr_link(info);
+		break;
+	case CL_TRUNC:
+	case CL_SETATTR:
+		rc = lr_setattr(info);
+		break;
+	case CL_SETXATTR:
+		rc = lr_setxattr(info);
+		break;
+	case CL_CLOSE:
+	case CL_EXT:
+	case CL_OPEN:
+	case CL_GETXATTR:
+	case CL_DN_OPEN:
+	case CL_LAYOUT:
+	case CL_MARK:
+		/*
+		 * Nothing needs to be done for these entries
+		 * fallthrough
+		 */
+	default:
+		break;
+	}
+
+	lr_debug(DTRACE, "##### End %lld %s (%d) %s %s %s rc=%d #####\n",
+		 info->recno, changelog_type2str(info->type),
+		 info->type, info->tfid, info->pfid, info->name, rc);
+
+	if (rc && rc != -ENOENT) {
+		lr_print_failure(info, rc);
+		lr_inc_errors();
+		if (abort_on_err)
+			quit = 1;
+	}
+
+	return rc;
+}
+
+/*
+ * Records which only update the data or attributes of an existing file can
+ * be replayed in parallel with records for other files. Namespace changes
+ * depend on the state left by earlier records and are replayed serially.
+ */
+static inline int lr_is_parallel(enum changelog_rec_type type)
+{
+	return type == CL_TRUNC || type == CL_SETATTR || type == CL_SETXATTR;
+}
+
+void *lr_worker_main(void *arg)
+{
+	struct lr_worker *wk = arg;
+	struct lr_info *info = wk->lwk_info;
+	struct lr_work *work;
+
+	pthread_mutex_lock(&lr_pool_lock);
+	while (1) {
+		while (!wk->lwk_head && !lr_pool_stop)
+			pthread_cond_wait(&lr_pool_work, &lr_pool_lock);
+		if (!wk->lwk_head)
+			break;
+
+		work = wk->lwk_head;
+		wk->lwk_head = work->lw_next;
+		if (!wk->lwk_head)
+			wk->lwk_tail = NULL;
+		pthread_mutex_unlock(&lr_pool_lock);
+
+		info->recno = work->lw_recno;
+		info->type = work->lw_type;
+		snprintf(info->tfid, sizeof(info->tfid), "%s", work->lw_tfid);
+		snprintf(info->pfid, sizeof(info->pfid), "%s", work->lw_pfid);
+		snprintf(info->name, sizeof(info->name), "%s", work->lw_name);
+		free(work);
+
+		if (!quit)
+			lr_replay(info);
+
+		pthread_mutex_lock(&lr_pool_lock);
+		wk->lwk_done++;
+		lr_parallel_count++;
+		if (--lr_pool_busy == 0)
+			pthread_cond_broadcast(&lr_pool_idle);
+	}
+	pthread_mutex_unlock(&lr_pool_lock);
+
+	return NULL;
+}
+
+/* Wait until all records handed off to the replay workers are replayed */
+void lr_pool_drain(void)
+{
+	if (!lr_workers)
+		return;
+
+	pthread_mutex_lock(&lr_pool_lock);
+	while (lr_pool_busy > 0)
+		pthread_cond_wait(&lr_pool_idle, &lr_pool_lock);
+	pthread_mutex_unlock(&lr_pool_lock);
+}
+
+/* Hand a record off to the worker owning its target FID */
+int lr_pool_queue(struct lr_info *info)
+{
+	struct lr_worker *wk;
+	struct lr_work *work;
+	unsigned long hash = 5381;
+	const char *c;
+
+	work = calloc(1, sizeof(*work));
+	if (!work)
+		return -ENOMEM;
+
+	work->lw_recno = info->recno;
+	work->lw_type = info->type;
+	snprintf(work->lw_tfid, sizeof(work->lw_tfid), "%s", info->tfid);
+	snprintf(work->lw_pfid, sizeof(work->lw_pfid), "%s", info->pfid);
+	snprintf(work->lw_name, sizeof(work->lw_name), "%s", info->name);
+
+	for (c = info->tfid; *c != '\0'; c++)
+		hash = hash * 33 + *c;
+	wk = &lr_workers[hash % lr_threads];
+
+	pthread_mutex_lock(&lr_pool_lock);
+	if (wk->lwk_tail)
+		wk->lwk_tail->lw_next = work;
+	else
+		wk->lwk_head = work;
+	wk->lwk_tail = work;
+	lr_pool_busy++;
+	pthread_cond_broadcast(&lr_pool_work);
+	pthread_mutex_unlock(&lr_pool_lock);
+
+	return 0;
+}
+
+void lr_pool_fini(void)
+{
+	int i;
+
+	if (!lr_workers)
+		return;
+
+	pthread_mutex_lock(&lr_pool_lock);
+	lr_pool_stop = 1;
+	pthread_cond_broadcast(&lr_pool_work);
+	pthread_mutex_unlock(&lr_pool_lock);
+
+	for (i = 0; i < lr_threads; i++) {
+		struct lr_worker *wk = &lr_workers[i];
+
+		if (wk->lwk_thread)
+			pthread_join(wk->lwk_thread, NULL);
+		if (wk->lwk_info) {
+			free(wk->lwk_info->buf);
+			free(wk->lwk_info->xlist);
+			free(wk->lwk_info->xvalue);
+			free(wk->lwk_info);
+		}
+		if (verbose > 1)
+			printf("Replay thread %d: %lld records\n", i,
+			       wk->lwk_done);
+	}
+
+	free(lr_workers);
+	lr_workers = NULL;
+}
+
+int lr_pool_init(void)
+{
+	int rc;
+	int i;
+
+	if (lr_threads <= 1)
+		return 0;
+
+	lr_workers = calloc(lr_threads, sizeof(*lr_workers));
+	if (!lr_workers)
+		return -ENOMEM;
+
+	for (i = 0; i < lr_threads; i++) {
+		struct lr_worker *wk = &lr_workers[i];
+
+		wk->lwk_info = calloc(1, sizeof(struct lr_info));
+		if (!wk->lwk_info) {
+			rc = -ENOMEM;
+			goto out_fini;
+		}
+
+		rc = pthread_create(&wk->lwk_thread, NULL, lr_worker_main, wk);
+		if (rc) {
+			wk->lwk_thread = 0;
+			rc = -rc;
+			goto out_fini;
+		}
+	}
+
+	return 0;
+
+out_fini:
+	fprintf(stderr, "Error starting replay threads: %s\n", strerror(-rc));
+	lr_pool_fini();
+	return rc;
+}
+
 /* Replicate filesystem operations from src_path to target_path */
 int lr_replicate(void)
 {
@@ -1619,6 +1916,10 @@ int lr_replicate(void)
 		goto out;
 	}
 
+	rc = lr_pool_init();
+	if (rc < 0)
+		goto out;
+
 	while (!quit && lr_parse_line(changelog_priv, info) == 0) {
 		rc = 0;
 
@@ -1645,62 +1946,20 @@ int lr_replicate(void)
 		if (dryrun)
 			continue;
 
-		lr_debug(DTRACE, "***** Start %lld %s (%d) %s %s %s *****\n",
-			 info->recno, changelog_type2str(info->type),
-			 info->type, info->tfid, info->pfid, info->name);
-
-		switch (info->type) {
-		case CL_CREATE:
-		case CL_MKDIR:
-		case CL_MKNOD:
-		case CL_SOFTLINK:
-			rc = lr_create(info);
-			break;
-		case CL_RMDIR:
-		case CL_UNLINK:
-			rc = lr_remove(info);
-			break;
-		case CL_RENAME:
-			rc = lr_move(info);
-			break;
-		case CL_HARDLINK:
-			rc = lr_link(info);
-			break;
-		case CL_TRUNC:
-		case CL_SETATTR:
-			rc = lr_setattr(info);
-			break;
-		case CL_SETXATTR:
-			rc = lr_setxattr(info);
-			break;
-		case CL_CLOSE:
-		case CL_EXT:
-		case CL_OPEN:
-		case CL_GETXATTR:
-		case CL_DN_OPEN:
-		case CL_LAYOUT:
-		case CL_MARK:
-			/*
-			 * Nothing needs to be done for these entries
-			 * fallthrough
-			 */
-		default:
-			break;
+		if (lr_workers && lr_is_parallel(info->type)) {
+			rc = lr_pool_queue(info);
+		} else {
+			/* Namespace changes wait for earlier records */
+			lr_pool_drain();
+			rc = lr_replay(info);
 		}
 
-		lr_debug(DTRACE, "##### End %lld %s (%d) %s %s %s rc=%d #####\n",
-			 info->recno, changelog_type2str(info->type),
-			 info->type, info->tfid, info->pfid, info->name, rc);
-
-		if (rc && rc != -ENOENT) {
-			lr_print_failure(info, rc);
-			errors++;
-			if (abort_on_err)
-				break;
-		}
+		if (rc && rc != -ENOENT && abort_on_err)
+			break;
 		lr_clear_cl(info, 0);
 	}
 
+	lr_pool_drain();
 	llapi_changelog_fini(&changelog_priv);
 
 	if (errors || verbose)
@@ -1712,11 +1971,15 @@ int lr_replicate(void)
 	if (verbose) {
 		printf("lustre_rsync took %ld seconds\n", time(NULL) - start);
 		printf("Changelog records consumed: %lld\n", rec_count);
+		if (lr_workers)
+			printf("Records replayed in parallel: %lld\n",
+			       lr_parallel_count);
 	}
 
 	rc = 0;
 
 out:
+	lr_pool_fini();
 	if (info)
 		free(info);
 	if (ext)
@@ -1742,7 +2005,7 @@ int main(int argc, char *argv[])
 	if ((rc = lr_init_status()) != 0)
 		return rc;
 
-	while ((rc = getopt_long(argc, argv, "as:t:m:u:l:vx:zc:ry:n:d:D:",
+	while ((rc = getopt_long(argc, argv, "as:t:T:m:u:l:vx:zc:ry:n:d:D:",
 				 long_opts, NULL)) >= 0) {
 		switch (rc) {
 		case 'a':
@@ -1777,6 +2040,15 @@ int main(int argc, char *argv[])
 			snprintf(status->ls_targets[status->ls_num_targets - 1],
 				 sizeof(status->ls_targets[0]), "%s", optarg);
 			break;
+		case 'T':
+			lr_threads = atoi(optarg);
+			if (lr_threads < 1) {
+				fprintf(stderr,
+					"error: invalid thread count '%s'\n",
+					optarg);
+				return -1;
+			}
+			break;
 		case 'm':
 			snprintf(status->ls_mdt_device,
 				 sizeof(status->ls_mdt_device),
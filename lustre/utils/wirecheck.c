@@ -624,6 +624,7 @@ check_obd_connect_data(void)
 	CHECK_DEFINE_64X(OBD_CONNECT2_ASYNC_DISCARD);
 	CHECK_DEFINE_64X(OBD_CONNECT2_ENCRYPT);
 	CHECK_DEFINE_64X(OBD_CONNECT2_FIDMAP);
+	CHECK_DEFINE_64X(OBD_CONNECT2_OUT_BATCH);
 
 	CHECK_VALUE_X(OBD_CKSUM_CRC32);
 	CHECK_VALUE_X(OBD_CKSUM_ADLER);
@@ -2000,7 +2001,8 @@ check_quota_body(void)
 	CHECK_MEMBER(quota_body, qb_slv_ver);
 	CHECK_MEMBER(quota_body, qb_lockh);
 	CHECK_MEMBER(quota_body, qb_glb_lockh);
-	CHECK_MEMBER(quota_body, qb_padding1[4]);
+	CHECK_MEMBER(quota_body, qb_demand);
+	CHECK_MEMBER(quota_body, qb_padding1[3]);
 }
 
 static void